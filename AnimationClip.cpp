@@ -0,0 +1,455 @@
+#include "AnimationClip.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ANIMATION_CLIP_USE_SSE2
+#endif
+
+namespace {
+
+// 最大成分を省いた残りの成分が取りうる範囲(±1/√2)
+const float kRotationRange = 0.70710678f;
+const float kRotationQuantizeMax = 32767.0f;
+const float kVectorQuantizeMax = 65535.0f;
+
+uint32_t AlignUp4(uint32_t value) { return (value + 3) & ~3u; }
+
+void Lerp3(const float a[3], const float b[3], float t, float out[3]) {
+	for (uint32_t i = 0; i < 3; ++i) {
+		out[i] = a[i] + (b[i] - a[i]) * t;
+	}
+}
+
+// 正規化線形補間。向きが逆の四元数は符号をそろえてから補間する(AnimationPose::Blendと同じ順序で計算する)
+void Nlerp(const float a[4], const float b[4], float t, float out[4]) {
+	float dot = ((a[0] * b[0] + a[1] * b[1]) + a[2] * b[2]) + a[3] * b[3];
+	float weightB = dot < 0.0f ? -t : t;
+	float weightA = 1.0f - t;
+	for (uint32_t i = 0; i < 4; ++i) {
+		out[i] = a[i] * weightA + b[i] * weightB;
+	}
+	float length = std::sqrt(((out[0] * out[0] + out[1] * out[1]) + out[2] * out[2]) + out[3] * out[3]);
+	for (uint32_t i = 0; i < 4; ++i) {
+		out[i] = out[i] / length;
+	}
+}
+
+// 符号をそろえたうえでの成分ごとの最大誤差(qと-qは同じ回転)
+float RotationError(const float a[4], const float b[4]) {
+	float sign = (a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]) < 0.0f ? -1.0f : 1.0f;
+	float error = 0.0f;
+	for (uint32_t i = 0; i < 4; ++i) {
+		error = std::max(error, std::abs(a[i] - b[i] * sign));
+	}
+	return error;
+}
+
+float VectorError(const float a[3], const float b[3]) {
+	return std::max(std::max(std::abs(a[0] - b[0]), std::abs(a[1] - b[1])), std::abs(a[2] - b[2]));
+}
+
+void EncodeRotation(const float rotation[4], uint16_t out[3]) {
+	uint32_t largest = 0;
+	for (uint32_t i = 1; i < 4; ++i) {
+		if (std::abs(rotation[i]) > std::abs(rotation[largest])) {
+			largest = i;
+		}
+	}
+	// 省く成分は常に正にしておけば、復元時は平方根の正の側を取ればよい
+	float sign = rotation[largest] < 0.0f ? -1.0f : 1.0f;
+	uint64_t bits = largest;
+	uint32_t shift = 2;
+	for (uint32_t i = 0; i < 4; ++i) {
+		if (i == largest) {
+			continue;
+		}
+		float normalized = std::clamp((rotation[i] * sign / kRotationRange) * 0.5f + 0.5f, 0.0f, 1.0f);
+		bits |= static_cast<uint64_t>(std::lround(normalized * kRotationQuantizeMax)) << shift;
+		shift += 15;
+	}
+	out[0] = static_cast<uint16_t>(bits);
+	out[1] = static_cast<uint16_t>(bits >> 16);
+	out[2] = static_cast<uint16_t>(bits >> 32);
+}
+
+void DecodeRotationBits(const uint16_t in[3], float out[4]) {
+	uint64_t bits = static_cast<uint64_t>(in[0]) | (static_cast<uint64_t>(in[1]) << 16) | (static_cast<uint64_t>(in[2]) << 32);
+	uint32_t largest = static_cast<uint32_t>(bits & 3);
+	uint32_t shift = 2;
+	float sumSq = 0.0f;
+	for (uint32_t i = 0; i < 4; ++i) {
+		if (i == largest) {
+			continue;
+		}
+		float normalized = static_cast<float>((bits >> shift) & 0x7fff) / kRotationQuantizeMax;
+		out[i] = (normalized * 2.0f - 1.0f) * kRotationRange;
+		sumSq += out[i] * out[i];
+		shift += 15;
+	}
+	out[largest] = std::sqrt(std::max(1.0f - sumSq, 0.0f));
+}
+
+/// <summary>
+/// 誤差内で直線補間できるキーを間引き、残すフレーム番号を返す
+/// </summary>
+/// <param name="frameCount">フレーム数</param>
+/// <param name="isConstant">全フレームを先頭のキー1つで表せるか</param>
+/// <param name="fits">キーk・jの間を補間したとき途中のフレームが誤差内に収まるか</param>
+template <typename FitsFunction>
+std::vector<uint32_t> ReduceKeys(uint32_t frameCount, bool isConstant, FitsFunction fits) {
+	std::vector<uint32_t> keys = { 0 };
+	if (isConstant) {
+		return keys;
+	}
+	// 前のキーから届く限り先まで伸ばす
+	uint32_t key = 0;
+	while (key < frameCount - 1) {
+		uint32_t next = key + 1;
+		while (next + 1 < frameCount && fits(key, next + 1)) {
+			++next;
+		}
+		keys.push_back(next);
+		key = next;
+	}
+	return keys;
+}
+
+} // namespace
+
+/*///////////////////////
+	AnimationPose
+*////////////////////////
+void AnimationPose::Resize(uint32_t count) {
+	if (count == jointCount && !translationX.empty()) {
+		return;
+	}
+	jointCount = count;
+	// 余りの関節は単位変換にしておけば、4つずつの計算にそのまま混ぜられる
+	const size_t padded = AlignUp4(count);
+	for (std::vector<float>* component : { &translationX, &translationY, &translationZ, &rotationX, &rotationY, &rotationZ }) {
+		component->assign(padded, 0.0f);
+	}
+	for (std::vector<float>* component : { &rotationW, &scaleX, &scaleY, &scaleZ }) {
+		component->assign(padded, 1.0f);
+	}
+}
+
+void AnimationPose::SetJoint(uint32_t joint, const JointTransform& transform) {
+	translationX[joint] = transform.translation[0];
+	translationY[joint] = transform.translation[1];
+	translationZ[joint] = transform.translation[2];
+	rotationX[joint] = transform.rotation[0];
+	rotationY[joint] = transform.rotation[1];
+	rotationZ[joint] = transform.rotation[2];
+	rotationW[joint] = transform.rotation[3];
+	scaleX[joint] = transform.scale[0];
+	scaleY[joint] = transform.scale[1];
+	scaleZ[joint] = transform.scale[2];
+}
+
+JointTransform AnimationPose::GetJoint(uint32_t joint) const {
+	return {
+		{ translationX[joint], translationY[joint], translationZ[joint] },
+		{ rotationX[joint], rotationY[joint], rotationZ[joint], rotationW[joint] },
+		{ scaleX[joint], scaleY[joint], scaleZ[joint] },
+	};
+}
+
+void AnimationPose::Blend(const AnimationPose& a, const AnimationPose& b, float weight, AnimationPose& out) {
+	assert(a.jointCount == b.jointCount);
+	out.Resize(a.jointCount);
+	const uint32_t padded = AlignUp4(a.jointCount);
+
+#ifdef ANIMATION_CLIP_USE_SSE2
+	const __m128 t = _mm_set1_ps(weight);
+	const __m128 weightA = _mm_set1_ps(1.0f - weight);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	auto lerp = [&](const std::vector<float>& from, const std::vector<float>& to, std::vector<float>& result, uint32_t i) {
+		__m128 va = _mm_loadu_ps(&from[i]);
+		_mm_storeu_ps(&result[i], _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&to[i]), va), t)));
+	};
+	for (uint32_t i = 0; i < padded; i += 4) {
+		lerp(a.translationX, b.translationX, out.translationX, i);
+		lerp(a.translationY, b.translationY, out.translationY, i);
+		lerp(a.translationZ, b.translationZ, out.translationZ, i);
+		lerp(a.scaleX, b.scaleX, out.scaleX, i);
+		lerp(a.scaleY, b.scaleY, out.scaleY, i);
+		lerp(a.scaleZ, b.scaleZ, out.scaleZ, i);
+
+		__m128 ax = _mm_loadu_ps(&a.rotationX[i]), ay = _mm_loadu_ps(&a.rotationY[i]);
+		__m128 az = _mm_loadu_ps(&a.rotationZ[i]), aw = _mm_loadu_ps(&a.rotationW[i]);
+		__m128 bx = _mm_loadu_ps(&b.rotationX[i]), by = _mm_loadu_ps(&b.rotationY[i]);
+		__m128 bz = _mm_loadu_ps(&b.rotationZ[i]), bw = _mm_loadu_ps(&b.rotationW[i]);
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz)), _mm_mul_ps(aw, bw));
+		// 内積が負なら重みの符号を反転する
+		__m128 weightB = _mm_xor_ps(t, _mm_and_ps(_mm_cmplt_ps(dot, zero), signBit));
+		__m128 x = _mm_add_ps(_mm_mul_ps(ax, weightA), _mm_mul_ps(bx, weightB));
+		__m128 y = _mm_add_ps(_mm_mul_ps(ay, weightA), _mm_mul_ps(by, weightB));
+		__m128 z = _mm_add_ps(_mm_mul_ps(az, weightA), _mm_mul_ps(bz, weightB));
+		__m128 w = _mm_add_ps(_mm_mul_ps(aw, weightA), _mm_mul_ps(bw, weightB));
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w)));
+		_mm_storeu_ps(&out.rotationX[i], _mm_div_ps(x, length));
+		_mm_storeu_ps(&out.rotationY[i], _mm_div_ps(y, length));
+		_mm_storeu_ps(&out.rotationZ[i], _mm_div_ps(z, length));
+		_mm_storeu_ps(&out.rotationW[i], _mm_div_ps(w, length));
+	}
+#else
+	for (uint32_t i = 0; i < padded; ++i) {
+		JointTransform ja = a.GetJoint(i);
+		JointTransform jb = b.GetJoint(i);
+		JointTransform result{};
+		Lerp3(ja.translation, jb.translation, weight, result.translation);
+		Lerp3(ja.scale, jb.scale, weight, result.scale);
+		Nlerp(ja.rotation, jb.rotation, weight, result.rotation);
+		out.SetJoint(i, result);
+	}
+#endif
+}
+
+/*///////////////////////
+	AnimationClip
+*////////////////////////
+void AnimationClip::Initialize(uint32_t jointCount, uint32_t frameCount, float sampleRate) {
+	assert(jointCount > 0 && frameCount >= 2 && sampleRate > 0.0f);
+	jointCount_ = jointCount;
+	frameCount_ = frameCount;
+	sampleRate_ = sampleRate;
+	keys_.assign(static_cast<size_t>(jointCount) * frameCount, JointTransform{ { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f } });
+}
+
+void AnimationClip::Sample(float time, AnimationPose& outPose) const {
+	outPose.Resize(jointCount_);
+	const float duration = GetDuration();
+	time = std::fmod(time, duration);
+	if (time < 0.0f) {
+		time += duration;
+	}
+	const float frame = time * sampleRate_;
+	const uint32_t frame0 = std::min(static_cast<uint32_t>(frame), frameCount_ - 2);
+	const float t = frame - static_cast<float>(frame0);
+
+	for (uint32_t joint = 0; joint < jointCount_; ++joint) {
+		const JointTransform& a = GetKey(frame0, joint);
+		const JointTransform& b = GetKey(frame0 + 1, joint);
+		JointTransform result{};
+		Lerp3(a.translation, b.translation, t, result.translation);
+		Nlerp(a.rotation, b.rotation, t, result.rotation);
+		Lerp3(a.scale, b.scale, t, result.scale);
+		outPose.SetJoint(joint, result);
+	}
+}
+
+/*///////////////////////
+	CompressedClip
+*////////////////////////
+void CompressedClip::Compress(const AnimationClip& clip, const ClipCompressionSettings& settings) {
+	// キーのフレーム番号は16ビットで持つ
+	assert(clip.GetFrameCount() <= 65536);
+	jointCount_ = clip.GetJointCount();
+	frameCount_ = clip.GetFrameCount();
+	sampleRate_ = clip.GetSampleRate();
+
+	translationTracks_.resize(jointCount_);
+	rotationTracks_.resize(jointCount_);
+	scaleTracks_.resize(jointCount_);
+	keyFrames_.clear();
+	vectorKeys_.clear();
+	rotationKeys_.clear();
+
+	for (uint32_t joint = 0; joint < jointCount_; ++joint) {
+		CompressVectorTrack(clip, joint, false, settings.translationTolerance, translationTracks_[joint]);
+		CompressRotationTrack(clip, joint, settings.rotationTolerance, rotationTracks_[joint]);
+		CompressVectorTrack(clip, joint, true, settings.scaleTolerance, scaleTracks_[joint]);
+	}
+	keyFrames_.shrink_to_fit();
+	vectorKeys_.shrink_to_fit();
+	rotationKeys_.shrink_to_fit();
+}
+
+void CompressedClip::Sample(float time, AnimationPose& outPose) const {
+	outPose.Resize(jointCount_);
+	const float duration = GetDuration();
+	time = std::fmod(time, duration);
+	if (time < 0.0f) {
+		time += duration;
+	}
+	const float frame = time * sampleRate_;
+
+	float t = 0.0f;
+	float a[4];
+	float b[4];
+	float value[4];
+	for (uint32_t joint = 0; joint < jointCount_; ++joint) {
+		const VectorTrack& translationTrack = translationTracks_[joint];
+		uint32_t key = FindKey(translationTrack, frame, t);
+		DecodeVector(translationTrack, key, a);
+		if (translationTrack.keyCount > 1) {
+			DecodeVector(translationTrack, key + 1, b);
+			Lerp3(a, b, t, value);
+		} else {
+			std::copy(a, a + 3, value);
+		}
+		outPose.translationX[joint] = value[0];
+		outPose.translationY[joint] = value[1];
+		outPose.translationZ[joint] = value[2];
+
+		const Track& rotationTrack = rotationTracks_[joint];
+		key = FindKey(rotationTrack, frame, t);
+		DecodeRotation(rotationTrack, key, a);
+		if (rotationTrack.keyCount > 1) {
+			DecodeRotation(rotationTrack, key + 1, b);
+			Nlerp(a, b, t, value);
+		} else {
+			std::copy(a, a + 4, value);
+		}
+		outPose.rotationX[joint] = value[0];
+		outPose.rotationY[joint] = value[1];
+		outPose.rotationZ[joint] = value[2];
+		outPose.rotationW[joint] = value[3];
+
+		const VectorTrack& scaleTrack = scaleTracks_[joint];
+		key = FindKey(scaleTrack, frame, t);
+		DecodeVector(scaleTrack, key, a);
+		if (scaleTrack.keyCount > 1) {
+			DecodeVector(scaleTrack, key + 1, b);
+			Lerp3(a, b, t, value);
+		} else {
+			std::copy(a, a + 3, value);
+		}
+		outPose.scaleX[joint] = value[0];
+		outPose.scaleY[joint] = value[1];
+		outPose.scaleZ[joint] = value[2];
+	}
+}
+
+size_t CompressedClip::GetSizeInBytes() const {
+	return sizeof(*this)
+		+ sizeof(VectorTrack) * (translationTracks_.size() + scaleTracks_.size())
+		+ sizeof(Track) * rotationTracks_.size()
+		+ sizeof(uint16_t) * (keyFrames_.size() + vectorKeys_.size() + rotationKeys_.size());
+}
+
+void CompressedClip::CompressVectorTrack(const AnimationClip& clip, uint32_t joint, bool isScale, float tolerance, VectorTrack& outTrack) {
+	auto source = [&](uint32_t frame) {
+		const JointTransform& key = clip.GetKey(frame, joint);
+		return isScale ? key.scale : key.translation;
+	};
+
+	// トラック内の範囲で量子化する
+	for (uint32_t axis = 0; axis < 3; ++axis) {
+		float minimum = source(0)[axis];
+		float maximum = minimum;
+		for (uint32_t frame = 1; frame < frameCount_; ++frame) {
+			minimum = std::min(minimum, source(frame)[axis]);
+			maximum = std::max(maximum, source(frame)[axis]);
+		}
+		outTrack.minimum[axis] = minimum;
+		outTrack.extent[axis] = maximum - minimum;
+	}
+	std::vector<uint16_t> quantized(static_cast<size_t>(frameCount_) * 3);
+	std::vector<float> decoded(static_cast<size_t>(frameCount_) * 3);
+	bool isConstant = true;
+	for (uint32_t frame = 0; frame < frameCount_; ++frame) {
+		for (uint32_t axis = 0; axis < 3; ++axis) {
+			float extent = outTrack.extent[axis];
+			float normalized = extent > 0.0f ? (source(frame)[axis] - outTrack.minimum[axis]) / extent : 0.0f;
+			uint16_t value = static_cast<uint16_t>(std::lround(std::clamp(normalized, 0.0f, 1.0f) * kVectorQuantizeMax));
+			quantized[frame * 3 + axis] = value;
+			decoded[frame * 3 + axis] = outTrack.minimum[axis] + static_cast<float>(value) * (extent / kVectorQuantizeMax);
+		}
+		isConstant = isConstant && VectorError(&decoded[0], source(frame)) <= tolerance;
+	}
+
+	std::vector<uint32_t> keys = ReduceKeys(frameCount_, isConstant, [&](uint32_t key0, uint32_t key1) {
+		float value[3];
+		for (uint32_t frame = key0 + 1; frame < key1; ++frame) {
+			float t = static_cast<float>(frame - key0) / static_cast<float>(key1 - key0);
+			Lerp3(&decoded[key0 * 3], &decoded[key1 * 3], t, value);
+			if (VectorError(value, source(frame)) > tolerance) {
+				return false;
+			}
+		}
+		return true;
+	});
+
+	outTrack.keyOffset = static_cast<uint32_t>(keyFrames_.size());
+	outTrack.valueOffset = static_cast<uint32_t>(vectorKeys_.size() / 3);
+	outTrack.keyCount = static_cast<uint32_t>(keys.size());
+	for (uint32_t frame : keys) {
+		keyFrames_.push_back(static_cast<uint16_t>(frame));
+		vectorKeys_.insert(vectorKeys_.end(), &quantized[frame * 3], &quantized[frame * 3] + 3);
+	}
+}
+
+void CompressedClip::CompressRotationTrack(const AnimationClip& clip, uint32_t joint, float tolerance, Track& outTrack) {
+	std::vector<uint16_t> quantized(static_cast<size_t>(frameCount_) * 3);
+	std::vector<float> decoded(static_cast<size_t>(frameCount_) * 4);
+	bool isConstant = true;
+	for (uint32_t frame = 0; frame < frameCount_; ++frame) {
+		EncodeRotation(clip.GetKey(frame, joint).rotation, &quantized[frame * 3]);
+		DecodeRotationBits(&quantized[frame * 3], &decoded[frame * 4]);
+		isConstant = isConstant && RotationError(&decoded[0], clip.GetKey(frame, joint).rotation) <= tolerance;
+	}
+
+	std::vector<uint32_t> keys = ReduceKeys(frameCount_, isConstant, [&](uint32_t key0, uint32_t key1) {
+		float value[4];
+		float expected[4];
+		for (uint32_t frame = key0; frame < key1; ++frame) {
+			if (frame > key0) {
+				float t = static_cast<float>(frame - key0) / static_cast<float>(key1 - key0);
+				Nlerp(&decoded[key0 * 4], &decoded[key1 * 4], t, value);
+				if (RotationError(value, clip.GetKey(frame, joint).rotation) > tolerance) {
+					return false;
+				}
+			}
+			// フレームの間も確かめる(正規化線形補間は間隔が広いほど途中の角速度が偏るので、フレーム上で合っていても間でずれる)
+			float t = (static_cast<float>(frame - key0) + 0.5f) / static_cast<float>(key1 - key0);
+			Nlerp(&decoded[key0 * 4], &decoded[key1 * 4], t, value);
+			Nlerp(clip.GetKey(frame, joint).rotation, clip.GetKey(frame + 1, joint).rotation, 0.5f, expected);
+			if (RotationError(value, expected) > tolerance) {
+				return false;
+			}
+		}
+		return true;
+	});
+
+	outTrack.keyOffset = static_cast<uint32_t>(keyFrames_.size());
+	outTrack.valueOffset = static_cast<uint32_t>(rotationKeys_.size() / 3);
+	outTrack.keyCount = static_cast<uint32_t>(keys.size());
+	for (uint32_t frame : keys) {
+		keyFrames_.push_back(static_cast<uint16_t>(frame));
+		rotationKeys_.insert(rotationKeys_.end(), &quantized[frame * 3], &quantized[frame * 3] + 3);
+	}
+}
+
+uint32_t CompressedClip::FindKey(const Track& track, float frame, float& outT) const {
+	if (track.keyCount == 1) {
+		outT = 0.0f;
+		return 0;
+	}
+	const uint16_t* frames = &keyFrames_[track.keyOffset];
+	// frame以下で最後のキー(最後のキーは補間の終わりにしか使わない)
+	const uint16_t* next = std::upper_bound(frames + 1, frames + track.keyCount - 1, frame,
+		[](float value, uint16_t keyFrame) { return value < static_cast<float>(keyFrame); });
+	const uint32_t key = static_cast<uint32_t>(next - frames) - 1;
+	const float frame0 = static_cast<float>(frames[key]);
+	const float frame1 = static_cast<float>(frames[key + 1]);
+	outT = std::clamp((frame - frame0) / (frame1 - frame0), 0.0f, 1.0f);
+	return key;
+}
+
+void CompressedClip::DecodeVector(const VectorTrack& track, uint32_t key, float outValue[3]) const {
+	const uint16_t* quantized = &vectorKeys_[static_cast<size_t>(track.valueOffset + key) * 3];
+	for (uint32_t axis = 0; axis < 3; ++axis) {
+		outValue[axis] = track.minimum[axis] + static_cast<float>(quantized[axis]) * (track.extent[axis] / kVectorQuantizeMax);
+	}
+}
+
+void CompressedClip::DecodeRotation(const Track& track, uint32_t key, float outValue[4]) const {
+	DecodeRotationBits(&rotationKeys_[static_cast<size_t>(track.valueOffset + key) * 3], outValue);
+}
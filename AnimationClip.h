@@ -0,0 +1,147 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// 関節のローカル変換(親関節からの相対)
+/// </summary>
+struct JointTransform {
+	float translation[3];
+	float rotation[4]; // 四元数(x, y, z, w)
+	float scale[3];
+};
+
+/// <summary>
+/// 全関節のポーズ。SIMDで4関節ずつ処理できるよう成分ごとに並べ、4の倍数まで単位変換で埋める
+/// </summary>
+struct AnimationPose {
+	std::vector<float> translationX;
+	std::vector<float> translationY;
+	std::vector<float> translationZ;
+	std::vector<float> rotationX;
+	std::vector<float> rotationY;
+	std::vector<float> rotationZ;
+	std::vector<float> rotationW;
+	std::vector<float> scaleX;
+	std::vector<float> scaleY;
+	std::vector<float> scaleZ;
+	uint32_t jointCount = 0;
+
+	void Resize(uint32_t count);
+	void SetJoint(uint32_t joint, const JointTransform& transform);
+	JointTransform GetJoint(uint32_t joint) const;
+
+	/// <summary>
+	/// 2つのポーズを補間する(移動・拡縮は線形、回転は正規化線形補間)
+	/// </summary>
+	/// <param name="weight">0でa、1でb</param>
+	static void Blend(const AnimationPose& a, const AnimationPose& b, float weight, AnimationPose& out);
+};
+
+/// <summary>
+/// 非圧縮のアニメーションクリップ(一定間隔の全関節のキー)。圧縮の入力と精度確認の基準に使う
+/// </summary>
+class AnimationClip {
+public: // メンバ関数
+	/// <summary>
+	/// 初期化。キーは単位変換で埋める
+	/// </summary>
+	/// <param name="jointCount">関節数</param>
+	/// <param name="frameCount">キーの数(2以上)</param>
+	/// <param name="sampleRate">1秒あたりのキーの数</param>
+	void Initialize(uint32_t jointCount, uint32_t frameCount, float sampleRate);
+
+	JointTransform& GetKey(uint32_t frame, uint32_t joint) { return keys_[static_cast<size_t>(frame) * jointCount_ + joint]; }
+	const JointTransform& GetKey(uint32_t frame, uint32_t joint) const { return keys_[static_cast<size_t>(frame) * jointCount_ + joint]; }
+
+	/// <summary>
+	/// 指定時刻のポーズを求める(ループ再生)
+	/// </summary>
+	void Sample(float time, AnimationPose& outPose) const;
+
+	uint32_t GetJointCount() const { return jointCount_; }
+	uint32_t GetFrameCount() const { return frameCount_; }
+	float GetSampleRate() const { return sampleRate_; }
+	float GetDuration() const { return static_cast<float>(frameCount_ - 1) / sampleRate_; }
+	size_t GetSizeInBytes() const { return sizeof(JointTransform) * keys_.size(); }
+
+private: // メンバ変数
+	std::vector<JointTransform> keys_; // フレーム×関節
+	uint32_t jointCount_ = 0;
+	uint32_t frameCount_ = 0;
+	float sampleRate_ = 30.0f;
+};
+
+/// <summary>
+/// 圧縮の許容誤差
+/// </summary>
+struct ClipCompressionSettings {
+	float translationTolerance = 0.0005f; // 移動(長さの単位)
+	float rotationTolerance = 0.0005f;    // 四元数の各成分
+	float scaleTolerance = 0.0005f;
+};
+
+/// <summary>
+/// 圧縮したアニメーションクリップ。
+/// 関節・成分(移動・回転・拡縮)ごとのトラックについて、直線補間で再現できるキーを誤差内で間引き、
+/// 残したキーを量子化して持つ(移動・拡縮はトラックの範囲で16ビット、回転は最大成分を省いた3成分を15ビット)
+/// </summary>
+class CompressedClip {
+public: // メンバ関数
+	/// <summary>
+	/// 非圧縮のクリップから作る
+	/// </summary>
+	void Compress(const AnimationClip& clip, const ClipCompressionSettings& settings = ClipCompressionSettings());
+
+	/// <summary>
+	/// 指定時刻のポーズを求める(ループ再生)
+	/// </summary>
+	void Sample(float time, AnimationPose& outPose) const;
+
+	uint32_t GetJointCount() const { return jointCount_; }
+	float GetDuration() const { return static_cast<float>(frameCount_ - 1) / sampleRate_; }
+	size_t GetKeyCount() const { return keyFrames_.size(); }
+	size_t GetSizeInBytes() const;
+
+private: // サブクラス
+	// トラックのキーはkeyFrames_[keyOffset]からと、値の配列の[valueOffset]から(3要素ずつ)のkeyCount個
+	struct Track {
+		uint32_t keyOffset;
+		uint32_t valueOffset;
+		uint32_t keyCount;
+	};
+
+	// 移動・拡縮のトラック。キーは[minimum, minimum + extent]を16ビットに量子化する
+	struct VectorTrack : Track {
+		float minimum[3];
+		float extent[3];
+	};
+
+private: // メンバ関数
+	void CompressVectorTrack(const AnimationClip& clip, uint32_t joint, bool isScale, float tolerance, VectorTrack& outTrack);
+	void CompressRotationTrack(const AnimationClip& clip, uint32_t joint, float tolerance, Track& outTrack);
+
+	/// <summary>
+	/// トラックのキーのうちframeを挟む2つを探す
+	/// </summary>
+	/// <returns>前のキーの番号(トラック内)。補間の割合はoutTに入る</returns>
+	uint32_t FindKey(const Track& track, float frame, float& outT) const;
+
+	void DecodeVector(const VectorTrack& track, uint32_t key, float outValue[3]) const;
+	void DecodeRotation(const Track& track, uint32_t key, float outValue[4]) const;
+
+private: // メンバ変数
+	// トラックは関節の順
+	std::vector<VectorTrack> translationTracks_;
+	std::vector<Track> rotationTracks_;
+	std::vector<VectorTrack> scaleTracks_;
+
+	std::vector<uint16_t> keyFrames_;    // キーのフレーム番号(全トラック分)
+	std::vector<uint16_t> vectorKeys_;   // 移動・拡縮のキー(16ビット×3成分)
+	std::vector<uint16_t> rotationKeys_; // 回転のキー(48ビット)
+
+	uint32_t jointCount_ = 0;
+	uint32_t frameCount_ = 0;
+	float sampleRate_ = 30.0f;
+};
@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "BenchmarkReport.h"
+#include "BenchmarkScene.h"
+#include "BenchmarkSuite.h"
+
+/*///////////////////////
+	確保の計測
+	(このプログラムのnew/deleteをすべて数える)
+*////////////////////////
+namespace {
+
+BenchmarkAllocationCounters allocationCounters;
+
+void* CountedAllocate(size_t size) {
+	allocationCounters.count.fetch_add(1, std::memory_order_relaxed);
+	allocationCounters.bytes.fetch_add(size, std::memory_order_relaxed);
+	void* pointer = std::malloc(size == 0 ? 1 : size);
+	if (pointer == nullptr) {
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void* CountedAllocateAligned(size_t size, size_t alignment) {
+	allocationCounters.count.fetch_add(1, std::memory_order_relaxed);
+	allocationCounters.bytes.fetch_add(size, std::memory_order_relaxed);
+	size = size == 0 ? alignment : (size + alignment - 1) / alignment * alignment;
+#ifdef _MSC_VER
+	void* pointer = _aligned_malloc(size, alignment);
+#else
+	void* pointer = std::aligned_alloc(alignment, size);
+#endif
+	if (pointer == nullptr) {
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void FreeAligned(void* pointer) {
+#ifdef _MSC_VER
+	_aligned_free(pointer);
+#else
+	std::free(pointer);
+#endif
+}
+
+} // namespace
+
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return CountedAllocateAligned(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return CountedAllocateAligned(size, static_cast<size_t>(alignment)); }
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { FreeAligned(pointer); }
+
+namespace {
+
+void PrintUsage() {
+	std::printf(
+		"Usage:\n"
+		"  Benchmark [--scene NAME]... [--suite NAME]... [--frames N] [--repeat N] [--threads N] [--out FILE] [--summary-only]\n"
+		"  Benchmark --compare BASELINE CURRENT [--threshold RATIO]\n"
+		"  Benchmark --list\n"
+		"\n"
+		"  --scene         run only the named scene (repeatable, default: all unless --suite is given)\n"
+		"  --suite         run the named module benchmark (repeatable, \"all\" for every suite)\n"
+		"  --frames        override the frame count of every scene\n"
+		"  --repeat        override the repeat count of every suite\n"
+		"  --threads       worker threads (0 = hardware concurrency, default)\n"
+		"  --out           write the JSON report to FILE\n"
+		"  --summary-only  omit per-frame values from the report\n"
+		"  --compare       compare two reports and exit with 1 on regressions\n"
+		"  --threshold     allowed slowdown ratio (default 0.1 = 10%%)\n");
+}
+
+void PrintScene(const BenchmarkSceneResult& scene) {
+	std::printf("%s (%zu frames, %u threads)\n", scene.name.c_str(), scene.frames.size(), scene.threadCount);
+	std::printf("  %-14s %9s %9s %9s %9s\n", "stage", "median", "p95", "p99", "max");
+	for (size_t stage = 0; stage < scene.stageNames.size(); ++stage) {
+		const BenchmarkSceneResult::Summary& summary = scene.stageSummaries[stage];
+		std::printf("  %-14s %9.3f %9.3f %9.3f %9.3f\n", scene.stageNames[stage].c_str(), summary.median, summary.p95, summary.p99, summary.max);
+	}
+	const BenchmarkSceneResult::Summary& total = scene.totalSummary;
+	std::printf("  %-14s %9.3f %9.3f %9.3f %9.3f (ms)\n", "total", total.median, total.p95, total.p99, total.max);
+	std::printf("  per frame: %.1f allocations (%.0f bytes), %.1f draws, %.1f dispatches, %.0f instances, %.1f pipeline changes\n",
+		scene.allocationsPerFrame, scene.allocatedBytesPerFrame, scene.drawsPerFrame, scene.dispatchesPerFrame,
+		scene.instancesPerFrame, scene.pipelineChangesPerFrame);
+	for (const BenchmarkSceneResult::Metric& metric : scene.metrics) {
+		std::printf("  %s = %.6g\n", metric.name.c_str(), metric.value);
+	}
+}
+
+int Compare(const char* baselinePath, const char* currentPath, double threshold) {
+	BenchmarkReport baseline;
+	BenchmarkReport current;
+	if (!baseline.Read(baselinePath)) {
+		std::fprintf(stderr, "Failed to read %s\n", baselinePath);
+		return 2;
+	}
+	if (!current.Read(currentPath)) {
+		std::fprintf(stderr, "Failed to read %s\n", currentPath);
+		return 2;
+	}
+	std::vector<BenchmarkRegression> regressions;
+	if (BenchmarkReport::Compare(baseline, current, threshold, regressions)) {
+		std::printf("No regressions beyond %.1f%%\n", threshold * 100.0);
+		return 0;
+	}
+	for (const BenchmarkRegression& regression : regressions) {
+		std::printf("REGRESSION %s %s: %.4f -> %.4f (x%.2f)\n", regression.scene.c_str(), regression.metric.c_str(),
+			regression.baseline, regression.current, regression.ratio);
+	}
+	return 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	std::vector<std::string> sceneNames;
+	std::vector<std::string> suiteNames;
+	uint32_t frameCount = 0;
+	uint32_t repeatCount = 0;
+	uint32_t threadCount = 0;
+	const char* outputPath = nullptr;
+	bool includeFrames = true;
+	const char* comparePaths[2] = { nullptr, nullptr };
+	double threshold = 0.1;
+
+	for (int i = 1; i < argc; ++i) {
+		const char* argument = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (std::strcmp(argument, "--scene") == 0 && hasValue) {
+			sceneNames.push_back(argv[++i]);
+		} else if (std::strcmp(argument, "--suite") == 0 && hasValue) {
+			suiteNames.push_back(argv[++i]);
+		} else if (std::strcmp(argument, "--frames") == 0 && hasValue) {
+			frameCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argument, "--repeat") == 0 && hasValue) {
+			repeatCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argument, "--threads") == 0 && hasValue) {
+			threadCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argument, "--out") == 0 && hasValue) {
+			outputPath = argv[++i];
+		} else if (std::strcmp(argument, "--summary-only") == 0) {
+			includeFrames = false;
+		} else if (std::strcmp(argument, "--compare") == 0 && i + 2 < argc) {
+			comparePaths[0] = argv[++i];
+			comparePaths[1] = argv[++i];
+		} else if (std::strcmp(argument, "--threshold") == 0 && hasValue) {
+			threshold = std::strtod(argv[++i], nullptr);
+		} else if (std::strcmp(argument, "--list") == 0) {
+			for (const BenchmarkSceneDesc& desc : BenchmarkScene::GetBuiltInScenes()) {
+				std::printf("%s\n", desc.name.c_str());
+			}
+			for (const BenchmarkSuiteDesc& desc : BenchmarkSuite::GetBuiltInSuites()) {
+				std::printf("%s (suite)\n", desc.name.c_str());
+			}
+			return 0;
+		} else {
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	if (comparePaths[0]) {
+		return Compare(comparePaths[0], comparePaths[1], threshold);
+	}
+
+	// --suiteだけが指定されたときはシーンを実行しない
+	std::vector<BenchmarkSceneDesc> scenes;
+	if (!sceneNames.empty() || suiteNames.empty()) {
+		for (const BenchmarkSceneDesc& desc : BenchmarkScene::GetBuiltInScenes()) {
+			if (sceneNames.empty() || std::find(sceneNames.begin(), sceneNames.end(), desc.name) != sceneNames.end()) {
+				scenes.push_back(desc);
+			}
+		}
+		if (scenes.size() < std::max<size_t>(sceneNames.size(), 1)) {
+			std::fprintf(stderr, "Unknown scene name\n");
+			return 2;
+		}
+	}
+	const bool allSuites = std::find(suiteNames.begin(), suiteNames.end(), "all") != suiteNames.end();
+	std::vector<BenchmarkSuiteDesc> suites;
+	for (const BenchmarkSuiteDesc& desc : BenchmarkSuite::GetBuiltInSuites()) {
+		if (allSuites || std::find(suiteNames.begin(), suiteNames.end(), desc.name) != suiteNames.end()) {
+			suites.push_back(desc);
+		}
+	}
+	if (!allSuites && suites.size() < suiteNames.size()) {
+		std::fprintf(stderr, "Unknown suite name\n");
+		return 2;
+	}
+
+	BenchmarkReport report;
+	report.SetDescription(threadCount == 0 ? "threads=auto" : "threads=" + std::to_string(threadCount));
+	for (BenchmarkSceneDesc& desc : scenes) {
+		if (frameCount > 0) {
+			desc.frameCount = frameCount;
+		}
+		report.GetScenes().push_back(BenchmarkScene::Run(desc, threadCount, &allocationCounters));
+		PrintScene(report.GetScenes().back());
+	}
+	for (BenchmarkSuiteDesc& desc : suites) {
+		if (repeatCount > 0) {
+			desc.repeatCount = repeatCount;
+		}
+		report.GetScenes().push_back(BenchmarkSuite::Run(desc, threadCount, &allocationCounters));
+		PrintScene(report.GetScenes().back());
+	}
+
+	if (outputPath && !report.Write(outputPath, includeFrames)) {
+		std::fprintf(stderr, "Failed to write %s\n", outputPath);
+		return 2;
+	}
+	return 0;
+}
@@ -0,0 +1,493 @@
+#include "BenchmarkReport.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+/*///////////////////////
+	JSONの読み込み
+	(Writeが書き出す形だけを読めればよいので、\uエスケープは扱わない)
+*////////////////////////
+struct JsonValue {
+	enum class Type {
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object,
+	};
+	Type type = Type::Null;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> elements;
+	std::vector<std::pair<std::string, JsonValue>> members;
+
+	const JsonValue* Find(const char* key) const {
+		for (const auto& [name, value] : members) {
+			if (name == key) {
+				return &value;
+			}
+		}
+		return nullptr;
+	}
+
+	double GetNumber(const char* key, double defaultValue = 0.0) const {
+		const JsonValue* value = Find(key);
+		return value && value->type == Type::Number ? value->number : defaultValue;
+	}
+
+	std::string GetString(const char* key) const {
+		const JsonValue* value = Find(key);
+		return value && value->type == Type::String ? value->string : std::string();
+	}
+};
+
+class JsonParser {
+public:
+	explicit JsonParser(const std::string& text) : text_(text) {}
+
+	bool Parse(JsonValue& outValue) {
+		if (!ParseValue(outValue, 0)) {
+			return false;
+		}
+		SkipSpace();
+		return position_ == text_.size();
+	}
+
+private:
+	// 壊れたファイルで再帰が深くなりすぎないようにする
+	static const uint32_t kMaxDepth = 64;
+
+	void SkipSpace() {
+		while (position_ < text_.size() && (text_[position_] == ' ' || text_[position_] == '\t' || text_[position_] == '\n' || text_[position_] == '\r')) {
+			++position_;
+		}
+	}
+
+	bool Consume(char c) {
+		SkipSpace();
+		if (position_ < text_.size() && text_[position_] == c) {
+			++position_;
+			return true;
+		}
+		return false;
+	}
+
+	bool ConsumeWord(const char* word) {
+		const size_t length = std::char_traits<char>::length(word);
+		if (text_.compare(position_, length, word) != 0) {
+			return false;
+		}
+		position_ += length;
+		return true;
+	}
+
+	bool ParseString(std::string& outString) {
+		if (!Consume('"')) {
+			return false;
+		}
+		outString.clear();
+		while (position_ < text_.size()) {
+			char c = text_[position_++];
+			if (c == '"') {
+				return true;
+			}
+			if (c == '\\') {
+				if (position_ >= text_.size()) {
+					return false;
+				}
+				c = text_[position_++];
+				switch (c) {
+				case 'n': c = '\n'; break;
+				case 't': c = '\t'; break;
+				case 'r': c = '\r'; break;
+				case '"': case '\\': case '/': break;
+				default: return false;
+				}
+			}
+			outString += c;
+		}
+		return false;
+	}
+
+	bool ParseValue(JsonValue& outValue, uint32_t depth) {
+		if (depth > kMaxDepth) {
+			return false;
+		}
+		SkipSpace();
+		if (position_ >= text_.size()) {
+			return false;
+		}
+		const char c = text_[position_];
+		if (c == '{') {
+			++position_;
+			outValue.type = JsonValue::Type::Object;
+			if (Consume('}')) {
+				return true;
+			}
+			do {
+				std::pair<std::string, JsonValue> member;
+				if (!ParseString(member.first) || !Consume(':') || !ParseValue(member.second, depth + 1)) {
+					return false;
+				}
+				outValue.members.push_back(std::move(member));
+			} while (Consume(','));
+			return Consume('}');
+		}
+		if (c == '[') {
+			++position_;
+			outValue.type = JsonValue::Type::Array;
+			if (Consume(']')) {
+				return true;
+			}
+			do {
+				outValue.elements.emplace_back();
+				if (!ParseValue(outValue.elements.back(), depth + 1)) {
+					return false;
+				}
+			} while (Consume(','));
+			return Consume(']');
+		}
+		if (c == '"') {
+			outValue.type = JsonValue::Type::String;
+			return ParseString(outValue.string);
+		}
+		if (ConsumeWord("true")) {
+			outValue.type = JsonValue::Type::Bool;
+			outValue.number = 1.0;
+			return true;
+		}
+		if (ConsumeWord("false")) {
+			outValue.type = JsonValue::Type::Bool;
+			return true;
+		}
+		if (ConsumeWord("null")) {
+			outValue.type = JsonValue::Type::Null;
+			return true;
+		}
+		char* end = nullptr;
+		outValue.number = std::strtod(text_.c_str() + position_, &end);
+		if (end == text_.c_str() + position_) {
+			return false;
+		}
+		position_ = static_cast<size_t>(end - text_.c_str());
+		outValue.type = JsonValue::Type::Number;
+		return true;
+	}
+
+	const std::string& text_;
+	size_t position_ = 0;
+};
+
+/*///////////////////////
+	JSONの書き出し
+*////////////////////////
+std::string FormatNumber(double value) {
+	if (!std::isfinite(value)) {
+		return "0";
+	}
+	char buffer[32];
+	std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+	return buffer;
+}
+
+std::string Quote(const std::string& text) {
+	std::string quoted = "\"";
+	for (char c : text) {
+		switch (c) {
+		case '"': quoted += "\\\""; break;
+		case '\\': quoted += "\\\\"; break;
+		case '\n': quoted += "\\n"; break;
+		case '\t': quoted += "\\t"; break;
+		case '\r': quoted += "\\r"; break;
+		default: quoted += c; break;
+		}
+	}
+	quoted += '"';
+	return quoted;
+}
+
+void WriteSummary(std::ostringstream& stream, const BenchmarkSceneResult::Summary& summary) {
+	stream << "\"mean\": " << FormatNumber(summary.mean)
+		<< ", \"median\": " << FormatNumber(summary.median)
+		<< ", \"p95\": " << FormatNumber(summary.p95)
+		<< ", \"p99\": " << FormatNumber(summary.p99)
+		<< ", \"max\": " << FormatNumber(summary.max);
+}
+
+BenchmarkSceneResult::Summary ReadSummary(const JsonValue& value) {
+	BenchmarkSceneResult::Summary summary;
+	summary.mean = value.GetNumber("mean");
+	summary.median = value.GetNumber("median");
+	summary.p95 = value.GetNumber("p95");
+	summary.p99 = value.GetNumber("p99");
+	summary.max = value.GetNumber("max");
+	return summary;
+}
+
+BenchmarkSceneResult::Summary Summarize(std::vector<double>& values) {
+	BenchmarkSceneResult::Summary summary;
+	if (values.empty()) {
+		return summary;
+	}
+	std::sort(values.begin(), values.end());
+	double sum = 0.0;
+	for (double value : values) {
+		sum += value;
+	}
+	// 最近傍順位で百分位を取る
+	auto percentile = [&](double q) {
+		size_t rank = static_cast<size_t>(std::ceil(q * static_cast<double>(values.size())));
+		return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+	};
+	summary.mean = sum / static_cast<double>(values.size());
+	summary.median = percentile(0.5);
+	summary.p95 = percentile(0.95);
+	summary.p99 = percentile(0.99);
+	summary.max = values.back();
+	return summary;
+}
+
+// 比べるカウンター(フレームあたりの平均)
+struct CounterField {
+	const char* name;
+	double BenchmarkSceneResult::* field;
+	bool exact; // 値が変わったら増減としきい値によらず悪化とする
+};
+const CounterField kCounterFields[] = {
+	{ "allocationsPerFrame", &BenchmarkSceneResult::allocationsPerFrame, false },
+	{ "allocatedBytesPerFrame", &BenchmarkSceneResult::allocatedBytesPerFrame, false },
+	{ "drawsPerFrame", &BenchmarkSceneResult::drawsPerFrame, true },
+	{ "dispatchesPerFrame", &BenchmarkSceneResult::dispatchesPerFrame, true },
+	{ "instancesPerFrame", &BenchmarkSceneResult::instancesPerFrame, false },
+	{ "pipelineChangesPerFrame", &BenchmarkSceneResult::pipelineChangesPerFrame, true },
+};
+
+void CompareTime(const std::string& scene, const std::string& metric, double baseline, double current, double threshold,
+	std::vector<BenchmarkRegression>& outRegressions) {
+	if (current > baseline * (1.0 + threshold) && current - baseline > BenchmarkReport::kMinimumMillisecondsDelta) {
+		outRegressions.push_back({ scene, metric, baseline, current, baseline > 0.0 ? current / baseline : 0.0 });
+	}
+}
+
+} // namespace
+
+/*///////////////////////
+	BenchmarkSceneResult
+*////////////////////////
+void BenchmarkSceneResult::Summarize() {
+	frameCount = static_cast<uint32_t>(frames.size());
+	std::vector<double> values(frameCount);
+	stageSummaries.resize(stageNames.size());
+	for (size_t stage = 0; stage < stageNames.size(); ++stage) {
+		for (size_t i = 0; i < frameCount; ++i) {
+			values[i] = frames[i].stageMilliseconds[stage];
+		}
+		stageSummaries[stage] = ::Summarize(values);
+	}
+	for (size_t i = 0; i < frameCount; ++i) {
+		values[i] = frames[i].totalMilliseconds;
+	}
+	totalSummary = ::Summarize(values);
+
+	double allocations = 0.0, bytes = 0.0, draws = 0.0, dispatches = 0.0, instances = 0.0, pipelineChanges = 0.0;
+	for (const Frame& frame : frames) {
+		allocations += static_cast<double>(frame.allocationCount);
+		bytes += static_cast<double>(frame.allocatedBytes);
+		draws += frame.drawCount;
+		dispatches += frame.dispatchCount;
+		instances += static_cast<double>(frame.instanceCount);
+		pipelineChanges += frame.pipelineChangeCount;
+	}
+	const double scale = frameCount > 0 ? 1.0 / static_cast<double>(frameCount) : 0.0;
+	allocationsPerFrame = allocations * scale;
+	allocatedBytesPerFrame = bytes * scale;
+	drawsPerFrame = draws * scale;
+	dispatchesPerFrame = dispatches * scale;
+	instancesPerFrame = instances * scale;
+	pipelineChangesPerFrame = pipelineChanges * scale;
+}
+
+/*///////////////////////
+	BenchmarkReport
+*////////////////////////
+bool BenchmarkReport::Write(const std::string& filePath, bool includeFrames) const {
+	std::ofstream stream(filePath, std::ios::binary);
+	if (!stream) {
+		return false;
+	}
+	stream << ToJson(includeFrames);
+	return static_cast<bool>(stream);
+}
+
+bool BenchmarkReport::Read(const std::string& filePath) {
+	std::ifstream stream(filePath, std::ios::binary);
+	if (!stream) {
+		return false;
+	}
+	std::ostringstream text;
+	text << stream.rdbuf();
+	return FromJson(text.str());
+}
+
+std::string BenchmarkReport::ToJson(bool includeFrames) const {
+	std::ostringstream stream;
+	stream << "{\n";
+	stream << "  \"version\": " << kVersion << ",\n";
+	stream << "  \"description\": " << Quote(description_) << ",\n";
+	stream << "  \"scenes\": [";
+	for (size_t s = 0; s < scenes_.size(); ++s) {
+		const BenchmarkSceneResult& scene = scenes_[s];
+		stream << (s == 0 ? "\n" : ",\n");
+		stream << "    {\n";
+		stream << "      \"name\": " << Quote(scene.name) << ",\n";
+		stream << "      \"threadCount\": " << scene.threadCount << ",\n";
+		stream << "      \"frameCount\": " << scene.frameCount << ",\n";
+		stream << "      \"stages\": [";
+		for (size_t stage = 0; stage < scene.stageNames.size(); ++stage) {
+			stream << (stage == 0 ? "\n" : ",\n");
+			stream << "        { \"name\": " << Quote(scene.stageNames[stage]) << ", ";
+			WriteSummary(stream, scene.stageSummaries[stage]);
+			stream << " }";
+		}
+		stream << "\n      ],\n";
+		stream << "      \"total\": { ";
+		WriteSummary(stream, scene.totalSummary);
+		stream << " },\n";
+		stream << "      \"counters\": {";
+		for (size_t i = 0; i < std::size(kCounterFields); ++i) {
+			stream << (i == 0 ? " " : ", ") << "\"" << kCounterFields[i].name << "\": " << FormatNumber(scene.*kCounterFields[i].field);
+		}
+		stream << " },\n";
+		stream << "      \"metrics\": {";
+		for (size_t i = 0; i < scene.metrics.size(); ++i) {
+			stream << (i == 0 ? " " : ", ") << Quote(scene.metrics[i].name) << ": " << FormatNumber(scene.metrics[i].value);
+		}
+		stream << (scene.metrics.empty() ? "}" : " }");
+		if (includeFrames) {
+			stream << ",\n      \"frames\": [";
+			for (size_t i = 0; i < scene.frames.size(); ++i) {
+				const BenchmarkSceneResult::Frame& frame = scene.frames[i];
+				stream << (i == 0 ? "\n" : ",\n");
+				stream << "        { \"total\": " << FormatNumber(frame.totalMilliseconds) << ", \"stages\": [";
+				for (size_t stage = 0; stage < frame.stageMilliseconds.size(); ++stage) {
+					stream << (stage == 0 ? "" : ", ") << FormatNumber(frame.stageMilliseconds[stage]);
+				}
+				stream << "], \"allocations\": " << frame.allocationCount
+					<< ", \"allocatedBytes\": " << frame.allocatedBytes
+					<< ", \"draws\": " << frame.drawCount
+					<< ", \"dispatches\": " << frame.dispatchCount
+					<< ", \"instances\": " << frame.instanceCount
+					<< ", \"pipelineChanges\": " << frame.pipelineChangeCount << " }";
+			}
+			stream << "\n      ]";
+		}
+		stream << "\n    }";
+	}
+	stream << "\n  ]\n}\n";
+	return stream.str();
+}
+
+bool BenchmarkReport::FromJson(const std::string& json) {
+	JsonValue root;
+	if (!JsonParser(json).Parse(root) || root.type != JsonValue::Type::Object) {
+		return false;
+	}
+	if (static_cast<uint32_t>(root.GetNumber("version")) != kVersion) {
+		return false;
+	}
+	const JsonValue* scenes = root.Find("scenes");
+	if (scenes == nullptr || scenes->type != JsonValue::Type::Array) {
+		return false;
+	}
+
+	description_ = root.GetString("description");
+	scenes_.clear();
+	for (const JsonValue& sceneValue : scenes->elements) {
+		BenchmarkSceneResult scene;
+		scene.name = sceneValue.GetString("name");
+		scene.threadCount = static_cast<uint32_t>(sceneValue.GetNumber("threadCount"));
+		scene.frameCount = static_cast<uint32_t>(sceneValue.GetNumber("frameCount"));
+		if (const JsonValue* stages = sceneValue.Find("stages")) {
+			for (const JsonValue& stage : stages->elements) {
+				scene.stageNames.push_back(stage.GetString("name"));
+				scene.stageSummaries.push_back(ReadSummary(stage));
+			}
+		}
+		if (const JsonValue* total = sceneValue.Find("total")) {
+			scene.totalSummary = ReadSummary(*total);
+		}
+		if (const JsonValue* counters = sceneValue.Find("counters")) {
+			for (const CounterField& counter : kCounterFields) {
+				scene.*counter.field = counters->GetNumber(counter.name);
+			}
+		}
+		if (const JsonValue* metrics = sceneValue.Find("metrics")) {
+			for (const auto& [name, value] : metrics->members) {
+				scene.metrics.push_back({ name, value.number });
+			}
+		}
+		scenes_.push_back(std::move(scene));
+	}
+	return true;
+}
+
+bool BenchmarkReport::Compare(const BenchmarkReport& baseline, const BenchmarkReport& current, double threshold, std::vector<BenchmarkRegression>& outRegressions) {
+	const size_t firstRegression = outRegressions.size();
+	for (const BenchmarkSceneResult& baseScene : baseline.scenes_) {
+		auto scene = std::find_if(current.scenes_.begin(), current.scenes_.end(),
+			[&](const BenchmarkSceneResult& candidate) { return candidate.name == baseScene.name; });
+		if (scene == current.scenes_.end()) {
+			// 落ちたり名前が変わったりして計れなかったシーンを見逃さない
+			outRegressions.push_back({ baseScene.name, "missing", 1.0, 0.0, 0.0 });
+			continue;
+		}
+
+		// 条件が違うと時間もカウンターも比べられないので、違い自体を報告して残りは比べない
+		if (scene->threadCount != baseScene.threadCount || scene->frameCount != baseScene.frameCount) {
+			if (scene->threadCount != baseScene.threadCount) {
+				outRegressions.push_back({ scene->name, "threadCount", static_cast<double>(baseScene.threadCount), static_cast<double>(scene->threadCount),
+					baseScene.threadCount > 0 ? static_cast<double>(scene->threadCount) / baseScene.threadCount : 0.0 });
+			}
+			if (scene->frameCount != baseScene.frameCount) {
+				outRegressions.push_back({ scene->name, "frameCount", static_cast<double>(baseScene.frameCount), static_cast<double>(scene->frameCount),
+					baseScene.frameCount > 0 ? static_cast<double>(scene->frameCount) / baseScene.frameCount : 0.0 });
+			}
+			continue;
+		}
+
+		for (size_t baseStage = 0; baseStage < baseScene.stageNames.size(); ++baseStage) {
+			const std::string& stageName = baseScene.stageNames[baseStage];
+			auto stage = std::find(scene->stageNames.begin(), scene->stageNames.end(), stageName);
+			if (stage == scene->stageNames.end()) {
+				outRegressions.push_back({ scene->name, stageName + ".missing", baseScene.stageSummaries[baseStage].median, 0.0, 0.0 });
+				continue;
+			}
+			const BenchmarkSceneResult::Summary& base = baseScene.stageSummaries[baseStage];
+			const BenchmarkSceneResult::Summary& now = scene->stageSummaries[static_cast<size_t>(stage - scene->stageNames.begin())];
+			CompareTime(scene->name, stageName + ".median", base.median, now.median, threshold, outRegressions);
+			CompareTime(scene->name, stageName + ".p95", base.p95, now.p95, threshold, outRegressions);
+		}
+		CompareTime(scene->name, "total.median", baseScene.totalSummary.median, scene->totalSummary.median, threshold, outRegressions);
+		CompareTime(scene->name, "total.p95", baseScene.totalSummary.p95, scene->totalSummary.p95, threshold, outRegressions);
+
+		// シーンは決まった手順で動くので、カウンターは揺れない。基準が0なら1つでも増えれば悪化とする
+		for (const CounterField& counter : kCounterFields) {
+			const double base = baseScene.*counter.field;
+			const double now = (*scene).*counter.field;
+			const bool regressed = counter.exact ? now != base : now > base && (base == 0.0 || now > base * (1.0 + threshold));
+			if (regressed) {
+				outRegressions.push_back({ scene->name, counter.name, base, now, base > 0.0 ? now / base : 0.0 });
+			}
+		}
+	}
+	return outRegressions.size() == firstRegression;
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// 1シーン分の計測結果
+/// </summary>
+struct BenchmarkSceneResult {
+	// 1フレーム分の計測値
+	struct Frame {
+		std::vector<double> stageMilliseconds; // stageNamesの順
+		double totalMilliseconds = 0.0;
+		uint64_t allocationCount = 0;
+		uint64_t allocatedBytes = 0;
+		uint32_t drawCount = 0;
+		uint32_t dispatchCount = 0;
+		uint64_t instanceCount = 0;
+		uint32_t pipelineChangeCount = 0;
+	};
+
+	// 時間とカウンター以外の値(スループットやデータサイズなど)。記録するだけで比較には使わない
+	struct Metric {
+		std::string name;
+		double value = 0.0;
+	};
+
+	// フレームをまたいだ集計(ミリ秒)
+	struct Summary {
+		double mean = 0.0;
+		double median = 0.0;
+		double p95 = 0.0;
+		double p99 = 0.0;
+		double max = 0.0;
+	};
+
+	std::string name;
+	uint32_t threadCount = 0;
+	uint32_t frameCount = 0; // 集計したフレーム数(読み込んだ結果はframesが空なのでこちらを使う)
+	std::vector<std::string> stageNames;
+	std::vector<Frame> frames;
+	std::vector<Metric> metrics;
+
+	// 以下はSummarizeで埋める
+	std::vector<Summary> stageSummaries; // stageNamesの順
+	Summary totalSummary;
+	double allocationsPerFrame = 0.0;
+	double allocatedBytesPerFrame = 0.0;
+	double drawsPerFrame = 0.0;
+	double dispatchesPerFrame = 0.0;
+	double instancesPerFrame = 0.0;
+	double pipelineChangesPerFrame = 0.0;
+
+	/// <summary>
+	/// framesから集計値を計算する
+	/// </summary>
+	void Summarize();
+};
+
+/// <summary>
+/// 比較で見つかった悪化
+/// </summary>
+struct BenchmarkRegression {
+	std::string scene;
+	std::string metric;  // "Culling.median"、"allocationsPerFrame"など。シーンや段階が無くなったら"missing"、"Culling.missing"
+	double baseline;
+	double current;
+	double ratio;        // current / baseline
+};
+
+/// <summary>
+/// ベンチマークの結果をJSONで読み書きし、2つの結果を比べる
+/// </summary>
+class BenchmarkReport {
+public: // 静的メンバ変数
+	static const uint32_t kVersion = 1;
+	// これより短い時間の差は計測の揺れとみなして比較しない(ミリ秒)
+	static constexpr double kMinimumMillisecondsDelta = 0.02;
+
+public: // メンバ関数
+	/// <summary>
+	/// JSONで書き出す
+	/// </summary>
+	/// <param name="filePath">出力先</param>
+	/// <param name="includeFrames">フレームごとの値も書き出すか</param>
+	/// <returns>書き出せたか</returns>
+	bool Write(const std::string& filePath, bool includeFrames = true) const;
+
+	/// <summary>
+	/// Writeで書き出したJSONを読み込む(フレームごとの値は読まず、集計値だけを使う)
+	/// </summary>
+	/// <returns>読み込めたか</returns>
+	bool Read(const std::string& filePath);
+
+	/// <summary>
+	/// JSON文字列にする
+	/// </summary>
+	std::string ToJson(bool includeFrames = true) const;
+
+	/// <summary>
+	/// JSON文字列から読み込む
+	/// </summary>
+	bool FromJson(const std::string& json);
+
+	std::vector<BenchmarkSceneResult>& GetScenes() { return scenes_; }
+	const std::vector<BenchmarkSceneResult>& GetScenes() const { return scenes_; }
+
+	void SetDescription(const std::string& description) { description_ = description; }
+	const std::string& GetDescription() const { return description_; }
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// 2つの結果を比べ、同じ名前のシーン・段階でしきい値を超えて悪化したものを集める。
+	/// 時間は外れ値に強い中央値とp95、カウンターはフレームあたりの平均で比べる。
+	/// 描画・ディスパッチ・パイプライン切り替えの数は、しきい値によらず増えても減っても悪化とする(描画の組み立てが変わった)。
+	/// 基準にあって今回に無いシーン・段階と、スレッド数・フレーム数の違うシーンも悪化として報告する
+	/// </summary>
+	/// <param name="baseline">基準の結果</param>
+	/// <param name="current">今回の結果</param>
+	/// <param name="threshold">許容する悪化の割合(0.1で10%)</param>
+	/// <param name="outRegressions">悪化の追加先</param>
+	/// <returns>悪化がなかったか</returns>
+	static bool Compare(const BenchmarkReport& baseline, const BenchmarkReport& current, double threshold, std::vector<BenchmarkRegression>& outRegressions);
+
+private: // メンバ変数
+	std::string description_;
+	std::vector<BenchmarkSceneResult> scenes_;
+};
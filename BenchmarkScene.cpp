@@ -0,0 +1,566 @@
+#include "BenchmarkScene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include "ClusteredLighting.h"
+#include "HotReload.h"
+#include "MemoryArena.h"
+#include "ParticleSystem.h"
+#include "SceneBvh.h"
+#include "SkeletalAnimation.h"
+#include "SpriteBatch.h"
+
+namespace {
+
+const float kPi = 3.14159265f;
+
+// フレームの時間は実時間によらず固定にし、毎回同じ動きにする
+const float kFrameSeconds = 1.0f / 60.0f;
+// 計測の前に回すフレーム数(作業領域の確保などを計測から外す)
+const uint32_t kWarmUpFrameCount = 5;
+
+// カメラ
+const float kFovY = 0.8f;
+const float kAspectRatio = 16.0f / 9.0f;
+const float kNearZ = 0.1f;
+const float kFarZ = 500.0f;
+
+// スプライトの描画先
+const float kScreenWidth = 1920.0f;
+const float kScreenHeight = 1080.0f;
+const uint32_t kSpritePageCount = 4;
+
+const uint32_t kMeshCount = 8;
+const uint32_t kCullingGroupSize = 64;
+// シェーダーのコンパイルとパイプラインの生成にかかる時間の代わり
+const std::chrono::milliseconds kSimulatedRebuildTime(20);
+
+// パイプラインの識別子
+enum Pipeline : uint32_t {
+	kPipelineCulling,
+	kPipelineMesh,
+	kPipelineSkinnedMesh,
+	kPipelineParticles,
+	kPipelineSprite,
+};
+
+// 計測する段階
+enum Stage : uint32_t {
+	kStageScene,     // 物体とライトを動かす
+	kStageBvhRefit,
+	kStageBvhQuery,  // 視錐台内の候補を集める
+	kStageCulling,
+	kStageLighting,
+	kStageParticles,
+	kStageAnimation,
+	kStageSprites,
+	kStageHotReload, // 差し替えと解放(メインスレッド側だけ)
+	kStageCount,
+};
+
+const char* const kStageNames[kStageCount] = {
+	"Scene", "BvhRefit", "BvhQuery", "Culling", "Lighting", "Particles", "Animation", "Sprites", "HotReload",
+};
+
+// 環境によらず同じ列を返す乱数(標準の分布は実装ごとに結果が違うので使わない)
+class Random {
+public:
+	explicit Random(uint32_t seed) : state_(seed) {}
+
+	float Next() {
+		state_ = state_ * 1664525u + 1013904223u;
+		return static_cast<float>(state_ >> 8) * (1.0f / 16777216.0f);
+	}
+
+	float Range(float minimum, float maximum) { return minimum + (maximum - minimum) * Next(); }
+
+private:
+	uint32_t state_;
+};
+
+// 中心を向いたまま円を描いて回るカメラ
+std::vector<BenchmarkCameraKey> MakeOrbitPath(float radius, float height, float duration, uint32_t keyCount) {
+	std::vector<BenchmarkCameraKey> path(keyCount + 1);
+	for (uint32_t i = 0; i <= keyCount; ++i) {
+		const float angle = 2.0f * kPi * static_cast<float>(i) / static_cast<float>(keyCount);
+		BenchmarkCameraKey& key = path[i];
+		key.time = duration * static_cast<float>(i) / static_cast<float>(keyCount);
+		key.position[0] = radius * std::cos(angle);
+		key.position[1] = height;
+		key.position[2] = radius * std::sin(angle);
+		// 前方(sin yaw, 0, cos yaw)が原点を向く角度。キーの間で連続するよう角度から直接求める
+		key.yaw = -angle - kPi * 0.5f;
+	}
+	return path;
+}
+
+// 親は(i - 1) / 2の二分木。関節が親より後に並ぶ
+void MakeSkeleton(uint32_t jointCount, Skeleton& outSkeleton) {
+	std::vector<int16_t> parents(jointCount);
+	std::vector<JointTransform> bindPose(jointCount);
+	for (uint32_t joint = 0; joint < jointCount; ++joint) {
+		parents[joint] = joint == 0 ? int16_t(-1) : static_cast<int16_t>((joint - 1) / 2);
+		bindPose[joint] = { { 0.0f, joint == 0 ? 0.0f : 0.2f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f } };
+	}
+	outSkeleton.Initialize(parents.data(), bindPose.data(), jointCount);
+}
+
+// 関節ごとに位相をずらしてz軸まわりに揺らす1秒のループ
+void MakeClip(const Skeleton& skeleton, float speed, AnimationClip& outClip) {
+	const uint32_t kFrameCount = 31;
+	const uint32_t jointCount = skeleton.GetJointCount();
+	outClip.Initialize(jointCount, kFrameCount, 30.0f);
+	for (uint32_t frame = 0; frame < kFrameCount; ++frame) {
+		for (uint32_t joint = 0; joint < jointCount; ++joint) {
+			JointTransform key = skeleton.GetBindPose()[joint];
+			const float angle = 0.3f * std::sin(2.0f * kPi * speed * static_cast<float>(frame) / 30.0f + static_cast<float>(joint) * 0.5f);
+			key.rotation[2] = std::sin(angle * 0.5f);
+			key.rotation[3] = std::cos(angle * 0.5f);
+			outClip.GetKey(frame, joint) = key;
+		}
+	}
+}
+
+void Multiply(const float a[4][4], const float b[4][4], float out[4][4]) {
+	for (uint32_t r = 0; r < 4; ++r) {
+		for (uint32_t c = 0; c < 4; ++c) {
+			out[r][c] = a[r][0] * b[0][c] + a[r][1] * b[1][c] + a[r][2] * b[2][c] + a[r][3] * b[3][c];
+		}
+	}
+}
+
+double ElapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+/*///////////////////////
+	HeadlessCommandList
+*////////////////////////
+void HeadlessCommandList::Reset() {
+	drawCount_ = 0;
+	dispatchCount_ = 0;
+	instanceCount_ = 0;
+	pipelineChangeCount_ = 0;
+	currentPipeline_ = UINT32_MAX;
+}
+
+void HeadlessCommandList::SetPipelineState(uint32_t pipelineId) {
+	if (pipelineId != currentPipeline_) {
+		currentPipeline_ = pipelineId;
+		++pipelineChangeCount_;
+	}
+}
+
+void HeadlessCommandList::DrawInstanced(uint32_t, uint32_t instanceCount) {
+	++drawCount_;
+	instanceCount_ += instanceCount;
+}
+
+void HeadlessCommandList::DrawIndexedInstanced(uint32_t, uint32_t instanceCount) {
+	++drawCount_;
+	instanceCount_ += instanceCount;
+}
+
+void HeadlessCommandList::Dispatch(uint32_t, uint32_t, uint32_t) {
+	++dispatchCount_;
+}
+
+void HeadlessCommandList::ExecuteIndirect(const DrawIndexedArguments* arguments, uint32_t argumentCount) {
+	for (uint32_t i = 0; i < argumentCount; ++i) {
+		DrawIndexedInstanced(arguments[i].indexCountPerInstance, arguments[i].instanceCount);
+	}
+}
+
+/*///////////////////////
+	BenchmarkScene
+*////////////////////////
+std::vector<BenchmarkSceneDesc> BenchmarkScene::GetBuiltInScenes() {
+	std::vector<BenchmarkSceneDesc> scenes(3);
+
+	// どの機能も少しずつ使う小さなシーン
+	BenchmarkSceneDesc& small = scenes[0];
+	small.name = "Small";
+	small.objectCount = 4096;
+	small.worldSize = 200.0f;
+	small.lightCount = 64;
+	small.particleCapacity = 16384;
+	small.particleEmitRate = 4000.0f;
+	small.characterCount = 8;
+	small.jointCount = 32;
+	small.spriteCount = 1024;
+	small.cameraPath = MakeOrbitPath(60.0f, 10.0f, 10.0f, 8);
+
+	// 普段のゲーム画面に近い量。1秒ごとにシェーダーを読み直す
+	BenchmarkSceneDesc& city = scenes[1];
+	city.name = "City";
+	city.objectCount = 100000;
+	city.worldSize = 600.0f;
+	city.lightCount = 4096;
+	city.particleCapacity = 1 << 18;
+	city.particleEmitRate = 80000.0f;
+	city.characterCount = 64;
+	city.jointCount = 64;
+	city.spriteCount = 16384;
+	city.hotReloadInterval = 60;
+	city.cameraPath = MakeOrbitPath(150.0f, 12.0f, 10.0f, 8);
+
+	// 各機能の上限付近
+	BenchmarkSceneDesc& stress = scenes[2];
+	stress.name = "Stress";
+	stress.frameCount = 120;
+	stress.objectCount = 1000000;
+	stress.worldSize = 2000.0f;
+	stress.lightCount = 16384;
+	stress.particleCapacity = 1 << 20;
+	stress.particleEmitRate = 400000.0f;
+	stress.characterCount = 256;
+	stress.jointCount = 64;
+	stress.spriteCount = 131072;
+	stress.cameraPath = MakeOrbitPath(400.0f, 20.0f, 10.0f, 8);
+
+	return scenes;
+}
+
+std::vector<std::string> BenchmarkScene::GetStageNames() {
+	return std::vector<std::string>(kStageNames, kStageNames + kStageCount);
+}
+
+void BenchmarkScene::EvaluateCamera(const std::vector<BenchmarkCameraKey>& path, float time, float outView[4][4], float outViewProjection[4][4]) {
+	BenchmarkCameraKey camera{ 0.0f, { 0.0f, 10.0f, -50.0f }, 0.0f };
+	if (path.size() == 1) {
+		camera = path[0];
+	} else if (path.size() > 1) {
+		const float duration = path.back().time;
+		const float t = duration > 0.0f ? std::fmod(time, duration) : 0.0f;
+		size_t next = 1;
+		while (next + 1 < path.size() && path[next].time <= t) {
+			++next;
+		}
+		const BenchmarkCameraKey& a = path[next - 1];
+		const BenchmarkCameraKey& b = path[next];
+		const float span = b.time - a.time;
+		const float weight = span > 0.0f ? std::clamp((t - a.time) / span, 0.0f, 1.0f) : 0.0f;
+		for (uint32_t i = 0; i < 3; ++i) {
+			camera.position[i] = a.position[i] + (b.position[i] - a.position[i]) * weight;
+		}
+		camera.yaw = a.yaw + (b.yaw - a.yaw) * weight;
+	}
+
+	// 水平に前を向くカメラの逆行列
+	const float right[3] = { std::cos(camera.yaw), 0.0f, -std::sin(camera.yaw) };
+	const float up[3] = { 0.0f, 1.0f, 0.0f };
+	const float forward[3] = { std::sin(camera.yaw), 0.0f, std::cos(camera.yaw) };
+	const float* eye = camera.position;
+	const float view[4][4] = {
+		{ right[0], up[0], forward[0], 0.0f },
+		{ right[1], up[1], forward[1], 0.0f },
+		{ right[2], up[2], forward[2], 0.0f },
+		{ -(eye[0] * right[0] + eye[1] * right[1] + eye[2] * right[2]),
+		  -(eye[0] * up[0] + eye[1] * up[1] + eye[2] * up[2]),
+		  -(eye[0] * forward[0] + eye[1] * forward[1] + eye[2] * forward[2]), 1.0f },
+	};
+	std::memcpy(outView, view, sizeof(view));
+
+	const float yScale = 1.0f / std::tan(kFovY * 0.5f);
+	const float xScale = yScale / kAspectRatio;
+	const float zScale = kFarZ / (kFarZ - kNearZ);
+	const float projection[4][4] = {
+		{ xScale, 0.0f, 0.0f, 0.0f },
+		{ 0.0f, yScale, 0.0f, 0.0f },
+		{ 0.0f, 0.0f, zScale, 1.0f },
+		{ 0.0f, 0.0f, -kNearZ * zScale, 0.0f },
+	};
+	Multiply(view, projection, outViewProjection);
+}
+
+BenchmarkSceneResult BenchmarkScene::Run(const BenchmarkSceneDesc& desc, uint32_t threadCount, const BenchmarkAllocationCounters* allocationCounters) {
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	Random random(desc.seed);
+
+	// 物体。先頭のdynamicObjectRatio分を毎フレーム動かす
+	const uint32_t objectCount = desc.objectCount;
+	const uint32_t dynamicObjectCount = static_cast<uint32_t>(static_cast<float>(objectCount) * std::clamp(desc.dynamicObjectRatio, 0.0f, 1.0f));
+	const float halfWorldSize = desc.worldSize * 0.5f;
+	std::vector<CullingInstance> instances(objectCount);
+	std::vector<BvhBounds> bounds(objectCount);
+	std::vector<float> baseCenters(static_cast<size_t>(dynamicObjectCount) * 3);
+	for (uint32_t i = 0; i < objectCount; ++i) {
+		CullingInstance& instance = instances[i];
+		instance = {};
+		instance.center[0] = random.Range(-halfWorldSize, halfWorldSize);
+		instance.center[1] = random.Range(0.0f, 20.0f);
+		instance.center[2] = random.Range(-halfWorldSize, halfWorldSize);
+		instance.radius = random.Range(0.5f, 3.0f);
+		instance.meshIndex = i % kMeshCount;
+		if (i < dynamicObjectCount) {
+			std::memcpy(&baseCenters[static_cast<size_t>(i) * 3], instance.center, sizeof(instance.center));
+		}
+	}
+	CullingMesh meshes[kMeshCount];
+	for (uint32_t mesh = 0; mesh < kMeshCount; ++mesh) {
+		meshes[mesh] = { 36u << (mesh % 4), mesh * 1024, 0, 0 };
+	}
+	auto updateBounds = [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			const CullingInstance& instance = instances[i];
+			for (uint32_t axis = 0; axis < 3; ++axis) {
+				bounds[i].min[axis] = instance.center[axis] - instance.radius;
+				bounds[i].max[axis] = instance.center[axis] + instance.radius;
+			}
+		}
+	};
+	updateBounds(0, objectCount);
+	SceneBvh bvh;
+	const auto bvhBuildStart = std::chrono::steady_clock::now();
+	bvh.Build(bounds.data(), objectCount, threadCount);
+	const double bvhBuildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bvhBuildStart).count();
+	std::vector<uint32_t> queryResults;
+
+	// ライト
+	std::vector<ClusterLight> lights(desc.lightCount);
+	std::vector<float> lightBaseHeights(desc.lightCount);
+	for (uint32_t i = 0; i < desc.lightCount; ++i) {
+		ClusterLight& light = lights[i];
+		light.position[0] = random.Range(-halfWorldSize, halfWorldSize);
+		light.position[1] = random.Range(1.0f, 15.0f);
+		light.position[2] = random.Range(-halfWorldSize, halfWorldSize);
+		light.radius = random.Range(5.0f, 20.0f);
+		light.color[0] = random.Next();
+		light.color[1] = random.Next();
+		light.color[2] = random.Next();
+		light.intensity = 1.0f;
+		lightBaseHeights[i] = light.position[1];
+	}
+	ClusterGridDesc clusterDesc;
+	clusterDesc.nearZ = kNearZ;
+	clusterDesc.farZ = kFarZ;
+	clusterDesc.fovY = kFovY;
+	clusterDesc.aspectRatio = kAspectRatio;
+	ClusteredLighting clusteredLighting;
+	clusteredLighting.Initialize(clusterDesc);
+
+	// パーティクル(main.cppと同じ噴水)
+	ParticleSystem particles;
+	if (desc.particleCapacity > 0) {
+		particles.Initialize(desc.particleCapacity, desc.seed);
+	}
+	ParticleEmitter emitter{};
+	emitter.positionSpread = 0.1f;
+	emitter.velocity[1] = 6.0f;
+	emitter.velocitySpread = 2.5f;
+	emitter.gravity[1] = -6.0f;
+	emitter.drag = 0.2f;
+	emitter.lifetimeMin = 1.5f;
+	emitter.lifetimeMax = 3.0f;
+	emitter.emitRate = desc.particleEmitRate;
+	emitter.size = 0.03f;
+
+	// キャラクター。歩きと走りを混ぜる
+	Skeleton skeleton;
+	AnimationClip sourceClips[2];
+	CompressedClip clips[2];
+	std::vector<CharacterAnimation> characters(desc.characterCount);
+	std::vector<SkinningMatrix> palettes(static_cast<size_t>(desc.characterCount) * desc.jointCount);
+	AnimationSystem animationSystem;
+	if (desc.characterCount > 0) {
+		MakeSkeleton(desc.jointCount, skeleton);
+		MakeClip(skeleton, 1.0f, sourceClips[0]);
+		MakeClip(skeleton, 2.0f, sourceClips[1]);
+		clips[0].Compress(sourceClips[0]);
+		clips[1].Compress(sourceClips[1]);
+		for (uint32_t i = 0; i < desc.characterCount; ++i) {
+			characters[i] = { &skeleton, { &clips[0], &clips[1] }, { 0.0f, 0.0f }, 0.0f, i * desc.jointCount };
+		}
+	}
+
+	// スプライト
+	SpriteBatch spriteBatch;
+	std::vector<Sprite> sprites(desc.spriteCount);
+	for (uint32_t i = 0; i < desc.spriteCount; ++i) {
+		Sprite& sprite = sprites[i];
+		sprite = {};
+		sprite.size[0] = random.Range(8.0f, 64.0f);
+		sprite.size[1] = random.Range(8.0f, 64.0f);
+		sprite.uvMin[0] = random.Range(0.0f, 0.5f);
+		sprite.uvMin[1] = random.Range(0.0f, 0.5f);
+		sprite.uvMax[0] = sprite.uvMin[0] + 0.25f;
+		sprite.uvMax[1] = sprite.uvMin[1] + 0.25f;
+		sprite.color = 0xffffffffu;
+		sprite.textureIndex = i % kSpritePageCount;
+		sprite.layer = static_cast<uint16_t>(i % 2);
+	}
+
+	// シェーダーの読み直し。ファイルは監視せず、決まったフレームで変更を通知する
+	HotReload hotReload;
+	uint32_t pipelineVersion = 0;
+	if (desc.hotReloadInterval > 0) {
+		hotReload.Initialize(std::string());
+		hotReload.Register("BenchmarkPipeline", { "Benchmark.hlsl" }, [&pipelineVersion]() -> HotReload::SwapFunction {
+			std::this_thread::sleep_for(kSimulatedRebuildTime);
+			return [&pipelineVersion](bool apply) -> HotReload::ReleaseFunction {
+				if (apply) {
+					++pipelineVersion;
+				}
+				return []() {};
+			};
+		});
+	}
+
+	// フレーム内の一時データ(描画引数とスプライトのインスタンス)
+	const size_t frameBytes = sizeof(DrawIndexedArguments) * objectCount + sizeof(SpriteInstance) * desc.spriteCount + 4096;
+	FrameAllocator frameAllocator(frameBytes, "Benchmark");
+	HeadlessCommandList commandList;
+
+	BenchmarkSceneResult result;
+	result.name = desc.name;
+	result.threadCount = threadCount;
+	result.stageNames = GetStageNames();
+	result.frames.reserve(desc.frameCount);
+	if (objectCount > 0) {
+		// BVHの構築(フレームの外で1回だけ行う)
+		result.metrics.push_back({ "Bvh.buildMilliseconds", bvhBuildMilliseconds });
+		result.metrics.push_back({ "Bvh.primitivesPerMillisecond", objectCount / bvhBuildMilliseconds });
+	}
+	if (desc.characterCount > 0) {
+		// 1クリップあたりの大きさ(圧縮前と圧縮後)
+		result.metrics.push_back({ "Animation.bytesPerClip", static_cast<double>(sourceClips[0].GetSizeInBytes() + sourceClips[1].GetSizeInBytes()) / 2.0 });
+		result.metrics.push_back({ "Animation.compressedBytesPerClip", static_cast<double>(clips[0].GetSizeInBytes() + clips[1].GetSizeInBytes()) / 2.0 });
+	}
+
+	for (uint32_t frame = 0; frame < kWarmUpFrameCount + desc.frameCount; ++frame) {
+		const float time = static_cast<float>(frame) * kFrameSeconds;
+		BenchmarkSceneResult::Frame record;
+		record.stageMilliseconds.resize(kStageCount);
+		uint64_t allocationCount = allocationCounters ? allocationCounters->count.load(std::memory_order_relaxed) : 0;
+		uint64_t allocatedBytes = allocationCounters ? allocationCounters->bytes.load(std::memory_order_relaxed) : 0;
+		const auto frameStart = std::chrono::steady_clock::now();
+		frameAllocator.BeginFrame();
+		commandList.Reset();
+
+		auto stageStart = std::chrono::steady_clock::now();
+		auto endStage = [&](Stage stage) {
+			const auto now = std::chrono::steady_clock::now();
+			record.stageMilliseconds[stage] = std::chrono::duration<double, std::milli>(now - stageStart).count();
+			stageStart = now;
+		};
+
+		// 物体とライトを動かす
+		for (uint32_t i = 0; i < dynamicObjectCount; ++i) {
+			const float phase = time * 1.5f + static_cast<float>(i) * 0.37f;
+			const float* base = &baseCenters[static_cast<size_t>(i) * 3];
+			instances[i].center[0] = base[0] + 2.0f * std::cos(phase);
+			instances[i].center[1] = base[1] + 0.5f * std::sin(phase * 1.3f);
+			instances[i].center[2] = base[2] + 2.0f * std::sin(phase);
+		}
+		updateBounds(0, dynamicObjectCount);
+		for (uint32_t i = 0; i < desc.lightCount; ++i) {
+			lights[i].position[1] = lightBaseHeights[i] + 2.0f * std::sin(time + static_cast<float>(i) * 0.1f);
+		}
+		float view[4][4];
+		float viewProjection[4][4];
+		EvaluateCamera(desc.cameraPath, time, view, viewProjection);
+		const CullingView cullingView = InstanceCulling::MakeView(viewProjection, nullptr, objectCount);
+		endStage(kStageScene);
+
+		if (objectCount > 0) {
+			bvh.Refit(bounds.data(), threadCount);
+		}
+		endStage(kStageBvhRefit);
+
+		if (objectCount > 0) {
+			// QueryFrustumは後ろに追加するので、前のフレームの結果を捨ててから問い合わせる
+			queryResults.clear();
+			bvh.QueryFrustum(cullingView.planes, queryResults);
+		}
+		endStage(kStageBvhQuery);
+
+		// GPUカリングと同じ結果をCPUで作り、間接描画として積む
+		DrawIndexedArguments* arguments = frameAllocator.AllocateArray<DrawIndexedArguments>(std::max(objectCount, 1u));
+		const uint32_t visibleCount = InstanceCulling::Cull(cullingView, instances.data(), meshes, nullptr, arguments, threadCount);
+		commandList.SetPipelineState(kPipelineCulling);
+		commandList.Dispatch((objectCount + kCullingGroupSize - 1) / kCullingGroupSize, 1, 1);
+		commandList.SetPipelineState(kPipelineMesh);
+		commandList.ExecuteIndirect(arguments, visibleCount);
+		endStage(kStageCulling);
+
+		clusteredLighting.Build(view, lights.data(), desc.lightCount, threadCount);
+		endStage(kStageLighting);
+
+		if (desc.particleCapacity > 0) {
+			particles.Update(emitter, kFrameSeconds, threadCount);
+			commandList.SetPipelineState(kPipelineParticles);
+			commandList.DrawInstanced(6, particles.GetAliveCount());
+		}
+		endStage(kStageParticles);
+
+		if (desc.characterCount > 0) {
+			for (uint32_t i = 0; i < desc.characterCount; ++i) {
+				CharacterAnimation& character = characters[i];
+				const float offset = static_cast<float>(i) * 0.13f;
+				character.times[0] = std::fmod(time + offset, clips[0].GetDuration());
+				character.times[1] = std::fmod(time + offset, clips[1].GetDuration());
+				character.blendWeight = 0.5f + 0.5f * std::sin(time + offset);
+			}
+			animationSystem.Evaluate(characters.data(), desc.characterCount, palettes.data(), threadCount);
+			commandList.SetPipelineState(kPipelineSkinnedMesh);
+			for (uint32_t i = 0; i < desc.characterCount; ++i) {
+				commandList.DrawIndexedInstanced(36u * desc.jointCount, 1);
+			}
+		}
+		endStage(kStageAnimation);
+
+		if (desc.spriteCount > 0) {
+			spriteBatch.Begin();
+			for (uint32_t i = 0; i < desc.spriteCount; ++i) {
+				Sprite& sprite = sprites[i];
+				const float angle = time * 0.5f + static_cast<float>(i) * 0.01f;
+				const float radius = 100.0f + static_cast<float>(i % 400);
+				sprite.position[0] = kScreenWidth * 0.5f + radius * std::cos(angle);
+				sprite.position[1] = kScreenHeight * 0.5f + radius * std::sin(angle) * 0.5f;
+				sprite.rotation = angle;
+				spriteBatch.Draw(sprite);
+			}
+			SpriteInstance* spriteInstances = frameAllocator.AllocateArray<SpriteInstance>(desc.spriteCount);
+			spriteBatch.End(spriteInstances, desc.spriteCount);
+			commandList.SetPipelineState(kPipelineSprite);
+			for (const SpriteBatchRange& batch : spriteBatch.GetBatches()) {
+				commandList.DrawInstanced(4, batch.instanceCount);
+			}
+		}
+		endStage(kStageSprites);
+
+		if (desc.hotReloadInterval > 0) {
+			if (frame % desc.hotReloadInterval == 0) {
+				hotReload.NotifyFileChanged("Benchmark.hlsl");
+			}
+			// ヘッドレスなので前のフレームまでのGPU処理は終わっている扱いにする
+			hotReload.BeginFrame(frame + 1, frame);
+		}
+		endStage(kStageHotReload);
+
+		record.totalMilliseconds = ElapsedMilliseconds(frameStart);
+		if (allocationCounters) {
+			record.allocationCount = allocationCounters->count.load(std::memory_order_relaxed) - allocationCount;
+			record.allocatedBytes = allocationCounters->bytes.load(std::memory_order_relaxed) - allocatedBytes;
+		}
+		record.drawCount = commandList.GetDrawCount();
+		record.dispatchCount = commandList.GetDispatchCount();
+		record.instanceCount = commandList.GetInstanceCount();
+		record.pipelineChangeCount = commandList.GetPipelineChangeCount();
+		if (frame >= kWarmUpFrameCount) {
+			result.frames.push_back(std::move(record));
+		}
+	}
+
+	hotReload.Finalize();
+	result.Summarize();
+	return result;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BenchmarkReport.h"
+#include "InstanceCulling.h"
+
+/// <summary>
+/// 計測用のコマンドリスト。GPUには何も送らず、積まれた描画・ディスパッチを数えるだけ(D3D12のコマンドリストと同じ名前の関数を持つ)
+/// </summary>
+class HeadlessCommandList {
+public: // メンバ関数
+	/// <summary>
+	/// 数えた値を0に戻す(フレームの先頭で呼ぶ)
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// パイプラインの設定。直前と同じものなら切り替えとして数えない
+	/// </summary>
+	/// <param name="pipelineId">パイプラインの識別子</param>
+	void SetPipelineState(uint32_t pipelineId);
+
+	void DrawInstanced(uint32_t vertexCountPerInstance, uint32_t instanceCount);
+	void DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount);
+	void Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ);
+
+	/// <summary>
+	/// 描画引数の配列による間接描画。引数1つを描画1回として数える
+	/// </summary>
+	void ExecuteIndirect(const DrawIndexedArguments* arguments, uint32_t argumentCount);
+
+	uint32_t GetDrawCount() const { return drawCount_; }
+	uint32_t GetDispatchCount() const { return dispatchCount_; }
+	uint64_t GetInstanceCount() const { return instanceCount_; }
+	uint32_t GetPipelineChangeCount() const { return pipelineChangeCount_; }
+
+private: // メンバ変数
+	uint32_t drawCount_ = 0;
+	uint32_t dispatchCount_ = 0;
+	uint64_t instanceCount_ = 0;
+	uint32_t pipelineChangeCount_ = 0;
+	uint32_t currentPipeline_ = UINT32_MAX;
+};
+
+/// <summary>
+/// カメラの通り道の1点
+/// </summary>
+struct BenchmarkCameraKey {
+	float time;        // 秒
+	float position[3];
+	float yaw;         // +zからy軸まわりの回転(ラジアン)
+};
+
+/// <summary>
+/// 決まった手順で動かすシーンの設定
+/// </summary>
+struct BenchmarkSceneDesc {
+	std::string name;
+	uint32_t frameCount = 300;
+	uint32_t seed = 1;
+
+	uint32_t objectCount = 0;        // カリングとBVHの対象
+	float dynamicObjectRatio = 0.1f; // 毎フレーム動かす割合
+	float worldSize = 400.0f;        // 物体とライトを置く範囲(xz平面の一辺)
+	uint32_t lightCount = 0;
+	uint32_t particleCapacity = 0;
+	float particleEmitRate = 0.0f;   // 1秒あたり
+	uint32_t characterCount = 0;
+	uint32_t jointCount = 64;
+	uint32_t spriteCount = 0;
+	uint32_t hotReloadInterval = 0;  // このフレーム数ごとにシェーダーの読み直しを起こす(0なら起こさない)
+
+	std::vector<BenchmarkCameraKey> cameraPath; // 最後まで進んだら先頭に戻る
+};
+
+/// <summary>
+/// 確保の回数とバイト数。置き換えたoperator newなどで数えたものを渡す
+/// </summary>
+struct BenchmarkAllocationCounters {
+	std::atomic<uint64_t> count = 0;
+	std::atomic<uint64_t> bytes = 0;
+};
+
+/// <summary>
+/// レンダラーのCPU側をヘッドレスで動かすベンチマーク。
+/// 1フレームごとにシーンの更新・BVHの更新と検索・カリング・ライトの振り分け・パーティクル・アニメーション・スプライト・シェーダーの差し替えを行い、
+/// 段階ごとの時間と、そのフレームの確保数・積んだコマンド数を記録する
+/// </summary>
+class BenchmarkScene {
+public: // 静的メンバ関数
+	/// <summary>
+	/// 組み込みのシーン
+	/// </summary>
+	static std::vector<BenchmarkSceneDesc> GetBuiltInScenes();
+
+	/// <summary>
+	/// 記録する段階の名前(BenchmarkSceneResult::stageNamesと同じ順)
+	/// </summary>
+	static std::vector<std::string> GetStageNames();
+
+	/// <summary>
+	/// シーンを作って全フレームを実行する
+	/// </summary>
+	/// <param name="desc">シーンの設定</param>
+	/// <param name="threadCount">使用スレッド数(0なら自動)</param>
+	/// <param name="allocationCounters">確保数の取得元(数えないならnullptr)</param>
+	/// <returns>フレームごとの計測値と集計値</returns>
+	static BenchmarkSceneResult Run(const BenchmarkSceneDesc& desc, uint32_t threadCount, const BenchmarkAllocationCounters* allocationCounters);
+
+	/// <summary>
+	/// カメラの通り道からビュー行列とビュープロジェクション行列を作る(行ベクトル×行列の規約)
+	/// </summary>
+	static void EvaluateCamera(const std::vector<BenchmarkCameraKey>& path, float time, float outView[4][4], float outViewProjection[4][4]);
+};
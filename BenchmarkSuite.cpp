@@ -0,0 +1,743 @@
+#include "BenchmarkSuite.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "AnimationClip.h"
+#include "BindlessAllocator.h"
+#include "ClusteredLighting.h"
+#include "InputQueue.h"
+#include "MemoryArena.h"
+#include "SceneBvh.h"
+#include "SpriteBatch.h"
+#include "StartupTaskGraph.h"
+#include "TextureAtlas.h"
+#include "TextureCooker.h"
+
+namespace {
+
+// 環境によらず同じ列を返す乱数
+class Random {
+public:
+	explicit Random(uint32_t seed) : state_(seed) {}
+
+	uint32_t Next() {
+		state_ = state_ * 1664525u + 1013904223u;
+		return state_ >> 8;
+	}
+
+	float Range(float minimum, float maximum) {
+		return minimum + (maximum - minimum) * static_cast<float>(Next() & 0xFFFF) / 65535.0f;
+	}
+
+private:
+	uint32_t state_;
+};
+
+/*///////////////////////
+	計測
+*////////////////////////
+
+// 段階ごとに処理を受け取り、1回の空回しの後でrepeatCount回測る
+class SuiteRecorder {
+public:
+	SuiteRecorder(const BenchmarkSuiteDesc& desc, uint32_t threadCount, const BenchmarkAllocationCounters* allocationCounters)
+		: repeatCount_(std::max(1u, desc.repeatCount)), allocationCounters_(allocationCounters) {
+		result_.name = desc.name;
+		result_.threadCount = threadCount;
+		result_.frames.resize(repeatCount_);
+	}
+
+	// 測った1回あたりの時間の中央値(ミリ秒)を返す
+	double Measure(const std::string& stageName, const std::function<void()>& body) {
+		body();
+		result_.stageNames.push_back(stageName);
+		std::vector<double> times(repeatCount_);
+		for (uint32_t i = 0; i < repeatCount_; ++i) {
+			BenchmarkSceneResult::Frame& frame = result_.frames[i];
+			const uint64_t allocationCount = allocationCounters_ ? allocationCounters_->count.load(std::memory_order_relaxed) : 0;
+			const uint64_t allocatedBytes = allocationCounters_ ? allocationCounters_->bytes.load(std::memory_order_relaxed) : 0;
+			const auto start = std::chrono::steady_clock::now();
+			body();
+			times[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (allocationCounters_) {
+				frame.allocationCount += allocationCounters_->count.load(std::memory_order_relaxed) - allocationCount;
+				frame.allocatedBytes += allocationCounters_->bytes.load(std::memory_order_relaxed) - allocatedBytes;
+			}
+			frame.stageMilliseconds.push_back(times[i]);
+			frame.totalMilliseconds += times[i];
+		}
+		std::sort(times.begin(), times.end());
+		return times[(times.size() - 1) / 2];
+	}
+
+	void AddMetric(const std::string& name, double value) { result_.metrics.push_back({ name, value }); }
+
+	uint32_t GetThreadCount() const { return result_.threadCount; }
+
+	BenchmarkSceneResult Finish() {
+		result_.Summarize();
+		return std::move(result_);
+	}
+
+private:
+	uint32_t repeatCount_;
+	const BenchmarkAllocationCounters* allocationCounters_;
+	BenchmarkSceneResult result_;
+};
+
+/*///////////////////////
+	テクスチャの圧縮
+*////////////////////////
+void RunTextureEncode(SuiteRecorder& recorder) {
+	const uint32_t kSize = 512;
+	Random random(7);
+	TextureImage image;
+	image.width = kSize;
+	image.height = kSize;
+	image.pixels.resize(static_cast<size_t>(kSize) * kSize * 4);
+	for (uint32_t y = 0; y < kSize; ++y) {
+		for (uint32_t x = 0; x < kSize; ++x) {
+			// グラデーションに少しノイズを乗せる(単色ブロックだけだと圧縮が簡単すぎる)
+			uint8_t* pixel = &image.pixels[(static_cast<size_t>(y) * kSize + x) * 4];
+			pixel[0] = static_cast<uint8_t>(std::clamp(static_cast<float>(x) * 0.5f + random.Range(-8.0f, 8.0f), 0.0f, 255.0f));
+			pixel[1] = static_cast<uint8_t>(std::clamp(static_cast<float>(y) * 0.5f + random.Range(-8.0f, 8.0f), 0.0f, 255.0f));
+			pixel[2] = static_cast<uint8_t>(128.0f + 100.0f * std::sin(static_cast<float>(x + y) * 0.05f));
+			pixel[3] = static_cast<uint8_t>(255 - y / 4);
+		}
+	}
+
+	const struct {
+		const char* name;
+		TextureFormat format;
+		uint32_t channelMask;
+	} kFormats[] = {
+		{ "BC1", TextureFormat::BC1, 0x7 },
+		{ "BC3", TextureFormat::BC3, 0xF },
+		{ "BC5", TextureFormat::BC5, 0x3 },
+		{ "BC7", TextureFormat::BC7, 0xF },
+	};
+	const double megaPixels = static_cast<double>(kSize) * kSize / 1.0e6;
+	for (const auto& entry : kFormats) {
+		std::vector<uint8_t> encoded;
+		const double milliseconds = recorder.Measure(entry.name, [&] { encoded = TextureCooker::Encode(image, entry.format, recorder.GetThreadCount()); });
+		TextureImage decoded;
+		TextureCooker::Decode(encoded.data(), kSize, kSize, entry.format, decoded);
+		recorder.AddMetric(std::string(entry.name) + ".megaPixelsPerSecond", megaPixels / (milliseconds / 1000.0));
+		recorder.AddMetric(std::string(entry.name) + ".psnr", TextureCooker::CalculatePSNR(image, decoded, entry.channelMask));
+	}
+
+	// ミップ生成から書き出し用コンテナの作成まで
+	TextureCooker::Desc desc;
+	desc.threadCount = recorder.GetThreadCount();
+	recorder.Measure("CookBC7", [&] { TextureCooker::Cook(image, desc); });
+}
+
+/*///////////////////////
+	確保の競合
+	(全スレッドが同時に小さな確保を繰り返し、mallocと専用アロケータを比べる)
+*////////////////////////
+void RunAllocators(SuiteRecorder& recorder) {
+	const uint32_t kAllocationsPerThread = 20000;
+	const uint32_t kMaxAllocationSize = 256;
+	const uint32_t threadCount = recorder.GetThreadCount();
+
+	Random random(11);
+	std::vector<uint32_t> sizes(kAllocationsPerThread);
+	for (uint32_t& size : sizes) {
+		size = 16 + random.Next() % (kMaxAllocationSize - 15);
+	}
+	std::vector<std::vector<void*>> pointers(threadCount, std::vector<void*>(kAllocationsPerThread));
+
+	// 全スレッドで同じ処理を行う
+	auto runThreads = [&](const std::function<void(uint32_t)>& body) {
+		std::vector<std::thread> workers;
+		workers.reserve(threadCount);
+		for (uint32_t i = 0; i < threadCount; ++i) {
+			workers.emplace_back(body, i);
+		}
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	};
+	// 書き込んで、確保したメモリが実際に使われるようにする
+	auto touch = [](void* pointer, uint32_t value) { *static_cast<uint8_t*>(pointer) = static_cast<uint8_t>(value); };
+
+	std::vector<std::pair<std::string, double>> times;
+	times.emplace_back("Malloc", recorder.Measure("Malloc", [&] {
+		runThreads([&](uint32_t thread) {
+			std::vector<void*>& owned = pointers[thread];
+			for (uint32_t i = 0; i < kAllocationsPerThread; ++i) {
+				owned[i] = std::malloc(sizes[i]);
+				touch(owned[i], i);
+			}
+			for (void* pointer : owned) {
+				std::free(pointer);
+			}
+		});
+	}));
+
+	// 全スレッドが1つのフレームアロケータを共有する(詰め物の分も見込んだ容量)
+	FrameAllocator frameAllocator(static_cast<size_t>(threadCount) * kAllocationsPerThread * (kMaxAllocationSize + alignof(std::max_align_t)), "BenchmarkFrame");
+	times.emplace_back("FrameAllocator", recorder.Measure("FrameAllocator", [&] {
+		frameAllocator.BeginFrame();
+		runThreads([&](uint32_t) {
+			for (uint32_t i = 0; i < kAllocationsPerThread; ++i) {
+				touch(frameAllocator.Allocate(sizes[i]), i);
+			}
+		});
+	}));
+
+	std::vector<std::unique_ptr<ScratchStack>> stacks;
+	std::vector<std::unique_ptr<PoolAllocator>> pools;
+	for (uint32_t i = 0; i < threadCount; ++i) {
+		stacks.push_back(std::make_unique<ScratchStack>(static_cast<size_t>(kAllocationsPerThread) * (kMaxAllocationSize + alignof(std::max_align_t)), "BenchmarkScratch"));
+		pools.push_back(std::make_unique<PoolAllocator>(kMaxAllocationSize, 4096, "BenchmarkPool"));
+	}
+	times.emplace_back("ScratchStack", recorder.Measure("ScratchStack", [&] {
+		runThreads([&](uint32_t thread) {
+			ScratchScope scope(*stacks[thread]);
+			for (uint32_t i = 0; i < kAllocationsPerThread; ++i) {
+				touch(scope.Allocate(sizes[i]), i);
+			}
+		});
+	}));
+	times.emplace_back("Pool", recorder.Measure("Pool", [&] {
+		runThreads([&](uint32_t thread) {
+			std::vector<void*>& owned = pointers[thread];
+			for (uint32_t i = 0; i < kAllocationsPerThread; ++i) {
+				owned[i] = pools[thread]->Allocate();
+				touch(owned[i], i);
+			}
+			for (void* pointer : owned) {
+				pools[thread]->Free(pointer);
+			}
+		});
+	}));
+
+	const double allocationCount = static_cast<double>(threadCount) * kAllocationsPerThread;
+	for (const auto& [name, milliseconds] : times) {
+		recorder.AddMetric(name + ".nanosecondsPerAllocation", milliseconds * 1.0e6 / allocationCount);
+	}
+}
+
+/*///////////////////////
+	起動時間
+	(main.cppと同じ依存関係のグラフを、プラットフォームの処理を置き換えたスタブで実行する)
+*////////////////////////
+void RunStartup(SuiteRecorder& recorder) {
+	using TaskId = StartupTaskGraph::TaskId;
+	// ドライバやOSを待つ処理は眠るだけ、CPUで行う処理は回し続けて時間を使う
+	auto wait = [](double milliseconds) {
+		return [milliseconds] {
+			std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(milliseconds));
+			return true;
+		};
+	};
+	auto work = [](double milliseconds) {
+		return [milliseconds] {
+			const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(milliseconds);
+			while (std::chrono::steady_clock::now() < end) {
+			}
+			return true;
+		};
+	};
+
+	StartupTaskGraph graph;
+	TaskId window = graph.AddTask("Window", wait(4.0), {}, StartupTaskGraph::Affinity::MainThread);
+	TaskId debugLayer = graph.AddTask("DebugLayer", wait(2.0));
+	TaskId factory = graph.AddTask("DXGIFactory", wait(2.0));
+	TaskId adapter = graph.AddTask("Adapter", wait(3.0), { factory });
+	TaskId device = graph.AddTask("Device", wait(12.0), { debugLayer, adapter });
+	graph.AddTask("InfoQueue", wait(0.5), { device });
+	TaskId commandQueue = graph.AddTask("CommandQueue", wait(1.0), { device });
+	TaskId swapChain = graph.AddTask("SwapChain", wait(5.0), { window, factory, commandQueue }, StartupTaskGraph::Affinity::MainThread);
+	TaskId rtvHeap = graph.AddTask("RTVHeap", wait(0.5), { device });
+	graph.AddTask("RenderTargetViews", wait(0.5), { swapChain, rtvHeap });
+	graph.AddTask("Fence", wait(0.5), { device });
+	TaskId shaderWarmUp = graph.AddTask("ShaderWarmUp", work(15.0));
+	graph.AddTask("GpuTimer", wait(0.5), { commandQueue });
+	TaskId bindlessHeap = graph.AddTask("BindlessHeap", wait(1.0), { device });
+	graph.AddTask("UpscalePipeline", wait(4.0), { device, bindlessHeap, shaderWarmUp });
+	graph.AddTask("Particles", wait(4.0), { device, shaderWarmUp });
+	TaskId spriteAtlas = graph.AddTask("SpriteAtlas", work(6.0));
+	graph.AddTask("Sprites", wait(3.0), { device, bindlessHeap, shaderWarmUp, spriteAtlas });
+
+	// main.cppと同じく、ワーカーは最大4つ
+	const uint32_t workerCount = std::min(recorder.GetThreadCount(), 4u);
+	const double serialMilliseconds = recorder.Measure("Serial", [&] { graph.Run(0); });
+	const double parallelMilliseconds = recorder.Measure("Parallel", [&] { graph.Run(workerCount); });
+	recorder.AddMetric("Parallel.workerCount", workerCount);
+	recorder.AddMetric("Parallel.criticalPathMilliseconds", graph.GetCriticalPathMilliseconds());
+	recorder.AddMetric("Parallel.speedup", serialMilliseconds / parallelMilliseconds);
+}
+
+/*///////////////////////
+	入力イベントの受け渡し
+	(入力スレッドが時刻つきのイベントを積み、ゲームスレッドが取り出すまでの時間とスループット)
+*////////////////////////
+void RunInputQueue(SuiteRecorder& recorder) {
+	const uint32_t kEventCount = 200000;
+	const uint32_t kLatencySampleInterval = 64;
+
+	// 書き込みスレッドを1つ立て、読み出し側はこのスレッドで回す。取り出すまでの時間を間引いて記録する
+	std::vector<double> latencies;
+	latencies.reserve(kEventCount / kLatencySampleInterval + 1);
+	auto transfer = [&](const std::function<bool(const InputEvent&)>& push, const std::function<bool(InputEvent&)>& pop) {
+		latencies.clear();
+		std::thread producer([&] {
+			for (uint32_t i = 0; i < kEventCount; ++i) {
+				InputEvent event{ InputQueue::GetTimestamp(), InputEventType::MouseMove, i, 1, -1 };
+				while (!push(event)) {
+					std::this_thread::yield();
+				}
+			}
+		});
+		InputEvent event{};
+		for (uint32_t received = 0; received < kEventCount;) {
+			if (!pop(event)) {
+				std::this_thread::yield();
+				continue;
+			}
+			if (event.code % kLatencySampleInterval == 0) {
+				latencies.push_back(static_cast<double>(InputQueue::GetTimestamp() - event.timestamp) / 1000.0);
+			}
+			++received;
+		}
+		producer.join();
+	};
+	auto addLatencyMetrics = [&](const std::string& name) {
+		std::sort(latencies.begin(), latencies.end());
+		recorder.AddMetric(name + ".latencyP50Microseconds", latencies[latencies.size() / 2]);
+		recorder.AddMetric(name + ".latencyP99Microseconds", latencies[latencies.size() * 99 / 100]);
+	};
+
+	auto ring = std::make_unique<SpscRing<InputEvent, InputQueue::kCapacity>>();
+	const double ringMilliseconds = recorder.Measure("SpscRing", [&] {
+		transfer([&](const InputEvent& event) { return ring->Push(event); }, [&](InputEvent& event) { return ring->Pop(event); });
+	});
+	recorder.AddMetric("SpscRing.eventsPerSecond", kEventCount / (ringMilliseconds / 1000.0));
+	addLatencyMetrics("SpscRing");
+
+	// 比較用に、ロックで守った両端キュー(容量は同じ)
+	std::mutex mutex;
+	std::deque<InputEvent> deque;
+	const double mutexMilliseconds = recorder.Measure("MutexQueue", [&] {
+		transfer([&](const InputEvent& event) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (deque.size() == InputQueue::kCapacity) {
+				return false;
+			}
+			deque.push_back(event);
+			return true;
+		}, [&](InputEvent& event) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (deque.empty()) {
+				return false;
+			}
+			event = deque.front();
+			deque.pop_front();
+			return true;
+		});
+	});
+	recorder.AddMetric("MutexQueue.eventsPerSecond", kEventCount / (mutexMilliseconds / 1000.0));
+	addLatencyMetrics("MutexQueue");
+
+	// マウスを激しく動かしたときの1回分の取り込み(まとめてから入力状態へ反映する)
+	const uint32_t kBurstCount = InputQueue::kCapacity;
+	auto queue = std::make_unique<InputQueue>();
+	InputState state;
+	std::vector<InputEvent> burst(kBurstCount);
+	for (uint32_t i = 0; i < kBurstCount; ++i) {
+		// 間にボタン操作を挟み、まとめられない区切りを作る
+		const InputEventType type = i % 64 == 63 ? InputEventType::MouseButtonDown : InputEventType::MouseMove;
+		burst[i] = { i, type, 0, 1, 1 };
+	}
+	const double drainMilliseconds = recorder.Measure("BurstDrain", [&] {
+		for (const InputEvent& event : burst) {
+			queue->Push(event);
+		}
+		state.BeginUpdate();
+		queue->Drain(UINT64_MAX, state);
+	});
+	recorder.AddMetric("BurstDrain.nanosecondsPerEvent", drainMilliseconds * 1.0e6 / kBurstCount);
+}
+
+/*///////////////////////
+	描画ごとのバインドのコスト
+	(描画ごとにディスクリプタをコピーしてテーブルを設定する方式と、インデックスをルート定数で渡すバインドレスを比べる。
+	 D3D12の呼び出しは、コマンド列への書き込みとディスクリプタのコピーに置き換える)
+*////////////////////////
+void RunBindless(SuiteRecorder& recorder) {
+	const uint32_t kDrawCount = 100000;
+	const uint32_t kResourcesPerDraw = 4;    // 定数バッファ1つとテクスチャ3枚
+	const uint32_t kResourceCount = 4096;
+	const size_t kDescriptorSize = 32;       // CBV_SRV_UAVのディスクリプタ1つ分(一般的なGPUの値)
+
+	enum Command : uint32_t {
+		kSetGraphicsRootDescriptorTable,
+		kSetGraphicsRoot32BitConstants,
+		kDrawIndexedInstanced,
+	};
+	std::vector<uint32_t> commands;
+	commands.reserve(static_cast<size_t>(kDrawCount) * (kResourcesPerDraw + 8));
+
+	Random random(13);
+	BindlessAllocator allocator;
+	allocator.Initialize(kResourceCount);
+	std::vector<BindlessHandle> resources(kResourceCount);
+	for (BindlessHandle& handle : resources) {
+		handle = allocator.Allocate();
+	}
+	std::vector<uint32_t> drawResources(static_cast<size_t>(kDrawCount) * kResourcesPerDraw);
+	for (uint32_t& resource : drawResources) {
+		resource = random.Next() % kResourceCount;
+	}
+
+	// CPU側に置いたディスクリプタと、毎フレーム使い捨てるシェーダーから見えるヒープ
+	std::vector<uint8_t> stagingDescriptors(kResourceCount * kDescriptorSize);
+	for (size_t i = 0; i < stagingDescriptors.size(); ++i) {
+		stagingDescriptors[i] = static_cast<uint8_t>(i);
+	}
+	std::vector<uint8_t> shaderVisibleDescriptors(static_cast<size_t>(kDrawCount) * kResourcesPerDraw * kDescriptorSize);
+	const double tableMilliseconds = recorder.Measure("DescriptorTable", [&] {
+		commands.clear();
+		size_t heapOffset = 0;
+		for (uint32_t draw = 0; draw < kDrawCount; ++draw) {
+			// CopyDescriptorsSimpleで連続した領域に集めてから、その先頭をテーブルとして設定する
+			const size_t tableStart = heapOffset;
+			for (uint32_t i = 0; i < kResourcesPerDraw; ++i) {
+				const uint32_t resource = drawResources[static_cast<size_t>(draw) * kResourcesPerDraw + i];
+				std::memcpy(&shaderVisibleDescriptors[heapOffset], &stagingDescriptors[resource * kDescriptorSize], kDescriptorSize);
+				heapOffset += kDescriptorSize;
+			}
+			commands.push_back(kSetGraphicsRootDescriptorTable);
+			commands.push_back(static_cast<uint32_t>(tableStart));
+			commands.push_back(kDrawIndexedInstanced);
+		}
+	});
+
+	const double bindlessMilliseconds = recorder.Measure("Bindless", [&] {
+		commands.clear();
+		for (uint32_t draw = 0; draw < kDrawCount; ++draw) {
+			// インデックスをそのままルート定数で渡す
+			commands.push_back(kSetGraphicsRoot32BitConstants);
+			commands.push_back(kResourcesPerDraw);
+			for (uint32_t i = 0; i < kResourcesPerDraw; ++i) {
+				commands.push_back(resources[drawResources[static_cast<size_t>(draw) * kResourcesPerDraw + i]].GetIndex());
+			}
+			commands.push_back(kDrawIndexedInstanced);
+		}
+	});
+
+	// デバッグビルドのように、渡す前にハンドルが古くなっていないか確かめる場合
+	uint32_t invalidCount = 0;
+	const double validatedMilliseconds = recorder.Measure("BindlessCheck", [&] {
+		commands.clear();
+		invalidCount = 0;
+		for (uint32_t draw = 0; draw < kDrawCount; ++draw) {
+			commands.push_back(kSetGraphicsRoot32BitConstants);
+			commands.push_back(kResourcesPerDraw);
+			for (uint32_t i = 0; i < kResourcesPerDraw; ++i) {
+				const BindlessHandle handle = resources[drawResources[static_cast<size_t>(draw) * kResourcesPerDraw + i]];
+				invalidCount += allocator.IsValid(handle) ? 0 : 1;
+				commands.push_back(handle.GetIndex());
+			}
+			commands.push_back(kDrawIndexedInstanced);
+		}
+	});
+
+	// ストリーミングのようにリソースを作り直し続けたときのスロット管理(フレームごとに1割を入れ替える)
+	const uint32_t kFrameCount = 100;
+	const uint32_t kChurnPerFrame = kResourceCount / 10;
+	const double churnMilliseconds = recorder.Measure("SlotChurn", [&] {
+		uint64_t fenceValue = 0;
+		for (uint32_t frame = 0; frame < kFrameCount; ++frame) {
+			for (uint32_t i = 0; i < kChurnPerFrame; ++i) {
+				BindlessHandle& handle = resources[(frame * kChurnPerFrame + i) % kResourceCount];
+				allocator.Free(handle, fenceValue + 2);
+				handle = allocator.Allocate();
+			}
+			// 2フレーム遅れでGPUが追いつく
+			++fenceValue;
+			allocator.Recycle(fenceValue);
+		}
+		allocator.Recycle(UINT64_MAX);
+	});
+
+	const double nanosecondsPerMillisecond = 1.0e6;
+	recorder.AddMetric("DescriptorTable.nanosecondsPerDraw", tableMilliseconds * nanosecondsPerMillisecond / kDrawCount);
+	recorder.AddMetric("Bindless.nanosecondsPerDraw", bindlessMilliseconds * nanosecondsPerMillisecond / kDrawCount);
+	recorder.AddMetric("BindlessCheck.nanosecondsPerDraw", validatedMilliseconds * nanosecondsPerMillisecond / kDrawCount);
+	recorder.AddMetric("BindlessCheck.invalidHandles", invalidCount);
+	recorder.AddMetric("SlotChurn.nanosecondsPerReplace", churnMilliseconds * nanosecondsPerMillisecond / (kFrameCount * kChurnPerFrame));
+}
+
+/*///////////////////////
+	ライト数ごとのクラスターへの割り当て
+	(ライトの密度を保ったまま範囲を広げ、64k個まで増やす)
+*////////////////////////
+void RunLightSweep(SuiteRecorder& recorder) {
+	const uint32_t kLightCounts[] = { 1024, 4096, 16384, 65536 };
+	const float kLightsPerSquareMeter = 4096.0f / (400.0f * 400.0f);
+
+	ClusterGridDesc clusterDesc;
+	clusterDesc.farZ = 2000.0f;
+	ClusteredLighting clusteredLighting;
+	clusteredLighting.Initialize(clusterDesc);
+	// 原点から+zを見下ろすカメラ
+	const float view[4][4] = {
+		{ 1.0f, 0.0f, 0.0f, 0.0f },
+		{ 0.0f, 1.0f, 0.0f, 0.0f },
+		{ 0.0f, 0.0f, 1.0f, 0.0f },
+		{ 0.0f, -20.0f, 0.0f, 1.0f },
+	};
+
+	for (uint32_t lightCount : kLightCounts) {
+		Random random(lightCount);
+		const float halfWorldSize = 0.5f * std::sqrt(static_cast<float>(lightCount) / kLightsPerSquareMeter);
+		std::vector<ClusterLight> lights(lightCount);
+		for (ClusterLight& light : lights) {
+			light.position[0] = random.Range(-halfWorldSize, halfWorldSize);
+			light.position[1] = random.Range(1.0f, 15.0f);
+			light.position[2] = random.Range(-halfWorldSize, halfWorldSize);
+			light.radius = random.Range(5.0f, 20.0f);
+			light.color[0] = light.color[1] = light.color[2] = 1.0f;
+			light.intensity = 1.0f;
+		}
+
+		const std::string name = "Build" + std::to_string(lightCount);
+		const double milliseconds = recorder.Measure(name, [&] { clusteredLighting.Build(view, lights.data(), lightCount, recorder.GetThreadCount()); });
+		recorder.AddMetric(name + ".lightsPerMillisecond", lightCount / milliseconds);
+		recorder.AddMetric(name + ".lightIndexCount", static_cast<double>(clusteredLighting.GetLightIndices().size()));
+	}
+}
+
+/*///////////////////////
+	アニメーションの圧縮
+	(圧縮前後の1クリップあたりの大きさと、サンプリングの速さを比べる)
+*////////////////////////
+void RunAnimation(SuiteRecorder& recorder) {
+	const uint32_t kJointCount = 64;
+	const uint32_t kFrameCount = 301; // 30fpsで10秒
+	const uint32_t kSampleCount = 1000;
+
+	// 関節ごとに周期と振れ幅の違う揺れ。4関節に1つは動かさない
+	Random random(17);
+	AnimationClip clip;
+	clip.Initialize(kJointCount, kFrameCount, 30.0f);
+	for (uint32_t joint = 0; joint < kJointCount; ++joint) {
+		const float frequency = random.Range(0.3f, 2.0f);
+		const float phase = random.Range(0.0f, 6.2831853f);
+		const float amplitude = joint % 4 == 3 ? 0.0f : random.Range(0.1f, 1.0f);
+		for (uint32_t frame = 0; frame < kFrameCount; ++frame) {
+			const float angle = amplitude * std::sin(6.2831853f * frequency * static_cast<float>(frame) / 30.0f + phase);
+			JointTransform& key = clip.GetKey(frame, joint);
+			key.translation[1] = joint == 0 ? 0.05f * angle : 0.2f;
+			key.rotation[0] = std::sin(angle * 0.5f) * 0.6f;
+			key.rotation[2] = std::sin(angle * 0.5f) * 0.8f;
+			key.rotation[3] = std::cos(angle * 0.5f);
+		}
+	}
+
+	CompressedClip compressed;
+	recorder.Measure("Compress", [&] { compressed.Compress(clip); });
+
+	AnimationPose pose;
+	const float timeStep = clip.GetDuration() / static_cast<float>(kSampleCount);
+	const double rawMilliseconds = recorder.Measure("Raw", [&] {
+		for (uint32_t i = 0; i < kSampleCount; ++i) {
+			clip.Sample(static_cast<float>(i) * timeStep, pose);
+		}
+	});
+	const double compressedMilliseconds = recorder.Measure("Compressed", [&] {
+		for (uint32_t i = 0; i < kSampleCount; ++i) {
+			compressed.Sample(static_cast<float>(i) * timeStep, pose);
+		}
+	});
+
+	recorder.AddMetric("bytesPerClip", static_cast<double>(clip.GetSizeInBytes()));
+	recorder.AddMetric("compressedBytesPerClip", static_cast<double>(compressed.GetSizeInBytes()));
+	recorder.AddMetric("compressionRatio", static_cast<double>(clip.GetSizeInBytes()) / static_cast<double>(compressed.GetSizeInBytes()));
+	recorder.AddMetric("Raw.nanosecondsPerJoint", rawMilliseconds * 1.0e6 / (static_cast<double>(kSampleCount) * kJointCount));
+	recorder.AddMetric("Compressed.nanosecondsPerJoint", compressedMilliseconds * 1.0e6 / (static_cast<double>(kSampleCount) * kJointCount));
+}
+
+/*///////////////////////
+	スプライトの並べ替えとアトラスの詰め込み
+	(10万枚を超えるスプライトを1フレーム分積んで書き出す)
+*////////////////////////
+void RunSprites(SuiteRecorder& recorder) {
+	const uint32_t kSpriteCounts[] = { 16384, 131072, 262144 };
+	const uint32_t kLayerCount = 8;
+	const uint32_t kPageCount = 16;
+
+	SpriteBatch spriteBatch;
+	for (uint32_t spriteCount : kSpriteCounts) {
+		Random random(spriteCount);
+		std::vector<Sprite> sprites(spriteCount);
+		for (Sprite& sprite : sprites) {
+			sprite = {};
+			sprite.position[0] = random.Range(0.0f, 1920.0f);
+			sprite.position[1] = random.Range(0.0f, 1080.0f);
+			sprite.size[0] = random.Range(8.0f, 64.0f);
+			sprite.size[1] = random.Range(8.0f, 64.0f);
+			sprite.uvMax[0] = sprite.uvMax[1] = 0.25f;
+			sprite.color = 0xffffffffu;
+			sprite.textureIndex = random.Next() % kPageCount;
+			sprite.layer = static_cast<uint16_t>(random.Next() % kLayerCount);
+		}
+		std::vector<SpriteInstance> instances(spriteCount);
+
+		const std::string name = "Batch" + std::to_string(spriteCount);
+		const double milliseconds = recorder.Measure(name, [&] {
+			spriteBatch.Begin();
+			for (const Sprite& sprite : sprites) {
+				spriteBatch.Draw(sprite);
+			}
+			spriteBatch.End(instances.data(), spriteCount);
+		});
+		recorder.AddMetric(name + ".nanosecondsPerSprite", milliseconds * 1.0e6 / spriteCount);
+		recorder.AddMetric(name + ".drawCount", static_cast<double>(spriteBatch.GetBatches().size()));
+	}
+
+	// UIやエフェクト程度の大きさの画像を2048のページに詰める
+	Random random(23);
+	std::vector<TextureImage> images(2048);
+	for (TextureImage& image : images) {
+		image.width = 8 + random.Next() % 120;
+		image.height = 8 + random.Next() % 120;
+		image.pixels.assign(static_cast<size_t>(image.width) * image.height * 4, 0x80);
+	}
+	std::vector<TextureImage> pages;
+	std::vector<AtlasRect> rects;
+	recorder.Measure("AtlasBuild", [&] { TextureAtlas::Build(images, 2048, 2, pages, rects); });
+	recorder.AddMetric("AtlasBuild.pageCount", static_cast<double>(pages.size()));
+}
+
+/*///////////////////////
+	BVHの構築・リフィット・クエリ
+	(物体の密度を保ったまま10万から100万個まで増やす)
+*////////////////////////
+void RunBvh(SuiteRecorder& recorder) {
+	const uint32_t kPrimitiveCounts[] = { 100000, 250000, 1000000 };
+	const float kObjectsPerSquareMeter = 100000.0f / (600.0f * 600.0f);
+	const uint32_t kRayCount = 100000;
+	const uint32_t kThreadCount = recorder.GetThreadCount();
+
+	SceneBvh bvh;
+	std::vector<uint32_t> queryResults;
+	for (uint32_t primitiveCount : kPrimitiveCounts) {
+		Random random(primitiveCount);
+		const float halfWorldSize = 0.5f * std::sqrt(static_cast<float>(primitiveCount) / kObjectsPerSquareMeter);
+		std::vector<BvhBounds> bounds(primitiveCount);
+		std::vector<float> centers(static_cast<size_t>(primitiveCount) * 3);
+		std::vector<float> radii(primitiveCount);
+		for (uint32_t i = 0; i < primitiveCount; ++i) {
+			centers[i * 3 + 0] = random.Range(-halfWorldSize, halfWorldSize);
+			centers[i * 3 + 1] = random.Range(0.0f, 20.0f);
+			centers[i * 3 + 2] = random.Range(-halfWorldSize, halfWorldSize);
+			radii[i] = random.Range(0.5f, 3.0f);
+		}
+		auto updateBounds = [&](float offset) {
+			for (uint32_t i = 0; i < primitiveCount; ++i) {
+				for (uint32_t axis = 0; axis < 3; ++axis) {
+					const float center = centers[i * 3 + axis] + (axis == 1 ? 0.0f : offset * std::sin(static_cast<float>(i) * 0.37f));
+					bounds[i].min[axis] = center - radii[i];
+					bounds[i].max[axis] = center + radii[i];
+				}
+			}
+		};
+		updateBounds(0.0f);
+
+		// 地面すれすれを横切るレイ
+		std::vector<BvhRay> rays(kRayCount);
+		for (BvhRay& ray : rays) {
+			ray.origin[0] = random.Range(-halfWorldSize, halfWorldSize);
+			ray.origin[1] = random.Range(1.0f, 19.0f);
+			ray.origin[2] = random.Range(-halfWorldSize, halfWorldSize);
+			const float angle = random.Range(0.0f, 6.2831853f);
+			ray.direction[0] = std::cos(angle);
+			ray.direction[1] = random.Range(-0.05f, 0.05f);
+			ray.direction[2] = std::sin(angle);
+			ray.maxDistance = 100.0f;
+		}
+		std::vector<BvhHit> hits(kRayCount);
+
+		// 原点から+zを向いた90度の視錐台
+		const float planes[6][4] = {
+			{ 1.0f, 0.0f, 1.0f, 0.0f },
+			{ -1.0f, 0.0f, 1.0f, 0.0f },
+			{ 0.0f, 1.0f, 1.0f, 0.0f },
+			{ 0.0f, -1.0f, 1.0f, 0.0f },
+			{ 0.0f, 0.0f, 1.0f, -0.1f },
+			{ 0.0f, 0.0f, -1.0f, 300.0f },
+		};
+
+		const std::string suffix = primitiveCount >= 1000000 ? std::to_string(primitiveCount / 1000000) + "M" : std::to_string(primitiveCount / 1000) + "k";
+		const double buildMilliseconds = recorder.Measure("Build" + suffix, [&] { bvh.Build(bounds.data(), primitiveCount, kThreadCount); });
+		updateBounds(2.0f);
+		const double refitMilliseconds = recorder.Measure("Refit" + suffix, [&] { bvh.Refit(bounds.data(), kThreadCount); });
+		recorder.Measure("Frustum" + suffix, [&] {
+			queryResults.clear();
+			bvh.QueryFrustum(planes, queryResults);
+		});
+		const double rayMilliseconds = recorder.Measure("Rays" + suffix, [&] { bvh.IntersectBatch(rays.data(), kRayCount, hits.data(), kThreadCount); });
+
+		recorder.AddMetric("Build" + suffix + ".primitivesPerMillisecond", primitiveCount / buildMilliseconds);
+		recorder.AddMetric("Refit" + suffix + ".primitivesPerMillisecond", primitiveCount / refitMilliseconds);
+		recorder.AddMetric("Frustum" + suffix + ".visibleCount", static_cast<double>(queryResults.size()));
+		recorder.AddMetric("Rays" + suffix + ".raysPerMillisecond", kRayCount / rayMilliseconds);
+	}
+}
+
+const struct {
+	const char* name;
+	uint32_t repeatCount;
+	void (*run)(SuiteRecorder& recorder);
+} kSuites[] = {
+	{ "TextureEncode", 5, RunTextureEncode },
+	{ "Allocators", 20, RunAllocators },
+	{ "Startup", 10, RunStartup },
+	{ "InputQueue", 10, RunInputQueue },
+	{ "Bindless", 10, RunBindless },
+	{ "LightSweep", 10, RunLightSweep },
+	{ "Animation", 10, RunAnimation },
+	{ "Sprites", 10, RunSprites },
+	{ "Bvh", 5, RunBvh },
+};
+
+} // namespace
+
+/*///////////////////////
+	BenchmarkSuite
+*////////////////////////
+std::vector<BenchmarkSuiteDesc> BenchmarkSuite::GetBuiltInSuites() {
+	std::vector<BenchmarkSuiteDesc> suites;
+	for (const auto& suite : kSuites) {
+		suites.push_back({ suite.name, suite.repeatCount });
+	}
+	return suites;
+}
+
+BenchmarkSceneResult BenchmarkSuite::Run(const BenchmarkSuiteDesc& desc, uint32_t threadCount, const BenchmarkAllocationCounters* allocationCounters) {
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	SuiteRecorder recorder(desc, threadCount, allocationCounters);
+	for (const auto& suite : kSuites) {
+		if (desc.name == suite.name) {
+			suite.run(recorder);
+			break;
+		}
+	}
+	return recorder.Finish();
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BenchmarkReport.h"
+#include "BenchmarkScene.h"
+
+/// <summary>
+/// 単体ベンチマークの設定
+/// </summary>
+struct BenchmarkSuiteDesc {
+	std::string name;
+	uint32_t repeatCount = 10; // 各段階を測る回数
+};
+
+/// <summary>
+/// シーンとは別に、1つのモジュールの処理を方式や規模ごとに測るベンチマーク。
+/// 段階を方式、フレームを繰り返しの1回として、シーンと同じ形の結果を返す(同じレポートに書き出して比較できる)
+/// </summary>
+class BenchmarkSuite {
+public: // 静的メンバ関数
+	/// <summary>
+	/// 組み込みの単体ベンチマーク
+	/// </summary>
+	static std::vector<BenchmarkSuiteDesc> GetBuiltInSuites();
+
+	/// <summary>
+	/// 全段階を繰り返し実行する
+	/// </summary>
+	/// <param name="desc">単体ベンチマークの設定</param>
+	/// <param name="threadCount">使用スレッド数(0なら自動)</param>
+	/// <param name="allocationCounters">確保数の取得元(数えないならnullptr)</param>
+	/// <returns>繰り返しごとの計測値と集計値。スループットなどはmetricsに入る</returns>
+	static BenchmarkSceneResult Run(const BenchmarkSuiteDesc& desc, uint32_t threadCount, const BenchmarkAllocationCounters* allocationCounters);
+};
@@ -0,0 +1,73 @@
+#include "BindlessAllocator.h"
+
+#include <cassert>
+
+void BindlessAllocator::Initialize(uint32_t capacity) {
+	assert(capacity <= BindlessHandle::kMaxCapacity);
+	std::lock_guard<std::mutex> lock(mutex_);
+	capacity_ = capacity;
+	nextUnusedIndex_ = 0;
+	freeIndices_.clear();
+	pendingFrees_.clear();
+	versions_.assign(capacity, 1);
+	allocated_.assign(capacity, false);
+	allocatedCount_ = 0;
+}
+
+BindlessHandle BindlessAllocator::Allocate() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	uint32_t index;
+	if (!freeIndices_.empty()) {
+		index = freeIndices_.back();
+		freeIndices_.pop_back();
+	} else if (nextUnusedIndex_ < capacity_) {
+		index = nextUnusedIndex_++;
+	} else {
+		return {};
+	}
+	allocated_[index] = true;
+	++allocatedCount_;
+	return BindlessHandle::Make(index, versions_[index]);
+}
+
+bool BindlessAllocator::Free(BindlessHandle handle, uint64_t fenceValue) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	uint32_t index = handle.GetIndex();
+	if (handle.IsNull() || index >= capacity_ || !allocated_[index] || versions_[index] != handle.GetVersion()) {
+		return false;
+	}
+	allocated_[index] = false;
+	--allocatedCount_;
+	// 世代を進める。0は無効なハンドル用なので飛ばす
+	uint16_t version = static_cast<uint16_t>((versions_[index] + 1) & BindlessHandle::kVersionMask);
+	versions_[index] = version == 0 ? 1 : version;
+	pendingFrees_.emplace_back(fenceValue, index);
+	return true;
+}
+
+uint32_t BindlessAllocator::Recycle(uint64_t completedFenceValue) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	uint32_t count = 0;
+	while (!pendingFrees_.empty() && pendingFrees_.front().first <= completedFenceValue) {
+		freeIndices_.push_back(pendingFrees_.front().second);
+		pendingFrees_.pop_front();
+		++count;
+	}
+	return count;
+}
+
+bool BindlessAllocator::IsValid(BindlessHandle handle) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	uint32_t index = handle.GetIndex();
+	return !handle.IsNull() && index < capacity_ && allocated_[index] && versions_[index] == handle.GetVersion();
+}
+
+uint32_t BindlessAllocator::GetAllocatedCount() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return allocatedCount_;
+}
+
+uint32_t BindlessAllocator::GetPendingCount() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return static_cast<uint32_t>(pendingFrees_.size());
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/// <summary>
+/// グローバルなディスクリプタヒープ上の1スロットを指すハンドル。
+/// 下位20ビットがシェーダーに渡すインデックス、上位12ビットが世代で、解放済みのスロットを指していないか確認できる
+/// </summary>
+struct BindlessHandle {
+	static const uint32_t kIndexBits = 20;
+	static const uint32_t kIndexMask = (1u << kIndexBits) - 1;
+	static const uint32_t kVersionMask = (1u << (32 - kIndexBits)) - 1;
+	// インデックスで表せる最大数(D3D12のCBV_SRV_UAVヒープの上限100万個が収まる)
+	static const uint32_t kMaxCapacity = 1u << kIndexBits;
+
+	uint32_t value = 0; // 0は無効(世代は1から始まるので有効なハンドルは0にならない)
+
+	static BindlessHandle Make(uint32_t index, uint32_t version) { return { (version << kIndexBits) | (index & kIndexMask) }; }
+
+	uint32_t GetIndex() const { return value & kIndexMask; }
+	uint32_t GetVersion() const { return value >> kIndexBits; }
+	bool IsNull() const { return value == 0; }
+};
+
+/// <summary>
+/// バインドレス用のスロット管理。解放したスロットは指定したフェンス値をGPUが通過するまで再利用しない。
+/// スレッドセーフ
+/// </summary>
+class BindlessAllocator {
+public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="capacity">スロット数(BindlessHandle::kMaxCapacity以下)</param>
+	void Initialize(uint32_t capacity);
+
+	/// <summary>
+	/// スロットの確保。空きがなければ無効なハンドルを返す
+	/// </summary>
+	BindlessHandle Allocate();
+
+	/// <summary>
+	/// スロットの解放。この時点で世代が進むので古いハンドルは無効になる
+	/// </summary>
+	/// <param name="handle">解放するハンドル</param>
+	/// <param name="fenceValue">このスロットを最後に使うコマンドの後にシグナルされるフェンス値</param>
+	/// <returns>有効なハンドルだったか(二重解放ならfalse)</returns>
+	bool Free(BindlessHandle handle, uint64_t fenceValue);
+
+	/// <summary>
+	/// GPUが通過したフェンス値までの解放待ちを空きスロットに戻す
+	/// </summary>
+	/// <param name="completedFenceValue">GPUが完了したフェンス値</param>
+	/// <returns>戻したスロット数</returns>
+	uint32_t Recycle(uint64_t completedFenceValue);
+
+	/// <summary>
+	/// ハンドルが今も確保中のスロットを指しているか
+	/// </summary>
+	bool IsValid(BindlessHandle handle) const;
+
+	uint32_t GetCapacity() const { return capacity_; }
+	uint32_t GetAllocatedCount() const;
+	uint32_t GetPendingCount() const;
+
+private: // メンバ変数
+	mutable std::mutex mutex_;
+	uint32_t capacity_ = 0;
+	// 一度も使っていないスロットの先頭。ここより後ろは空きリストに積まずに済ませる
+	uint32_t nextUnusedIndex_ = 0;
+	std::vector<uint32_t> freeIndices_;
+	// フェンス値とスロット。フェンス値は増える順に積まれる前提
+	std::deque<std::pair<uint64_t, uint32_t>> pendingFrees_;
+	std::vector<uint16_t> versions_;
+	std::vector<bool> allocated_;
+	uint32_t allocatedCount_ = 0;
+};
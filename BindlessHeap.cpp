@@ -0,0 +1,81 @@
+#include "BindlessHeap.h"
+
+#include <cassert>
+
+D3D12_DESCRIPTOR_RANGE BindlessHeap::MakeDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE type, UINT registerSpace) {
+	D3D12_DESCRIPTOR_RANGE range{};
+	range.RangeType = type;
+	range.NumDescriptors = UINT_MAX; // 上限なし(ヒープの終わりまで)
+	range.BaseShaderRegister = 0;
+	range.RegisterSpace = registerSpace;
+	range.OffsetInDescriptorsFromTableStart = 0;
+	return range;
+}
+
+void BindlessHeap::Initialize(ID3D12Device* device, uint32_t capacity) {
+	device_ = device;
+
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc{};
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	heapDesc.NumDescriptors = capacity;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	HRESULT hr = device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&heap_));
+	assert(SUCCEEDED(hr));
+
+	cpuStart_ = heap_->GetCPUDescriptorHandleForHeapStart();
+	descriptorSize_ = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	allocator_.Initialize(capacity);
+	submitFenceValue_ = 0;
+}
+
+void BindlessHeap::Finalize() {
+	if (heap_) {
+		heap_->Release();
+		heap_ = nullptr;
+	}
+	device_ = nullptr;
+}
+
+void BindlessHeap::BeginFrame(uint64_t submitFenceValue, uint64_t completedFenceValue) {
+	submitFenceValue_ = submitFenceValue;
+	allocator_.Recycle(completedFenceValue);
+}
+
+BindlessHandle BindlessHeap::CreateShaderResourceView(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc) {
+	BindlessHandle handle = allocator_.Allocate();
+	assert(!handle.IsNull());
+	device_->CreateShaderResourceView(resource, desc, GetCpuHandle(handle));
+	return handle;
+}
+
+BindlessHandle BindlessHeap::CreateUnorderedAccessView(ID3D12Resource* resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* desc) {
+	BindlessHandle handle = allocator_.Allocate();
+	assert(!handle.IsNull());
+	device_->CreateUnorderedAccessView(resource, nullptr, desc, GetCpuHandle(handle));
+	return handle;
+}
+
+BindlessHandle BindlessHeap::CreateConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc) {
+	BindlessHandle handle = allocator_.Allocate();
+	assert(!handle.IsNull());
+	device_->CreateConstantBufferView(&desc, GetCpuHandle(handle));
+	return handle;
+}
+
+void BindlessHeap::Free(BindlessHandle handle) {
+	bool freed = allocator_.Free(handle, submitFenceValue_);
+	// 二重解放・古いハンドルでの解放
+	assert(freed);
+	(void)freed;
+}
+
+void BindlessHeap::Bind(ID3D12GraphicsCommandList* commandList) const {
+	ID3D12DescriptorHeap* descriptorHeaps[] = { heap_ };
+	commandList->SetDescriptorHeaps(1, descriptorHeaps);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE BindlessHeap::GetCpuHandle(BindlessHandle handle) const {
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = cpuStart_;
+	cpuHandle.ptr += static_cast<SIZE_T>(handle.GetIndex()) * descriptorSize_;
+	return cpuHandle;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+
+#include <d3d12.h>
+
+#include "BindlessAllocator.h"
+
+/// <summary>
+/// シェーダーから見える1つの大きなCBV_SRV_UAVヒープ。
+/// ビューはここに作り、シェーダーにはルート定数でインデックスだけを渡す(テーブルはフレームに1回設定するだけ)
+/// </summary>
+class BindlessHeap {
+public: // 静的メンバ変数
+	static const uint32_t kDefaultCapacity = 65536;
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// ヒープ全体を指すディスクリプタレンジ。HLSL側は Texture2D gTextures[] : register(t0, space1) のように受ける
+	/// </summary>
+	/// <param name="type">SRV・UAV・CBV</param>
+	/// <param name="registerSpace">レジスタ空間</param>
+	static D3D12_DESCRIPTOR_RANGE MakeDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE type, UINT registerSpace);
+
+public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	/// <param name="capacity">ディスクリプタ数</param>
+	void Initialize(ID3D12Device* device, uint32_t capacity = kDefaultCapacity);
+
+	/// <summary>
+	/// 解放
+	/// </summary>
+	void Finalize();
+
+	/// <summary>
+	/// フレームの開始。GPUが終えた分の解放待ちを再利用に回し、これ以降のFreeに付けるフェンス値を決める
+	/// </summary>
+	/// <param name="submitFenceValue">このフレームのコマンドの後にシグナルするフェンス値</param>
+	/// <param name="completedFenceValue">GPUが完了したフェンス値</param>
+	void BeginFrame(uint64_t submitFenceValue, uint64_t completedFenceValue);
+
+	BindlessHandle CreateShaderResourceView(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc);
+	BindlessHandle CreateUnorderedAccessView(ID3D12Resource* resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* desc);
+	BindlessHandle CreateConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc);
+
+	/// <summary>
+	/// ビューの解放。スロットは今フレームのコマンドをGPUが終えてから再利用する
+	/// </summary>
+	void Free(BindlessHandle handle);
+
+	/// <summary>
+	/// コマンドリストにヒープを設定する
+	/// </summary>
+	void Bind(ID3D12GraphicsCommandList* commandList) const;
+
+	/// <summary>
+	/// ルートパラメーターのディスクリプタテーブルに渡すヒープの先頭
+	/// </summary>
+	D3D12_GPU_DESCRIPTOR_HANDLE GetTableStart() const { return heap_->GetGPUDescriptorHandleForHeapStart(); }
+
+	bool IsValid(BindlessHandle handle) const { return allocator_.IsValid(handle); }
+	const BindlessAllocator& GetAllocator() const { return allocator_; }
+
+private: // メンバ関数
+	D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(BindlessHandle handle) const;
+
+private: // メンバ変数
+	ID3D12Device* device_ = nullptr;
+	ID3D12DescriptorHeap* heap_ = nullptr;
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuStart_{};
+	uint32_t descriptorSize_ = 0;
+	BindlessAllocator allocator_;
+	uint64_t submitFenceValue_ = 0;
+};
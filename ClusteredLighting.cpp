@@ -0,0 +1,296 @@
+#include "ClusteredLighting.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define CLUSTERED_LIGHTING_USE_SSE2
+#endif
+
+namespace {
+
+// どのクラスターにも当たらない位置(2乗すると無限大になるので必ず範囲外になる)
+const float kFarAway = 3.0e38f;
+
+} // namespace
+
+/*///////////////////////
+	LightSoA
+*////////////////////////
+void ClusteredLighting::LightSoA::Resize(size_t count) {
+	x.resize(count);
+	y.resize(count);
+	z.resize(count);
+	radius.resize(count);
+	index.resize(count);
+}
+
+void ClusteredLighting::LightSoA::Pad() {
+	size_t count = x.size();
+	size_t padded = (count + 3) & ~static_cast<size_t>(3);
+	Resize(padded);
+	for (size_t i = count; i < padded; ++i) {
+		x[i] = y[i] = z[i] = kFarAway;
+		radius[i] = 0.0f;
+		index[i] = 0;
+	}
+}
+
+/*///////////////////////
+	ClusteredLighting
+*////////////////////////
+void ClusteredLighting::Initialize(const ClusterGridDesc& desc) {
+	assert(desc.tileCountX > 0 && desc.tileCountY > 0 && desc.sliceCount > 0 && desc.nearZ > 0.0f && desc.farZ > desc.nearZ);
+	desc_ = desc;
+	const uint32_t tileCountX = desc.tileCountX;
+	const uint32_t tileCountY = desc.tileCountY;
+	clusterBounds_.resize(GetClusterCount());
+	rowBounds_.resize(static_cast<size_t>(tileCountY) * desc.sliceCount);
+	sliceBounds_.resize(desc.sliceCount);
+	sliceIndices_.resize(desc.sliceCount);
+	ranges_.assign(GetClusterCount(), {});
+
+	const float tanY = std::tan(desc.fovY * 0.5f);
+	const float tanX = tanY * desc.aspectRatio;
+	const float depthRatio = desc.farZ / desc.nearZ;
+
+	for (uint32_t slice = 0; slice < desc.sliceCount; ++slice) {
+		float z0 = desc.nearZ * std::pow(depthRatio, static_cast<float>(slice) / static_cast<float>(desc.sliceCount));
+		float z1 = desc.nearZ * std::pow(depthRatio, static_cast<float>(slice + 1) / static_cast<float>(desc.sliceCount));
+		Bounds& sliceBounds = sliceBounds_[slice];
+		sliceBounds = { { kFarAway, kFarAway, z0 }, { -kFarAway, -kFarAway, z1 } };
+
+		for (uint32_t tileY = 0; tileY < tileCountY; ++tileY) {
+			// タイルの行は画面の上から数える
+			float ndcY0 = 1.0f - 2.0f * static_cast<float>(tileY + 1) / static_cast<float>(tileCountY);
+			float ndcY1 = 1.0f - 2.0f * static_cast<float>(tileY) / static_cast<float>(tileCountY);
+			Bounds& rowBounds = rowBounds_[slice * tileCountY + tileY];
+			rowBounds = { { kFarAway, kFarAway, z0 }, { -kFarAway, -kFarAway, z1 } };
+
+			for (uint32_t tileX = 0; tileX < tileCountX; ++tileX) {
+				float ndcX0 = -1.0f + 2.0f * static_cast<float>(tileX) / static_cast<float>(tileCountX);
+				float ndcX1 = -1.0f + 2.0f * static_cast<float>(tileX + 1) / static_cast<float>(tileCountX);
+
+				// タイルの四隅を手前と奥の深さで広げた8点を囲む
+				Bounds& bounds = clusterBounds_[GetClusterIndex(tileX, tileY, slice)];
+				bounds.min[0] = std::min(ndcX0 * tanX * z0, ndcX0 * tanX * z1);
+				bounds.max[0] = std::max(ndcX1 * tanX * z0, ndcX1 * tanX * z1);
+				bounds.min[1] = std::min(ndcY0 * tanY * z0, ndcY0 * tanY * z1);
+				bounds.max[1] = std::max(ndcY1 * tanY * z0, ndcY1 * tanY * z1);
+				bounds.min[2] = z0;
+				bounds.max[2] = z1;
+
+				for (uint32_t axis = 0; axis < 2; ++axis) {
+					rowBounds.min[axis] = std::min(rowBounds.min[axis], bounds.min[axis]);
+					rowBounds.max[axis] = std::max(rowBounds.max[axis], bounds.max[axis]);
+				}
+			}
+			for (uint32_t axis = 0; axis < 2; ++axis) {
+				sliceBounds.min[axis] = std::min(sliceBounds.min[axis], rowBounds.min[axis]);
+				sliceBounds.max[axis] = std::max(sliceBounds.max[axis], rowBounds.max[axis]);
+			}
+		}
+	}
+}
+
+void ClusteredLighting::Build(const float view[4][4], const ClusterLight* lights, uint32_t lightCount, uint32_t threadCount) {
+	TransformLights(view, lights, lightCount);
+
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threadCount = std::min(threadCount, desc_.sliceCount);
+	if (threadCount == 1) {
+		LightSoA sliceLights;
+		LightSoA rowLights;
+		for (uint32_t slice = 0; slice < desc_.sliceCount; ++slice) {
+			BuildSlice(slice, sliceLights, rowLights);
+		}
+	} else {
+		// スライスごとにライト数が大きく違うので、空いたスレッドから次のスライスを取る
+		std::atomic<uint32_t> nextSlice = 0;
+		std::vector<std::thread> workers;
+		workers.reserve(threadCount);
+		for (uint32_t i = 0; i < threadCount; ++i) {
+			workers.emplace_back([&]() {
+				LightSoA sliceLights;
+				LightSoA rowLights;
+				for (uint32_t slice = nextSlice.fetch_add(1); slice < desc_.sliceCount; slice = nextSlice.fetch_add(1)) {
+					BuildSlice(slice, sliceLights, rowLights);
+				}
+			});
+		}
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}
+	Compact();
+}
+
+void ClusteredLighting::BuildReference(const float view[4][4], const ClusterLight* lights, uint32_t lightCount) {
+	TransformLights(view, lights, lightCount);
+
+	lightIndices_.clear();
+	for (uint32_t cluster = 0; cluster < GetClusterCount(); ++cluster) {
+		ranges_[cluster].offset = static_cast<uint32_t>(lightIndices_.size());
+		for (uint32_t i = 0; i < lightCount; ++i) {
+			if (Intersects(clusterBounds_[cluster], viewLights_.x[i], viewLights_.y[i], viewLights_.z[i], viewLights_.radius[i])) {
+				lightIndices_.push_back(i);
+			}
+		}
+		ranges_[cluster].count = static_cast<uint32_t>(lightIndices_.size()) - ranges_[cluster].offset;
+	}
+}
+
+uint32_t ClusteredLighting::GetSlice(float viewZ) const {
+	if (viewZ <= desc_.nearZ) {
+		return 0;
+	}
+	float slice = std::log(viewZ / desc_.nearZ) * static_cast<float>(desc_.sliceCount) / std::log(desc_.farZ / desc_.nearZ);
+	return std::min(static_cast<uint32_t>(slice), desc_.sliceCount - 1);
+}
+
+void ClusteredLighting::TransformLights(const float view[4][4], const ClusterLight* lights, uint32_t lightCount) {
+	viewLights_.Resize(lightCount);
+	for (uint32_t i = 0; i < lightCount; ++i) {
+		const float* p = lights[i].position;
+		viewLights_.x[i] = p[0] * view[0][0] + p[1] * view[1][0] + p[2] * view[2][0] + view[3][0];
+		viewLights_.y[i] = p[0] * view[0][1] + p[1] * view[1][1] + p[2] * view[2][1] + view[3][1];
+		viewLights_.z[i] = p[0] * view[0][2] + p[1] * view[1][2] + p[2] * view[2][2] + view[3][2];
+		viewLights_.radius[i] = lights[i].radius;
+		viewLights_.index[i] = i;
+	}
+	viewLights_.Pad();
+}
+
+void ClusteredLighting::BuildSlice(uint32_t slice, LightSoA& sliceLights, LightSoA& rowLights) {
+	const uint32_t tileCountX = desc_.tileCountX;
+	const uint32_t tileCountY = desc_.tileCountY;
+	std::vector<uint32_t>& indices = sliceIndices_[slice];
+	indices.clear();
+
+	Filter(sliceBounds_[slice], viewLights_, sliceLights);
+	for (uint32_t tileY = 0; tileY < tileCountY; ++tileY) {
+		const uint32_t rowCluster = GetClusterIndex(0, tileY, slice);
+		if (sliceLights.x.empty()) {
+			for (uint32_t tileX = 0; tileX < tileCountX; ++tileX) {
+				ranges_[rowCluster + tileX] = { static_cast<uint32_t>(indices.size()), 0 };
+			}
+			continue;
+		}
+		Filter(rowBounds_[slice * tileCountY + tileY], sliceLights, rowLights);
+
+		for (uint32_t tileX = 0; tileX < tileCountX; ++tileX) {
+			const Bounds& bounds = clusterBounds_[rowCluster + tileX];
+			// ひとまずスライス内での位置を入れておき、Compactで全体の位置にずらす
+			const uint32_t begin = static_cast<uint32_t>(indices.size());
+			const size_t count = rowLights.x.size();
+#ifdef CLUSTERED_LIGHTING_USE_SSE2
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 minX = _mm_set1_ps(bounds.min[0]), maxX = _mm_set1_ps(bounds.max[0]);
+			const __m128 minY = _mm_set1_ps(bounds.min[1]), maxY = _mm_set1_ps(bounds.max[1]);
+			const __m128 minZ = _mm_set1_ps(bounds.min[2]), maxZ = _mm_set1_ps(bounds.max[2]);
+			for (size_t i = 0; i < count; i += 4) {
+				__m128 x = _mm_loadu_ps(&rowLights.x[i]);
+				__m128 y = _mm_loadu_ps(&rowLights.y[i]);
+				__m128 z = _mm_loadu_ps(&rowLights.z[i]);
+				__m128 radius = _mm_loadu_ps(&rowLights.radius[i]);
+				__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, x), _mm_sub_ps(x, maxX)), zero);
+				__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, y), _mm_sub_ps(y, maxY)), zero);
+				__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, z), _mm_sub_ps(z, maxZ)), zero);
+				__m128 distanceSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+				int mask = _mm_movemask_ps(_mm_cmple_ps(distanceSq, _mm_mul_ps(radius, radius)));
+				for (int lane = 0; lane < 4; ++lane) {
+					if (mask & (1 << lane)) {
+						indices.push_back(rowLights.index[i + lane]);
+					}
+				}
+			}
+#else
+			for (size_t i = 0; i < count; ++i) {
+				if (Intersects(bounds, rowLights.x[i], rowLights.y[i], rowLights.z[i], rowLights.radius[i])) {
+					indices.push_back(rowLights.index[i]);
+				}
+			}
+#endif
+			ranges_[rowCluster + tileX] = { begin, static_cast<uint32_t>(indices.size()) - begin };
+		}
+	}
+}
+
+void ClusteredLighting::Compact() {
+	const uint32_t clustersPerSlice = desc_.tileCountX * desc_.tileCountY;
+	size_t total = 0;
+	for (const std::vector<uint32_t>& indices : sliceIndices_) {
+		total += indices.size();
+	}
+	lightIndices_.resize(total);
+
+	uint32_t offset = 0;
+	for (uint32_t slice = 0; slice < desc_.sliceCount; ++slice) {
+		const std::vector<uint32_t>& indices = sliceIndices_[slice];
+		for (uint32_t i = 0; i < clustersPerSlice; ++i) {
+			ranges_[slice * clustersPerSlice + i].offset += offset;
+		}
+		if (!indices.empty()) {
+			std::memcpy(lightIndices_.data() + offset, indices.data(), sizeof(uint32_t) * indices.size());
+		}
+		offset += static_cast<uint32_t>(indices.size());
+	}
+}
+
+bool ClusteredLighting::Intersects(const Bounds& bounds, float x, float y, float z, float radius) {
+	float dx = std::max(std::max(bounds.min[0] - x, x - bounds.max[0]), 0.0f);
+	float dy = std::max(std::max(bounds.min[1] - y, y - bounds.max[1]), 0.0f);
+	float dz = std::max(std::max(bounds.min[2] - z, z - bounds.max[2]), 0.0f);
+	return (dx * dx + dy * dy) + dz * dz <= radius * radius;
+}
+
+void ClusteredLighting::Filter(const Bounds& bounds, const LightSoA& source, LightSoA& destination) {
+	const size_t count = source.x.size();
+	destination.Resize(count);
+	size_t written = 0;
+	auto emit = [&](size_t i) {
+		destination.x[written] = source.x[i];
+		destination.y[written] = source.y[i];
+		destination.z[written] = source.z[i];
+		destination.radius[written] = source.radius[i];
+		destination.index[written] = source.index[i];
+		++written;
+	};
+#ifdef CLUSTERED_LIGHTING_USE_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 minX = _mm_set1_ps(bounds.min[0]), maxX = _mm_set1_ps(bounds.max[0]);
+	const __m128 minY = _mm_set1_ps(bounds.min[1]), maxY = _mm_set1_ps(bounds.max[1]);
+	const __m128 minZ = _mm_set1_ps(bounds.min[2]), maxZ = _mm_set1_ps(bounds.max[2]);
+	for (size_t i = 0; i < count; i += 4) {
+		__m128 x = _mm_loadu_ps(&source.x[i]);
+		__m128 y = _mm_loadu_ps(&source.y[i]);
+		__m128 z = _mm_loadu_ps(&source.z[i]);
+		__m128 radius = _mm_loadu_ps(&source.radius[i]);
+		__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, x), _mm_sub_ps(x, maxX)), zero);
+		__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, y), _mm_sub_ps(y, maxY)), zero);
+		__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, z), _mm_sub_ps(z, maxZ)), zero);
+		__m128 distanceSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		int mask = _mm_movemask_ps(_mm_cmple_ps(distanceSq, _mm_mul_ps(radius, radius)));
+		for (int lane = 0; lane < 4; ++lane) {
+			if (mask & (1 << lane)) {
+				emit(i + lane);
+			}
+		}
+	}
+#else
+	for (size_t i = 0; i < count; ++i) {
+		if (Intersects(bounds, source.x[i], source.y[i], source.z[i], source.radius[i])) {
+			emit(i);
+		}
+	}
+#endif
+	destination.Resize(written);
+	destination.Pad();
+}
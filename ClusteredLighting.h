@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 以下の構造体はシェーダーのStructuredBufferと同じレイアウトにする
+
+/// <summary>
+/// 点光源(ワールド空間)
+/// </summary>
+struct ClusterLight {
+	float position[3];
+	float radius; // 影響範囲
+	float color[3];
+	float intensity;
+};
+
+/// <summary>
+/// クラスター1つ分のライトリストの範囲(ライトインデックス配列の先頭と個数)
+/// </summary>
+struct ClusterRange {
+	uint32_t offset;
+	uint32_t count;
+};
+
+/// <summary>
+/// クラスターの分割設定。奥行きは近いほど細かくなるよう指数的に分割する
+/// </summary>
+struct ClusterGridDesc {
+	uint32_t tileCountX = 16;
+	uint32_t tileCountY = 9;
+	uint32_t sliceCount = 24;
+	float nearZ = 0.1f;
+	float farZ = 1000.0f;
+	float fovY = 0.45f;  // 縦の画角(ラジアン)
+	float aspectRatio = 1280.0f / 720.0f;
+};
+
+/// <summary>
+/// クラスタードライティングのライト割り当て(CPU参照実装)。
+/// ビュー空間の視錐台をタイル×奥行きのクラスターに分け、各クラスターに影響するライトの番号を詰めて並べる
+/// </summary>
+class ClusteredLighting {
+public: // メンバ関数
+	/// <summary>
+	/// 初期化。各クラスターのビュー空間AABBを計算しておく
+	/// </summary>
+	void Initialize(const ClusterGridDesc& desc);
+
+	/// <summary>
+	/// ライトをクラスターに割り当てる。各クラスターのリストはライト番号の昇順
+	/// </summary>
+	/// <param name="view">ビュー行列(行ベクトル×行列の規約、+zが奥)</param>
+	/// <param name="lights">ライト</param>
+	/// <param name="lightCount">ライト数</param>
+	/// <param name="threadCount">使用スレッド数(0なら自動)</param>
+	void Build(const float view[4][4], const ClusterLight* lights, uint32_t lightCount, uint32_t threadCount = 1);
+
+	/// <summary>
+	/// 全クラスター×全ライトを総当たりで判定する検証用の実装(結果はBuildと一致する)
+	/// </summary>
+	void BuildReference(const float view[4][4], const ClusterLight* lights, uint32_t lightCount);
+
+	/// <summary>
+	/// ビュー空間の奥行きからスライス番号を求める(シェーダー側と同じ式)
+	/// </summary>
+	uint32_t GetSlice(float viewZ) const;
+
+	uint32_t GetClusterIndex(uint32_t tileX, uint32_t tileY, uint32_t slice) const { return (slice * desc_.tileCountY + tileY) * desc_.tileCountX + tileX; }
+	uint32_t GetClusterCount() const { return desc_.tileCountX * desc_.tileCountY * desc_.sliceCount; }
+	const ClusterGridDesc& GetDesc() const { return desc_; }
+
+	const std::vector<ClusterRange>& GetRanges() const { return ranges_; }
+	const std::vector<uint32_t>& GetLightIndices() const { return lightIndices_; }
+
+private: // サブクラス
+	struct Bounds {
+		float min[3];
+		float max[3];
+	};
+
+	// ビュー空間に変換したライト(SIMDで4つずつ読めるよう成分ごとに並べる)
+	struct LightSoA {
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+		std::vector<float> radius;
+		std::vector<uint32_t> index; // 元のライト番号
+
+		void Resize(size_t count);
+		// 4の倍数まで、どこにも当たらないライトで埋める
+		void Pad();
+	};
+
+private: // メンバ関数
+	/// <summary>
+	/// ライトをビュー空間に変換する
+	/// </summary>
+	void TransformLights(const float view[4][4], const ClusterLight* lights, uint32_t lightCount);
+
+	/// <summary>
+	/// 1スライス分の割り当て。スライス→タイルの行→タイルの順に候補を絞り込む
+	/// </summary>
+	void BuildSlice(uint32_t slice, LightSoA& sliceLights, LightSoA& rowLights);
+
+	/// <summary>
+	/// 割り当て結果をスライス順に連結する
+	/// </summary>
+	void Compact();
+
+	/// <summary>
+	/// 球とAABBが交差するか(SIMD版と同じ順序で計算する)
+	/// </summary>
+	static bool Intersects(const Bounds& bounds, float x, float y, float z, float radius);
+
+	/// <summary>
+	/// sourceのうちboundsと交差するライトをdestinationへ詰めて書き出す
+	/// </summary>
+	static void Filter(const Bounds& bounds, const LightSoA& source, LightSoA& destination);
+
+private: // メンバ変数
+	ClusterGridDesc desc_;
+	std::vector<Bounds> clusterBounds_;
+	std::vector<Bounds> rowBounds_;   // スライス内のタイル1行分
+	std::vector<Bounds> sliceBounds_;
+
+	LightSoA viewLights_;
+	std::vector<std::vector<uint32_t>> sliceIndices_;
+
+	std::vector<ClusterRange> ranges_;
+	std::vector<uint32_t> lightIndices_;
+};
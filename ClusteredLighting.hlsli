@@ -0,0 +1,80 @@
+// クラスタードライティングのライトリストの読み出し
+// バッファはClusteredLightingBuffersが作る。構造体はClusteredLighting.hと同じレイアウトにする
+//
+// 使う側のルートシグネチャでは、バインドレスヒープ全体を次のレジスタ空間のSRVとして見せ、
+// ClusterConstantsをルート定数で渡す
+//   t0, space2: StructuredBuffer<ClusterLight>
+//   t0, space3: StructuredBuffer<ClusterRange>
+//   t0, space4: StructuredBuffer<uint>
+
+struct ClusterLight {
+	float3 position; // ワールド空間
+	float radius;    // 影響範囲
+	float3 color;
+	float intensity;
+};
+
+struct ClusterRange {
+	uint offset; // ライト番号の配列の先頭
+	uint count;
+};
+
+// ClusteredLightingBuffers::Constantsと同じ並び
+struct ClusterConstants {
+	uint lightBufferIndex;
+	uint rangeBufferIndex;
+	uint lightIndexBufferIndex;
+	uint lightCount;
+	uint tileCountX;
+	uint tileCountY;
+	uint sliceCount;
+	float nearZ;
+	float sliceScale; // sliceCount / log(farZ / nearZ)
+};
+
+StructuredBuffer<ClusterLight> gClusterLights[] : register(t0, space2);
+StructuredBuffer<ClusterRange> gClusterRanges[] : register(t0, space3);
+StructuredBuffer<uint> gClusterLightIndices[] : register(t0, space4);
+
+// ビュー空間の奥行きからスライス番号を求める(ClusteredLighting::GetSliceと同じ式)
+uint GetClusterSlice(ClusterConstants constants, float viewZ) {
+	if (viewZ <= constants.nearZ) {
+		return 0;
+	}
+	return min(uint(log(viewZ / constants.nearZ) * constants.sliceScale), constants.sliceCount - 1);
+}
+
+// 画面上の位置(左上が0、右下が1)と奥行きからクラスター番号を求める
+uint GetClusterIndex(ClusterConstants constants, float2 screenUv, float viewZ) {
+	uint2 tile = min(uint2(saturate(screenUv) * float2(constants.tileCountX, constants.tileCountY)),
+		uint2(constants.tileCountX - 1, constants.tileCountY - 1));
+	uint slice = GetClusterSlice(constants, viewZ);
+	return (slice * constants.tileCountY + tile.y) * constants.tileCountX + tile.x;
+}
+
+ClusterRange GetClusterRange(ClusterConstants constants, uint clusterIndex) {
+	return gClusterRanges[constants.rangeBufferIndex][clusterIndex];
+}
+
+// クラスターのi番目のライト(iはrange.count未満)
+ClusterLight GetClusterLight(ClusterConstants constants, ClusterRange range, uint i) {
+	uint lightIndex = gClusterLightIndices[constants.lightIndexBufferIndex][range.offset + i];
+	return gClusterLights[constants.lightBufferIndex][lightIndex];
+}
+
+// クラスター内の点光源によるランバート拡散光の合計
+float3 AccumulateClusterLights(ClusterConstants constants, float2 screenUv, float viewZ, float3 worldPosition, float3 normal) {
+	ClusterRange range = GetClusterRange(constants, GetClusterIndex(constants, screenUv, viewZ));
+	float3 result = 0.0f;
+	for (uint i = 0; i < range.count; ++i) {
+		ClusterLight light = GetClusterLight(constants, range, i);
+		float3 toLight = light.position - worldPosition;
+		float distance = length(toLight);
+		// 影響範囲の端で0になる減衰
+		float attenuation = saturate(1.0f - distance / light.radius);
+		attenuation *= attenuation;
+		float lambert = saturate(dot(normal, toLight / max(distance, 1.0e-4f)));
+		result += light.color * (light.intensity * attenuation * lambert);
+	}
+	return result;
+}
@@ -0,0 +1,117 @@
+#include "ClusteredLightingBuffers.h"
+
+#include <Windows.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+void ClusteredLightingBuffers::Initialize(ID3D12Device* device, BindlessHeap* bindlessHeap, uint32_t clusterCount, uint32_t maxLightCount, uint32_t maxLightIndexCount) {
+	assert(clusterCount > 0 && maxLightCount > 0 && maxLightIndexCount > 0);
+	bindlessHeap_ = bindlessHeap;
+	frameIndex_ = 0;
+	truncatedLightIndexCount_ = 0;
+
+	CreateBuffer(device, lightBuffer_, maxLightCount, sizeof(ClusterLight));
+	CreateBuffer(device, rangeBuffer_, clusterCount, sizeof(ClusterRange));
+	CreateBuffer(device, lightIndexBuffer_, maxLightIndexCount, sizeof(uint32_t));
+}
+
+void ClusteredLightingBuffers::Finalize() {
+	ReleaseBuffer(lightBuffer_);
+	ReleaseBuffer(rangeBuffer_);
+	ReleaseBuffer(lightIndexBuffer_);
+}
+
+ClusteredLightingBuffers::Constants ClusteredLightingBuffers::Upload(const ClusteredLighting& lighting, const ClusterLight* lights, uint32_t lightCount) {
+	assert(lightCount <= lightBuffer_.elementCount);
+	lightCount = std::min(lightCount, lightBuffer_.elementCount);
+	const std::vector<ClusterRange>& ranges = lighting.GetRanges();
+	const std::vector<uint32_t>& lightIndices = lighting.GetLightIndices();
+	assert(ranges.size() == rangeBuffer_.elementCount);
+
+	std::memcpy(GetFrameData(lightBuffer_), lights, sizeof(ClusterLight) * lightCount);
+
+	// ライト番号が収まらないときは、はみ出したクラスターの個数を減らす(範囲外を読ませない)
+	const uint32_t maxLightIndexCount = lightIndexBuffer_.elementCount;
+	const uint32_t lightIndexCount = static_cast<uint32_t>(std::min<size_t>(lightIndices.size(), maxLightIndexCount));
+	truncatedLightIndexCount_ = static_cast<uint32_t>(lightIndices.size() - lightIndexCount);
+	ClusterRange* mappedRanges = static_cast<ClusterRange*>(GetFrameData(rangeBuffer_));
+	if (truncatedLightIndexCount_ == 0) {
+		std::memcpy(mappedRanges, ranges.data(), sizeof(ClusterRange) * ranges.size());
+	} else {
+		for (size_t i = 0; i < ranges.size(); ++i) {
+			ClusterRange range = ranges[i];
+			range.count = range.offset < maxLightIndexCount ? std::min(range.count, maxLightIndexCount - range.offset) : 0;
+			mappedRanges[i] = range;
+		}
+	}
+	std::memcpy(GetFrameData(lightIndexBuffer_), lightIndices.data(), sizeof(uint32_t) * lightIndexCount);
+
+	const ClusterGridDesc& desc = lighting.GetDesc();
+	Constants constants{};
+	constants.lightBufferIndex = lightBuffer_.handles[frameIndex_].GetIndex();
+	constants.rangeBufferIndex = rangeBuffer_.handles[frameIndex_].GetIndex();
+	constants.lightIndexBufferIndex = lightIndexBuffer_.handles[frameIndex_].GetIndex();
+	constants.lightCount = lightCount;
+	constants.tileCountX = desc.tileCountX;
+	constants.tileCountY = desc.tileCountY;
+	constants.sliceCount = desc.sliceCount;
+	constants.nearZ = desc.nearZ;
+	constants.sliceScale = static_cast<float>(desc.sliceCount) / std::log(desc.farZ / desc.nearZ);
+
+	frameIndex_ = (frameIndex_ + 1) % kFrameCount;
+	return constants;
+}
+
+void ClusteredLightingBuffers::CreateBuffer(ID3D12Device* device, Buffer& buffer, uint32_t elementCount, uint32_t stride) {
+	buffer.elementCount = elementCount;
+	buffer.stride = stride;
+
+	// 毎フレームCPUから書くのでアップロードヒープに置いてマップしたままにする
+	D3D12_HEAP_PROPERTIES heapProperties{};
+	heapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+
+	D3D12_RESOURCE_DESC resourceDesc{};
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resourceDesc.Width = static_cast<uint64_t>(elementCount) * stride * kFrameCount;
+	resourceDesc.Height = 1;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.MipLevels = 1;
+	resourceDesc.SampleDesc.Count = 1;
+	resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+	HRESULT hr = device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&buffer.resource));
+	assert(SUCCEEDED(hr));
+	D3D12_RANGE readRange{ 0, 0 };
+	hr = buffer.resource->Map(0, &readRange, reinterpret_cast<void**>(&buffer.mapped));
+	assert(SUCCEEDED(hr));
+
+	// フレームごとの領域をそれぞれ別のSRVにする
+	for (uint32_t frame = 0; frame < kFrameCount; ++frame) {
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Buffer.FirstElement = static_cast<uint64_t>(elementCount) * frame;
+		srvDesc.Buffer.NumElements = elementCount;
+		srvDesc.Buffer.StructureByteStride = stride;
+		srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+		buffer.handles[frame] = bindlessHeap_->CreateShaderResourceView(buffer.resource, &srvDesc);
+	}
+}
+
+void ClusteredLightingBuffers::ReleaseBuffer(Buffer& buffer) {
+	for (BindlessHandle& handle : buffer.handles) {
+		if (!handle.IsNull()) {
+			bindlessHeap_->Free(handle);
+			handle = {};
+		}
+	}
+	if (buffer.resource) {
+		buffer.resource->Release();
+		buffer.resource = nullptr;
+		buffer.mapped = nullptr;
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+
+#include <d3d12.h>
+
+#include "BindlessHeap.h"
+#include "ClusteredLighting.h"
+
+/// <summary>
+/// ClusteredLightingの割り当て結果(クラスターごとの範囲とライト番号の配列)とライトを、シェーダーから読めるStructuredBufferにする。
+/// バッファは常時マップしたアップロードヒープをフレームごとに分けて使い、SRVはバインドレスヒープに置く(読み方はClusteredLighting.hlsli)
+/// </summary>
+class ClusteredLightingBuffers {
+public: // 静的メンバ変数
+	// バッファをフレームごとに分ける数(GPUが読んでいる領域に書き込まないため)
+	static const uint32_t kFrameCount = 2;
+
+public: // サブクラス
+	/// <summary>
+	/// シェーダーへルート定数で渡す値(ClusteredLighting.hlsliのClusterConstantsと同じ並び)
+	/// </summary>
+	struct Constants {
+		uint32_t lightBufferIndex;      // StructuredBuffer<ClusterLight>のSRV
+		uint32_t rangeBufferIndex;      // StructuredBuffer<ClusterRange>のSRV
+		uint32_t lightIndexBufferIndex; // StructuredBuffer<uint>のSRV
+		uint32_t lightCount;
+		uint32_t tileCountX;
+		uint32_t tileCountY;
+		uint32_t sliceCount;
+		float nearZ;
+		float sliceScale;               // sliceCount / log(farZ / nearZ)
+	};
+
+public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	/// <param name="bindlessHeap">SRVを置くヒープ</param>
+	/// <param name="clusterCount">クラスター数(ClusteredLighting::GetClusterCount)</param>
+	/// <param name="maxLightCount">1フレームに渡せるライト数の上限</param>
+	/// <param name="maxLightIndexCount">ライト番号の配列の上限。超えた分は範囲の個数を切り詰める</param>
+	void Initialize(ID3D12Device* device, BindlessHeap* bindlessHeap, uint32_t clusterCount, uint32_t maxLightCount, uint32_t maxLightIndexCount);
+
+	/// <summary>
+	/// 解放(SRVも含む)
+	/// </summary>
+	void Finalize();
+
+	/// <summary>
+	/// 割り当て結果とライトを今フレームの領域へ書き込む。Buildの後、描画を積む前に1フレーム1回呼ぶ
+	/// </summary>
+	/// <param name="lighting">割り当て済みのクラスタードライティング</param>
+	/// <param name="lights">Buildに渡したライト</param>
+	/// <param name="lightCount">ライト数(maxLightCount以下)</param>
+	/// <returns>シェーダーに渡す値</returns>
+	Constants Upload(const ClusteredLighting& lighting, const ClusterLight* lights, uint32_t lightCount);
+
+	/// <summary>
+	/// 上限を超えて切り詰めたライト番号の数(直近のUpload)
+	/// </summary>
+	uint32_t GetTruncatedLightIndexCount() const { return truncatedLightIndexCount_; }
+
+private: // サブクラス
+	// 1種類分のStructuredBuffer。フレーム数分を1つのリソースに並べ、フレームごとにSRVを作る
+	struct Buffer {
+		ID3D12Resource* resource = nullptr;
+		uint8_t* mapped = nullptr;
+		uint32_t elementCount = 0; // 1フレーム分の要素数
+		uint32_t stride = 0;
+		BindlessHandle handles[kFrameCount];
+	};
+
+private: // メンバ関数
+	void CreateBuffer(ID3D12Device* device, Buffer& buffer, uint32_t elementCount, uint32_t stride);
+	void ReleaseBuffer(Buffer& buffer);
+
+	/// <summary>
+	/// 今フレームの領域の先頭
+	/// </summary>
+	void* GetFrameData(const Buffer& buffer) const { return buffer.mapped + static_cast<size_t>(buffer.elementCount) * buffer.stride * frameIndex_; }
+
+private: // メンバ変数
+	BindlessHeap* bindlessHeap_ = nullptr;
+	Buffer lightBuffer_;
+	Buffer rangeBuffer_;
+	Buffer lightIndexBuffer_;
+	uint32_t frameIndex_ = 0;
+	uint32_t truncatedLightIndexCount_ = 0;
+};
@@ -0,0 +1,119 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+DynamicResolution::Statistics DynamicResolution::ReplayTrace(const Config& config, const std::vector<float>& nativeMilliseconds, uint32_t outputWidth, uint32_t outputHeight,
+	std::vector<float>* outScales) {
+	DynamicResolution controller;
+	controller.Initialize(config, outputWidth, outputHeight);
+	const float nativePixels = static_cast<float>(outputWidth) * static_cast<float>(outputHeight);
+	if (outScales) {
+		outScales->clear();
+		outScales->reserve(nativeMilliseconds.size());
+	}
+	for (float milliseconds : nativeMilliseconds) {
+		if (outScales) {
+			outScales->push_back(controller.GetScale());
+		}
+		float pixels = static_cast<float>(controller.GetRenderWidth()) * static_cast<float>(controller.GetRenderHeight());
+		controller.Update(milliseconds * pixels / nativePixels);
+	}
+	return controller.GetStatistics();
+}
+
+void DynamicResolution::Initialize(const Config& config, uint32_t outputWidth, uint32_t outputHeight) {
+	assert(config.minScale > 0.0f && config.minScale <= config.maxScale);
+	assert(config.increaseThreshold < config.decreaseThreshold);
+	config_ = config;
+	scale_ = config_.maxScale;
+	smoothedMilliseconds_ = 0.0f;
+	hasSample_ = false;
+	lastWasOutlier_ = false;
+	underBudgetFrames_ = 0;
+	lastDirection_ = 0;
+	statistics_ = Statistics();
+	SetOutputSize(outputWidth, outputHeight);
+}
+
+void DynamicResolution::SetOutputSize(uint32_t outputWidth, uint32_t outputHeight) {
+	outputWidth_ = outputWidth;
+	outputHeight_ = outputHeight;
+	UpdateRenderSize();
+}
+
+void DynamicResolution::Update(float gpuMilliseconds) {
+	// 新しい計測値が無いフレームでは何も決めない(古い平均のままでは、上げるまでのフレームを数えたり、同じ値で何度も下げたりしてしまう)
+	if (gpuMilliseconds < 0.0f) {
+		return;
+	}
+	statistics_.frameCount++;
+	statistics_.scaleSum += scale_;
+	statistics_.minScale = std::min(statistics_.minScale, scale_);
+	statistics_.maxScale = std::max(statistics_.maxScale, scale_);
+	if (gpuMilliseconds > config_.budgetMilliseconds) {
+		statistics_.overBudgetFrameCount++;
+	}
+
+	if (hasSample_ && gpuMilliseconds > smoothedMilliseconds_ * config_.outlierRatio && !lastWasOutlier_) {
+		// シェーダーのコンパイルなどによる1フレームだけの突出では下げない(下げた後の戻りで振動するため)
+		lastWasOutlier_ = true;
+		statistics_.outlierFrameCount++;
+	} else if (hasSample_) {
+		lastWasOutlier_ = false;
+		smoothedMilliseconds_ += (gpuMilliseconds - smoothedMilliseconds_) * config_.smoothing;
+	} else {
+		smoothedMilliseconds_ = gpuMilliseconds;
+		hasSample_ = true;
+	}
+	if (!hasSample_ || smoothedMilliseconds_ <= 0.0f) {
+		return;
+	}
+
+	// GPU時間はピクセル数(倍率の2乗)に比例するとみなして、狙いの時間に収まる倍率を求める
+	const float budget = config_.budgetMilliseconds;
+	float desiredScale = scale_ * std::sqrt(budget * config_.targetUtilization / smoothedMilliseconds_);
+
+	float newScale = scale_;
+	if (smoothedMilliseconds_ > budget * config_.decreaseThreshold) {
+		// 予算超過はすぐに下げる
+		newScale = std::max(desiredScale, scale_ - config_.maxStep);
+		underBudgetFrames_ = 0;
+	} else if (smoothedMilliseconds_ < budget * config_.increaseThreshold) {
+		// 余裕がしばらく続いたときだけ上げる(ヒステリシス)
+		if (++underBudgetFrames_ >= config_.increaseDelayFrames) {
+			newScale = std::min(desiredScale, scale_ + config_.maxStep);
+			underBudgetFrames_ = 0;
+		}
+	} else {
+		underBudgetFrames_ = 0;
+	}
+	newScale = std::clamp(newScale, config_.minScale, config_.maxScale);
+
+	if (std::abs(newScale - scale_) < 1e-4f) {
+		return;
+	}
+
+	int direction = newScale > scale_ ? 1 : -1;
+	if (lastDirection_ != 0 && direction != lastDirection_) {
+		statistics_.directionChangeCount++;
+	}
+	lastDirection_ = direction;
+	statistics_.scaleChangeCount++;
+
+	// 変更後のGPU時間を予測して平均に反映し、同じ超過に対して何度も下げないようにする
+	smoothedMilliseconds_ *= (newScale * newScale) / (scale_ * scale_);
+	scale_ = newScale;
+	UpdateRenderSize();
+}
+
+void DynamicResolution::UpdateRenderSize() {
+	auto alignSize = [this](uint32_t outputSize) {
+		uint32_t alignment = std::max(1u, config_.alignment);
+		uint32_t size = static_cast<uint32_t>(std::lround(static_cast<float>(outputSize) * scale_ / static_cast<float>(alignment))) * alignment;
+		return std::clamp(size, std::min(alignment, outputSize), outputSize);
+	};
+	renderWidth_ = alignSize(outputWidth_);
+	renderHeight_ = alignSize(outputHeight_);
+}
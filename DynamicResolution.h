@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// GPU時間をもとに内部描画解像度を決める動的解像度コントローラ(CPUのみ)
+/// </summary>
+class DynamicResolution {
+public: // サブクラス
+	struct Config {
+		float budgetMilliseconds = 16.0f;  // GPU時間の予算
+		float targetUtilization = 0.85f;   // 解像度を決めるときに狙う予算の割合
+		float minScale = 0.5f;             // 1辺あたりの最小倍率
+		float maxScale = 1.0f;             // 1辺あたりの最大倍率
+		float smoothing = 0.15f;           // GPU時間の指数移動平均の係数
+		float outlierRatio = 2.0f;         // 平均のこの倍を超えた単発のフレームは平均に入れない(2フレーム続いたら入れる)
+		float decreaseThreshold = 0.95f;   // 平均が予算のこの割合を超えたらすぐ下げる
+		float increaseThreshold = 0.75f;   // 平均がこの割合を下回り続けたら上げる
+		uint32_t increaseDelayFrames = 30; // 上げるまでに必要な連続フレーム数
+		float maxStep = 0.1f;              // 1回で変える倍率の上限
+		uint32_t alignment = 8;            // 描画サイズの丸め単位(ピクセル)
+	};
+
+	struct Statistics {
+		uint32_t frameCount = 0;
+		uint32_t overBudgetFrameCount = 0; // 生のGPU時間が予算を超えたフレーム数
+		uint32_t scaleChangeCount = 0;
+		uint32_t directionChangeCount = 0; // 上げ下げの向きが反転した回数(振動の指標)
+		uint32_t outlierFrameCount = 0;    // 単発の突出として平均に入れなかったフレーム数
+		double scaleSum = 0.0;
+		float minScale = 1.0f;
+		float maxScale = 0.0f;
+
+		float GetBudgetAdherence() const { return frameCount ? 1.0f - static_cast<float>(overBudgetFrameCount) / static_cast<float>(frameCount) : 1.0f; }
+		float GetAverageScale() const { return frameCount ? static_cast<float>(scaleSum / frameCount) : 0.0f; }
+	};
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// ネイティブ解像度で記録したGPU時間の列を再生し、コントローラの挙動を評価する。
+	/// 各フレームのGPU時間は描画ピクセル数に比例すると仮定する
+	/// </summary>
+	/// <param name="config">設定</param>
+	/// <param name="nativeMilliseconds">ネイティブ解像度での各フレームのGPU時間</param>
+	/// <param name="outputWidth">出力の幅</param>
+	/// <param name="outputHeight">出力の高さ</param>
+	/// <param name="outScales">各フレームの描画に使った倍率の出力先(不要ならnullptr)</param>
+	/// <returns>再生結果の統計</returns>
+	static Statistics ReplayTrace(const Config& config, const std::vector<float>& nativeMilliseconds, uint32_t outputWidth, uint32_t outputHeight,
+		std::vector<float>* outScales = nullptr);
+
+public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	void Initialize(const Config& config, uint32_t outputWidth, uint32_t outputHeight);
+
+	/// <summary>
+	/// 出力(バックバッファ)のサイズ変更
+	/// </summary>
+	void SetOutputSize(uint32_t outputWidth, uint32_t outputHeight);
+
+	/// <summary>
+	/// 計測したGPU時間を渡して次のフレームの倍率を決める
+	/// </summary>
+	/// <param name="gpuMilliseconds">直前のフレームのGPU時間(計測できなければ負数)</param>
+	void Update(float gpuMilliseconds);
+
+	float GetScale() const { return scale_; }
+	uint32_t GetRenderWidth() const { return renderWidth_; }
+	uint32_t GetRenderHeight() const { return renderHeight_; }
+	float GetSmoothedMilliseconds() const { return smoothedMilliseconds_; }
+	const Statistics& GetStatistics() const { return statistics_; }
+
+private: // メンバ関数
+	/// <summary>
+	/// 倍率から描画サイズを求める
+	/// </summary>
+	void UpdateRenderSize();
+
+private: // メンバ変数
+	Config config_;
+	uint32_t outputWidth_ = 0;
+	uint32_t outputHeight_ = 0;
+	uint32_t renderWidth_ = 0;
+	uint32_t renderHeight_ = 0;
+
+	float scale_ = 1.0f;
+	float smoothedMilliseconds_ = 0.0f;
+	bool hasSample_ = false;
+	bool lastWasOutlier_ = false;
+	uint32_t underBudgetFrames_ = 0;
+	int lastDirection_ = 0;
+
+	Statistics statistics_;
+};
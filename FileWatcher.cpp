@@ -0,0 +1,261 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 監視スレッドが終了要求を確認する間隔(ミリ秒)
+const int kStopCheckMilliseconds = 50;
+
+} // namespace
+
+FileWatcher::~FileWatcher() {
+	Stop();
+}
+
+uint64_t FileWatcher::GetTimestamp() {
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint32_t FileWatcher::Poll(std::vector<std::string>& outFiles, uint64_t settleNanoseconds) {
+	const uint64_t now = GetTimestamp();
+	uint32_t count = 0;
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (auto it = changes_.begin(); it != changes_.end();) {
+		if (now - it->second >= settleNanoseconds) {
+			outFiles.push_back(it->first);
+			it = changes_.erase(it);
+			++count;
+		} else {
+			++it;
+		}
+	}
+	return count;
+}
+
+void FileWatcher::Record(const std::string& file) {
+	const uint64_t now = GetTimestamp();
+	std::lock_guard<std::mutex> lock(mutex_);
+	changes_[file] = now;
+}
+
+#ifdef _WIN32
+/*///////////////////////
+	Windows(ReadDirectoryChangesW)
+*////////////////////////
+bool FileWatcher::Start(const std::string& directory) {
+	Stop();
+	directory_ = directory;
+	HANDLE directoryHandle = CreateFileA(directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (directoryHandle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	directoryHandle_ = directoryHandle;
+	stopEvent_ = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	running_ = true;
+	thread_ = std::thread(&FileWatcher::Run, this);
+	return true;
+}
+
+void FileWatcher::Stop() {
+	if (!thread_.joinable()) {
+		return;
+	}
+	running_ = false;
+	SetEvent(static_cast<HANDLE>(stopEvent_));
+	thread_.join();
+	CloseHandle(static_cast<HANDLE>(stopEvent_));
+	CloseHandle(static_cast<HANDLE>(directoryHandle_));
+	stopEvent_ = nullptr;
+	directoryHandle_ = nullptr;
+}
+
+void FileWatcher::Run() {
+	HANDLE directoryHandle = static_cast<HANDLE>(directoryHandle_);
+	OVERLAPPED overlapped{};
+	overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	// FILE_NOTIFY_INFORMATIONはDWORD境界に置く
+	alignas(DWORD) uint8_t buffer[16 * 1024];
+	const HANDLE events[] = { overlapped.hEvent, static_cast<HANDLE>(stopEvent_) };
+	while (running_) {
+		ResetEvent(overlapped.hEvent);
+		// サブディレクトリも含めて、上書き保存(書き込み)と、一時ファイルからの置き換え(名前の変更)を拾う
+		if (!ReadDirectoryChangesW(directoryHandle, buffer, sizeof(buffer), TRUE,
+			FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, nullptr, &overlapped, nullptr)) {
+			break;
+		}
+		if (WaitForMultipleObjects(_countof(events), events, FALSE, INFINITE) != WAIT_OBJECT_0) {
+			CancelIoEx(directoryHandle, &overlapped);
+			DWORD ignored;
+			GetOverlappedResult(directoryHandle, &overlapped, &ignored, TRUE);
+			break;
+		}
+		DWORD bytes = 0;
+		if (!GetOverlappedResult(directoryHandle, &overlapped, &bytes, FALSE) || bytes == 0) {
+			// バッファが溢れた分は取りこぼすが、次の保存で拾える
+			continue;
+		}
+		for (const uint8_t* entry = buffer;;) {
+			const FILE_NOTIFY_INFORMATION* information = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+			if (information->Action == FILE_ACTION_MODIFIED || information->Action == FILE_ACTION_ADDED ||
+				information->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+				const int length = static_cast<int>(information->FileNameLength / sizeof(WCHAR));
+				const int size = WideCharToMultiByte(CP_UTF8, 0, information->FileName, length, nullptr, 0, nullptr, nullptr);
+				std::string file(static_cast<size_t>(size), '\0');
+				WideCharToMultiByte(CP_UTF8, 0, information->FileName, length, file.data(), size, nullptr, nullptr);
+				// サブディレクトリのファイルは"sub\file"で来るので、区切りをLinuxとそろえる
+				std::replace(file.begin(), file.end(), '\\', '/');
+				Record(file);
+			}
+			if (information->NextEntryOffset == 0) {
+				break;
+			}
+			entry += information->NextEntryOffset;
+		}
+	}
+	CloseHandle(overlapped.hEvent);
+}
+
+#elif defined(__linux__)
+/*///////////////////////
+	Linux(inotify)
+*////////////////////////
+namespace {
+
+// 書き込みの終わりと、一時ファイルからの置き換え(名前の変更)、サブディレクトリの追加を拾う
+const uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE;
+
+} // namespace
+
+bool FileWatcher::Start(const std::string& directory) {
+	Stop();
+	directory_ = directory;
+	inotifyDescriptor_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyDescriptor_ < 0) {
+		return false;
+	}
+	// inotifyはディレクトリ直下しか見ないので、サブディレクトリごとに監視を加える
+	if (!AddWatchRecursive(std::string(), false)) {
+		close(inotifyDescriptor_);
+		inotifyDescriptor_ = -1;
+		watchDirectories_.clear();
+		return false;
+	}
+	running_ = true;
+	thread_ = std::thread(&FileWatcher::Run, this);
+	return true;
+}
+
+void FileWatcher::Stop() {
+	if (!thread_.joinable()) {
+		return;
+	}
+	running_ = false;
+	thread_.join();
+	close(inotifyDescriptor_);
+	inotifyDescriptor_ = -1;
+	watchDirectories_.clear();
+}
+
+bool FileWatcher::AddWatchRecursive(const std::string& relativePath, bool recordFiles) {
+	const std::string path = relativePath.empty() ? directory_ : directory_ + "/" + relativePath;
+	const int watchDescriptor = inotify_add_watch(inotifyDescriptor_, path.c_str(), kWatchMask | IN_ONLYDIR);
+	if (watchDescriptor < 0) {
+		return false;
+	}
+	watchDirectories_[watchDescriptor] = relativePath;
+
+	DIR* directory = opendir(path.c_str());
+	if (!directory) {
+		return true;
+	}
+	while (const dirent* entry = readdir(directory)) {
+		const std::string name = entry->d_name;
+		if (name == "." || name == "..") {
+			continue;
+		}
+		const std::string child = relativePath.empty() ? name : relativePath + "/" + name;
+		// d_typeが分からないファイルシステムでは、監視を加えてみてディレクトリかどうかを確かめる
+		if (entry->d_type == DT_DIR || entry->d_type == DT_UNKNOWN) {
+			if (AddWatchRecursive(child, recordFiles) || entry->d_type == DT_DIR) {
+				continue;
+			}
+		}
+		if (recordFiles) {
+			Record(child);
+		}
+	}
+	closedir(directory);
+	return true;
+}
+
+void FileWatcher::Run() {
+	alignas(inotify_event) char buffer[16 * 1024];
+	pollfd descriptor{ inotifyDescriptor_, POLLIN, 0 };
+	while (running_) {
+		if (poll(&descriptor, 1, kStopCheckMilliseconds) <= 0) {
+			continue;
+		}
+		for (;;) {
+			const ssize_t bytes = read(inotifyDescriptor_, buffer, sizeof(buffer));
+			if (bytes <= 0) {
+				break;
+			}
+			for (ssize_t offset = 0; offset < bytes;) {
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+				offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+				const auto watch = watchDirectories_.find(event->wd);
+				if (watch == watchDirectories_.end()) {
+					continue;
+				}
+				if (event->mask & IN_IGNORED) {
+					// 削除・移動されたディレクトリの監視が外れた
+					watchDirectories_.erase(watch);
+					continue;
+				}
+				if (event->len == 0) {
+					continue;
+				}
+				const std::string file = watch->second.empty() ? std::string(event->name) : watch->second + "/" + event->name;
+				if (event->mask & IN_ISDIR) {
+					// 作られた・移されてきたディレクトリも監視し、監視を加えるまでに書かれたファイルは変更として扱う。
+					// 木の中で移したディレクトリは同じ監視記述子が返るので、相対パスがここで付け替わる
+					if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+						AddWatchRecursive(file, true);
+					}
+				} else if (event->mask & (IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO)) {
+					Record(file);
+				}
+			}
+		}
+	}
+}
+
+#else
+/*///////////////////////
+	未対応の環境
+*////////////////////////
+bool FileWatcher::Start(const std::string& directory) {
+	directory_ = directory;
+	return false;
+}
+
+void FileWatcher::Stop() {
+}
+
+void FileWatcher::Run() {
+}
+#endif
@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// ディレクトリ以下(サブディレクトリを含む)のファイルの書き込みを監視する。
+/// 監視は専用スレッドで行い(WindowsはReadDirectoryChangesW、Linuxはディレクトリごとのinotify)、変更はPollでまとめて取り出す
+/// </summary>
+class FileWatcher {
+public: // メンバ関数
+	~FileWatcher();
+
+	/// <summary>
+	/// 監視の開始
+	/// </summary>
+	/// <param name="directory">監視するディレクトリ</param>
+	/// <returns>監視できたか(対応していない環境ではfalse)</returns>
+	bool Start(const std::string& directory);
+
+	/// <summary>
+	/// 監視の終了
+	/// </summary>
+	void Stop();
+
+	/// <summary>
+	/// 最後の変更から一定時間たったファイルを取り出す。
+	/// エディタは1回の保存で何度も書き込むことがあるので、書き込みが落ち着くまで待つ
+	/// </summary>
+	/// <param name="outFiles">変更されたファイル(ディレクトリからの相対パス。区切りは/)の追加先</param>
+	/// <param name="settleNanoseconds">最後の変更からこれだけたったものを返す</param>
+	/// <returns>取り出した数</returns>
+	uint32_t Poll(std::vector<std::string>& outFiles, uint64_t settleNanoseconds);
+
+	bool IsRunning() const { return running_; }
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// 単調増加の時刻(ナノ秒)
+	/// </summary>
+	static uint64_t GetTimestamp();
+
+private: // メンバ関数
+	/// <summary>
+	/// 監視スレッドの本体
+	/// </summary>
+	void Run();
+
+	/// <summary>
+	/// 変更を記録する(同じファイルは最後の時刻だけ残す)
+	/// </summary>
+	void Record(const std::string& file);
+
+#ifdef __linux__
+	/// <summary>
+	/// ディレクトリとその下のすべてのディレクトリを監視に加える
+	/// </summary>
+	/// <param name="relativePath">監視するディレクトリからの相対パス(空ならルート)</param>
+	/// <param name="recordFiles">中にあるファイルを変更として記録するか(監視を始める前に書かれた分を取りこぼさないため)</param>
+	/// <returns>relativePath自体を監視できたか</returns>
+	bool AddWatchRecursive(const std::string& relativePath, bool recordFiles);
+#endif
+
+private: // メンバ変数
+	std::string directory_;
+	std::thread thread_;
+	std::atomic<bool> running_ = false;
+
+	std::mutex mutex_;
+	std::map<std::string, uint64_t> changes_; // ファイルと最後に変更された時刻
+
+#ifdef _WIN32
+	void* directoryHandle_ = nullptr; // HANDLE
+	void* stopEvent_ = nullptr;       // HANDLE
+#else
+	int inotifyDescriptor_ = -1;
+	std::map<int, std::string> watchDirectories_; // 監視記述子と、そのディレクトリの相対パス(ルートは空)
+#endif
+};
@@ -0,0 +1,265 @@
+#include "GpuCulling.h"
+
+#include "ShaderCompiler.h"
+
+#include <Windows.h>
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+// ルートパラメータの番号
+enum RootParameter {
+	kRootView,          // b0 カメラ情報(ルート定数)
+	kRootInstances,     // t0
+	kRootMeshes,        // t1
+	kRootHiZ,           // t2(テーブル)
+	kRootDrawArguments, // u0
+	kRootDrawCount,     // u1
+	kRootParameterCount,
+};
+
+const uint32_t kThreadGroupSize = 64;
+
+} // namespace
+
+void GpuCulling::Initialize(ID3D12Device* device, uint32_t maxInstanceCount, uint32_t maxMeshCount) {
+	maxInstanceCount_ = maxInstanceCount;
+	maxMeshCount_ = maxMeshCount;
+
+	CreatePipeline(device);
+
+	// 入力は毎フレームCPUから書き換えるのでアップロードヒープに置いてマップしたままにする
+	instanceBuffer_ = CreateBuffer(device, sizeof(CullingInstance) * maxInstanceCount, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ);
+	meshBuffer_ = CreateBuffer(device, sizeof(CullingMesh) * maxMeshCount, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ);
+	D3D12_RANGE readRange{ 0, 0 };
+	HRESULT hr = instanceBuffer_->Map(0, &readRange, reinterpret_cast<void**>(&mappedInstances_));
+	assert(SUCCEEDED(hr));
+	hr = meshBuffer_->Map(0, &readRange, reinterpret_cast<void**>(&mappedMeshes_));
+	assert(SUCCEEDED(hr));
+
+	// 出力はCOMMONで作り、以降の状態はargumentState_/countState_で追跡する
+	argumentBuffer_ = CreateBuffer(device, sizeof(DrawIndexedArguments) * maxInstanceCount, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON);
+	countBuffer_ = CreateBuffer(device, sizeof(uint32_t), D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON);
+	argumentState_ = D3D12_RESOURCE_STATE_COMMON;
+	countState_ = D3D12_RESOURCE_STATE_COMMON;
+
+	zeroBuffer_ = CreateBuffer(device, sizeof(uint32_t), D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ);
+	void* zero = nullptr;
+	hr = zeroBuffer_->Map(0, &readRange, &zero);
+	assert(SUCCEEDED(hr));
+	std::memset(zero, 0, sizeof(uint32_t));
+	zeroBuffer_->Unmap(0, nullptr);
+
+	// Hi-Z用のSRV。設定されるまではnullのSRVを置いておく
+	D3D12_DESCRIPTOR_HEAP_DESC descriptorHeapDesc{};
+	descriptorHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	descriptorHeapDesc.NumDescriptors = 1;
+	descriptorHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	hr = device->CreateDescriptorHeap(&descriptorHeapDesc, IID_PPV_ARGS(&descriptorHeap_));
+	assert(SUCCEEDED(hr));
+	SetHiZ(device, nullptr, 0);
+
+	// 描画引数だけのコマンドシグネチャ(ルート引数を変えないのでルートシグネチャは不要)
+	D3D12_INDIRECT_ARGUMENT_DESC argumentDesc{};
+	argumentDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+	D3D12_COMMAND_SIGNATURE_DESC commandSignatureDesc{};
+	commandSignatureDesc.ByteStride = sizeof(DrawIndexedArguments);
+	commandSignatureDesc.NumArgumentDescs = 1;
+	commandSignatureDesc.pArgumentDescs = &argumentDesc;
+	hr = device->CreateCommandSignature(&commandSignatureDesc, nullptr, IID_PPV_ARGS(&commandSignature_));
+	assert(SUCCEEDED(hr));
+}
+
+void GpuCulling::Finalize() {
+	ID3D12Resource** resources[] = { &instanceBuffer_, &meshBuffer_, &argumentBuffer_, &countBuffer_, &zeroBuffer_ };
+	for (ID3D12Resource** resource : resources) {
+		if (*resource) {
+			(*resource)->Release();
+			*resource = nullptr;
+		}
+	}
+	mappedInstances_ = nullptr;
+	mappedMeshes_ = nullptr;
+	if (descriptorHeap_) {
+		descriptorHeap_->Release();
+		descriptorHeap_ = nullptr;
+	}
+	if (commandSignature_) {
+		commandSignature_->Release();
+		commandSignature_ = nullptr;
+	}
+	if (pipelineState_) {
+		pipelineState_->Release();
+		pipelineState_ = nullptr;
+	}
+	if (rootSignature_) {
+		rootSignature_->Release();
+		rootSignature_ = nullptr;
+	}
+}
+
+void GpuCulling::UpdateInstances(const CullingInstance* instances, uint32_t instanceCount) {
+	assert(instanceCount <= maxInstanceCount_);
+	std::memcpy(mappedInstances_, instances, sizeof(CullingInstance) * instanceCount);
+	instanceCount_ = instanceCount;
+}
+
+void GpuCulling::UpdateMeshes(const CullingMesh* meshes, uint32_t meshCount) {
+	assert(meshCount <= maxMeshCount_);
+	std::memcpy(mappedMeshes_, meshes, sizeof(CullingMesh) * meshCount);
+}
+
+void GpuCulling::SetHiZ(ID3D12Device* device, ID3D12Resource* hiZ, uint32_t mipCount) {
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Texture2D.MipLevels = hiZ ? mipCount : 1;
+	device->CreateShaderResourceView(hiZ, &srvDesc, descriptorHeap_->GetCPUDescriptorHandleForHeapStart());
+
+	if (hiZ) {
+		D3D12_RESOURCE_DESC desc = hiZ->GetDesc();
+		hiZWidth_ = static_cast<uint32_t>(desc.Width);
+		hiZHeight_ = desc.Height;
+		hiZMipCount_ = mipCount;
+	} else {
+		hiZWidth_ = hiZHeight_ = hiZMipCount_ = 0;
+	}
+}
+
+void GpuCulling::Dispatch(ID3D12GraphicsCommandList* commandList, const CullingView& view) {
+	CullingView constants = view;
+	constants.instanceCount = instanceCount_;
+	constants.hiZWidth = hiZWidth_;
+	constants.hiZHeight = hiZHeight_;
+	constants.hiZMipCount = hiZMipCount_;
+
+	// 前フレームの間接引数の状態から戻し、個数を0にしてから書き込み可能にする
+	TransitionOutputs(commandList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST);
+	commandList->CopyBufferRegion(countBuffer_, 0, zeroBuffer_, 0, sizeof(uint32_t));
+	TransitionOutputs(commandList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+	ID3D12DescriptorHeap* descriptorHeaps[] = { descriptorHeap_ };
+	commandList->SetDescriptorHeaps(1, descriptorHeaps);
+	commandList->SetComputeRootSignature(rootSignature_);
+	commandList->SetPipelineState(pipelineState_);
+	commandList->SetComputeRoot32BitConstants(kRootView, sizeof(CullingView) / sizeof(uint32_t), &constants, 0);
+	commandList->SetComputeRootShaderResourceView(kRootInstances, instanceBuffer_->GetGPUVirtualAddress());
+	commandList->SetComputeRootShaderResourceView(kRootMeshes, meshBuffer_->GetGPUVirtualAddress());
+	commandList->SetComputeRootDescriptorTable(kRootHiZ, descriptorHeap_->GetGPUDescriptorHandleForHeapStart());
+	commandList->SetComputeRootUnorderedAccessView(kRootDrawArguments, argumentBuffer_->GetGPUVirtualAddress());
+	commandList->SetComputeRootUnorderedAccessView(kRootDrawCount, countBuffer_->GetGPUVirtualAddress());
+	commandList->Dispatch((instanceCount_ + kThreadGroupSize - 1) / kThreadGroupSize, 1, 1);
+
+	// 書き込みが終わったら間接引数として読める状態へ
+	TransitionOutputs(commandList, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+}
+
+void GpuCulling::ExecuteIndirect(ID3D12GraphicsCommandList* commandList) {
+	// 実際の描画数はGPUが書いた個数で決まるので、CPU側のコストはインスタンス数に依存しない
+	commandList->ExecuteIndirect(commandSignature_, instanceCount_, argumentBuffer_, 0, countBuffer_, 0);
+
+	// コマンドリストを跨いでも状態が決まっているようにCOMMONへ戻しておく
+	TransitionOutputs(commandList, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COMMON);
+}
+
+void GpuCulling::CreatePipeline(ID3D12Device* device) {
+	D3D12_DESCRIPTOR_RANGE hiZRange{};
+	hiZRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	hiZRange.NumDescriptors = 1;
+	hiZRange.BaseShaderRegister = 2;
+	hiZRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
+	D3D12_ROOT_PARAMETER rootParameters[kRootParameterCount]{};
+	rootParameters[kRootView].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	rootParameters[kRootView].Constants.ShaderRegister = 0;
+	rootParameters[kRootView].Constants.Num32BitValues = sizeof(CullingView) / sizeof(uint32_t);
+	rootParameters[kRootInstances].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	rootParameters[kRootInstances].Descriptor.ShaderRegister = 0;
+	rootParameters[kRootMeshes].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	rootParameters[kRootMeshes].Descriptor.ShaderRegister = 1;
+	rootParameters[kRootHiZ].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	rootParameters[kRootHiZ].DescriptorTable.NumDescriptorRanges = 1;
+	rootParameters[kRootHiZ].DescriptorTable.pDescriptorRanges = &hiZRange;
+	rootParameters[kRootDrawArguments].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+	rootParameters[kRootDrawArguments].Descriptor.ShaderRegister = 0;
+	rootParameters[kRootDrawCount].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+	rootParameters[kRootDrawCount].Descriptor.ShaderRegister = 1;
+	for (D3D12_ROOT_PARAMETER& rootParameter : rootParameters) {
+		rootParameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	}
+
+	D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc{};
+	rootSignatureDesc.NumParameters = _countof(rootParameters);
+	rootSignatureDesc.pParameters = rootParameters;
+
+	ID3DBlob* signatureBlob = nullptr;
+	ID3DBlob* errorBlob = nullptr;
+	HRESULT hr = D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signatureBlob, &errorBlob);
+	if (FAILED(hr)) {
+		OutputDebugStringA(static_cast<const char*>(errorBlob->GetBufferPointer()));
+		assert(false);
+	}
+	hr = device->CreateRootSignature(0, signatureBlob->GetBufferPointer(), signatureBlob->GetBufferSize(), IID_PPV_ARGS(&rootSignature_));
+	assert(SUCCEEDED(hr));
+	signatureBlob->Release();
+
+	ID3DBlob* computeShaderBlob = CompileShader(L"InstanceCulling.hlsl", "main", "cs_5_0");
+
+	D3D12_COMPUTE_PIPELINE_STATE_DESC pipelineStateDesc{};
+	pipelineStateDesc.pRootSignature = rootSignature_;
+	pipelineStateDesc.CS = { computeShaderBlob->GetBufferPointer(), computeShaderBlob->GetBufferSize() };
+	hr = device->CreateComputePipelineState(&pipelineStateDesc, IID_PPV_ARGS(&pipelineState_));
+	assert(SUCCEEDED(hr));
+	computeShaderBlob->Release();
+}
+
+ID3D12Resource* GpuCulling::CreateBuffer(ID3D12Device* device, uint64_t size, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_FLAGS flags, D3D12_RESOURCE_STATES initialState) {
+	D3D12_HEAP_PROPERTIES heapProperties{};
+	heapProperties.Type = heapType;
+
+	D3D12_RESOURCE_DESC resourceDesc{};
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resourceDesc.Width = size;
+	resourceDesc.Height = 1;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.MipLevels = 1;
+	resourceDesc.SampleDesc.Count = 1;
+	resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	resourceDesc.Flags = flags;
+
+	ID3D12Resource* buffer = nullptr;
+	HRESULT hr = device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc, initialState, nullptr, IID_PPV_ARGS(&buffer));
+	assert(SUCCEEDED(hr));
+	return buffer;
+}
+
+void GpuCulling::TransitionOutputs(ID3D12GraphicsCommandList* commandList, D3D12_RESOURCE_STATES argumentState, D3D12_RESOURCE_STATES countState) {
+	D3D12_RESOURCE_BARRIER barriers[2]{};
+	uint32_t barrierCount = 0;
+	struct {
+		ID3D12Resource* resource;
+		D3D12_RESOURCE_STATES* current;
+		D3D12_RESOURCE_STATES after;
+	} const outputs[] = {
+		{ argumentBuffer_, &argumentState_, argumentState },
+		{ countBuffer_, &countState_, countState },
+	};
+	for (const auto& output : outputs) {
+		if (*output.current == output.after) {
+			continue;
+		}
+		D3D12_RESOURCE_BARRIER& barrier = barriers[barrierCount++];
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		barrier.Transition.pResource = output.resource;
+		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		barrier.Transition.StateBefore = *output.current;
+		barrier.Transition.StateAfter = output.after;
+		*output.current = output.after;
+	}
+	if (barrierCount > 0) {
+		commandList->ResourceBarrier(barrierCount, barriers);
+	}
+}
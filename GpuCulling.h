@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+
+#include <d3d12.h>
+
+#include "InstanceCulling.h"
+
+/// <summary>
+/// コンピュートシェーダーでインスタンスをカリングし、ExecuteIndirectの引数と個数を生成する。
+/// 描画引数のStartInstanceLocationにインスタンス番号が入るので、インスタンス単位の頂点バッファで参照する
+/// </summary>
+class GpuCulling {
+public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	/// <param name="maxInstanceCount">インスタンス数の上限</param>
+	/// <param name="maxMeshCount">メッシュ数の上限</param>
+	void Initialize(ID3D12Device* device, uint32_t maxInstanceCount, uint32_t maxMeshCount);
+
+	/// <summary>
+	/// 解放
+	/// </summary>
+	void Finalize();
+
+	/// <summary>
+	/// インスタンスを書き込む(アップロードヒープに常時マップしてあるバッファへ直接コピー)
+	/// </summary>
+	void UpdateInstances(const CullingInstance* instances, uint32_t instanceCount);
+
+	/// <summary>
+	/// メッシュを書き込む
+	/// </summary>
+	void UpdateMeshes(const CullingMesh* meshes, uint32_t meshCount);
+
+	/// <summary>
+	/// オクルージョン判定に使うHi-Zを設定する(nullptrで無効)
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	/// <param name="hiZ">R32_FLOATの最大深度ミップチェーン</param>
+	/// <param name="mipCount">ミップ数</param>
+	void SetHiZ(ID3D12Device* device, ID3D12Resource* hiZ, uint32_t mipCount);
+
+	/// <summary>
+	/// カリングを実行して描画引数と個数を書き出す
+	/// </summary>
+	/// <param name="commandList">コマンドリスト</param>
+	/// <param name="view">カメラ情報(instanceCountとHi-Zの情報はこのクラスの値で上書きする)</param>
+	void Dispatch(ID3D12GraphicsCommandList* commandList, const CullingView& view);
+
+	/// <summary>
+	/// 生成した描画引数で描画する。呼び出し側でパイプラインと頂点・インデックスバッファを設定しておく。
+	/// 描画後に出力バッファをCOMMONへ戻すので、Dispatchと同じコマンドリストで呼ぶ
+	/// </summary>
+	void ExecuteIndirect(ID3D12GraphicsCommandList* commandList);
+
+private: // メンバ関数
+	/// <summary>
+	/// ルートシグネチャとパイプラインの生成
+	/// </summary>
+	void CreatePipeline(ID3D12Device* device);
+
+	/// <summary>
+	/// バッファの生成
+	/// </summary>
+	ID3D12Resource* CreateBuffer(ID3D12Device* device, uint64_t size, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_FLAGS flags, D3D12_RESOURCE_STATES initialState);
+
+	/// <summary>
+	/// 出力バッファを指定の状態へ遷移させる(記録している状態と同じものはバリアを積まない)
+	/// </summary>
+	/// <param name="commandList">コマンドリスト</param>
+	/// <param name="argumentState">描画引数バッファの遷移先</param>
+	/// <param name="countState">個数バッファの遷移先</param>
+	void TransitionOutputs(ID3D12GraphicsCommandList* commandList, D3D12_RESOURCE_STATES argumentState, D3D12_RESOURCE_STATES countState);
+
+private: // メンバ変数
+	ID3D12RootSignature* rootSignature_ = nullptr;
+	ID3D12PipelineState* pipelineState_ = nullptr;
+	ID3D12CommandSignature* commandSignature_ = nullptr;
+	ID3D12DescriptorHeap* descriptorHeap_ = nullptr;
+
+	// CPUから書き込む入力(アップロードヒープ)
+	ID3D12Resource* instanceBuffer_ = nullptr;
+	ID3D12Resource* meshBuffer_ = nullptr;
+	CullingInstance* mappedInstances_ = nullptr;
+	CullingMesh* mappedMeshes_ = nullptr;
+
+	// GPUが書き込む出力
+	ID3D12Resource* argumentBuffer_ = nullptr;
+	ID3D12Resource* countBuffer_ = nullptr;
+	// 個数をクリアするための0
+	ID3D12Resource* zeroBuffer_ = nullptr;
+	// 出力バッファの現在の状態(暗黙の昇格・減衰には頼らず明示的に遷移させる)
+	D3D12_RESOURCE_STATES argumentState_ = D3D12_RESOURCE_STATE_COMMON;
+	D3D12_RESOURCE_STATES countState_ = D3D12_RESOURCE_STATE_COMMON;
+
+	uint32_t maxInstanceCount_ = 0;
+	uint32_t maxMeshCount_ = 0;
+	uint32_t instanceCount_ = 0;
+	uint32_t hiZWidth_ = 0;
+	uint32_t hiZHeight_ = 0;
+	uint32_t hiZMipCount_ = 0;
+};
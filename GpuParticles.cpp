@@ -0,0 +1,326 @@
+#include "GpuParticles.h"
+
+#include "ShaderCompiler.h"
+
+#include <Windows.h>
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+// シミュレーションのルートパラメータの番号
+enum ComputeRootParameter {
+	kRootSimulateConstants, // b0
+	kRootParticles,         // u0
+	kRootDeadList,          // u1
+	kRootAliveCurrent,      // u2
+	kRootAliveNext,         // u3
+	kRootCounters,          // u4
+	kRootDrawArguments,     // u5
+	kComputeRootParameterCount,
+};
+
+// 描画のルートパラメータの番号
+enum DrawRootParameter {
+	kRootDrawConstants, // b0
+	kRootParticlesSrv,  // t0
+	kRootAliveListSrv,  // t1
+	kDrawRootParameterCount,
+};
+
+const uint32_t kThreadGroupSize = 64;
+// 死亡数・生存数×2・発生上限
+const uint32_t kCounterSize = sizeof(uint32_t) * 4;
+
+ID3D12RootSignature* CreateRootSignature(ID3D12Device* device, const D3D12_ROOT_SIGNATURE_DESC& rootSignatureDesc) {
+	ID3DBlob* signatureBlob = nullptr;
+	ID3DBlob* errorBlob = nullptr;
+	HRESULT hr = D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signatureBlob, &errorBlob);
+	if (FAILED(hr)) {
+		OutputDebugStringA(static_cast<const char*>(errorBlob->GetBufferPointer()));
+		assert(false);
+	}
+	ID3D12RootSignature* rootSignature = nullptr;
+	hr = device->CreateRootSignature(0, signatureBlob->GetBufferPointer(), signatureBlob->GetBufferSize(), IID_PPV_ARGS(&rootSignature));
+	assert(SUCCEEDED(hr));
+	signatureBlob->Release();
+	return rootSignature;
+}
+
+ID3D12PipelineState* CreateComputePipeline(ID3D12Device* device, ID3D12RootSignature* rootSignature, const char* entryPoint) {
+	ID3DBlob* computeShaderBlob = CompileShader(L"Particles.hlsl", entryPoint, "cs_5_0");
+
+	D3D12_COMPUTE_PIPELINE_STATE_DESC pipelineStateDesc{};
+	pipelineStateDesc.pRootSignature = rootSignature;
+	pipelineStateDesc.CS = { computeShaderBlob->GetBufferPointer(), computeShaderBlob->GetBufferSize() };
+	ID3D12PipelineState* pipelineState = nullptr;
+	HRESULT hr = device->CreateComputePipelineState(&pipelineStateDesc, IID_PPV_ARGS(&pipelineState));
+	assert(SUCCEEDED(hr));
+	computeShaderBlob->Release();
+	return pipelineState;
+}
+
+template <typename T>
+void SafeRelease(T*& object) {
+	if (object) {
+		object->Release();
+		object = nullptr;
+	}
+}
+
+} // namespace
+
+void GpuParticles::Initialize(ID3D12Device* device, uint32_t capacity) {
+	assert(capacity > 0);
+	capacity_ = capacity;
+
+	CreateCommandObjects(device);
+	CreatePipelines(device);
+
+	particleBuffer_ = CreateBuffer(device, sizeof(ParticleData) * static_cast<uint64_t>(capacity));
+	deadListBuffer_ = CreateBuffer(device, sizeof(uint32_t) * static_cast<uint64_t>(capacity));
+	aliveListBuffers_[0] = CreateBuffer(device, sizeof(uint32_t) * static_cast<uint64_t>(capacity));
+	aliveListBuffers_[1] = CreateBuffer(device, sizeof(uint32_t) * static_cast<uint64_t>(capacity));
+	counterBuffer_ = CreateBuffer(device, kCounterSize);
+	drawArgumentBuffer_ = CreateBuffer(device, sizeof(D3D12_DRAW_ARGUMENTS));
+
+	// 描画引数だけのコマンドシグネチャ
+	D3D12_INDIRECT_ARGUMENT_DESC argumentDesc{};
+	argumentDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW;
+	D3D12_COMMAND_SIGNATURE_DESC commandSignatureDesc{};
+	commandSignatureDesc.ByteStride = sizeof(D3D12_DRAW_ARGUMENTS);
+	commandSignatureDesc.NumArgumentDescs = 1;
+	commandSignatureDesc.pArgumentDescs = &argumentDesc;
+	HRESULT hr = device->CreateCommandSignature(&commandSignatureDesc, nullptr, IID_PPV_ARGS(&commandSignature_));
+	assert(SUCCEEDED(hr));
+
+	aliveSlot_ = 0;
+	frameIndex_ = 0;
+	emitAccumulator_ = 0.0f;
+	needsReset_ = true;
+}
+
+void GpuParticles::Finalize() {
+	// 実行中のシミュレーションがあれば終わるまで待つ(削除されたデバイスのFenceは完了扱いになる)
+	if (computeFence_ && computeFence_->GetCompletedValue() < computeFenceValue_) {
+		computeFence_->SetEventOnCompletion(computeFenceValue_, nullptr);
+	}
+
+	ID3D12Resource** resources[] = { &particleBuffer_, &deadListBuffer_, &aliveListBuffers_[0], &aliveListBuffers_[1], &counterBuffer_, &drawArgumentBuffer_ };
+	for (ID3D12Resource** resource : resources) {
+		SafeRelease(*resource);
+	}
+	SafeRelease(commandSignature_);
+	SafeRelease(drawPipeline_);
+	SafeRelease(drawRootSignature_);
+	SafeRelease(finalizePipeline_);
+	SafeRelease(simulatePipeline_);
+	SafeRelease(emitPipeline_);
+	SafeRelease(initializePipeline_);
+	SafeRelease(computeRootSignature_);
+	SafeRelease(computeFence_);
+	SafeRelease(computeList_);
+	SafeRelease(computeAllocator_);
+	SafeRelease(computeQueue_);
+	computeFenceValue_ = 0;
+}
+
+void GpuParticles::Simulate(const ParticleEmitter& emitter, float deltaTime) {
+	// 前回の結果を使う描画の完了を呼び出し側が待っているので、アロケータはそのまま使い回せる
+	HRESULT hr = computeAllocator_->Reset();
+	assert(SUCCEEDED(hr));
+	hr = computeList_->Reset(computeAllocator_, nullptr);
+	assert(SUCCEEDED(hr));
+
+	// 端数の発生数は次のフレームへ持ち越す
+	emitAccumulator_ += emitter.emitRate * deltaTime;
+	const uint32_t emitCount = static_cast<uint32_t>(emitAccumulator_);
+	emitAccumulator_ -= static_cast<float>(emitCount);
+	particleSize_ = emitter.size;
+
+	SimulateConstants constants{};
+	constants.emitter = emitter;
+	constants.deltaTime = deltaTime;
+	constants.emitCount = emitCount;
+	constants.capacity = capacity_;
+	constants.seed = frameIndex_++;
+	constants.aliveSlot = aliveSlot_;
+
+	computeList_->SetComputeRootSignature(computeRootSignature_);
+	computeList_->SetComputeRoot32BitConstants(kRootSimulateConstants, sizeof(SimulateConstants) / sizeof(uint32_t), &constants, 0);
+	computeList_->SetComputeRootUnorderedAccessView(kRootParticles, particleBuffer_->GetGPUVirtualAddress());
+	computeList_->SetComputeRootUnorderedAccessView(kRootDeadList, deadListBuffer_->GetGPUVirtualAddress());
+	computeList_->SetComputeRootUnorderedAccessView(kRootAliveCurrent, aliveListBuffers_[aliveSlot_]->GetGPUVirtualAddress());
+	computeList_->SetComputeRootUnorderedAccessView(kRootAliveNext, aliveListBuffers_[aliveSlot_ ^ 1]->GetGPUVirtualAddress());
+	computeList_->SetComputeRootUnorderedAccessView(kRootCounters, counterBuffer_->GetGPUVirtualAddress());
+	computeList_->SetComputeRootUnorderedAccessView(kRootDrawArguments, drawArgumentBuffer_->GetGPUVirtualAddress());
+
+	const uint32_t capacityGroupCount = (capacity_ + kThreadGroupSize - 1) / kThreadGroupSize;
+	if (needsReset_) {
+		computeList_->SetPipelineState(initializePipeline_);
+		computeList_->Dispatch(capacityGroupCount, 1, 1);
+		UavBarrier();
+		needsReset_ = false;
+	}
+	if (emitCount > 0) {
+		computeList_->SetPipelineState(emitPipeline_);
+		computeList_->Dispatch((emitCount + kThreadGroupSize - 1) / kThreadGroupSize, 1, 1);
+		UavBarrier();
+	}
+	computeList_->SetPipelineState(simulatePipeline_);
+	computeList_->Dispatch(capacityGroupCount, 1, 1);
+	UavBarrier();
+	computeList_->SetPipelineState(finalizePipeline_);
+	computeList_->Dispatch(1, 1, 1);
+
+	hr = computeList_->Close();
+	assert(SUCCEEDED(hr));
+	ID3D12CommandList* commandLists[] = { computeList_ };
+	computeQueue_->ExecuteCommandLists(1, commandLists);
+	computeQueue_->Signal(computeFence_, ++computeFenceValue_);
+
+	// 生き残りを書いた側が次の描画と次フレームの入力になる
+	aliveSlot_ ^= 1;
+}
+
+void GpuParticles::WaitForSimulation(ID3D12CommandQueue* commandQueue) {
+	commandQueue->Wait(computeFence_, computeFenceValue_);
+}
+
+void GpuParticles::Draw(ID3D12GraphicsCommandList* commandList, const float viewProjection[4][4], const float cameraRight[3], const float cameraUp[3]) {
+	DrawConstants constants{};
+	std::memcpy(constants.viewProjection, viewProjection, sizeof(constants.viewProjection));
+	std::memcpy(constants.cameraRight, cameraRight, sizeof(constants.cameraRight));
+	std::memcpy(constants.cameraUp, cameraUp, sizeof(constants.cameraUp));
+	constants.size = particleSize_;
+
+	commandList->SetGraphicsRootSignature(drawRootSignature_);
+	commandList->SetPipelineState(drawPipeline_);
+	commandList->SetGraphicsRoot32BitConstants(kRootDrawConstants, sizeof(DrawConstants) / sizeof(uint32_t), &constants, 0);
+	commandList->SetGraphicsRootShaderResourceView(kRootParticlesSrv, particleBuffer_->GetGPUVirtualAddress());
+	commandList->SetGraphicsRootShaderResourceView(kRootAliveListSrv, aliveListBuffers_[aliveSlot_]->GetGPUVirtualAddress());
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	// インスタンス数はGPUが書いた生存数なので、CPUはパーティクル数を知らなくてよい
+	commandList->ExecuteIndirect(commandSignature_, 1, drawArgumentBuffer_, 0, nullptr, 0);
+}
+
+void GpuParticles::CreatePipelines(ID3D12Device* device) {
+	// シミュレーション: ルート定数とルートUAVだけで、ディスクリプタヒープは使わない
+	D3D12_ROOT_PARAMETER computeRootParameters[kComputeRootParameterCount]{};
+	computeRootParameters[kRootSimulateConstants].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	computeRootParameters[kRootSimulateConstants].Constants.ShaderRegister = 0;
+	computeRootParameters[kRootSimulateConstants].Constants.Num32BitValues = sizeof(SimulateConstants) / sizeof(uint32_t);
+	for (uint32_t i = kRootParticles; i < kComputeRootParameterCount; ++i) {
+		computeRootParameters[i].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+		computeRootParameters[i].Descriptor.ShaderRegister = i - kRootParticles;
+	}
+	for (D3D12_ROOT_PARAMETER& rootParameter : computeRootParameters) {
+		rootParameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	}
+	D3D12_ROOT_SIGNATURE_DESC computeRootSignatureDesc{};
+	computeRootSignatureDesc.NumParameters = _countof(computeRootParameters);
+	computeRootSignatureDesc.pParameters = computeRootParameters;
+	computeRootSignature_ = CreateRootSignature(device, computeRootSignatureDesc);
+
+	initializePipeline_ = CreateComputePipeline(device, computeRootSignature_, "CSInitialize");
+	emitPipeline_ = CreateComputePipeline(device, computeRootSignature_, "CSEmit");
+	simulatePipeline_ = CreateComputePipeline(device, computeRootSignature_, "CSSimulate");
+	finalizePipeline_ = CreateComputePipeline(device, computeRootSignature_, "CSFinalize");
+
+	// 描画: 頂点バッファを使わず、ルートSRVからパーティクルを読む
+	D3D12_ROOT_PARAMETER drawRootParameters[kDrawRootParameterCount]{};
+	drawRootParameters[kRootDrawConstants].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	drawRootParameters[kRootDrawConstants].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+	drawRootParameters[kRootDrawConstants].Constants.ShaderRegister = 0;
+	drawRootParameters[kRootDrawConstants].Constants.Num32BitValues = sizeof(DrawConstants) / sizeof(uint32_t);
+	drawRootParameters[kRootParticlesSrv].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	drawRootParameters[kRootParticlesSrv].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+	drawRootParameters[kRootParticlesSrv].Descriptor.ShaderRegister = 0;
+	drawRootParameters[kRootAliveListSrv].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	drawRootParameters[kRootAliveListSrv].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+	drawRootParameters[kRootAliveListSrv].Descriptor.ShaderRegister = 1;
+	D3D12_ROOT_SIGNATURE_DESC drawRootSignatureDesc{};
+	drawRootSignatureDesc.NumParameters = _countof(drawRootParameters);
+	drawRootSignatureDesc.pParameters = drawRootParameters;
+	drawRootSignature_ = CreateRootSignature(device, drawRootSignatureDesc);
+
+	ID3DBlob* vertexShaderBlob = CompileShader(L"Particles.hlsl", "VSMain", "vs_5_0");
+	ID3DBlob* pixelShaderBlob = CompileShader(L"Particles.hlsl", "PSMain", "ps_5_0");
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineStateDesc{};
+	pipelineStateDesc.pRootSignature = drawRootSignature_;
+	pipelineStateDesc.VS = { vertexShaderBlob->GetBufferPointer(), vertexShaderBlob->GetBufferSize() };
+	pipelineStateDesc.PS = { pixelShaderBlob->GetBufferPointer(), pixelShaderBlob->GetBufferSize() };
+	// 加算合成なので描画順に依存しない(並べ替え不要)
+	D3D12_RENDER_TARGET_BLEND_DESC& blendDesc = pipelineStateDesc.BlendState.RenderTarget[0];
+	blendDesc.BlendEnable = TRUE;
+	blendDesc.SrcBlend = D3D12_BLEND_SRC_ALPHA;
+	blendDesc.DestBlend = D3D12_BLEND_ONE;
+	blendDesc.BlendOp = D3D12_BLEND_OP_ADD;
+	blendDesc.SrcBlendAlpha = D3D12_BLEND_ZERO;
+	blendDesc.DestBlendAlpha = D3D12_BLEND_ONE;
+	blendDesc.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+	blendDesc.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+	pipelineStateDesc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+	pipelineStateDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	pipelineStateDesc.RasterizerState.DepthClipEnable = TRUE;
+	pipelineStateDesc.SampleMask = D3D12_DEFAULT_SAMPLE_MASK;
+	pipelineStateDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	pipelineStateDesc.NumRenderTargets = 1;
+	// 内部解像度のシーン(UpscalePass)と同じ形式
+	pipelineStateDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	pipelineStateDesc.SampleDesc.Count = 1;
+	HRESULT hr = device->CreateGraphicsPipelineState(&pipelineStateDesc, IID_PPV_ARGS(&drawPipeline_));
+	assert(SUCCEEDED(hr));
+
+	vertexShaderBlob->Release();
+	pixelShaderBlob->Release();
+}
+
+void GpuParticles::CreateCommandObjects(ID3D12Device* device) {
+	// 描画と並行して動かせるよう専用のコンピュートキューを使う
+	D3D12_COMMAND_QUEUE_DESC commandQueueDesc{};
+	commandQueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COMPUTE;
+	HRESULT hr = device->CreateCommandQueue(&commandQueueDesc, IID_PPV_ARGS(&computeQueue_));
+	assert(SUCCEEDED(hr));
+	hr = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COMPUTE, IID_PPV_ARGS(&computeAllocator_));
+	assert(SUCCEEDED(hr));
+	hr = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COMPUTE, computeAllocator_, nullptr, IID_PPV_ARGS(&computeList_));
+	assert(SUCCEEDED(hr));
+	// Simulateの先頭でResetするので閉じておく
+	hr = computeList_->Close();
+	assert(SUCCEEDED(hr));
+
+	computeFenceValue_ = 0;
+	hr = device->CreateFence(computeFenceValue_, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&computeFence_));
+	assert(SUCCEEDED(hr));
+}
+
+ID3D12Resource* GpuParticles::CreateBuffer(ID3D12Device* device, uint64_t size) {
+	D3D12_HEAP_PROPERTIES heapProperties{};
+	heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+
+	D3D12_RESOURCE_DESC resourceDesc{};
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resourceDesc.Width = size;
+	resourceDesc.Height = 1;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.MipLevels = 1;
+	resourceDesc.SampleDesc.Count = 1;
+	resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	resourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+	ID3D12Resource* buffer = nullptr;
+	HRESULT hr = device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&buffer));
+	assert(SUCCEEDED(hr));
+	return buffer;
+}
+
+void GpuParticles::UavBarrier() {
+	D3D12_RESOURCE_BARRIER barrier{};
+	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+	barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+	// 全UAVを対象にする
+	barrier.UAV.pResource = nullptr;
+	computeList_->ResourceBarrier(1, &barrier);
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+
+#include <d3d12.h>
+
+#include "ParticleSystem.h"
+
+/// <summary>
+/// コンピュートシェーダーによるパーティクル。発生・移動・削除はコンピュートキューで行い、
+/// 生存リストの個数をGPUが描画引数へ書き込むので、CPUはパーティクル数に関係なく一定の処理で済む。
+/// 空きは死亡リスト、生存リストは2つを交互に使い、毎フレーム生き残りだけを詰め直す
+/// </summary>
+class GpuParticles {
+public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	/// <param name="capacity">最大数</param>
+	void Initialize(ID3D12Device* device, uint32_t capacity);
+
+	/// <summary>
+	/// 解放(コンピュートキューの完了を待ってから)
+	/// </summary>
+	void Finalize();
+
+	/// <summary>
+	/// 1フレーム分のシミュレーションをコンピュートキューへ積んで実行する。
+	/// 前回の結果を描画したグラフィックスのコマンドが完了してから呼ぶ
+	/// </summary>
+	/// <param name="emitter">エミッター</param>
+	/// <param name="deltaTime">経過秒</param>
+	void Simulate(const ParticleEmitter& emitter, float deltaTime);
+
+	/// <summary>
+	/// シミュレーションの完了をGPU上で待たせる(描画するコマンドリストの実行前に呼ぶ)
+	/// </summary>
+	/// <param name="commandQueue">描画に使うキュー</param>
+	void WaitForSimulation(ID3D12CommandQueue* commandQueue);
+
+	/// <summary>
+	/// 生きているパーティクルをカメラ向きの四角形で加算描画する
+	/// </summary>
+	/// <param name="commandList">コマンドリスト(描画先は設定済み)</param>
+	/// <param name="viewProjection">ビュープロジェクション行列(行ベクトル×行列の規約)</param>
+	/// <param name="cameraRight">カメラの右方向</param>
+	/// <param name="cameraUp">カメラの上方向</param>
+	void Draw(ID3D12GraphicsCommandList* commandList, const float viewProjection[4][4], const float cameraRight[3], const float cameraUp[3]);
+
+	uint32_t GetCapacity() const { return capacity_; }
+
+private: // サブクラス
+	// シミュレーション用のルート定数(Particles.hlslのSimulateConstantsと同じ並び)
+	struct SimulateConstants {
+		ParticleEmitter emitter;
+		float deltaTime;
+		uint32_t emitCount;
+		uint32_t capacity;
+		uint32_t seed;
+		uint32_t aliveSlot; // 今の生存リスト(0か1)
+	};
+
+	// 描画用のルート定数(Particles.hlslのDrawConstantsと同じ並び)
+	struct DrawConstants {
+		float viewProjection[4][4];
+		float cameraRight[3];
+		float size;
+		float cameraUp[3];
+		float padding;
+	};
+
+private: // メンバ関数
+	/// <summary>
+	/// ルートシグネチャとパイプラインの生成
+	/// </summary>
+	void CreatePipelines(ID3D12Device* device);
+
+	/// <summary>
+	/// コンピュートキューとコマンドリストの生成
+	/// </summary>
+	void CreateCommandObjects(ID3D12Device* device);
+
+	/// <summary>
+	/// バッファの生成
+	/// </summary>
+	ID3D12Resource* CreateBuffer(ID3D12Device* device, uint64_t size);
+
+	/// <summary>
+	/// UAVへの書き込みを次のディスパッチから見えるようにする
+	/// </summary>
+	void UavBarrier();
+
+private: // メンバ変数
+	// シミュレーション
+	ID3D12CommandQueue* computeQueue_ = nullptr;
+	ID3D12CommandAllocator* computeAllocator_ = nullptr;
+	ID3D12GraphicsCommandList* computeList_ = nullptr;
+	ID3D12Fence* computeFence_ = nullptr;
+	uint64_t computeFenceValue_ = 0;
+	ID3D12RootSignature* computeRootSignature_ = nullptr;
+	ID3D12PipelineState* initializePipeline_ = nullptr;
+	ID3D12PipelineState* emitPipeline_ = nullptr;
+	ID3D12PipelineState* simulatePipeline_ = nullptr;
+	ID3D12PipelineState* finalizePipeline_ = nullptr;
+
+	// 描画
+	ID3D12RootSignature* drawRootSignature_ = nullptr;
+	ID3D12PipelineState* drawPipeline_ = nullptr;
+	ID3D12CommandSignature* commandSignature_ = nullptr;
+
+	// すべてCOMMONで作り、キューをまたぐ状態は暗黙の昇格と減衰に任せる
+	ID3D12Resource* particleBuffer_ = nullptr;
+	ID3D12Resource* deadListBuffer_ = nullptr;
+	ID3D12Resource* aliveListBuffers_[2] = {};
+	ID3D12Resource* counterBuffer_ = nullptr;      // 死亡数・生存数2つ・今フレームの発生上限
+	ID3D12Resource* drawArgumentBuffer_ = nullptr;
+
+	uint32_t capacity_ = 0;
+	uint32_t aliveSlot_ = 0;
+	uint32_t frameIndex_ = 0;
+	float emitAccumulator_ = 0.0f;
+	float particleSize_ = 0.0f;
+	bool needsReset_ = true;
+};
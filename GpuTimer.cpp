@@ -0,0 +1,73 @@
+#include "GpuTimer.h"
+
+#include <cassert>
+
+void GpuTimer::Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue) {
+	HRESULT hr = commandQueue->GetTimestampFrequency(&frequency_);
+	assert(SUCCEEDED(hr));
+
+	// 開始と終了の2つ
+	D3D12_QUERY_HEAP_DESC queryHeapDesc{};
+	queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	queryHeapDesc.Count = 2;
+	hr = device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&queryHeap_));
+	assert(SUCCEEDED(hr));
+
+	D3D12_HEAP_PROPERTIES heapProperties{};
+	heapProperties.Type = D3D12_HEAP_TYPE_READBACK;
+
+	D3D12_RESOURCE_DESC resourceDesc{};
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resourceDesc.Width = sizeof(uint64_t) * 2;
+	resourceDesc.Height = 1;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.MipLevels = 1;
+	resourceDesc.SampleDesc.Count = 1;
+	resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+	hr = device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&readbackBuffer_));
+	assert(SUCCEEDED(hr));
+
+	pending_ = false;
+	milliseconds_ = -1.0f;
+}
+
+void GpuTimer::Finalize() {
+	if (readbackBuffer_) {
+		readbackBuffer_->Release();
+		readbackBuffer_ = nullptr;
+	}
+	if (queryHeap_) {
+		queryHeap_->Release();
+		queryHeap_ = nullptr;
+	}
+}
+
+void GpuTimer::Begin(ID3D12GraphicsCommandList* commandList) {
+	commandList->EndQuery(queryHeap_, D3D12_QUERY_TYPE_TIMESTAMP, 0);
+}
+
+void GpuTimer::End(ID3D12GraphicsCommandList* commandList) {
+	commandList->EndQuery(queryHeap_, D3D12_QUERY_TYPE_TIMESTAMP, 1);
+	commandList->ResolveQueryData(queryHeap_, D3D12_QUERY_TYPE_TIMESTAMP, 0, 2, readbackBuffer_, 0);
+	pending_ = true;
+}
+
+void GpuTimer::Resolve() {
+	if (!pending_) {
+		return;
+	}
+	pending_ = false;
+
+	uint64_t* timestamps = nullptr;
+	D3D12_RANGE readRange{ 0, sizeof(uint64_t) * 2 };
+	if (FAILED(readbackBuffer_->Map(0, &readRange, reinterpret_cast<void**>(&timestamps)))) {
+		return;
+	}
+	if (timestamps[1] >= timestamps[0] && frequency_ != 0) {
+		milliseconds_ = static_cast<float>(static_cast<double>(timestamps[1] - timestamps[0]) * 1000.0 / static_cast<double>(frequency_));
+	}
+	D3D12_RANGE writeRange{ 0, 0 };
+	readbackBuffer_->Unmap(0, &writeRange);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+
+#include <d3d12.h>
+
+/// <summary>
+/// タイムスタンプクエリによる1フレーム分のGPU時間計測
+/// </summary>
+class GpuTimer {
+public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	/// <param name="commandQueue">計測するコマンドを実行するキュー</param>
+	void Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue);
+
+	/// <summary>
+	/// 解放
+	/// </summary>
+	void Finalize();
+
+	/// <summary>
+	/// 計測開始のタイムスタンプを積む
+	/// </summary>
+	void Begin(ID3D12GraphicsCommandList* commandList);
+
+	/// <summary>
+	/// 計測終了のタイムスタンプを積み、読み戻し用バッファへ解決する
+	/// </summary>
+	void End(ID3D12GraphicsCommandList* commandList);
+
+	/// <summary>
+	/// 計測結果を読み戻す。Endを積んだコマンドリストの完了をFenceで待った後に呼ぶ
+	/// </summary>
+	void Resolve();
+
+	/// <summary>
+	/// 直近に解決したGPU時間(まだ計測していなければ負数)
+	/// </summary>
+	float GetMilliseconds() const { return milliseconds_; }
+
+private: // メンバ変数
+	ID3D12QueryHeap* queryHeap_ = nullptr;
+	ID3D12Resource* readbackBuffer_ = nullptr;
+	uint64_t frequency_ = 0;
+	bool pending_ = false;
+	float milliseconds_ = -1.0f;
+};
@@ -0,0 +1,118 @@
+#include "GraphicsRecovery.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+namespace {
+
+double ElapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+void GraphicsRecovery::Initialize(RecoverableDevice* device, uint32_t width, uint32_t height) {
+	assert(device);
+	device_ = device;
+	width_ = width;
+	height_ = height;
+	state_ = State::Running;
+	recreateAttempts_ = 0;
+
+	// 初期化前に届いたリサイズ要求は、サイズが変わっていなければ捨てる
+	if (resizePending_ && pendingWidth_ == width_ && pendingHeight_ == height_) {
+		resizePending_ = false;
+	}
+}
+
+void GraphicsRecovery::RequestResize(uint32_t width, uint32_t height) {
+	pendingWidth_ = width;
+	pendingHeight_ = height;
+	resizePending_ = true;
+}
+
+void GraphicsRecovery::NotifyDeviceLost() {
+	if (state_ != State::Failed) {
+		state_ = State::DeviceLost;
+	}
+}
+
+bool GraphicsRecovery::BeginFrame() {
+	assert(device_);
+
+	if (state_ == State::DeviceLost) {
+		TryRecreate();
+	}
+
+	if (resizePending_ && (state_ == State::Running || state_ == State::Suspended)) {
+		resizePending_ = false;
+		if (pendingWidth_ == 0 || pendingHeight_ == 0) {
+			// 最小化中はバッファを作り直さず描画を止める
+			state_ = State::Suspended;
+		} else {
+			state_ = State::Running;
+			if (pendingWidth_ != width_ || pendingHeight_ != height_) {
+				PerformResize();
+			}
+		}
+	}
+
+	return state_ == State::Running;
+}
+
+void GraphicsRecovery::PerformResize() {
+	auto start = std::chrono::steady_clock::now();
+
+	// デバイスごと作り直すのではなく、実行中のフレームが終わるのだけを待つ
+	DeviceResult result = device_->WaitForInFlightFrames();
+	if (result == DeviceResult::Ok) {
+		device_->ReleaseBackBuffers();
+		result = device_->ResizeBuffers(pendingWidth_, pendingHeight_);
+	}
+	if (result == DeviceResult::Ok) {
+		result = device_->CreateRenderTargetViews();
+	}
+
+	if (result != DeviceResult::Ok) {
+		// 失敗したら再生成の経路に回す。再生成は新しいサイズで行う
+		width_ = pendingWidth_;
+		height_ = pendingHeight_;
+		state_ = State::DeviceLost;
+		return;
+	}
+
+	width_ = pendingWidth_;
+	height_ = pendingHeight_;
+	statistics_.resizeCount++;
+	statistics_.lastResizeMilliseconds = ElapsedMilliseconds(start);
+	statistics_.maxResizeMilliseconds = std::max(statistics_.maxResizeMilliseconds, statistics_.lastResizeMilliseconds);
+}
+
+void GraphicsRecovery::TryRecreate() {
+	auto start = std::chrono::steady_clock::now();
+
+	// 再生成の時点で分かっている最新のサイズで作る
+	if (resizePending_ && pendingWidth_ != 0 && pendingHeight_ != 0) {
+		width_ = pendingWidth_;
+		height_ = pendingHeight_;
+		resizePending_ = false;
+	}
+
+	device_->ReleaseDeviceObjects();
+	DeviceResult result = device_->CreateDeviceObjects(width_, height_);
+	if (result != DeviceResult::Ok) {
+		statistics_.recreateFailureCount++;
+		recreateAttempts_++;
+		if (result == DeviceResult::Failed || recreateAttempts_ >= kMaxRecreateAttempts) {
+			state_ = State::Failed;
+		}
+		return;
+	}
+
+	recreateAttempts_ = 0;
+	state_ = State::Running;
+	statistics_.recreateCount++;
+	statistics_.lastRecreateMilliseconds = ElapsedMilliseconds(start);
+	statistics_.maxRecreateMilliseconds = std::max(statistics_.maxRecreateMilliseconds, statistics_.lastRecreateMilliseconds);
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <cstdint>
+
+/// <summary>
+/// デバイス操作の結果
+/// </summary>
+enum class DeviceResult {
+	Ok,
+	DeviceLost, // デバイスが削除・リセットされた
+	Failed,     // 回復できない失敗
+};
+
+/// <summary>
+/// リサイズ・デバイスロストからの回復に必要なデバイス側の操作。
+/// D3D12実装の他に、故障を注入する偽デバイスに差し替えられるようプラットフォームに依存しない
+/// </summary>
+class RecoverableDevice {
+public: // メンバ関数
+	virtual ~RecoverableDevice() = default;
+
+	/// <summary>
+	/// GPUで実行中のフレームの完了を待つ
+	/// </summary>
+	virtual DeviceResult WaitForInFlightFrames() = 0;
+
+	/// <summary>
+	/// バックバッファへの参照(RTV用リソース)を解放する
+	/// </summary>
+	virtual void ReleaseBackBuffers() = 0;
+
+	/// <summary>
+	/// スワップチェーンのバッファサイズを変更する
+	/// </summary>
+	virtual DeviceResult ResizeBuffers(uint32_t width, uint32_t height) = 0;
+
+	/// <summary>
+	/// バックバッファを取得し直し、既存のヒープ上にRTVを作り直す
+	/// </summary>
+	virtual DeviceResult CreateRenderTargetViews() = 0;
+
+	/// <summary>
+	/// デバイスに依存するオブジェクトをすべて解放する
+	/// </summary>
+	virtual void ReleaseDeviceObjects() = 0;
+
+	/// <summary>
+	/// キャッシュしてある作成時の設定からデバイスに依存するオブジェクトを作り直す
+	/// </summary>
+	/// <param name="width">スワップチェーンの幅</param>
+	/// <param name="height">スワップチェーンの高さ</param>
+	virtual DeviceResult CreateDeviceObjects(uint32_t width, uint32_t height) = 0;
+};
+
+/// <summary>
+/// ウインドウのリサイズとデバイスロストを扱う状態機械。
+/// 要求はウインドウプロシージャなどから積んでおき、フレームの境目でまとめて処理する
+/// </summary>
+class GraphicsRecovery {
+public: // サブクラス
+	enum class State {
+		Running,    // 通常描画
+		Suspended,  // 最小化中(描画しない)
+		DeviceLost, // デバイス再生成待ち
+		Failed,     // 再生成に失敗し続けた
+	};
+
+	struct Statistics {
+		uint32_t resizeCount = 0;
+		uint32_t recreateCount = 0;
+		uint32_t recreateFailureCount = 0;
+		double lastResizeMilliseconds = 0.0;   // 待機からRTV再作成まで
+		double lastRecreateMilliseconds = 0.0; // 解放から再作成完了まで
+		double maxResizeMilliseconds = 0.0;
+		double maxRecreateMilliseconds = 0.0;
+	};
+
+public: // 静的メンバ変数
+	// 再生成を諦めるまでの連続失敗回数
+	static const uint32_t kMaxRecreateAttempts = 8;
+
+public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="device">操作対象のデバイス</param>
+	/// <param name="width">現在のバッファの幅</param>
+	/// <param name="height">現在のバッファの高さ</param>
+	void Initialize(RecoverableDevice* device, uint32_t width, uint32_t height);
+
+	/// <summary>
+	/// リサイズ要求。複数回来た場合は最後のサイズだけを反映する
+	/// </summary>
+	/// <param name="width">クライアント領域の幅(最小化時は0)</param>
+	/// <param name="height">クライアント領域の高さ(最小化時は0)</param>
+	void RequestResize(uint32_t width, uint32_t height);
+
+	/// <summary>
+	/// Presentなどでデバイスの削除を検出したときに呼ぶ
+	/// </summary>
+	void NotifyDeviceLost();
+
+	/// <summary>
+	/// フレーム開始時に溜まった要求を処理する
+	/// </summary>
+	/// <returns>このフレームを描画してよいか</returns>
+	bool BeginFrame();
+
+	State GetState() const { return state_; }
+	uint32_t GetWidth() const { return width_; }
+	uint32_t GetHeight() const { return height_; }
+	const Statistics& GetStatistics() const { return statistics_; }
+
+private: // メンバ関数
+	/// <summary>
+	/// 実行中のフレームだけを待ってバッファを作り直す
+	/// </summary>
+	void PerformResize();
+
+	/// <summary>
+	/// デバイス依存オブジェクトの再生成を試みる
+	/// </summary>
+	void TryRecreate();
+
+private: // メンバ変数
+	RecoverableDevice* device_ = nullptr;
+	State state_ = State::Running;
+
+	// 現在のバッファサイズ
+	uint32_t width_ = 0;
+	uint32_t height_ = 0;
+
+	// 未処理のリサイズ要求
+	bool resizePending_ = false;
+	uint32_t pendingWidth_ = 0;
+	uint32_t pendingHeight_ = 0;
+
+	uint32_t recreateAttempts_ = 0;
+	Statistics statistics_;
+};
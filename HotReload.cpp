@@ -0,0 +1,304 @@
+#include "HotReload.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+namespace {
+
+// 作り直し用スレッドがファイルの変更を確認する間隔
+const std::chrono::milliseconds kPollInterval(50);
+
+// 区切りを/にそろえ、先頭の./と途中のdir/../を取り除く
+std::string NormalizePath(const std::string& path) {
+	std::string normalized = path;
+	std::replace(normalized.begin(), normalized.end(), '\\', '/');
+	std::vector<std::string> parts;
+	size_t begin = 0;
+	while (begin <= normalized.size()) {
+		size_t end = normalized.find('/', begin);
+		if (end == std::string::npos) {
+			end = normalized.size();
+		}
+		const std::string part = normalized.substr(begin, end - begin);
+		if (part == "..") {
+			if (!parts.empty() && parts.back() != "..") {
+				parts.pop_back();
+			} else {
+				parts.push_back(part);
+			}
+		} else if (!part.empty() && part != ".") {
+			parts.push_back(part);
+		}
+		begin = end + 1;
+	}
+	std::string result;
+	for (const std::string& part : parts) {
+		if (!result.empty()) {
+			result += '/';
+		}
+		result += part;
+	}
+	return result;
+}
+
+// #includeを追う拡張子か
+bool HasIncludes(const std::string& file) {
+	const size_t dot = file.find_last_of('.');
+	if (dot == std::string::npos) {
+		return false;
+	}
+	const std::string extension = file.substr(dot);
+	return extension == ".hlsl" || extension == ".hlsli";
+}
+
+double ElapsedMicroseconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+HotReload::~HotReload() {
+	Finalize();
+}
+
+bool HotReload::Initialize(const std::string& directory) {
+	directory_ = directory;
+	const bool watching = watcher_.Start(directory);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		running_ = true;
+		suspended_ = false;
+	}
+	thread_ = std::thread(&HotReload::Run, this);
+	return watching;
+}
+
+void HotReload::Finalize() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		running_ = false;
+	}
+	condition_.notify_all();
+	if (thread_.joinable()) {
+		thread_.join();
+	}
+	watcher_.Stop();
+
+	std::vector<ReadySwap> discarded;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		discarded.swap(ready_);
+		queue_.clear();
+		items_.clear();
+	}
+	for (ReadySwap& readySwap : discarded) {
+		readySwap.swap(false);
+	}
+	ReleaseRetired();
+}
+
+HotReload::ItemId HotReload::Register(const std::string& name, const std::vector<std::string>& files, RebuildFunction rebuild) {
+	Item item;
+	item.name = name;
+	for (const std::string& file : files) {
+		item.files.push_back(NormalizePath(file));
+	}
+	// ファイルを読むのはロックの外で行う
+	item.dependencies = CollectDependencies(item.files);
+	item.rebuild = std::move(rebuild);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	items_.push_back(std::move(item));
+	return static_cast<ItemId>(items_.size() - 1);
+}
+
+void HotReload::NotifyFileChanged(const std::string& file) {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		QueueDependents(NormalizePath(file));
+	}
+	condition_.notify_all();
+}
+
+void HotReload::BeginFrame(uint64_t submitFenceValue, uint64_t completedFenceValue) {
+	const auto start = std::chrono::steady_clock::now();
+
+	// GPUが使い終えた古いものを解放する
+	uint32_t releaseCount = 0;
+	while (!retired_.empty() && retired_.front().fenceValue <= completedFenceValue) {
+		retired_.front().release();
+		retired_.pop_front();
+		++releaseCount;
+	}
+
+	// 作り直しが済んだものを差し替える。ここではポインタの入れ替えだけでコンパイルや生成は行わない
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		swapScratch_.swap(ready_);
+	}
+	for (ReadySwap& readySwap : swapScratch_) {
+		ReleaseFunction release = readySwap.swap(true);
+		if (release) {
+			// 差し替えより前に積んだフレームが参照しているので、このフレームが終わるまで待つ
+			retired_.push_back({ submitFenceValue, std::move(release) });
+		}
+	}
+	const uint32_t swapCount = static_cast<uint32_t>(swapScratch_.size());
+	swapScratch_.clear();
+
+	const double elapsed = ElapsedMicroseconds(start);
+	std::lock_guard<std::mutex> lock(mutex_);
+	statistics_.swapCount += swapCount;
+	statistics_.releaseCount += releaseCount;
+	statistics_.lastBeginFrameMicroseconds = elapsed;
+	statistics_.maxBeginFrameMicroseconds = std::max(statistics_.maxBeginFrameMicroseconds, elapsed);
+}
+
+void HotReload::Suspend() {
+	std::vector<ReadySwap> discarded;
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		suspended_ = true;
+		condition_.wait(lock, [this]() { return !rebuilding_; });
+		discarded.swap(ready_);
+	}
+	for (ReadySwap& readySwap : discarded) {
+		readySwap.swap(false);
+	}
+}
+
+void HotReload::Resume() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		suspended_ = false;
+	}
+	condition_.notify_all();
+}
+
+void HotReload::ReleaseRetired() {
+	uint32_t releaseCount = 0;
+	for (RetiredObject& retiredObject : retired_) {
+		retiredObject.release();
+		++releaseCount;
+	}
+	retired_.clear();
+	std::lock_guard<std::mutex> lock(mutex_);
+	statistics_.releaseCount += releaseCount;
+}
+
+bool HotReload::IsIdle() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return queue_.empty() && !rebuilding_ && ready_.empty();
+}
+
+HotReload::Statistics HotReload::GetStatistics() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return statistics_;
+}
+
+std::vector<std::string> HotReload::GetDependencies(ItemId id) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return items_[id].dependencies;
+}
+
+void HotReload::Run() {
+	std::vector<std::string> changedFiles;
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (running_) {
+		condition_.wait_for(lock, kPollInterval, [this]() { return !running_ || (!suspended_ && !queue_.empty()); });
+		if (!running_) {
+			break;
+		}
+
+		// 書き込みが落ち着いたファイルに依存する項目を積む
+		lock.unlock();
+		changedFiles.clear();
+		watcher_.Poll(changedFiles, kSettleNanoseconds);
+		lock.lock();
+		for (const std::string& file : changedFiles) {
+			QueueDependents(NormalizePath(file));
+		}
+		if (suspended_ || queue_.empty()) {
+			continue;
+		}
+
+		const ItemId id = queue_.front();
+		queue_.pop_front();
+		Item& item = items_[id];
+		item.queued = false;
+		RebuildFunction rebuild = item.rebuild;
+		const std::vector<std::string> files = item.files;
+		rebuilding_ = true;
+		lock.unlock();
+
+		// 作り直しはロックの外で行う(この間もメインスレッドは止まらない)
+		const auto start = std::chrono::steady_clock::now();
+		SwapFunction swap = rebuild();
+		const double elapsed = ElapsedMicroseconds(start) * 0.001;
+		// #includeが増減しているかもしれないので依存を集め直す
+		std::vector<std::string> dependencies = CollectDependencies(files);
+
+		lock.lock();
+		items_[id].dependencies = std::move(dependencies);
+		++statistics_.rebuildCount;
+		statistics_.lastRebuildMilliseconds = elapsed;
+		if (swap) {
+			ready_.push_back({ id, std::move(swap) });
+		} else {
+			++statistics_.failureCount;
+		}
+		rebuilding_ = false;
+		condition_.notify_all();
+	}
+}
+
+void HotReload::QueueDependents(const std::string& file) {
+	for (size_t i = 0; i < items_.size(); ++i) {
+		Item& item = items_[i];
+		if (item.queued || std::find(item.dependencies.begin(), item.dependencies.end(), file) == item.dependencies.end()) {
+			continue;
+		}
+		item.queued = true;
+		queue_.push_back(static_cast<ItemId>(i));
+	}
+}
+
+std::vector<std::string> HotReload::CollectDependencies(const std::vector<std::string>& files) const {
+	std::vector<std::string> dependencies;
+	for (const std::string& file : files) {
+		CollectIncludes(directory_, file, dependencies);
+	}
+	return dependencies;
+}
+
+void HotReload::CollectIncludes(const std::string& directory, const std::string& file, std::vector<std::string>& outFiles) {
+	const std::string normalized = NormalizePath(file);
+	if (std::find(outFiles.begin(), outFiles.end(), normalized) != outFiles.end()) {
+		return;
+	}
+	outFiles.push_back(normalized);
+	if (!HasIncludes(normalized)) {
+		return;
+	}
+	std::ifstream stream(directory.empty() ? normalized : directory + "/" + normalized);
+	if (!stream) {
+		return;
+	}
+	// #include "..."はそのファイルのあるディレクトリからの相対パス
+	const size_t slash = normalized.find_last_of('/');
+	const std::string baseDirectory = slash == std::string::npos ? std::string() : normalized.substr(0, slash + 1);
+	std::string line;
+	while (std::getline(stream, line)) {
+		const size_t hash = line.find_first_not_of(" \t");
+		if (hash == std::string::npos || line.compare(hash, 8, "#include") != 0) {
+			continue;
+		}
+		const size_t open = line.find('"', hash + 8);
+		const size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+		if (close == std::string::npos) {
+			continue;
+		}
+		CollectIncludes(directory, baseDirectory + line.substr(open + 1, close - open - 1), outFiles);
+	}
+}
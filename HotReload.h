@@ -0,0 +1,169 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FileWatcher.h"
+
+/// <summary>
+/// シェーダーやアセットの実行中の読み直し。
+/// 変更されたファイルに依存する項目だけを専用スレッドで作り直し、メインスレッドはフレームの境目でポインタを差し替えるだけにする。
+/// 差し替えた古いものは、それを参照していたフレームをGPUが終えてから解放する
+/// </summary>
+class HotReload {
+public: // サブクラス
+	// 古いものの解放処理
+	using ReleaseFunction = std::function<void()>;
+	// 作り直したものを差し替え、古いものの解放処理を返す。applyがfalseなら差し替えずに新しいものを捨てる
+	using SwapFunction = std::function<ReleaseFunction(bool apply)>;
+	// 別スレッドで作り直す。失敗したら空を返す(今のものをそのまま使い続ける)
+	using RebuildFunction = std::function<SwapFunction()>;
+
+	using ItemId = uint32_t;
+
+	struct Statistics {
+		uint32_t rebuildCount = 0;
+		uint32_t failureCount = 0;
+		uint32_t swapCount = 0;
+		uint32_t releaseCount = 0;
+		double lastRebuildMilliseconds = 0.0;     // 別スレッドでの作り直し
+		double lastBeginFrameMicroseconds = 0.0;  // メインスレッドでの差し替えと解放
+		double maxBeginFrameMicroseconds = 0.0;
+	};
+
+public: // 静的メンバ変数
+	// ファイルの書き込みが落ち着いたとみなすまでの時間
+	static const uint64_t kSettleNanoseconds = 100000000ull;
+
+public: // メンバ関数
+	~HotReload();
+
+	/// <summary>
+	/// 監視と作り直し用のスレッドを開始する
+	/// </summary>
+	/// <param name="directory">監視するディレクトリ(登録するファイル名はここからの相対パス)</param>
+	/// <returns>ファイルの監視ができたか(できなくてもNotifyFileChangedでの通知は使える)</returns>
+	bool Initialize(const std::string& directory);
+
+	/// <summary>
+	/// スレッドを止め、差し替え待ちを捨てて、解放待ちをすべて解放する。GPUが止まってから呼ぶ
+	/// </summary>
+	void Finalize();
+
+	/// <summary>
+	/// 読み直す項目の登録
+	/// </summary>
+	/// <param name="name">ログ用の名前</param>
+	/// <param name="files">依存するファイル。.hlsl/.hlsliは#includeしているファイルも自動で追う</param>
+	/// <param name="rebuild">作り直し(別スレッドで呼ばれる)</param>
+	ItemId Register(const std::string& name, const std::vector<std::string>& files, RebuildFunction rebuild);
+
+	/// <summary>
+	/// ファイルが変わったことを手動で知らせる(監視できない環境や、ツールからの通知用)
+	/// </summary>
+	void NotifyFileChanged(const std::string& file);
+
+	/// <summary>
+	/// フレームの開始。作り直しが済んだものを差し替え、GPUが終えた分の古いものを解放する(メインスレッド)
+	/// </summary>
+	/// <param name="submitFenceValue">このフレームのコマンドの後にシグナルするフェンス値</param>
+	/// <param name="completedFenceValue">GPUが完了したフェンス値</param>
+	void BeginFrame(uint64_t submitFenceValue, uint64_t completedFenceValue);
+
+	/// <summary>
+	/// 作り直しを止める。実行中の作り直しが終わるのを待ち、差し替え待ちは捨てる(デバイスロスト時など)
+	/// </summary>
+	void Suspend();
+
+	/// <summary>
+	/// 作り直しを再開する
+	/// </summary>
+	void Resume();
+
+	/// <summary>
+	/// 解放待ちをフェンス値によらずすべて解放する。GPUが止まってから呼ぶ
+	/// </summary>
+	void ReleaseRetired();
+
+	/// <summary>
+	/// 作り直し待ち・実行中・差し替え待ちが残っていないか
+	/// </summary>
+	bool IsIdle() const;
+
+	Statistics GetStatistics() const;
+	uint32_t GetRetiredCount() const { return static_cast<uint32_t>(retired_.size()); }
+
+	/// <summary>
+	/// 項目が今依存しているファイル(#includeを展開したもの)
+	/// </summary>
+	std::vector<std::string> GetDependencies(ItemId id) const;
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// ファイルと、そこから#include "..."で読むファイルを再帰的に集める
+	/// </summary>
+	/// <param name="directory">基準のディレクトリ</param>
+	/// <param name="file">directoryからの相対パス</param>
+	/// <param name="outFiles">見つけたファイルの追加先(重複しない)</param>
+	static void CollectIncludes(const std::string& directory, const std::string& file, std::vector<std::string>& outFiles);
+
+private: // サブクラス
+	struct Item {
+		std::string name;
+		std::vector<std::string> files;        // 登録されたファイル
+		std::vector<std::string> dependencies; // 登録されたファイルと#includeしているファイル
+		RebuildFunction rebuild;
+		bool queued = false;
+	};
+
+	struct ReadySwap {
+		ItemId id;
+		SwapFunction swap;
+	};
+
+	struct RetiredObject {
+		uint64_t fenceValue;
+		ReleaseFunction release;
+	};
+
+private: // メンバ関数
+	/// <summary>
+	/// 作り直し用スレッドの本体
+	/// </summary>
+	void Run();
+
+	/// <summary>
+	/// 変更されたファイルに依存する項目を作り直し待ちに積む(mutex_を持った状態で呼ぶ)
+	/// </summary>
+	void QueueDependents(const std::string& file);
+
+	/// <summary>
+	/// 依存ファイルを集め直す
+	/// </summary>
+	std::vector<std::string> CollectDependencies(const std::vector<std::string>& files) const;
+
+private: // メンバ変数
+	std::string directory_;
+	FileWatcher watcher_;
+	std::thread thread_;
+	bool running_ = false;
+
+	// 項目・作り直し待ち・差し替え待ちを守る
+	mutable std::mutex mutex_;
+	std::condition_variable condition_;
+	std::vector<Item> items_;
+	std::deque<ItemId> queue_;
+	std::vector<ReadySwap> ready_;
+	bool suspended_ = false;
+	bool rebuilding_ = false; // 作り直しの実行中(Suspendはこれが落ちるのを待つ)
+	Statistics statistics_;
+
+	// メインスレッドだけが触る。フェンス値は増える順に積まれる
+	std::deque<RetiredObject> retired_;
+	std::vector<ReadySwap> swapScratch_;
+};
@@ -0,0 +1,120 @@
+#include "InputQueue.h"
+
+#include <chrono>
+
+/*///////////////////////
+	InputState
+*////////////////////////
+void InputState::BeginUpdate() {
+	pressedKeys_.reset();
+	releasedKeys_.reset();
+	mouseDeltaX_ = 0;
+	mouseDeltaY_ = 0;
+	wheelDelta_ = 0;
+}
+
+void InputState::Apply(const InputEvent& event) {
+	switch (event.type) {
+	case InputEventType::KeyDown:
+		if (event.code < kKeyCount) {
+			// キーリピートは押した瞬間として数えない
+			if (!keys_[event.code]) {
+				pressedKeys_[event.code] = true;
+			}
+			keys_[event.code] = true;
+		}
+		break;
+	case InputEventType::KeyUp:
+		// 前面にない間に押したキーは届かないので、押されていたキーだけ離したものとして数える
+		if (event.code < kKeyCount && keys_[event.code]) {
+			keys_[event.code] = false;
+			releasedKeys_[event.code] = true;
+		}
+		break;
+	case InputEventType::MouseMove:
+		mouseDeltaX_ += event.x;
+		mouseDeltaY_ += event.y;
+		break;
+	case InputEventType::MouseButtonDown:
+		if (event.code < kMouseButtonCount) {
+			mouseButtons_[event.code] = true;
+		}
+		break;
+	case InputEventType::MouseButtonUp:
+		if (event.code < kMouseButtonCount) {
+			mouseButtons_[event.code] = false;
+		}
+		break;
+	case InputEventType::MouseWheel:
+		wheelDelta_ += event.y;
+		break;
+	}
+}
+
+/*///////////////////////
+	InputQueue
+*////////////////////////
+uint64_t InputQueue::GetTimestamp() {
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void InputQueue::Coalesce(std::vector<InputEvent>& events, size_t begin) {
+	if (events.size() <= begin) {
+		return;
+	}
+	// 直前に残したイベントと同じ種類なら足し込み、時刻は後のものにする
+	size_t write = begin;
+	for (size_t read = begin + 1; read < events.size(); ++read) {
+		InputEvent& last = events[write];
+		const InputEvent& event = events[read];
+		if (event.type == last.type) {
+			if (event.type == InputEventType::MouseMove || event.type == InputEventType::MouseWheel) {
+				last.x += event.x;
+				last.y += event.y;
+				last.timestamp = event.timestamp;
+				continue;
+			}
+			if (event.type == InputEventType::KeyDown && event.code == last.code) {
+				last.timestamp = event.timestamp;
+				continue;
+			}
+		}
+		events[++write] = event;
+	}
+	events.resize(write + 1);
+}
+
+void InputQueue::Push(const InputEvent& event) {
+	if (!ring_.Push(event)) {
+		droppedCount_.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void InputQueue::Push(const InputEvent& event, bool focused) {
+	if (!focused && event.type != InputEventType::KeyUp && event.type != InputEventType::MouseButtonUp) {
+		return;
+	}
+	Push(event);
+}
+
+size_t InputQueue::Drain(uint64_t untilTimestamp, std::vector<InputEvent>& events) {
+	size_t begin = events.size();
+	size_t count = 0;
+	for (const InputEvent* event = ring_.Front(); event != nullptr && event->timestamp <= untilTimestamp; event = ring_.Front()) {
+		events.push_back(*event);
+		ring_.PopFront();
+		++count;
+	}
+	Coalesce(events, begin);
+	return count;
+}
+
+size_t InputQueue::Drain(uint64_t untilTimestamp, InputState& state) {
+	drainBuffer_.clear();
+	size_t count = Drain(untilTimestamp, drainBuffer_);
+	for (const InputEvent& event : drainBuffer_) {
+		state.Apply(event);
+	}
+	return count;
+}
@@ -0,0 +1,195 @@
+#pragma once
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+/// <summary>
+/// 単一の書き込みスレッドと単一の読み出しスレッドの間で使うロックフリーのリングバッファ
+/// </summary>
+/// <typeparam name="T">要素の型(トリビアルにコピーできるもの)</typeparam>
+/// <typeparam name="kCapacity">容量(2のべき乗)</typeparam>
+template <typename T, size_t kCapacity>
+class SpscRing {
+	static_assert((kCapacity & (kCapacity - 1)) == 0, "capacity must be a power of two");
+
+public: // メンバ関数
+	/// <summary>
+	/// 書き込み(書き込みスレッドから呼ぶ)。満杯ならfalse
+	/// </summary>
+	bool Push(const T& value) {
+		size_t tail = tail_.load(std::memory_order_relaxed);
+		if (tail - cachedHead_ == kCapacity) {
+			// 手元の値で満杯に見えるときだけ相手の位置を読み直す
+			cachedHead_ = head_.load(std::memory_order_acquire);
+			if (tail - cachedHead_ == kCapacity) {
+				return false;
+			}
+		}
+		buffer_[tail & (kCapacity - 1)] = value;
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// <summary>
+	/// 先頭の要素を見る(読み出しスレッドから呼ぶ)。空ならnullptr
+	/// </summary>
+	const T* Front() {
+		size_t head = head_.load(std::memory_order_relaxed);
+		if (head == cachedTail_) {
+			cachedTail_ = tail_.load(std::memory_order_acquire);
+			if (head == cachedTail_) {
+				return nullptr;
+			}
+		}
+		return &buffer_[head & (kCapacity - 1)];
+	}
+
+	/// <summary>
+	/// 先頭の要素を捨てる。Frontがnullptrでないときだけ呼ぶ
+	/// </summary>
+	void PopFront() {
+		head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/// <summary>
+	/// 取り出し。空ならfalse
+	/// </summary>
+	bool Pop(T& value) {
+		const T* front = Front();
+		if (front == nullptr) {
+			return false;
+		}
+		value = *front;
+		PopFront();
+		return true;
+	}
+
+private: // メンバ変数
+	// 書き込み側と読み出し側で別のキャッシュラインに置き、偽共有を避ける
+	static const size_t kCacheLineSize = 64;
+
+	alignas(kCacheLineSize) std::atomic<size_t> tail_ = 0; // 書き込み位置
+	size_t cachedHead_ = 0;                                // 書き込み側が最後に見た読み出し位置
+	alignas(kCacheLineSize) std::atomic<size_t> head_ = 0; // 読み出し位置
+	size_t cachedTail_ = 0;                                // 読み出し側が最後に見た書き込み位置
+	alignas(kCacheLineSize) T buffer_[kCapacity];
+};
+
+/// <summary>
+/// 入力イベントの種類
+/// </summary>
+enum class InputEventType : uint8_t {
+	KeyDown,
+	KeyUp,
+	MouseMove,       // x,yに移動量
+	MouseButtonDown, // codeにボタン番号
+	MouseButtonUp,
+	MouseWheel,      // yに回転量
+};
+
+/// <summary>
+/// 時刻つきの入力イベント
+/// </summary>
+struct InputEvent {
+	uint64_t timestamp; // InputQueue::GetTimestampの値(ナノ秒)
+	InputEventType type;
+	uint32_t code;      // キーコード・ボタン番号
+	int32_t x;
+	int32_t y;
+};
+
+/// <summary>
+/// 固定更新1回分で見える入力の状態
+/// </summary>
+class InputState {
+public: // 静的メンバ変数
+	static const uint32_t kKeyCount = 256;
+	static const uint32_t kMouseButtonCount = 8;
+
+public: // メンバ関数
+	/// <summary>
+	/// 更新の開始。移動量と押した・離したの記録をクリアする
+	/// </summary>
+	void BeginUpdate();
+
+	/// <summary>
+	/// イベントを反映する
+	/// </summary>
+	void Apply(const InputEvent& event);
+
+	bool IsKeyDown(uint32_t key) const { return key < kKeyCount && keys_[key]; }
+	// この更新中に押された(押して離した場合も含む)
+	bool IsKeyTriggered(uint32_t key) const { return key < kKeyCount && pressedKeys_[key]; }
+	bool IsKeyReleased(uint32_t key) const { return key < kKeyCount && releasedKeys_[key]; }
+	bool IsMouseButtonDown(uint32_t button) const { return button < kMouseButtonCount && mouseButtons_[button]; }
+	int32_t GetMouseDeltaX() const { return mouseDeltaX_; }
+	int32_t GetMouseDeltaY() const { return mouseDeltaY_; }
+	int32_t GetWheelDelta() const { return wheelDelta_; }
+
+private: // メンバ変数
+	std::bitset<kKeyCount> keys_;
+	std::bitset<kKeyCount> pressedKeys_;
+	std::bitset<kKeyCount> releasedKeys_;
+	std::bitset<kMouseButtonCount> mouseButtons_;
+	int32_t mouseDeltaX_ = 0;
+	int32_t mouseDeltaY_ = 0;
+	int32_t wheelDelta_ = 0;
+};
+
+/// <summary>
+/// 入力スレッドからゲームスレッドへイベントを渡すキュー
+/// </summary>
+class InputQueue {
+public: // 静的メンバ変数
+	static const size_t kCapacity = 4096;
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// イベントに付ける時刻(単調増加のナノ秒)
+	/// </summary>
+	static uint64_t GetTimestamp();
+
+	/// <summary>
+	/// 連続するマウス移動・ホイール・キーリピートを1つにまとめる
+	/// </summary>
+	/// <param name="events">まとめるイベント列(書き換える)</param>
+	/// <param name="begin">まとめ始める位置</param>
+	static void Coalesce(std::vector<InputEvent>& events, size_t begin = 0);
+
+public: // メンバ関数
+	/// <summary>
+	/// イベントを積む(入力スレッドから呼ぶ)。満杯なら捨てて数える
+	/// </summary>
+	void Push(const InputEvent& event);
+
+	/// <summary>
+	/// ゲームが前面にあるかを見てイベントを積む。前面にないときは離したイベントだけ積む
+	/// (フォーカスを失っている間に離したキーを捨てると押しっぱなしのまま残るため)
+	/// </summary>
+	/// <param name="event">イベント</param>
+	/// <param name="focused">ゲームのウインドウが前面にあるか</param>
+	void Push(const InputEvent& event, bool focused);
+
+	/// <summary>
+	/// 指定時刻までに起きたイベントを取り出してまとめる(ゲームスレッドから呼ぶ)
+	/// </summary>
+	/// <param name="untilTimestamp">この時刻以前のイベントだけ取り出す</param>
+	/// <param name="events">取り出したイベントを後ろに追加する</param>
+	/// <returns>キューから取り出した数(まとめる前)</returns>
+	size_t Drain(uint64_t untilTimestamp, std::vector<InputEvent>& events);
+
+	/// <summary>
+	/// 指定時刻までのイベントを入力状態へ反映する
+	/// </summary>
+	size_t Drain(uint64_t untilTimestamp, InputState& state);
+
+	uint64_t GetDroppedCount() const { return droppedCount_.load(std::memory_order_relaxed); }
+
+private: // メンバ変数
+	SpscRing<InputEvent, kCapacity> ring_;
+	std::vector<InputEvent> drainBuffer_;
+	std::atomic<uint64_t> droppedCount_ = 0;
+};
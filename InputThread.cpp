@@ -0,0 +1,137 @@
+#include "InputThread.h"
+
+#include <cassert>
+
+namespace {
+
+const wchar_t kInputWindowClassName[] = L"CG2InputWindowClass";
+
+// Raw InputのHIDの種類
+const USHORT kHidUsagePageGeneric = 0x01;
+const USHORT kHidUsageMouse = 0x02;
+const USHORT kHidUsageKeyboard = 0x06;
+
+} // namespace
+
+InputThread::~InputThread() {
+	Stop();
+}
+
+void InputThread::Start(HWND gameWindow, InputQueue* queue) {
+	assert(!thread_.joinable());
+	gameWindow_ = gameWindow;
+	queue_ = queue;
+
+	// スレッドのメッセージキューができるまで待ってから戻る(Stopでメッセージを送れるように)
+	readyEvent_ = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	assert(readyEvent_ != nullptr);
+	thread_ = std::thread(&InputThread::Run, this);
+	WaitForSingleObject(readyEvent_, INFINITE);
+	CloseHandle(readyEvent_);
+	readyEvent_ = nullptr;
+}
+
+void InputThread::Stop() {
+	if (!thread_.joinable()) {
+		return;
+	}
+	PostThreadMessage(threadId_, WM_QUIT, 0, 0);
+	thread_.join();
+}
+
+void InputThread::Run() {
+	threadId_ = GetCurrentThreadId();
+
+	WNDCLASS wc{};
+	wc.lpfnWndProc = WindowProc;
+	wc.lpszClassName = kInputWindowClassName;
+	wc.hInstance = GetModuleHandle(nullptr);
+	RegisterClass(&wc);
+
+	// 表示しないメッセージ専用ウインドウでRaw Inputを受ける
+	messageWindow_ = CreateWindowEx(0, kInputWindowClassName, nullptr, 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr, wc.hInstance, nullptr);
+	assert(messageWindow_ != nullptr);
+	SetWindowLongPtr(messageWindow_, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+
+	// 前面にないウインドウでも受け取れるようINPUTSINKを付ける。ゲームが前面にあるかはHandleRawInputで見る
+	RAWINPUTDEVICE devices[2]{};
+	devices[0].usUsagePage = kHidUsagePageGeneric;
+	devices[0].usUsage = kHidUsageMouse;
+	devices[0].dwFlags = RIDEV_INPUTSINK;
+	devices[0].hwndTarget = messageWindow_;
+	devices[1].usUsagePage = kHidUsagePageGeneric;
+	devices[1].usUsage = kHidUsageKeyboard;
+	devices[1].dwFlags = RIDEV_INPUTSINK;
+	devices[1].hwndTarget = messageWindow_;
+	BOOL registered = RegisterRawInputDevices(devices, _countof(devices), sizeof(RAWINPUTDEVICE));
+	assert(registered);
+
+	// PeekMessageを1回呼ぶとこのスレッドのメッセージキューが作られる
+	MSG msg{};
+	PeekMessage(&msg, nullptr, 0, 0, PM_NOREMOVE);
+	SetEvent(readyEvent_);
+
+	while (GetMessage(&msg, nullptr, 0, 0) > 0) {
+		DispatchMessage(&msg);
+	}
+
+	if (registered) {
+		devices[0].dwFlags = RIDEV_REMOVE;
+		devices[0].hwndTarget = nullptr;
+		devices[1].dwFlags = RIDEV_REMOVE;
+		devices[1].hwndTarget = nullptr;
+		RegisterRawInputDevices(devices, _countof(devices), sizeof(RAWINPUTDEVICE));
+	}
+	DestroyWindow(messageWindow_);
+	messageWindow_ = nullptr;
+	UnregisterClass(kInputWindowClassName, wc.hInstance);
+}
+
+void InputThread::HandleRawInput(HRAWINPUT rawInputHandle) {
+	uint64_t timestamp = InputQueue::GetTimestamp();
+
+	RAWINPUT rawInput{};
+	UINT size = sizeof(rawInput);
+	if (GetRawInputData(rawInputHandle, RID_INPUT, &rawInput, &size, sizeof(RAWINPUTHEADER)) == static_cast<UINT>(-1)) {
+		return;
+	}
+	// 他のアプリを操作しているときの入力は積まない。離したイベントだけはInputQueueが通す
+	bool focused = GetForegroundWindow() == gameWindow_;
+
+	if (rawInput.header.dwType == RIM_TYPEMOUSE) {
+		const RAWMOUSE& mouse = rawInput.data.mouse;
+		if ((mouse.usFlags & MOUSE_MOVE_ABSOLUTE) == 0 && (mouse.lLastX != 0 || mouse.lLastY != 0)) {
+			queue_->Push({ timestamp, InputEventType::MouseMove, 0, mouse.lLastX, mouse.lLastY }, focused);
+		}
+		// ボタンiの押下がビット2i、離しがビット2i+1に入っている
+		for (uint32_t button = 0; button < 5; ++button) {
+			if (mouse.usButtonFlags & (1u << (button * 2))) {
+				queue_->Push({ timestamp, InputEventType::MouseButtonDown, button, 0, 0 }, focused);
+			}
+			if (mouse.usButtonFlags & (1u << (button * 2 + 1))) {
+				queue_->Push({ timestamp, InputEventType::MouseButtonUp, button, 0, 0 }, focused);
+			}
+		}
+		if (mouse.usButtonFlags & RI_MOUSE_WHEEL) {
+			queue_->Push({ timestamp, InputEventType::MouseWheel, 0, 0, static_cast<SHORT>(mouse.usButtonData) }, focused);
+		}
+	} else if (rawInput.header.dwType == RIM_TYPEKEYBOARD) {
+		const RAWKEYBOARD& keyboard = rawInput.data.keyboard;
+		// 0xFFは一部のキーが送ってくる偽のキー
+		if (keyboard.VKey == 0xFF) {
+			return;
+		}
+		InputEventType type = (keyboard.Flags & RI_KEY_BREAK) ? InputEventType::KeyUp : InputEventType::KeyDown;
+		queue_->Push({ timestamp, type, keyboard.VKey, 0, 0 }, focused);
+	}
+}
+
+LRESULT CALLBACK InputThread::WindowProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
+	if (msg == WM_INPUT) {
+		InputThread* inputThread = reinterpret_cast<InputThread*>(GetWindowLongPtr(hwnd, GWLP_USERDATA));
+		if (inputThread != nullptr) {
+			inputThread->HandleRawInput(reinterpret_cast<HRAWINPUT>(lparam));
+		}
+	}
+	return DefWindowProc(hwnd, msg, wparam, lparam);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <Windows.h>
+#include <thread>
+
+#include "InputQueue.h"
+
+/// <summary>
+/// 専用スレッドでRaw Inputを受け取り、時刻つきのイベントとしてInputQueueへ積む。
+/// メッセージ専用ウインドウで受けるので、ゲームスレッドのメッセージ処理や描画に左右されない
+/// </summary>
+class InputThread {
+public: // メンバ関数
+	~InputThread();
+
+	/// <summary>
+	/// 入力スレッドの開始
+	/// </summary>
+	/// <param name="gameWindow">ゲームのウインドウ(前面にないときは離したイベントだけ積む)</param>
+	/// <param name="queue">書き込み先</param>
+	void Start(HWND gameWindow, InputQueue* queue);
+
+	/// <summary>
+	/// 入力スレッドを止めて終わるまで待つ
+	/// </summary>
+	void Stop();
+
+private: // メンバ関数
+	/// <summary>
+	/// 入力スレッドの本体
+	/// </summary>
+	void Run();
+
+	/// <summary>
+	/// WM_INPUTの中身をイベントにして積む
+	/// </summary>
+	void HandleRawInput(HRAWINPUT rawInputHandle);
+
+	static LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam);
+
+private: // メンバ変数
+	std::thread thread_;
+	DWORD threadId_ = 0;
+	HANDLE readyEvent_ = nullptr;
+	HWND gameWindow_ = nullptr;
+	HWND messageWindow_ = nullptr;
+	InputQueue* queue_ = nullptr;
+};
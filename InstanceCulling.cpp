@@ -0,0 +1,261 @@
+#include "InstanceCulling.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define INSTANCE_CULLING_USE_SSE2
+#endif
+
+namespace {
+
+// 1スレッドあたりの最小インスタンス数
+const uint32_t kMinInstancesPerThread = 4096;
+
+void TransformPoint(const float m[4][4], float x, float y, float z, float out[4]) {
+	for (uint32_t c = 0; c < 4; ++c) {
+		out[c] = x * m[0][c] + y * m[1][c] + z * m[2][c] + m[3][c];
+	}
+}
+
+// [begin, end)のインスタンスをカリングして描画引数を書き出す
+uint32_t CullRange(const CullingView& view, const CullingInstance* instances, const CullingMesh* meshes,
+	const HiZBuffer* hiZ, uint32_t begin, uint32_t end, DrawIndexedArguments* outArguments) {
+	const bool useHiZ = hiZ != nullptr && view.hiZMipCount != 0;
+	uint32_t count = 0;
+
+	auto emit = [&](uint32_t index) {
+		const CullingInstance& instance = instances[index];
+		if (useHiZ && hiZ->IsOccluded(view.viewProjection, instance.center, instance.radius)) {
+			return;
+		}
+		const CullingMesh& mesh = meshes[instance.meshIndex];
+		DrawIndexedArguments& arguments = outArguments[count++];
+		arguments.indexCountPerInstance = mesh.indexCount;
+		arguments.instanceCount = 1;
+		arguments.startIndexLocation = mesh.startIndex;
+		arguments.baseVertexLocation = mesh.baseVertex;
+		arguments.startInstanceLocation = index;
+	};
+
+	uint32_t index = begin;
+#ifdef INSTANCE_CULLING_USE_SSE2
+	// 4インスタンスずつ6平面と判定する
+	for (; index + 4 <= end; index += 4) {
+		const CullingInstance* i = &instances[index];
+		__m128 cx = _mm_set_ps(i[3].center[0], i[2].center[0], i[1].center[0], i[0].center[0]);
+		__m128 cy = _mm_set_ps(i[3].center[1], i[2].center[1], i[1].center[1], i[0].center[1]);
+		__m128 cz = _mm_set_ps(i[3].center[2], i[2].center[2], i[1].center[2], i[0].center[2]);
+		__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_set_ps(i[3].radius, i[2].radius, i[1].radius, i[0].radius));
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (uint32_t p = 0; p < 6; ++p) {
+			const float* plane = view.planes[p];
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane[0])), _mm_mul_ps(cy, _mm_set1_ps(plane[1]))),
+				_mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane[2])), _mm_set1_ps(plane[3])));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (uint32_t lane = 0; lane < 4; ++lane) {
+			if (mask & (1 << lane)) {
+				emit(index + lane);
+			}
+		}
+	}
+#endif
+	for (; index < end; ++index) {
+		if (InstanceCulling::IsInsideFrustum(view, instances[index].center, instances[index].radius)) {
+			emit(index);
+		}
+	}
+	return count;
+}
+
+} // namespace
+
+void HiZBuffer::Build(const float* depth, uint32_t width, uint32_t height) {
+	assert(width > 0 && height > 0);
+	mips_.clear();
+	widths_.clear();
+	heights_.clear();
+
+	mips_.emplace_back(depth, depth + static_cast<size_t>(width) * height);
+	widths_.push_back(width);
+	heights_.push_back(height);
+
+	// 各テクセルは下のミップの対応範囲の最大深度(最も奥)を持つ。奇数サイズは端の1列・1行も含める
+	while (width > 1 || height > 1) {
+		uint32_t nextWidth = std::max(1u, width / 2);
+		uint32_t nextHeight = std::max(1u, height / 2);
+		const std::vector<float>& source = mips_.back();
+		std::vector<float> next(static_cast<size_t>(nextWidth) * nextHeight);
+
+		for (uint32_t y = 0; y < nextHeight; ++y) {
+			uint32_t y0 = y * 2;
+			uint32_t y1 = std::min(y0 + ((y == nextHeight - 1 && (height & 1)) ? 2u : 1u), height - 1);
+			for (uint32_t x = 0; x < nextWidth; ++x) {
+				uint32_t x0 = x * 2;
+				uint32_t x1 = std::min(x0 + ((x == nextWidth - 1 && (width & 1)) ? 2u : 1u), width - 1);
+				float maxDepth = 0.0f;
+				for (uint32_t sy = y0; sy <= y1; ++sy) {
+					for (uint32_t sx = x0; sx <= x1; ++sx) {
+						maxDepth = std::max(maxDepth, source[static_cast<size_t>(sy) * width + sx]);
+					}
+				}
+				next[static_cast<size_t>(y) * nextWidth + x] = maxDepth;
+			}
+		}
+
+		mips_.push_back(std::move(next));
+		widths_.push_back(nextWidth);
+		heights_.push_back(nextHeight);
+		width = nextWidth;
+		height = nextHeight;
+	}
+}
+
+bool HiZBuffer::IsOccluded(const float viewProjection[4][4], const float center[3], float radius) const {
+	if (mips_.empty()) {
+		return false;
+	}
+
+	// 境界球を囲むAABBの8頂点を投影して、画面上の矩形と最も手前の深度を求める
+	float minX = 1.0f, minY = 1.0f, maxX = -1.0f, maxY = -1.0f, minZ = 1.0f;
+	for (uint32_t corner = 0; corner < 8; ++corner) {
+		float clip[4];
+		TransformPoint(viewProjection,
+			center[0] + ((corner & 1) ? radius : -radius),
+			center[1] + ((corner & 2) ? radius : -radius),
+			center[2] + ((corner & 4) ? radius : -radius), clip);
+		// ニア面をまたぐものは隠れていないとみなす
+		if (clip[3] <= 1e-5f) {
+			return false;
+		}
+		float x = clip[0] / clip[3];
+		float y = clip[1] / clip[3];
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, clip[2] / clip[3]);
+	}
+	if (minZ <= 0.0f) {
+		return false;
+	}
+
+	// NDCからUVへ(Yは反転)
+	float u0 = std::clamp(minX * 0.5f + 0.5f, 0.0f, 1.0f);
+	float u1 = std::clamp(maxX * 0.5f + 0.5f, 0.0f, 1.0f);
+	float v0 = std::clamp(-maxY * 0.5f + 0.5f, 0.0f, 1.0f);
+	float v1 = std::clamp(-minY * 0.5f + 0.5f, 0.0f, 1.0f);
+
+	// 矩形が2x2テクセル以内に収まるミップを選ぶ
+	float extent = std::max((u1 - u0) * static_cast<float>(widths_[0]), (v1 - v0) * static_cast<float>(heights_[0]));
+	uint32_t mip = extent > 1.0f ? static_cast<uint32_t>(std::ceil(std::log2(extent))) : 0;
+	mip = std::min(mip, GetMipCount() - 1);
+
+	// 最上位ミップのテクセルを求めてからミップの段数だけずらす。奇数サイズの端は縮小で最後のテクセルに含めているので、
+	// 各ミップのサイズにUVを掛けると端の画素を含むテクセルを見落とす
+	const uint32_t width0 = widths_[0];
+	const uint32_t height0 = heights_[0];
+	const uint32_t lastX = widths_[mip] - 1;
+	const uint32_t lastY = heights_[mip] - 1;
+	uint32_t x0 = std::min(std::min(static_cast<uint32_t>(u0 * static_cast<float>(width0)), width0 - 1) >> mip, lastX);
+	uint32_t x1 = std::min(std::min(static_cast<uint32_t>(u1 * static_cast<float>(width0)), width0 - 1) >> mip, lastX);
+	uint32_t y0 = std::min(std::min(static_cast<uint32_t>(v0 * static_cast<float>(height0)), height0 - 1) >> mip, lastY);
+	uint32_t y1 = std::min(std::min(static_cast<uint32_t>(v1 * static_cast<float>(height0)), height0 - 1) >> mip, lastY);
+
+	float maxDepth = 0.0f;
+	for (uint32_t y = y0; y <= y1; ++y) {
+		for (uint32_t x = x0; x <= x1; ++x) {
+			maxDepth = std::max(maxDepth, Load(mip, x, y));
+		}
+	}
+	return minZ > maxDepth;
+}
+
+CullingView InstanceCulling::MakeView(const float viewProjection[4][4], const HiZBuffer* hiZ, uint32_t instanceCount) {
+	CullingView view{};
+	std::memcpy(view.viewProjection, viewProjection, sizeof(view.viewProjection));
+
+	// 行ベクトル規約の行列から6平面を取り出す(D3DのクリップZは0～w)
+	const float(*m)[4] = viewProjection;
+	for (uint32_t r = 0; r < 4; ++r) {
+		float column0 = m[r][0], column1 = m[r][1], column2 = m[r][2], column3 = m[r][3];
+		view.planes[0][r] = column3 + column0; // 左
+		view.planes[1][r] = column3 - column0; // 右
+		view.planes[2][r] = column3 + column1; // 下
+		view.planes[3][r] = column3 - column1; // 上
+		view.planes[4][r] = column2;           // ニア
+		view.planes[5][r] = column3 - column2; // ファー
+	}
+	for (uint32_t p = 0; p < 6; ++p) {
+		float length = std::sqrt(view.planes[p][0] * view.planes[p][0] + view.planes[p][1] * view.planes[p][1] + view.planes[p][2] * view.planes[p][2]);
+		if (length > 0.0f) {
+			for (uint32_t c = 0; c < 4; ++c) {
+				view.planes[p][c] /= length;
+			}
+		}
+	}
+
+	if (hiZ && hiZ->GetMipCount() != 0) {
+		view.hiZWidth = hiZ->GetWidth();
+		view.hiZHeight = hiZ->GetHeight();
+		view.hiZMipCount = hiZ->GetMipCount();
+	}
+	view.instanceCount = instanceCount;
+	return view;
+}
+
+uint32_t InstanceCulling::Cull(const CullingView& view, const CullingInstance* instances, const CullingMesh* meshes,
+	const HiZBuffer* hiZ, DrawIndexedArguments* outArguments, uint32_t threadCount) {
+	const uint32_t instanceCount = view.instanceCount;
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threadCount = std::clamp(instanceCount / kMinInstancesPerThread, 1u, threadCount);
+	if (threadCount == 1) {
+		return CullRange(view, instances, meshes, hiZ, 0, instanceCount, outArguments);
+	}
+
+	// 範囲ごとに書き出してから詰め直すことで、出力順をシングルスレッドと同じにする
+	std::vector<uint32_t> counts(threadCount);
+	std::vector<uint32_t> begins(threadCount + 1);
+	for (uint32_t i = 0; i <= threadCount; ++i) {
+		begins[i] = static_cast<uint32_t>(static_cast<uint64_t>(instanceCount) * i / threadCount);
+	}
+	std::vector<std::thread> workers;
+	workers.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i) {
+		workers.emplace_back([&, i]() {
+			counts[i] = CullRange(view, instances, meshes, hiZ, begins[i], begins[i + 1], outArguments + begins[i]);
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	uint32_t total = counts[0];
+	for (uint32_t i = 1; i < threadCount; ++i) {
+		std::memmove(outArguments + total, outArguments + begins[i], sizeof(DrawIndexedArguments) * counts[i]);
+		total += counts[i];
+	}
+	return total;
+}
+
+bool InstanceCulling::IsInsideFrustum(const CullingView& view, const float center[3], float radius) {
+	for (uint32_t p = 0; p < 6; ++p) {
+		const float* plane = view.planes[p];
+		// SIMD版と同じ順序で計算する
+		if ((plane[0] * center[0] + plane[1] * center[1]) + (plane[2] * center[2] + plane[3]) < -radius) {
+			return false;
+		}
+	}
+	return true;
+}
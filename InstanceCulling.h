@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 以下の構造体はInstanceCulling.hlslと同じレイアウトにする
+
+/// <summary>
+/// カリング対象のインスタンス(境界球とメッシュ番号)
+/// </summary>
+struct CullingInstance {
+	float center[3];
+	float radius;
+	uint32_t meshIndex;
+	uint32_t padding[3];
+};
+
+/// <summary>
+/// インスタンスが参照するメッシュのインデックス範囲
+/// </summary>
+struct CullingMesh {
+	uint32_t indexCount;
+	uint32_t startIndex;
+	int32_t baseVertex;
+	uint32_t padding;
+};
+
+/// <summary>
+/// D3D12_DRAW_INDEXED_ARGUMENTSと同じレイアウトの間接描画引数
+/// </summary>
+struct DrawIndexedArguments {
+	uint32_t indexCountPerInstance;
+	uint32_t instanceCount;
+	uint32_t startIndexLocation;
+	int32_t baseVertexLocation;
+	uint32_t startInstanceLocation; // インスタンス番号(インスタンス単位の頂点バッファで参照する)
+};
+
+/// <summary>
+/// カリングに使うカメラ情報。GPUにはルート定数として渡す
+/// </summary>
+struct CullingView {
+	float viewProjection[4][4]; // 行ベクトル×行列の規約(行優先)
+	float planes[6][4];         // 内向き法線と距離(xyz・w)
+	uint32_t hiZWidth;
+	uint32_t hiZHeight;
+	uint32_t hiZMipCount;       // 0ならオクルージョン判定をしない
+	uint32_t instanceCount;
+};
+
+/// <summary>
+/// 深度の最大値ピラミッド(Hi-Z)。GPU版と同じ規則でCPU上に作る
+/// </summary>
+class HiZBuffer {
+public: // メンバ関数
+	/// <summary>
+	/// 深度バッファ(0が手前、1が奥)からミップチェーンを作る
+	/// </summary>
+	void Build(const float* depth, uint32_t width, uint32_t height);
+
+	/// <summary>
+	/// 境界球が手前の深度に完全に隠れているか
+	/// </summary>
+	bool IsOccluded(const float viewProjection[4][4], const float center[3], float radius) const;
+
+	uint32_t GetWidth(uint32_t mip = 0) const { return widths_[mip]; }
+	uint32_t GetHeight(uint32_t mip = 0) const { return heights_[mip]; }
+	uint32_t GetMipCount() const { return static_cast<uint32_t>(mips_.size()); }
+	float Load(uint32_t mip, uint32_t x, uint32_t y) const { return mips_[mip][static_cast<size_t>(y) * widths_[mip] + x]; }
+
+private: // メンバ変数
+	std::vector<std::vector<float>> mips_;
+	std::vector<uint32_t> widths_;
+	std::vector<uint32_t> heights_;
+};
+
+/// <summary>
+/// インスタンスカリングと間接描画引数の生成のCPU参照実装
+/// </summary>
+class InstanceCulling {
+public: // 静的メンバ関数
+	/// <summary>
+	/// ビュープロジェクション行列からカリング用のカメラ情報を作る
+	/// </summary>
+	/// <param name="viewProjection">ビュープロジェクション行列</param>
+	/// <param name="hiZ">Hi-Z(使わないならnullptr)</param>
+	/// <param name="instanceCount">インスタンス数</param>
+	static CullingView MakeView(const float viewProjection[4][4], const HiZBuffer* hiZ, uint32_t instanceCount);
+
+	/// <summary>
+	/// 視錐台とHi-Zでカリングし、残ったインスタンスの描画引数を詰めて書き出す。
+	/// 出力はインスタンス番号順(GPU版はアトミックで追記するので順不同)
+	/// </summary>
+	/// <param name="view">カメラ情報</param>
+	/// <param name="instances">インスタンス(view.instanceCount個)</param>
+	/// <param name="meshes">メッシュ</param>
+	/// <param name="hiZ">Hi-Z(view.hiZMipCountが0なら参照しない)</param>
+	/// <param name="outArguments">描画引数の出力先(instanceCount個分の容量)</param>
+	/// <param name="threadCount">使用スレッド数(0なら自動)</param>
+	/// <returns>書き出した描画引数の数</returns>
+	static uint32_t Cull(const CullingView& view, const CullingInstance* instances, const CullingMesh* meshes,
+		const HiZBuffer* hiZ, DrawIndexedArguments* outArguments, uint32_t threadCount = 1);
+
+	/// <summary>
+	/// 境界球が視錐台と交差するか(スカラー版)
+	/// </summary>
+	static bool IsInsideFrustum(const CullingView& view, const float center[3], float radius);
+};
@@ -0,0 +1,122 @@
+// インスタンスを視錐台とHi-Zでカリングし、残ったものの間接描画引数を詰めて書き出す
+// CPU参照実装はInstanceCulling.cpp。構造体のレイアウトはInstanceCulling.hと合わせる
+
+struct CullingInstance {
+	float3 center;
+	float radius;
+	uint meshIndex;
+	uint3 padding;
+};
+
+struct CullingMesh {
+	uint indexCount;
+	uint startIndex;
+	int baseVertex;
+	uint padding;
+};
+
+struct DrawIndexedArguments {
+	uint indexCountPerInstance;
+	uint instanceCount;
+	uint startIndexLocation;
+	int baseVertexLocation;
+	uint startInstanceLocation;
+};
+
+cbuffer CullingView : register(b0) {
+	row_major float4x4 viewProjection;
+	float4 planes[6];
+	uint hiZWidth;
+	uint hiZHeight;
+	uint hiZMipCount;
+	uint instanceCount;
+};
+
+StructuredBuffer<CullingInstance> gInstances : register(t0);
+StructuredBuffer<CullingMesh> gMeshes : register(t1);
+Texture2D<float> gHiZ : register(t2);
+RWStructuredBuffer<DrawIndexedArguments> gDrawArguments : register(u0);
+RWByteAddressBuffer gDrawCount : register(u1);
+
+bool IsInsideFrustum(float3 center, float radius) {
+	[unroll]
+	for (uint p = 0; p < 6; ++p) {
+		if ((planes[p].x * center.x + planes[p].y * center.y) + (planes[p].z * center.z + planes[p].w) < -radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool IsOccluded(float3 center, float radius) {
+	float2 minXY = float2(1.0f, 1.0f);
+	float2 maxXY = float2(-1.0f, -1.0f);
+	float minZ = 1.0f;
+	[unroll]
+	for (uint corner = 0; corner < 8; ++corner) {
+		float3 offset = float3((corner & 1) ? radius : -radius, (corner & 2) ? radius : -radius, (corner & 4) ? radius : -radius);
+		float4 clip = mul(float4(center + offset, 1.0f), viewProjection);
+		// ニア面をまたぐものは隠れていないとみなす
+		if (clip.w <= 1e-5f) {
+			return false;
+		}
+		float3 ndc = clip.xyz / clip.w;
+		minXY = min(minXY, ndc.xy);
+		maxXY = max(maxXY, ndc.xy);
+		minZ = min(minZ, ndc.z);
+	}
+	if (minZ <= 0.0f) {
+		return false;
+	}
+
+	float2 uv0 = saturate(float2(minXY.x, -maxXY.y) * 0.5f + 0.5f);
+	float2 uv1 = saturate(float2(maxXY.x, -minXY.y) * 0.5f + 0.5f);
+
+	// 矩形が2x2テクセル以内に収まるミップを選ぶ
+	float extent = max((uv1.x - uv0.x) * hiZWidth, (uv1.y - uv0.y) * hiZHeight);
+	uint mip = extent > 1.0f ? (uint)ceil(log2(extent)) : 0;
+	mip = min(mip, hiZMipCount - 1);
+
+	// 最上位ミップのテクセルを求めてからミップの段数だけずらす(奇数サイズの端は縮小で最後のテクセルに含めている)
+	uint2 size0 = uint2(hiZWidth, hiZHeight);
+	uint2 lastTexel = uint2(max(hiZWidth >> mip, 1), max(hiZHeight >> mip, 1)) - 1;
+	uint2 texel0 = min(min((uint2)(uv0 * size0), size0 - 1) >> mip, lastTexel);
+	uint2 texel1 = min(min((uint2)(uv1 * size0), size0 - 1) >> mip, lastTexel);
+
+	float maxDepth = 0.0f;
+	for (uint y = texel0.y; y <= texel1.y; ++y) {
+		for (uint x = texel0.x; x <= texel1.x; ++x) {
+			maxDepth = max(maxDepth, gHiZ.Load(int3(x, y, mip)));
+		}
+	}
+	return minZ > maxDepth;
+}
+
+[numthreads(64, 1, 1)]
+void main(uint3 dispatchThreadId : SV_DispatchThreadID) {
+	uint index = dispatchThreadId.x;
+	if (index >= instanceCount) {
+		return;
+	}
+
+	CullingInstance instance = gInstances[index];
+	if (!IsInsideFrustum(instance.center, instance.radius)) {
+		return;
+	}
+	if (hiZMipCount != 0 && IsOccluded(instance.center, instance.radius)) {
+		return;
+	}
+
+	// 残ったものを詰めて追記する
+	uint slot;
+	gDrawCount.InterlockedAdd(0, 1, slot);
+
+	CullingMesh mesh = gMeshes[instance.meshIndex];
+	DrawIndexedArguments arguments;
+	arguments.indexCountPerInstance = mesh.indexCount;
+	arguments.instanceCount = 1;
+	arguments.startIndexLocation = mesh.startIndex;
+	arguments.baseVertexLocation = mesh.baseVertex;
+	arguments.startInstanceLocation = index;
+	gDrawArguments[slot] = arguments;
+}
@@ -0,0 +1,232 @@
+#include "MemoryArena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+namespace {
+
+size_t AlignUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// bufferの先頭からoffset以降で、アドレスがalignmentの倍数になる最初のオフセット
+// (バッファ自体はmax_align_tにしか揃っていないので、オフセットではなくアドレスを揃える)
+size_t AlignOffset(const std::byte* buffer, size_t offset, size_t alignment) {
+	const uintptr_t address = reinterpret_cast<uintptr_t>(buffer);
+	return AlignUp(address + offset, alignment) - address;
+}
+
+std::byte* AllocateBuffer(size_t size) {
+	return static_cast<std::byte*>(::operator new(size, std::align_val_t(alignof(std::max_align_t))));
+}
+
+void FreeBuffer(void* buffer) {
+	::operator delete(buffer, std::align_val_t(alignof(std::max_align_t)));
+}
+
+} // namespace
+
+/*///////////////////////
+	MemoryStatistics
+*////////////////////////
+void MemoryStatistics::RecordAllocation(size_t size) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	uint64_t current = currentBytes.fetch_add(size, std::memory_order_relaxed) + size;
+	uint64_t peak = peakBytes.load(std::memory_order_relaxed);
+	while (current > peak && !peakBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+	}
+}
+
+void MemoryStatistics::RecordRelease(size_t size) {
+	currentBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+/*///////////////////////
+	MemoryTracker
+*////////////////////////
+MemoryTracker* MemoryTracker::GetInstance() {
+	static MemoryTracker instance;
+	return &instance;
+}
+
+MemoryStatistics* MemoryTracker::Register(const char* name) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (MemoryStatistics& statistics : statistics_) {
+		if (statistics.name == name) {
+			return &statistics;
+		}
+	}
+	MemoryStatistics& statistics = statistics_.emplace_back();
+	statistics.name = name;
+	return &statistics;
+}
+
+std::vector<MemoryTracker::Snapshot> MemoryTracker::GetSnapshots() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::vector<Snapshot> snapshots;
+	snapshots.reserve(statistics_.size());
+	for (const MemoryStatistics& statistics : statistics_) {
+		snapshots.push_back({ statistics.name, statistics.allocationCount.load(), statistics.allocatedBytes.load(),
+			statistics.currentBytes.load(), statistics.peakBytes.load(), statistics.overflowCount.load() });
+	}
+	return snapshots;
+}
+
+/*///////////////////////
+	LinearArena
+*////////////////////////
+LinearArena::LinearArena(size_t capacity, const char* name)
+	: buffer_(AllocateBuffer(capacity)), capacity_(capacity), statistics_(MemoryTracker::GetInstance()->Register(name)) {
+}
+
+LinearArena::~LinearArena() {
+	Reset();
+	FreeBuffer(buffer_);
+}
+
+void* LinearArena::Allocate(size_t size, size_t alignment) {
+	assert((alignment & (alignment - 1)) == 0);
+
+	// ロックせずにオフセットを進める
+	size_t offset = offset_.load(std::memory_order_relaxed);
+	for (;;) {
+		size_t aligned = AlignOffset(buffer_, offset, alignment);
+		if (aligned + size > capacity_) {
+			return AllocateOverflow(size, alignment);
+		}
+		if (offset_.compare_exchange_weak(offset, aligned + size, std::memory_order_relaxed)) {
+			// アライメントの詰め物も使用量に含める
+			statistics_->RecordAllocation(aligned + size - offset);
+			return buffer_ + aligned;
+		}
+	}
+}
+
+void LinearArena::Reset() {
+	statistics_->RecordRelease(offset_.load(std::memory_order_relaxed) + overflowBytes_);
+	offset_.store(0, std::memory_order_relaxed);
+	for (const auto& [block, alignment] : overflowBlocks_) {
+		::operator delete(block, std::align_val_t(alignment));
+	}
+	overflowBlocks_.clear();
+	overflowBytes_ = 0;
+}
+
+void* LinearArena::AllocateOverflow(size_t size, size_t alignment) {
+	alignment = std::max(alignment, alignof(std::max_align_t));
+	void* block = ::operator new(size, std::align_val_t(alignment));
+
+	std::lock_guard<std::mutex> lock(overflowMutex_);
+	overflowBlocks_.emplace_back(block, alignment);
+	overflowBytes_ += size;
+	statistics_->overflowCount.fetch_add(1, std::memory_order_relaxed);
+	statistics_->RecordAllocation(size);
+	return block;
+}
+
+/*///////////////////////
+	FrameAllocator
+*////////////////////////
+FrameAllocator::FrameAllocator(size_t capacityPerFrame, const char* name) {
+	for (uint32_t i = 0; i < kFrameCount; ++i) {
+		arenas_[i] = std::make_unique<LinearArena>(capacityPerFrame, name);
+		resources_[i] = std::make_unique<ArenaResource>(arenas_[i].get());
+	}
+}
+
+void FrameAllocator::BeginFrame() {
+	frameIndex_ = (frameIndex_ + 1) % kFrameCount;
+	arenas_[frameIndex_]->Reset();
+}
+
+/*///////////////////////
+	ScratchStack
+*////////////////////////
+ScratchStack& ScratchStack::GetThreadLocal() {
+	thread_local ScratchStack stack(kThreadLocalCapacity, "ThreadScratch");
+	return stack;
+}
+
+ScratchStack::ScratchStack(size_t capacity, const char* name)
+	: buffer_(AllocateBuffer(capacity)), capacity_(capacity), resource_(this), statistics_(MemoryTracker::GetInstance()->Register(name)) {
+}
+
+ScratchStack::~ScratchStack() {
+	FreeToMarker({ 0, 0 });
+	FreeBuffer(buffer_);
+}
+
+void* ScratchStack::Allocate(size_t size, size_t alignment) {
+	assert((alignment & (alignment - 1)) == 0);
+	size_t aligned = AlignOffset(buffer_, offset_, alignment);
+	if (aligned + size <= capacity_) {
+		statistics_->RecordAllocation(aligned + size - offset_);
+		offset_ = aligned + size;
+		return buffer_ + aligned;
+	}
+
+	// 入りきらない分はヒープから確保し、マーカーまで巻き戻すときに解放する
+	alignment = std::max(alignment, alignof(std::max_align_t));
+	void* block = ::operator new(size, std::align_val_t(alignment));
+	overflowBlocks_.emplace_back(block, alignment);
+	overflowSizes_.push_back(size);
+	statistics_->overflowCount.fetch_add(1, std::memory_order_relaxed);
+	statistics_->RecordAllocation(size);
+	return block;
+}
+
+void ScratchStack::FreeToMarker(const Marker& marker) {
+	assert(marker.offset <= offset_ && marker.overflowCount <= overflowBlocks_.size());
+	while (overflowBlocks_.size() > marker.overflowCount) {
+		::operator delete(overflowBlocks_.back().first, std::align_val_t(overflowBlocks_.back().second));
+		statistics_->RecordRelease(overflowSizes_.back());
+		overflowBlocks_.pop_back();
+		overflowSizes_.pop_back();
+	}
+	statistics_->RecordRelease(offset_ - marker.offset);
+	offset_ = marker.offset;
+}
+
+/*///////////////////////
+	PoolAllocator
+*////////////////////////
+PoolAllocator::PoolAllocator(size_t blockSize, size_t blocksPerChunk, const char* name)
+	: blockSize_(AlignUp(std::max(blockSize, sizeof(FreeBlock)), alignof(std::max_align_t))),
+	blocksPerChunk_(std::max<size_t>(blocksPerChunk, 1)),
+	statistics_(MemoryTracker::GetInstance()->Register(name)) {
+}
+
+PoolAllocator::~PoolAllocator() {
+	for (std::byte* chunk : chunks_) {
+		FreeBuffer(chunk);
+	}
+}
+
+void* PoolAllocator::Allocate() {
+	if (freeList_ == nullptr) {
+		// まとめて確保して空きリストにつなぐ
+		std::byte* chunk = AllocateBuffer(blockSize_ * blocksPerChunk_);
+		chunks_.push_back(chunk);
+		for (size_t i = blocksPerChunk_; i-- > 0;) {
+			FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + i * blockSize_);
+			block->next = freeList_;
+			freeList_ = block;
+		}
+	}
+	FreeBlock* block = freeList_;
+	freeList_ = block->next;
+	statistics_->RecordAllocation(blockSize_);
+	return block;
+}
+
+void PoolAllocator::Free(void* block) {
+	if (block == nullptr) {
+		return;
+	}
+	FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+	freeBlock->next = freeList_;
+	freeList_ = freeBlock;
+	statistics_->RecordRelease(blockSize_);
+}
@@ -0,0 +1,317 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// <summary>
+/// アロケータ1つ分の割り当て統計(スレッドセーフに加算する)
+/// </summary>
+struct MemoryStatistics {
+	std::string name;
+	std::atomic<uint64_t> allocationCount = 0;
+	std::atomic<uint64_t> allocatedBytes = 0; // 累計
+	std::atomic<uint64_t> currentBytes = 0;   // 現在使用中
+	std::atomic<uint64_t> peakBytes = 0;
+	std::atomic<uint64_t> overflowCount = 0;  // 容量を超えてヒープに逃がした回数
+
+	void RecordAllocation(size_t size);
+	void RecordRelease(size_t size);
+};
+
+/// <summary>
+/// サブシステムごとの割り当て統計の登録先
+/// </summary>
+class MemoryTracker {
+public: // サブクラス
+	struct Snapshot {
+		std::string name;
+		uint64_t allocationCount;
+		uint64_t allocatedBytes;
+		uint64_t currentBytes;
+		uint64_t peakBytes;
+		uint64_t overflowCount;
+	};
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// シングルトンインスタンスの取得
+	/// </summary>
+	static MemoryTracker* GetInstance();
+
+public: // メンバ関数
+	/// <summary>
+	/// 統計を登録する。同じ名前の統計があればそれを共有する(スレッドごとのアロケータなどで登録が増え続けないように)。
+	/// 返したポインタはプログラム終了まで有効
+	/// </summary>
+	/// <param name="name">サブシステム名</param>
+	MemoryStatistics* Register(const char* name);
+
+	/// <summary>
+	/// 全サブシステムの統計を取得する
+	/// </summary>
+	std::vector<Snapshot> GetSnapshots();
+
+private: // メンバ変数
+	std::mutex mutex_;
+	std::deque<MemoryStatistics> statistics_; // アドレスが変わらないようdequeで持つ
+};
+
+/// <summary>
+/// 固定容量のリニア(バンプ)アロケータ。Allocateはスレッドセーフ、Resetはシングルスレッドで呼ぶ。
+/// 容量を超えた分はヒープから確保し、Resetでまとめて解放する
+/// </summary>
+class LinearArena {
+public: // メンバ関数
+	LinearArena(size_t capacity, const char* name);
+	~LinearArena();
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	/// <summary>
+	/// 割り当て。個別の解放はできない
+	/// </summary>
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	/// <summary>
+	/// 全割り当てを破棄する
+	/// </summary>
+	void Reset();
+
+	size_t GetUsedBytes() const { return offset_.load(std::memory_order_relaxed); }
+	size_t GetCapacity() const { return capacity_; }
+	MemoryStatistics* GetStatistics() const { return statistics_; }
+
+private: // メンバ関数
+	void* AllocateOverflow(size_t size, size_t alignment);
+
+private: // メンバ変数
+	std::byte* buffer_ = nullptr;
+	size_t capacity_ = 0;
+	std::atomic<size_t> offset_ = 0;
+
+	std::mutex overflowMutex_;
+	std::vector<std::pair<void*, size_t>> overflowBlocks_; // ポインタとアライメント
+	size_t overflowBytes_ = 0;
+
+	MemoryStatistics* statistics_ = nullptr;
+};
+
+/// <summary>
+/// LinearArenaをstd::pmrのコンテナから使うためのアダプタ(解放は何もしない)
+/// </summary>
+class ArenaResource : public std::pmr::memory_resource {
+public: // メンバ関数
+	explicit ArenaResource(LinearArena* arena) : arena_(arena) {}
+
+private: // メンバ関数
+	void* do_allocate(size_t bytes, size_t alignment) override { return arena_->Allocate(bytes, alignment); }
+	void do_deallocate(void*, size_t, size_t) override {}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private: // メンバ変数
+	LinearArena* arena_;
+};
+
+/// <summary>
+/// フレーム単位の二重化アリーナ。BeginFrameで次のアリーナに切り替えてリセットするので、
+/// 割り当てたメモリは次のフレームの終わり(GPUが前フレームを使い終わるまで)有効
+/// </summary>
+class FrameAllocator {
+public: // 静的メンバ変数
+	static const uint32_t kFrameCount = 2;
+
+public: // メンバ関数
+	FrameAllocator(size_t capacityPerFrame, const char* name);
+
+	/// <summary>
+	/// フレーム開始。2フレーム前のアリーナをリセットして使う
+	/// </summary>
+	void BeginFrame();
+
+	/// <summary>
+	/// 今フレームのアリーナから割り当てる(スレッドセーフ)
+	/// </summary>
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t)) { return arenas_[frameIndex_]->Allocate(size, alignment); }
+
+	/// <summary>
+	/// 配列の割り当て(コンストラクタは呼ばない)
+	/// </summary>
+	template <typename T>
+	T* AllocateArray(size_t count) { return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T))); }
+
+	/// <summary>
+	/// 今フレームのstd::pmr用リソース
+	/// </summary>
+	std::pmr::memory_resource* GetResource() { return resources_[frameIndex_].get(); }
+
+	LinearArena& GetCurrentArena() { return *arenas_[frameIndex_]; }
+
+private: // メンバ変数
+	std::unique_ptr<LinearArena> arenas_[kFrameCount];
+	std::unique_ptr<ArenaResource> resources_[kFrameCount];
+	uint32_t frameIndex_ = 0;
+};
+
+/// <summary>
+/// スレッドごとの一時領域。マーカーまで巻き戻して解放する(スレッドセーフではない)
+/// </summary>
+class ScratchStack {
+public: // サブクラス
+	struct Marker {
+		size_t offset;
+		size_t overflowCount;
+	};
+
+public: // 静的メンバ変数
+	// スレッドローカルな一時領域の容量
+	static const size_t kThreadLocalCapacity = 1024 * 1024;
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// 呼び出したスレッド専用の一時領域(統計は"ThreadScratch"として全スレッドで1つにまとめる)
+	/// </summary>
+	static ScratchStack& GetThreadLocal();
+
+public: // メンバ関数
+	ScratchStack(size_t capacity, const char* name);
+	~ScratchStack();
+	ScratchStack(const ScratchStack&) = delete;
+	ScratchStack& operator=(const ScratchStack&) = delete;
+
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	Marker GetMarker() const { return { offset_, overflowBlocks_.size() }; }
+
+	/// <summary>
+	/// マーカー以降の割り当てをすべて解放する
+	/// </summary>
+	void FreeToMarker(const Marker& marker);
+
+	std::pmr::memory_resource* GetResource() { return &resource_; }
+
+private: // サブクラス
+	class Resource : public std::pmr::memory_resource {
+	public:
+		explicit Resource(ScratchStack* stack) : stack_(stack) {}
+
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override { return stack_->Allocate(bytes, alignment); }
+		void do_deallocate(void*, size_t, size_t) override {}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+		ScratchStack* stack_;
+	};
+
+private: // メンバ変数
+	std::byte* buffer_ = nullptr;
+	size_t capacity_ = 0;
+	size_t offset_ = 0;
+	std::vector<std::pair<void*, size_t>> overflowBlocks_; // ポインタとアライメント
+	std::vector<size_t> overflowSizes_;
+	Resource resource_;
+	MemoryStatistics* statistics_ = nullptr;
+};
+
+/// <summary>
+/// スコープを抜けるときに一時領域を巻き戻す
+/// </summary>
+class ScratchScope {
+public: // メンバ関数
+	explicit ScratchScope(ScratchStack& stack = ScratchStack::GetThreadLocal()) : stack_(stack), marker_(stack.GetMarker()) {}
+	~ScratchScope() { stack_.FreeToMarker(marker_); }
+	ScratchScope(const ScratchScope&) = delete;
+	ScratchScope& operator=(const ScratchScope&) = delete;
+
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t)) { return stack_.Allocate(size, alignment); }
+	std::pmr::memory_resource* GetResource() { return stack_.GetResource(); }
+
+private: // メンバ変数
+	ScratchStack& stack_;
+	ScratchStack::Marker marker_;
+};
+
+/// <summary>
+/// 固定サイズブロックのプール(スレッドセーフではない。スレッドごとに持つか外側で排他する)
+/// </summary>
+class PoolAllocator {
+public: // メンバ関数
+	/// <summary>
+	/// コンストラクタ
+	/// </summary>
+	/// <param name="blockSize">ブロックのサイズ</param>
+	/// <param name="blocksPerChunk">足りなくなったときにまとめて確保するブロック数</param>
+	/// <param name="name">統計の名前</param>
+	PoolAllocator(size_t blockSize, size_t blocksPerChunk, const char* name);
+	~PoolAllocator();
+	PoolAllocator(const PoolAllocator&) = delete;
+	PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+	void* Allocate();
+	void Free(void* block);
+
+	size_t GetBlockSize() const { return blockSize_; }
+
+private: // メンバ変数
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+
+	size_t blockSize_;
+	size_t blocksPerChunk_;
+	FreeBlock* freeList_ = nullptr;
+	std::vector<std::byte*> chunks_;
+	MemoryStatistics* statistics_ = nullptr;
+};
+
+/// <summary>
+/// PoolAllocatorをstd::pmrから使うためのアダプタ。ブロックに収まらない要求は上流へ回す
+/// </summary>
+class PoolResource : public std::pmr::memory_resource {
+public: // メンバ関数
+	explicit PoolResource(PoolAllocator* pool, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) : pool_(pool), upstream_(upstream) {}
+
+private: // メンバ関数
+	bool Fits(size_t bytes, size_t alignment) const { return bytes <= pool_->GetBlockSize() && alignment <= alignof(std::max_align_t); }
+	void* do_allocate(size_t bytes, size_t alignment) override { return Fits(bytes, alignment) ? pool_->Allocate() : upstream_->allocate(bytes, alignment); }
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+		if (Fits(bytes, alignment)) {
+			pool_->Free(p);
+		} else {
+			upstream_->deallocate(p, bytes, alignment);
+		}
+	}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private: // メンバ変数
+	PoolAllocator* pool_;
+	std::pmr::memory_resource* upstream_;
+};
+
+/// <summary>
+/// 型付きのオブジェクトプール
+/// </summary>
+template <typename T>
+class ObjectPool {
+public: // メンバ関数
+	ObjectPool(size_t objectsPerChunk, const char* name) : pool_(sizeof(T) < sizeof(void*) ? sizeof(void*) : sizeof(T), objectsPerChunk, name) {
+		static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types are not supported");
+	}
+
+	template <typename... Args>
+	T* Create(Args&&... args) { return new (pool_.Allocate()) T(std::forward<Args>(args)...); }
+
+	void Destroy(T* object) {
+		object->~T();
+		pool_.Free(object);
+	}
+
+private: // メンバ変数
+	PoolAllocator pool_;
+};
@@ -0,0 +1,188 @@
+#include "ParticleSystem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <thread>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PARTICLE_SYSTEM_USE_SSE2
+#endif
+
+namespace {
+
+// これより少ない数しか担当しないならスレッドを増やさない(起動のほうが高くつく)
+const uint32_t kMinParticlesPerThread = 16384;
+
+uint32_t AlignUp4(uint32_t value) { return (value + 3) & ~3u; }
+
+} // namespace
+
+void ParticleSystem::Initialize(uint32_t capacity, uint32_t seed) {
+	assert(capacity > 0);
+	capacity_ = capacity;
+	const size_t padded = AlignUp4(capacity);
+	for (std::vector<float>* component : { &positionX_, &positionY_, &positionZ_, &velocityX_, &velocityY_, &velocityZ_, &age_, &lifetime_ }) {
+		component->assign(padded, 0.0f);
+	}
+	aliveCount_ = 0;
+	emitAccumulator_ = 0.0f;
+	// xorshiftは0から抜け出せない
+	randomState_ = seed != 0 ? seed : 1;
+}
+
+void ParticleSystem::Update(const ParticleEmitter& emitter, float deltaTime, uint32_t threadCount) {
+	// 発生は乱数の順序を固定するため1スレッドで行う(GPU版と同じく、発生したものもこのフレームで動かす)
+	emitAccumulator_ += emitter.emitRate * deltaTime;
+	const uint32_t emitCount = static_cast<uint32_t>(emitAccumulator_);
+	emitAccumulator_ -= static_cast<float>(emitCount);
+	Emit(emitter, emitCount);
+
+	if (aliveCount_ == 0) {
+		return;
+	}
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threadCount = std::clamp(aliveCount_ / kMinParticlesPerThread, 1u, threadCount);
+	if (threadCount == 1) {
+		aliveCount_ = SimulateRange(emitter, deltaTime, 0, aliveCount_);
+		return;
+	}
+
+	// 4の倍数の境界で区切り、各スレッドは自分の範囲の中だけで詰める
+	const uint32_t chunkSize = AlignUp4((aliveCount_ + threadCount - 1) / threadCount);
+	const uint32_t chunkCount = (aliveCount_ + chunkSize - 1) / chunkSize;
+	std::vector<uint32_t> survivors(chunkCount);
+	std::vector<std::thread> workers;
+	workers.reserve(chunkCount);
+	for (uint32_t chunk = 0; chunk < chunkCount; ++chunk) {
+		workers.emplace_back([&, chunk]() {
+			const uint32_t begin = chunk * chunkSize;
+			survivors[chunk] = SimulateRange(emitter, deltaTime, begin, std::min(begin + chunkSize, aliveCount_));
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	// 範囲の順につなげるので、結果の並びはスレッド数によらない
+	uint32_t aliveCount = survivors[0];
+	for (uint32_t chunk = 1; chunk < chunkCount; ++chunk) {
+		Move(aliveCount, chunk * chunkSize, survivors[chunk]);
+		aliveCount += survivors[chunk];
+	}
+	aliveCount_ = aliveCount;
+}
+
+uint32_t ParticleSystem::Emit(const ParticleEmitter& emitter, uint32_t count) {
+	count = std::min(count, capacity_ - aliveCount_);
+	for (uint32_t i = aliveCount_; i < aliveCount_ + count; ++i) {
+		positionX_[i] = emitter.position[0] + emitter.positionSpread * (Random() * 2.0f - 1.0f);
+		positionY_[i] = emitter.position[1] + emitter.positionSpread * (Random() * 2.0f - 1.0f);
+		positionZ_[i] = emitter.position[2] + emitter.positionSpread * (Random() * 2.0f - 1.0f);
+		velocityX_[i] = emitter.velocity[0] + emitter.velocitySpread * (Random() * 2.0f - 1.0f);
+		velocityY_[i] = emitter.velocity[1] + emitter.velocitySpread * (Random() * 2.0f - 1.0f);
+		velocityZ_[i] = emitter.velocity[2] + emitter.velocitySpread * (Random() * 2.0f - 1.0f);
+		age_[i] = 0.0f;
+		lifetime_[i] = emitter.lifetimeMin + (emitter.lifetimeMax - emitter.lifetimeMin) * Random();
+	}
+	aliveCount_ += count;
+	return count;
+}
+
+void ParticleSystem::CopyTo(ParticleData* outParticles) const {
+	for (uint32_t i = 0; i < aliveCount_; ++i) {
+		outParticles[i] = GetParticle(i);
+	}
+}
+
+ParticleData ParticleSystem::GetParticle(uint32_t index) const {
+	assert(index < aliveCount_);
+	ParticleData particle{};
+	particle.position[0] = positionX_[index];
+	particle.position[1] = positionY_[index];
+	particle.position[2] = positionZ_[index];
+	particle.age = age_[index];
+	particle.velocity[0] = velocityX_[index];
+	particle.velocity[1] = velocityY_[index];
+	particle.velocity[2] = velocityZ_[index];
+	particle.lifetime = lifetime_[index];
+	return particle;
+}
+
+uint32_t ParticleSystem::SimulateRange(const ParticleEmitter& emitter, float deltaTime, uint32_t begin, uint32_t end) {
+	// 減速は1フレーム分の係数にまとめる(負にはしない)
+	const float dragFactor = std::max(1.0f - emitter.drag * deltaTime, 0.0f);
+	const float gravityX = emitter.gravity[0] * deltaTime;
+	const float gravityY = emitter.gravity[1] * deltaTime;
+	const float gravityZ = emitter.gravity[2] * deltaTime;
+
+#ifdef PARTICLE_SYSTEM_USE_SSE2
+	// 配列は4の倍数で確保してあるので、最後の端数も4つ単位で計算してよい(詰めるときに無視される)
+	const uint32_t simdEnd = AlignUp4(end);
+	const __m128 dt = _mm_set1_ps(deltaTime);
+	const __m128 drag = _mm_set1_ps(dragFactor);
+	const __m128 gx = _mm_set1_ps(gravityX), gy = _mm_set1_ps(gravityY), gz = _mm_set1_ps(gravityZ);
+	for (uint32_t i = begin; i < simdEnd; i += 4) {
+		__m128 vx = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&velocityX_[i]), gx), drag);
+		__m128 vy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&velocityY_[i]), gy), drag);
+		__m128 vz = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&velocityZ_[i]), gz), drag);
+		_mm_storeu_ps(&velocityX_[i], vx);
+		_mm_storeu_ps(&velocityY_[i], vy);
+		_mm_storeu_ps(&velocityZ_[i], vz);
+		_mm_storeu_ps(&positionX_[i], _mm_add_ps(_mm_loadu_ps(&positionX_[i]), _mm_mul_ps(vx, dt)));
+		_mm_storeu_ps(&positionY_[i], _mm_add_ps(_mm_loadu_ps(&positionY_[i]), _mm_mul_ps(vy, dt)));
+		_mm_storeu_ps(&positionZ_[i], _mm_add_ps(_mm_loadu_ps(&positionZ_[i]), _mm_mul_ps(vz, dt)));
+		_mm_storeu_ps(&age_[i], _mm_add_ps(_mm_loadu_ps(&age_[i]), dt));
+	}
+#else
+	for (uint32_t i = begin; i < end; ++i) {
+		velocityX_[i] = (velocityX_[i] + gravityX) * dragFactor;
+		velocityY_[i] = (velocityY_[i] + gravityY) * dragFactor;
+		velocityZ_[i] = (velocityZ_[i] + gravityZ) * dragFactor;
+		positionX_[i] = positionX_[i] + velocityX_[i] * deltaTime;
+		positionY_[i] = positionY_[i] + velocityY_[i] * deltaTime;
+		positionZ_[i] = positionZ_[i] + velocityZ_[i] * deltaTime;
+		age_[i] = age_[i] + deltaTime;
+	}
+#endif
+
+	// 寿命が尽きたものを抜いて前に詰める(最初に死んだものが見つかるまではコピー不要)
+	uint32_t write = begin;
+	while (write < end && age_[write] < lifetime_[write]) {
+		++write;
+	}
+	for (uint32_t i = write; i < end; ++i) {
+		if (age_[i] < lifetime_[i]) {
+			positionX_[write] = positionX_[i];
+			positionY_[write] = positionY_[i];
+			positionZ_[write] = positionZ_[i];
+			velocityX_[write] = velocityX_[i];
+			velocityY_[write] = velocityY_[i];
+			velocityZ_[write] = velocityZ_[i];
+			age_[write] = age_[i];
+			lifetime_[write] = lifetime_[i];
+			++write;
+		}
+	}
+	return write - begin;
+}
+
+void ParticleSystem::Move(uint32_t destination, uint32_t source, uint32_t count) {
+	if (destination == source || count == 0) {
+		return;
+	}
+	for (std::vector<float>* component : { &positionX_, &positionY_, &positionZ_, &velocityX_, &velocityY_, &velocityZ_, &age_, &lifetime_ }) {
+		std::memmove(component->data() + destination, component->data() + source, sizeof(float) * count);
+	}
+}
+
+float ParticleSystem::Random() {
+	randomState_ ^= randomState_ << 13;
+	randomState_ ^= randomState_ >> 17;
+	randomState_ ^= randomState_ << 5;
+	// 上位24ビットを[0,1)にする
+	return static_cast<float>(randomState_ >> 8) * (1.0f / 16777216.0f);
+}
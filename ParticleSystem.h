@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 以下の構造体はParticles.hlslと同じレイアウトにする
+
+/// <summary>
+/// パーティクル1つ分(GPUのバッファ上の形式)
+/// </summary>
+struct ParticleData {
+	float position[3];
+	float age;
+	float velocity[3];
+	float lifetime;
+};
+
+/// <summary>
+/// エミッターの設定
+/// </summary>
+struct ParticleEmitter {
+	float position[3];
+	float positionSpread; // 発生位置のばらつき(各軸±)
+	float velocity[3];
+	float velocitySpread; // 初速のばらつき(各軸±)
+	float gravity[3];
+	float drag;           // 1秒あたりの減速率
+	float lifetimeMin;
+	float lifetimeMax;
+	float emitRate;       // 1秒あたりの発生数
+	float size;           // 描画時の大きさ
+};
+
+/// <summary>
+/// パーティクルのCPUシミュレーション。GPUが使えないときやヘッドレス実行用で、GPU版と同じ規則で動かす。
+/// 成分ごとの配列(SoA)で持ち、SIMDで4つずつ更新する。死んだパーティクルは順序を保ったまま詰める
+/// </summary>
+class ParticleSystem {
+public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="capacity">最大数</param>
+	/// <param name="seed">乱数の種</param>
+	void Initialize(uint32_t capacity, uint32_t seed = 1);
+
+	/// <summary>
+	/// 発生・移動・寿命切れの削除を行う
+	/// </summary>
+	/// <param name="emitter">エミッター</param>
+	/// <param name="deltaTime">経過秒</param>
+	/// <param name="threadCount">使用スレッド数(0なら自動)</param>
+	void Update(const ParticleEmitter& emitter, float deltaTime, uint32_t threadCount = 1);
+
+	/// <summary>
+	/// 指定数を今すぐ発生させる
+	/// </summary>
+	/// <returns>実際に発生した数(空きがなければ減る)</returns>
+	uint32_t Emit(const ParticleEmitter& emitter, uint32_t count);
+
+	/// <summary>
+	/// 生きているパーティクルをGPUと同じ形式で書き出す(アップロード用)
+	/// </summary>
+	/// <param name="outParticles">GetAliveCount()個分の書き込み先</param>
+	void CopyTo(ParticleData* outParticles) const;
+
+	ParticleData GetParticle(uint32_t index) const;
+	uint32_t GetAliveCount() const { return aliveCount_; }
+	uint32_t GetCapacity() const { return capacity_; }
+
+private: // メンバ関数
+	/// <summary>
+	/// [begin, end)を更新して生き残りを範囲の先頭に詰める
+	/// </summary>
+	/// <returns>生き残った数</returns>
+	uint32_t SimulateRange(const ParticleEmitter& emitter, float deltaTime, uint32_t begin, uint32_t end);
+
+	/// <summary>
+	/// 範囲の要素を移動する(全成分)
+	/// </summary>
+	void Move(uint32_t destination, uint32_t source, uint32_t count);
+
+	/// <summary>
+	/// [0,1)の乱数
+	/// </summary>
+	float Random();
+
+private: // メンバ変数
+	// 4の倍数に切り上げた長さで確保する
+	std::vector<float> positionX_;
+	std::vector<float> positionY_;
+	std::vector<float> positionZ_;
+	std::vector<float> velocityX_;
+	std::vector<float> velocityY_;
+	std::vector<float> velocityZ_;
+	std::vector<float> age_;
+	std::vector<float> lifetime_;
+
+	uint32_t capacity_ = 0;
+	uint32_t aliveCount_ = 0;
+	float emitAccumulator_ = 0.0f; // 端数の発生数を次のフレームへ持ち越す
+	uint32_t randomState_ = 1;
+};
@@ -0,0 +1,182 @@
+// パーティクルの発生・移動・削除と描画
+// CPU版はParticleSystem.cpp。構造体のレイアウトはParticleSystem.h・GpuParticles.hと合わせる
+
+struct ParticleData {
+	float3 position;
+	float age;
+	float3 velocity;
+	float lifetime;
+};
+
+// カウンターのバイト位置
+static const uint kDeadCountOffset = 0;
+static const uint kAliveCountOffset = 4; // 生存リストごとに4バイト
+static const uint kEmitLimitOffset = 12;  // 今フレームの発生上限(前フレーム終了時の死亡数)
+
+/*///////////////////////
+	シミュレーション
+*////////////////////////
+cbuffer SimulateConstants : register(b0) {
+	float3 emitterPosition;
+	float positionSpread;
+	float3 emitterVelocity;
+	float velocitySpread;
+	float3 gravity;
+	float drag;
+	float lifetimeMin;
+	float lifetimeMax;
+	float emitRate;
+	float emitterSize;
+	float deltaTime;
+	uint emitCount;
+	uint capacity;
+	uint seed;
+	uint aliveSlot; // 今の生存リスト。生き残りはもう一方へ書く
+};
+
+RWStructuredBuffer<ParticleData> gParticlesRW : register(u0);
+RWStructuredBuffer<uint> gDeadList : register(u1);
+RWStructuredBuffer<uint> gAliveCurrent : register(u2);
+RWStructuredBuffer<uint> gAliveNext : register(u3);
+RWByteAddressBuffer gCounters : register(u4);
+RWByteAddressBuffer gDrawArguments : register(u5);
+
+uint Hash(uint value) {
+	value ^= value >> 16;
+	value *= 0x7feb352du;
+	value ^= value >> 15;
+	value *= 0x846ca68bu;
+	value ^= value >> 16;
+	return value;
+}
+
+// [0,1)の乱数。stateは呼ぶたびに進める
+float Random(inout uint state) {
+	state = Hash(state);
+	return float(state >> 8) * (1.0f / 16777216.0f);
+}
+
+float3 RandomSigned3(inout uint state) {
+	float x = Random(state) * 2.0f - 1.0f;
+	float y = Random(state) * 2.0f - 1.0f;
+	float z = Random(state) * 2.0f - 1.0f;
+	return float3(x, y, z);
+}
+
+// 全パーティクルを死亡リストに入れる(最初のフレームだけ)
+[numthreads(64, 1, 1)]
+void CSInitialize(uint3 dispatchThreadId : SV_DispatchThreadID) {
+	uint index = dispatchThreadId.x;
+	if (index >= capacity) {
+		return;
+	}
+	gDeadList[index] = index;
+	if (index == 0) {
+		gCounters.Store4(kDeadCountOffset, uint4(capacity, 0, 0, capacity));
+	}
+}
+
+[numthreads(64, 1, 1)]
+void CSEmit(uint3 dispatchThreadId : SV_DispatchThreadID) {
+	// 空きより多くは発生させない(死亡数はこのディスパッチ中は減る一方なので、開始時の値で判定する)
+	if (dispatchThreadId.x >= min(emitCount, gCounters.Load(kEmitLimitOffset))) {
+		return;
+	}
+	uint deadCount;
+	gCounters.InterlockedAdd(kDeadCountOffset, 0xffffffffu, deadCount);
+	uint index = gDeadList[deadCount - 1];
+
+	uint state = Hash(dispatchThreadId.x ^ Hash(seed));
+	ParticleData particle;
+	particle.position = emitterPosition + positionSpread * RandomSigned3(state);
+	particle.velocity = emitterVelocity + velocitySpread * RandomSigned3(state);
+	particle.age = 0.0f;
+	particle.lifetime = lerp(lifetimeMin, lifetimeMax, Random(state));
+	gParticlesRW[index] = particle;
+
+	uint aliveIndex;
+	gCounters.InterlockedAdd(kAliveCountOffset + aliveSlot * 4, 1, aliveIndex);
+	gAliveCurrent[aliveIndex] = index;
+}
+
+// 生存リストの数は分からないので最大数分ディスパッチして、範囲外は何もしない
+[numthreads(64, 1, 1)]
+void CSSimulate(uint3 dispatchThreadId : SV_DispatchThreadID) {
+	if (dispatchThreadId.x >= gCounters.Load(kAliveCountOffset + aliveSlot * 4)) {
+		return;
+	}
+	uint index = gAliveCurrent[dispatchThreadId.x];
+	ParticleData particle = gParticlesRW[index];
+
+	// CPU版と同じ順序で計算する
+	float dragFactor = max(1.0f - drag * deltaTime, 0.0f);
+	particle.velocity = (particle.velocity + gravity * deltaTime) * dragFactor;
+	particle.position = particle.position + particle.velocity * deltaTime;
+	particle.age = particle.age + deltaTime;
+	gParticlesRW[index] = particle;
+
+	if (particle.age < particle.lifetime) {
+		uint aliveIndex;
+		gCounters.InterlockedAdd(kAliveCountOffset + (aliveSlot ^ 1) * 4, 1, aliveIndex);
+		gAliveNext[aliveIndex] = index;
+	} else {
+		uint deadIndex;
+		gCounters.InterlockedAdd(kDeadCountOffset, 1, deadIndex);
+		gDeadList[deadIndex] = index;
+	}
+}
+
+// 描画引数を書き、使い終わった生存リストを空にする
+[numthreads(1, 1, 1)]
+void CSFinalize() {
+	uint aliveCount = gCounters.Load(kAliveCountOffset + (aliveSlot ^ 1) * 4);
+	// 頂点数・インスタンス数・開始頂点・開始インスタンス
+	gDrawArguments.Store4(0, uint4(6, aliveCount, 0, 0));
+	gCounters.Store(kAliveCountOffset + aliveSlot * 4, 0);
+	gCounters.Store(kEmitLimitOffset, gCounters.Load(kDeadCountOffset));
+}
+
+/*///////////////////////
+	描画
+*////////////////////////
+cbuffer DrawConstants : register(b0) {
+	row_major float4x4 viewProjection;
+	float3 cameraRight;
+	float particleSize;
+	float3 cameraUp;
+	float padding;
+};
+
+StructuredBuffer<ParticleData> gParticles : register(t0);
+StructuredBuffer<uint> gAliveList : register(t1);
+
+struct VertexShaderOutput {
+	float4 position : SV_POSITION;
+	float2 texcoord : TEXCOORD0;
+	float4 color : COLOR0;
+};
+
+// 頂点バッファを使わず、頂点IDから四角形の角を、インスタンスIDから生存リストのパーティクルを引く
+VertexShaderOutput VSMain(uint vertexId : SV_VertexID, uint instanceId : SV_InstanceID) {
+	static const float2 kCorners[6] = {
+		float2(-1.0f, -1.0f), float2(-1.0f, 1.0f), float2(1.0f, -1.0f),
+		float2(1.0f, -1.0f), float2(-1.0f, 1.0f), float2(1.0f, 1.0f),
+	};
+	ParticleData particle = gParticles[gAliveList[instanceId]];
+	float2 corner = kCorners[vertexId];
+	float3 worldPosition = particle.position + (cameraRight * corner.x + cameraUp * corner.y) * particleSize;
+
+	VertexShaderOutput output;
+	output.position = mul(float4(worldPosition, 1.0f), viewProjection);
+	output.texcoord = corner;
+	// 寿命に合わせて黄色から赤へ変わりながら消える
+	float t = saturate(particle.age / particle.lifetime);
+	output.color = lerp(float4(1.0f, 0.8f, 0.3f, 1.0f), float4(0.8f, 0.2f, 0.1f, 0.0f), t);
+	return output;
+}
+
+float4 PSMain(VertexShaderOutput input) : SV_TARGET {
+	// 中心から縁へなめらかに薄くする
+	float falloff = saturate(1.0f - dot(input.texcoord, input.texcoord));
+	return float4(input.color.rgb, input.color.a * falloff * falloff);
+}
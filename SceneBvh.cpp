@@ -0,0 +1,792 @@
+#include "SceneBvh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cfloat>
+#include <thread>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SCENE_BVH_USE_SSE2
+#endif
+
+namespace {
+
+// SAHのビンの数
+const uint32_t kBinCount = 16;
+// ノード1つをたどるコスト(プリミティブ1つの判定を1とする)
+const float kTraversalCost = 1.0f;
+// これより深くなったらSAHをやめて半分に分ける(走査用のスタックがあふれないように)
+const uint32_t kMaxSahDepth = 48;
+// 走査用のスタックの大きさ
+const uint32_t kStackSize = 256;
+// 1スレッドが一度に取るレイの数
+const uint32_t kRayBlockSize = 64;
+
+// 何も含まないAABB(どの判定にも当たらず、合併しても相手を変えない)
+const BvhBounds kEmptyBounds = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+
+// SIMDの_mm_max_ps・_mm_min_psと同じ規則(NaNのときは2つ目を返す)
+inline float Max(float a, float b) { return a > b ? a : b; }
+inline float Min(float a, float b) { return a < b ? a : b; }
+
+void Grow(BvhBounds& bounds, const BvhBounds& other) {
+	for (int axis = 0; axis < 3; ++axis) {
+		bounds.min[axis] = std::min(bounds.min[axis], other.min[axis]);
+		bounds.max[axis] = std::max(bounds.max[axis], other.max[axis]);
+	}
+}
+
+void GrowPoint(BvhBounds& bounds, const float point[3]) {
+	for (int axis = 0; axis < 3; ++axis) {
+		bounds.min[axis] = std::min(bounds.min[axis], point[axis]);
+		bounds.max[axis] = std::max(bounds.max[axis], point[axis]);
+	}
+}
+
+// 表面積の半分(SAHでは比だけを使う)
+float HalfArea(const BvhBounds& bounds) {
+	const float x = std::max(bounds.max[0] - bounds.min[0], 0.0f);
+	const float y = std::max(bounds.max[1] - bounds.min[1], 0.0f);
+	const float z = std::max(bounds.max[2] - bounds.min[2], 0.0f);
+	return x * y + y * z + z * x;
+}
+
+void SetSlot(SceneBvh::Node& node, uint32_t slot, const BvhBounds& bounds) {
+	node.minX[slot] = bounds.min[0];
+	node.minY[slot] = bounds.min[1];
+	node.minZ[slot] = bounds.min[2];
+	node.maxX[slot] = bounds.max[0];
+	node.maxY[slot] = bounds.max[1];
+	node.maxZ[slot] = bounds.max[2];
+}
+
+BvhBounds GetNodeBounds(const SceneBvh::Node& node) {
+	BvhBounds bounds = kEmptyBounds;
+	for (uint32_t slot = 0; slot < 4; ++slot) {
+		const BvhBounds slotBounds = { { node.minX[slot], node.minY[slot], node.minZ[slot] }, { node.maxX[slot], node.maxY[slot], node.maxZ[slot] } };
+		Grow(bounds, slotBounds);
+	}
+	return bounds;
+}
+
+void InitializeNode(SceneBvh::Node& node) {
+	for (uint32_t slot = 0; slot < 4; ++slot) {
+		SetSlot(node, slot, kEmptyBounds);
+		node.children[slot] = SceneBvh::kInvalidIndex;
+		node.counts[slot] = 0;
+	}
+}
+
+// 方向の逆数と、軸ごとに手前側になる面を先に決めたレイ
+struct PreparedRay {
+	float origin[3];
+	float inverse[3];
+	bool negative[3];
+	float maxDistance;
+
+	explicit PreparedRay(const BvhRay& ray) {
+		for (int axis = 0; axis < 3; ++axis) {
+			origin[axis] = ray.origin[axis];
+			inverse[axis] = 1.0f / ray.direction[axis];
+			negative[axis] = inverse[axis] < 0.0f;
+		}
+		maxDistance = ray.maxDistance;
+	}
+};
+
+// レイとAABBのスラブ判定。SIMD版と同じ順序で計算する
+bool IntersectSlabs(const PreparedRay& ray, const BvhBounds& bounds, float limit, float& outDistance) {
+	float nearDistance[3];
+	float farDistance[3];
+	for (int axis = 0; axis < 3; ++axis) {
+		const float nearPlane = ray.negative[axis] ? bounds.max[axis] : bounds.min[axis];
+		const float farPlane = ray.negative[axis] ? bounds.min[axis] : bounds.max[axis];
+		nearDistance[axis] = (nearPlane - ray.origin[axis]) * ray.inverse[axis];
+		farDistance[axis] = (farPlane - ray.origin[axis]) * ray.inverse[axis];
+	}
+	// 軸と平行なレイが面の上から出るとNaNになるので、その軸は制限なしとして扱う(NaNは1つ目に置くと捨てられる)
+	const float tNear = Max(nearDistance[2], Max(nearDistance[1], Max(nearDistance[0], 0.0f)));
+	const float tFar = Min(farDistance[2], Min(farDistance[1], Min(farDistance[0], limit)));
+	outDistance = tNear;
+	return tNear <= tFar;
+}
+
+// 4つの子のうちレイが当たるものをビットで返す
+uint32_t IntersectNode(const SceneBvh::Node& node, const PreparedRay& ray, float limit, float outDistances[4]) {
+	const float* nearX = ray.negative[0] ? node.maxX : node.minX;
+	const float* nearY = ray.negative[1] ? node.maxY : node.minY;
+	const float* nearZ = ray.negative[2] ? node.maxZ : node.minZ;
+	const float* farX = ray.negative[0] ? node.minX : node.maxX;
+	const float* farY = ray.negative[1] ? node.minY : node.maxY;
+	const float* farZ = ray.negative[2] ? node.minZ : node.maxZ;
+#ifdef SCENE_BVH_USE_SSE2
+	const __m128 originX = _mm_set1_ps(ray.origin[0]);
+	const __m128 originY = _mm_set1_ps(ray.origin[1]);
+	const __m128 originZ = _mm_set1_ps(ray.origin[2]);
+	const __m128 inverseX = _mm_set1_ps(ray.inverse[0]);
+	const __m128 inverseY = _mm_set1_ps(ray.inverse[1]);
+	const __m128 inverseZ = _mm_set1_ps(ray.inverse[2]);
+	__m128 tNear = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearX), originX), inverseX), _mm_setzero_ps());
+	tNear = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearY), originY), inverseY), tNear);
+	tNear = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearZ), originZ), inverseZ), tNear);
+	__m128 tFar = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(farX), originX), inverseX), _mm_set1_ps(limit));
+	tFar = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(farY), originY), inverseY), tFar);
+	tFar = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(farZ), originZ), inverseZ), tFar);
+	_mm_storeu_ps(outDistances, tNear);
+	return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(tNear, tFar)));
+#else
+	uint32_t mask = 0;
+	for (uint32_t slot = 0; slot < 4; ++slot) {
+		float tNear = Max((nearX[slot] - ray.origin[0]) * ray.inverse[0], 0.0f);
+		tNear = Max((nearY[slot] - ray.origin[1]) * ray.inverse[1], tNear);
+		tNear = Max((nearZ[slot] - ray.origin[2]) * ray.inverse[2], tNear);
+		float tFar = Min((farX[slot] - ray.origin[0]) * ray.inverse[0], limit);
+		tFar = Min((farY[slot] - ray.origin[1]) * ray.inverse[1], tFar);
+		tFar = Min((farZ[slot] - ray.origin[2]) * ray.inverse[2], tFar);
+		outDistances[slot] = tNear;
+		mask |= (tNear <= tFar ? 1u : 0u) << slot;
+	}
+	return mask;
+#endif
+}
+
+// 4つの子のうちAABBと重なるものをビットで返す
+uint32_t OverlapNode(const SceneBvh::Node& node, const BvhBounds& bounds) {
+#ifdef SCENE_BVH_USE_SSE2
+	__m128 overlap = _mm_and_ps(
+		_mm_cmple_ps(_mm_load_ps(node.minX), _mm_set1_ps(bounds.max[0])),
+		_mm_cmpge_ps(_mm_load_ps(node.maxX), _mm_set1_ps(bounds.min[0])));
+	overlap = _mm_and_ps(overlap, _mm_and_ps(
+		_mm_cmple_ps(_mm_load_ps(node.minY), _mm_set1_ps(bounds.max[1])),
+		_mm_cmpge_ps(_mm_load_ps(node.maxY), _mm_set1_ps(bounds.min[1]))));
+	overlap = _mm_and_ps(overlap, _mm_and_ps(
+		_mm_cmple_ps(_mm_load_ps(node.minZ), _mm_set1_ps(bounds.max[2])),
+		_mm_cmpge_ps(_mm_load_ps(node.maxZ), _mm_set1_ps(bounds.min[2]))));
+	return static_cast<uint32_t>(_mm_movemask_ps(overlap));
+#else
+	uint32_t mask = 0;
+	for (uint32_t slot = 0; slot < 4; ++slot) {
+		const bool overlap =
+			node.minX[slot] <= bounds.max[0] && node.maxX[slot] >= bounds.min[0] &&
+			node.minY[slot] <= bounds.max[1] && node.maxY[slot] >= bounds.min[1] &&
+			node.minZ[slot] <= bounds.max[2] && node.maxZ[slot] >= bounds.min[2];
+		mask |= (overlap ? 1u : 0u) << slot;
+	}
+	return mask;
+#endif
+}
+
+// 4つの子のうち視錐台と重なるものをビットで返す。outInsideには視錐台に完全に入っているものを返す
+uint32_t OverlapNodeFrustum(const SceneBvh::Node& node, const float planes[6][4], uint32_t& outInside) {
+#ifdef SCENE_BVH_USE_SSE2
+	__m128 outside = _mm_setzero_ps();
+	__m128 partial = _mm_setzero_ps();
+	for (int i = 0; i < 6; ++i) {
+		const float* plane = planes[i];
+		// 法線の向きに一番進んだ頂点(p)と一番戻った頂点(n)
+		const float* pX = plane[0] >= 0.0f ? node.maxX : node.minX;
+		const float* pY = plane[1] >= 0.0f ? node.maxY : node.minY;
+		const float* pZ = plane[2] >= 0.0f ? node.maxZ : node.minZ;
+		const float* nX = plane[0] >= 0.0f ? node.minX : node.maxX;
+		const float* nY = plane[1] >= 0.0f ? node.minY : node.maxY;
+		const float* nZ = plane[2] >= 0.0f ? node.minZ : node.maxZ;
+		const __m128 normalX = _mm_set1_ps(plane[0]);
+		const __m128 normalY = _mm_set1_ps(plane[1]);
+		const __m128 normalZ = _mm_set1_ps(plane[2]);
+		const __m128 distance = _mm_set1_ps(plane[3]);
+		const __m128 pDot = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(normalX, _mm_load_ps(pX)), _mm_mul_ps(normalY, _mm_load_ps(pY))), _mm_mul_ps(normalZ, _mm_load_ps(pZ))), distance);
+		const __m128 nDot = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(normalX, _mm_load_ps(nX)), _mm_mul_ps(normalY, _mm_load_ps(nY))), _mm_mul_ps(normalZ, _mm_load_ps(nZ))), distance);
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(pDot, _mm_setzero_ps()));
+		partial = _mm_or_ps(partial, _mm_cmplt_ps(nDot, _mm_setzero_ps()));
+	}
+	const uint32_t outsideMask = static_cast<uint32_t>(_mm_movemask_ps(outside));
+	const uint32_t partialMask = static_cast<uint32_t>(_mm_movemask_ps(partial));
+#else
+	uint32_t outsideMask = 0;
+	uint32_t partialMask = 0;
+	for (uint32_t slot = 0; slot < 4; ++slot) {
+		for (int i = 0; i < 6; ++i) {
+			const float* plane = planes[i];
+			const float pX = plane[0] >= 0.0f ? node.maxX[slot] : node.minX[slot];
+			const float pY = plane[1] >= 0.0f ? node.maxY[slot] : node.minY[slot];
+			const float pZ = plane[2] >= 0.0f ? node.maxZ[slot] : node.minZ[slot];
+			const float nX = plane[0] >= 0.0f ? node.minX[slot] : node.maxX[slot];
+			const float nY = plane[1] >= 0.0f ? node.minY[slot] : node.maxY[slot];
+			const float nZ = plane[2] >= 0.0f ? node.minZ[slot] : node.maxZ[slot];
+			if (plane[0] * pX + plane[1] * pY + plane[2] * pZ + plane[3] < 0.0f) {
+				outsideMask |= 1u << slot;
+			}
+			if (plane[0] * nX + plane[1] * nY + plane[2] * nZ + plane[3] < 0.0f) {
+				partialMask |= 1u << slot;
+			}
+		}
+	}
+#endif
+	const uint32_t overlapMask = ~outsideMask & 0xf;
+	outInside = overlapMask & ~partialMask;
+	return overlapMask;
+}
+
+// function()をworkerCount個のスレッドで同時に実行する(1つは呼び出し元のスレッド)
+template<class Function>
+void RunWorkers(uint32_t workerCount, Function function) {
+	std::vector<std::thread> workers;
+	workers.reserve(workerCount > 0 ? workerCount - 1 : 0);
+	for (uint32_t i = 1; i < workerCount; ++i) {
+		workers.emplace_back([&, i]() { function(i); });
+	}
+	function(0u);
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+// [0, count)をthreadCount個の連続した範囲に分けて処理する
+template<class Function>
+void ParallelRanges(uint32_t count, uint32_t threadCount, Function function) {
+	RunWorkers(threadCount, [&](uint32_t thread) {
+		function(thread, static_cast<uint32_t>(static_cast<uint64_t>(count) * thread / threadCount),
+			static_cast<uint32_t>(static_cast<uint64_t>(count) * (thread + 1) / threadCount));
+	});
+}
+
+uint32_t ResolveThreadCount(uint32_t threadCount) {
+	return threadCount == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threadCount;
+}
+
+} // namespace
+
+/*///////////////////////
+	構築
+*////////////////////////
+// 構築中のプリミティブ。分割のたびに並べ替えて、どの段でも連続したメモリを読むようにする
+struct SceneBvh::BuildPrimitive {
+	BvhBounds bounds;
+	float centroid[3];
+	uint32_t index;
+};
+
+struct SceneBvh::BuildContext {
+	std::vector<BuildPrimitive> primitives;
+	std::vector<BuildNode> nodes;
+	std::atomic<uint32_t> nodeCount{ 0 };
+	uint32_t spawnDepth = 0; // これより浅いところでは右の子を別スレッドで作る
+};
+
+void SceneBvh::Build(const BvhBounds* bounds, uint32_t count, uint32_t threadCount) {
+	nodes_.clear();
+	primitiveIndices_.resize(count);
+	primitiveBounds_.resize(count);
+	if (count == 0) {
+		return;
+	}
+
+	BuildContext context;
+	context.primitives.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		BuildPrimitive& primitive = context.primitives[i];
+		primitive.bounds = bounds[i];
+		for (int axis = 0; axis < 3; ++axis) {
+			primitive.centroid[axis] = (bounds[i].min[axis] + bounds[i].max[axis]) * 0.5f;
+		}
+		primitive.index = i;
+	}
+	// 葉に1つ以上入るので二分木のノードは2n-1個を超えない
+	context.nodes.resize(static_cast<size_t>(count) * 2 - 1);
+	threadCount = ResolveThreadCount(threadCount);
+	while ((1u << context.spawnDepth) < threadCount) {
+		++context.spawnDepth;
+	}
+	const uint32_t root = BuildRange(context, 0, count, 0);
+
+	nodes_.reserve(context.nodeCount / 2 + 1);
+	Collapse(context.nodes, root);
+	for (uint32_t i = 0; i < count; ++i) {
+		primitiveIndices_[i] = context.primitives[i].index;
+		primitiveBounds_[i] = context.primitives[i].bounds;
+	}
+}
+
+uint32_t SceneBvh::BuildRange(BuildContext& context, uint32_t first, uint32_t count, uint32_t depth) {
+	const uint32_t nodeIndex = context.nodeCount.fetch_add(1);
+	BuildPrimitive* primitives = context.primitives.data() + first;
+
+	BvhBounds bounds = kEmptyBounds;
+	BvhBounds centroidBounds = kEmptyBounds;
+	for (uint32_t i = 0; i < count; ++i) {
+		Grow(bounds, primitives[i].bounds);
+		GrowPoint(centroidBounds, primitives[i].centroid);
+	}
+	BuildNode node = { bounds, kInvalidIndex, kInvalidIndex, first, count };
+
+	// ビンに分けて、分割位置ごとのSAHコストを求める
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	uint32_t bestSplit = 0;
+	// 小さいノードではビンを減らす(数が少ないと空のビンを回るだけになる)
+	const uint32_t binCount = std::min(kBinCount, std::max(count, 2u));
+	if (count > 1 && depth < kMaxSahDepth) {
+		for (int axis = 0; axis < 3; ++axis) {
+			const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+			if (!(extent > 0.0f)) {
+				continue;
+			}
+			const float scale = static_cast<float>(binCount) / extent;
+			BvhBounds binBounds[kBinCount];
+			uint32_t binCounts[kBinCount] = {};
+			std::fill(binBounds, binBounds + binCount, kEmptyBounds);
+			for (uint32_t i = 0; i < count; ++i) {
+				const uint32_t bin = std::min(binCount - 1, static_cast<uint32_t>((primitives[i].centroid[axis] - centroidBounds.min[axis]) * scale));
+				Grow(binBounds[bin], primitives[i].bounds);
+				++binCounts[bin];
+			}
+			// 左から累積した面積と個数
+			float leftAreas[kBinCount];
+			uint32_t leftCounts[kBinCount];
+			BvhBounds leftBounds = kEmptyBounds;
+			uint32_t leftCount = 0;
+			for (uint32_t bin = 0; bin < binCount - 1; ++bin) {
+				Grow(leftBounds, binBounds[bin]);
+				leftCount += binCounts[bin];
+				leftAreas[bin + 1] = HalfArea(leftBounds);
+				leftCounts[bin + 1] = leftCount;
+			}
+			BvhBounds rightBounds = kEmptyBounds;
+			uint32_t rightCount = 0;
+			for (uint32_t split = binCount - 1; split > 0; --split) {
+				Grow(rightBounds, binBounds[split]);
+				rightCount += binCounts[split];
+				if (leftCounts[split] == 0 || rightCount == 0) {
+					continue;
+				}
+				const float cost = leftAreas[split] * static_cast<float>(leftCounts[split]) + HalfArea(rightBounds) * static_cast<float>(rightCount);
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = split;
+				}
+			}
+		}
+	}
+
+	// 葉にした方が安ければ葉にする(面積で割らずに比べる)
+	const float area = HalfArea(bounds);
+	if (count == 1 || (count <= kMaxLeafSize && (bestAxis < 0 || static_cast<float>(count) * area <= kTraversalCost * area + bestCost))) {
+		context.nodes[nodeIndex] = node;
+		return nodeIndex;
+	}
+
+	// 中心がすべて同じ・深すぎるときは今の並びのまま半分に分ける
+	uint32_t leftCount = count / 2;
+	if (bestAxis >= 0) {
+		const float minimum = centroidBounds.min[bestAxis];
+		const float scale = static_cast<float>(binCount) / (centroidBounds.max[bestAxis] - minimum);
+		BuildPrimitive* middle = std::partition(primitives, primitives + count, [&](const BuildPrimitive& primitive) {
+			return std::min(binCount - 1, static_cast<uint32_t>((primitive.centroid[bestAxis] - minimum) * scale)) < bestSplit;
+		});
+		leftCount = static_cast<uint32_t>(middle - primitives);
+	}
+
+	if (depth < context.spawnDepth) {
+		std::thread worker([&]() {
+			node.right = BuildRange(context, first + leftCount, count - leftCount, depth + 1);
+		});
+		node.left = BuildRange(context, first, leftCount, depth + 1);
+		worker.join();
+	} else {
+		node.left = BuildRange(context, first, leftCount, depth + 1);
+		node.right = BuildRange(context, first + leftCount, count - leftCount, depth + 1);
+	}
+	node.count = 0;
+	context.nodes[nodeIndex] = node;
+	return nodeIndex;
+}
+
+uint32_t SceneBvh::Collapse(const std::vector<BuildNode>& buildNodes, uint32_t buildIndex) {
+	const uint32_t nodeIndex = static_cast<uint32_t>(nodes_.size());
+	nodes_.emplace_back();
+	InitializeNode(nodes_[nodeIndex]);
+
+	// 子を最大4つ集める。面積の大きい内部ノードから孫に開き、並びはプリミティブの順のまま保つ
+	uint32_t slots[4];
+	uint32_t slotCount = 0;
+	const BuildNode& buildNode = buildNodes[buildIndex];
+	if (buildNode.count > 0) {
+		slots[slotCount++] = buildIndex;
+	} else {
+		slots[slotCount++] = buildNode.left;
+		slots[slotCount++] = buildNode.right;
+		while (slotCount < 4) {
+			int expand = -1;
+			float largestArea = -1.0f;
+			for (uint32_t i = 0; i < slotCount; ++i) {
+				const BuildNode& child = buildNodes[slots[i]];
+				if (child.count == 0 && HalfArea(child.bounds) > largestArea) {
+					largestArea = HalfArea(child.bounds);
+					expand = static_cast<int>(i);
+				}
+			}
+			if (expand < 0) {
+				break;
+			}
+			const BuildNode& child = buildNodes[slots[expand]];
+			for (uint32_t i = slotCount; i > static_cast<uint32_t>(expand) + 1; --i) {
+				slots[i] = slots[i - 1];
+			}
+			slots[expand] = child.left;
+			slots[expand + 1] = child.right;
+			++slotCount;
+		}
+	}
+
+	for (uint32_t slot = 0; slot < slotCount; ++slot) {
+		const BuildNode& child = buildNodes[slots[slot]];
+		SetSlot(nodes_[nodeIndex], slot, child.bounds);
+		if (child.count > 0) {
+			nodes_[nodeIndex].children[slot] = child.first;
+			nodes_[nodeIndex].counts[slot] = child.count;
+		} else {
+			// 再帰中にnodes_が伸びるので参照を持ち越さない
+			const uint32_t childIndex = Collapse(buildNodes, slots[slot]);
+			nodes_[nodeIndex].children[slot] = childIndex;
+		}
+	}
+	return nodeIndex;
+}
+
+/*///////////////////////
+	リフィット
+*////////////////////////
+void SceneBvh::Refit(const BvhBounds* bounds, uint32_t threadCount) {
+	if (nodes_.empty()) {
+		return;
+	}
+	threadCount = ResolveThreadCount(threadCount);
+
+	// ノードは行きがけ順なので、根の子の部分木はそれぞれ連続した範囲になる
+	uint32_t rangeBegins[4];
+	uint32_t rangeCount = 0;
+	const Node& root = nodes_[0];
+	for (uint32_t slot = 0; slot < 4; ++slot) {
+		if (root.children[slot] != kInvalidIndex && root.counts[slot] == 0) {
+			rangeBegins[rangeCount++] = root.children[slot];
+		}
+	}
+	const uint32_t nodeCount = static_cast<uint32_t>(nodes_.size());
+	if (threadCount <= 1 || rangeCount < 2) {
+		RefitNodes(bounds, 1, nodeCount);
+	} else {
+		std::atomic<uint32_t> nextRange = 0;
+		std::vector<std::thread> workers;
+		const uint32_t workerCount = std::min(threadCount, rangeCount);
+		workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; ++i) {
+			workers.emplace_back([&]() {
+				for (uint32_t range = nextRange.fetch_add(1); range < rangeCount; range = nextRange.fetch_add(1)) {
+					const uint32_t end = range + 1 < rangeCount ? rangeBegins[range + 1] : nodeCount;
+					RefitNodes(bounds, rangeBegins[range], end);
+				}
+			});
+		}
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}
+	RefitNodes(bounds, 0, 1);
+}
+
+void SceneBvh::RefitNodes(const BvhBounds* bounds, uint32_t begin, uint32_t end) {
+	for (uint32_t index = end; index-- > begin;) {
+		Node& node = nodes_[index];
+		for (uint32_t slot = 0; slot < 4; ++slot) {
+			if (node.children[slot] == kInvalidIndex) {
+				continue;
+			}
+			BvhBounds slotBounds = kEmptyBounds;
+			if (node.counts[slot] > 0) {
+				// 並べ替え後の順に写しながら合併する
+				const uint32_t first = node.children[slot];
+				for (uint32_t i = first; i < first + node.counts[slot]; ++i) {
+					primitiveBounds_[i] = bounds[primitiveIndices_[i]];
+					Grow(slotBounds, primitiveBounds_[i]);
+				}
+			} else {
+				// 空きの子は反転したAABBなので合併しても影響しない
+				slotBounds = GetNodeBounds(nodes_[node.children[slot]]);
+			}
+			SetSlot(node, slot, slotBounds);
+		}
+	}
+}
+
+/*///////////////////////
+	レイ
+*////////////////////////
+template<bool anyHit>
+bool SceneBvh::Traverse(const BvhRay& ray, BvhHit& outHit) const {
+	outHit = { kInvalidIndex, ray.maxDistance };
+	if (nodes_.empty()) {
+		return false;
+	}
+	const PreparedRay prepared(ray);
+
+	struct StackEntry {
+		uint32_t node;
+		float distance;
+	};
+	StackEntry stack[kStackSize];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, 0.0f };
+	while (stackSize > 0) {
+		const StackEntry entry = stack[--stackSize];
+		// 積んだ後により近い当たりが見つかっていたら飛ばす(同じ距離は番号で決めるので残す)
+		if (entry.distance > outHit.distance) {
+			continue;
+		}
+		const Node& node = nodes_[entry.node];
+		float distances[4];
+		uint32_t mask = IntersectNode(node, prepared, outHit.distance, distances);
+
+		// 内部ノードは遠い順に積み、近いものから取り出す
+		StackEntry children[4];
+		uint32_t childCount = 0;
+		for (uint32_t slot = 0; mask != 0; ++slot, mask >>= 1) {
+			if ((mask & 1) == 0 || node.children[slot] == kInvalidIndex) {
+				continue;
+			}
+			if (node.counts[slot] == 0) {
+				uint32_t i = childCount++;
+				for (; i > 0 && children[i - 1].distance < distances[slot]; --i) {
+					children[i] = children[i - 1];
+				}
+				children[i] = { node.children[slot], distances[slot] };
+				continue;
+			}
+			const uint32_t first = node.children[slot];
+			for (uint32_t i = first; i < first + node.counts[slot]; ++i) {
+				float distance;
+				if (!IntersectSlabs(prepared, primitiveBounds_[i], outHit.distance, distance)) {
+					continue;
+				}
+				if (anyHit) {
+					outHit = { primitiveIndices_[i], distance };
+					return true;
+				}
+				if (distance < outHit.distance || outHit.primitive == kInvalidIndex || primitiveIndices_[i] < outHit.primitive) {
+					outHit = { primitiveIndices_[i], distance };
+				}
+			}
+		}
+		assert(stackSize + childCount <= kStackSize);
+		for (uint32_t i = 0; i < childCount; ++i) {
+			stack[stackSize++] = children[i];
+		}
+	}
+	return outHit.primitive != kInvalidIndex;
+}
+
+bool SceneBvh::Intersect(const BvhRay& ray, BvhHit& outHit) const {
+	return Traverse<false>(ray, outHit);
+}
+
+bool SceneBvh::IsOccluded(const BvhRay& ray) const {
+	BvhHit hit;
+	return Traverse<true>(ray, hit);
+}
+
+void SceneBvh::IntersectBatch(const BvhRay* rays, uint32_t count, BvhHit* outHits, uint32_t threadCount) const {
+	// レイごとに走査の長さが大きく違うので、空いたスレッドから次のブロックを取る
+	const uint32_t blockCount = (count + kRayBlockSize - 1) / kRayBlockSize;
+	std::atomic<uint32_t> nextBlock = 0;
+	RunWorkers(std::max(1u, std::min(ResolveThreadCount(threadCount), blockCount)), [&](uint32_t) {
+		for (uint32_t block = nextBlock.fetch_add(1); block < blockCount; block = nextBlock.fetch_add(1)) {
+			const uint32_t end = std::min(count, (block + 1) * kRayBlockSize);
+			for (uint32_t i = block * kRayBlockSize; i < end; ++i) {
+				Traverse<false>(rays[i], outHits[i]);
+			}
+		}
+	});
+}
+
+void SceneBvh::IsOccludedBatch(const BvhRay* rays, uint32_t count, uint8_t* outOccluded, uint32_t threadCount) const {
+	const uint32_t blockCount = (count + kRayBlockSize - 1) / kRayBlockSize;
+	std::atomic<uint32_t> nextBlock = 0;
+	RunWorkers(std::max(1u, std::min(ResolveThreadCount(threadCount), blockCount)), [&](uint32_t) {
+		for (uint32_t block = nextBlock.fetch_add(1); block < blockCount; block = nextBlock.fetch_add(1)) {
+			const uint32_t end = std::min(count, (block + 1) * kRayBlockSize);
+			for (uint32_t i = block * kRayBlockSize; i < end; ++i) {
+				BvhHit hit;
+				outOccluded[i] = Traverse<true>(rays[i], hit) ? 1 : 0;
+			}
+		}
+	});
+}
+
+/*///////////////////////
+	範囲クエリ
+*////////////////////////
+uint32_t SceneBvh::QueryBounds(const BvhBounds& bounds, std::vector<uint32_t>& outPrimitives) const {
+	if (nodes_.empty()) {
+		return 0;
+	}
+	const size_t startSize = outPrimitives.size();
+	uint32_t stack[kStackSize];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const Node& node = nodes_[stack[--stackSize]];
+		uint32_t mask = OverlapNode(node, bounds);
+		for (uint32_t slot = 0; mask != 0; ++slot, mask >>= 1) {
+			if ((mask & 1) == 0 || node.children[slot] == kInvalidIndex) {
+				continue;
+			}
+			if (node.counts[slot] == 0) {
+				assert(stackSize < kStackSize);
+				stack[stackSize++] = node.children[slot];
+				continue;
+			}
+			const uint32_t first = node.children[slot];
+			for (uint32_t i = first; i < first + node.counts[slot]; ++i) {
+				if (OverlapBounds(primitiveBounds_[i], bounds)) {
+					outPrimitives.push_back(primitiveIndices_[i]);
+				}
+			}
+		}
+	}
+	return static_cast<uint32_t>(outPrimitives.size() - startSize);
+}
+
+uint32_t SceneBvh::QueryFrustum(const float planes[6][4], std::vector<uint32_t>& outPrimitives) const {
+	if (nodes_.empty()) {
+		return 0;
+	}
+	const size_t startSize = outPrimitives.size();
+	uint32_t stack[kStackSize];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const Node& node = nodes_[stack[--stackSize]];
+		uint32_t inside;
+		uint32_t mask = OverlapNodeFrustum(node, planes, inside);
+		for (uint32_t slot = 0; mask != 0; ++slot, mask >>= 1, inside >>= 1) {
+			if ((mask & 1) == 0 || node.children[slot] == kInvalidIndex) {
+				continue;
+			}
+			if (node.counts[slot] == 0) {
+				if (inside & 1) {
+					// 完全に内側なら中身は判定せずにすべて取る(中身のAABBも必ず内側と判定される)
+					AppendSubtree(node.children[slot], outPrimitives);
+				} else {
+					assert(stackSize < kStackSize);
+					stack[stackSize++] = node.children[slot];
+				}
+				continue;
+			}
+			const uint32_t first = node.children[slot];
+			for (uint32_t i = first; i < first + node.counts[slot]; ++i) {
+				if ((inside & 1) || OverlapFrustum(planes, primitiveBounds_[i])) {
+					outPrimitives.push_back(primitiveIndices_[i]);
+				}
+			}
+		}
+	}
+	return static_cast<uint32_t>(outPrimitives.size() - startSize);
+}
+
+void SceneBvh::AppendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& outPrimitives) const {
+	uint32_t stack[kStackSize];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = nodeIndex;
+	while (stackSize > 0) {
+		const Node& node = nodes_[stack[--stackSize]];
+		for (uint32_t slot = 0; slot < 4; ++slot) {
+			if (node.children[slot] == kInvalidIndex) {
+				continue;
+			}
+			if (node.counts[slot] == 0) {
+				assert(stackSize < kStackSize);
+				stack[stackSize++] = node.children[slot];
+				continue;
+			}
+			const uint32_t first = node.children[slot];
+			outPrimitives.insert(outPrimitives.end(), primitiveIndices_.begin() + first, primitiveIndices_.begin() + first + node.counts[slot]);
+		}
+	}
+}
+
+void SceneBvh::QueryBoundsBatch(const BvhBounds* bounds, uint32_t count, std::vector<BvhQueryRange>& outRanges,
+	std::vector<uint32_t>& outPrimitives, uint32_t threadCount) const {
+	threadCount = std::max(1u, std::min(ResolveThreadCount(threadCount), count));
+	// スレッドごとに書き出してから、クエリ順に連結する
+	std::vector<std::vector<uint32_t>> threadPrimitives(threadCount);
+	outRanges.resize(count);
+	ParallelRanges(count, threadCount, [&](uint32_t thread, uint32_t begin, uint32_t end) {
+		std::vector<uint32_t>& primitives = threadPrimitives[thread];
+		for (uint32_t i = begin; i < end; ++i) {
+			outRanges[i].offset = static_cast<uint32_t>(primitives.size());
+			outRanges[i].count = QueryBounds(bounds[i], primitives);
+		}
+	});
+	outPrimitives.clear();
+	for (uint32_t thread = 0; thread < threadCount; ++thread) {
+		const uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(count) * thread / threadCount);
+		const uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(count) * (thread + 1) / threadCount);
+		for (uint32_t i = begin; i < end; ++i) {
+			outRanges[i].offset += static_cast<uint32_t>(outPrimitives.size());
+		}
+		outPrimitives.insert(outPrimitives.end(), threadPrimitives[thread].begin(), threadPrimitives[thread].end());
+	}
+}
+
+void SceneBvh::QueryFrustumBatch(const float (*planes)[6][4], uint32_t count, std::vector<BvhQueryRange>& outRanges,
+	std::vector<uint32_t>& outPrimitives, uint32_t threadCount) const {
+	threadCount = std::max(1u, std::min(ResolveThreadCount(threadCount), count));
+	std::vector<std::vector<uint32_t>> threadPrimitives(threadCount);
+	outRanges.resize(count);
+	ParallelRanges(count, threadCount, [&](uint32_t thread, uint32_t begin, uint32_t end) {
+		std::vector<uint32_t>& primitives = threadPrimitives[thread];
+		for (uint32_t i = begin; i < end; ++i) {
+			outRanges[i].offset = static_cast<uint32_t>(primitives.size());
+			outRanges[i].count = QueryFrustum(planes[i], primitives);
+		}
+	});
+	outPrimitives.clear();
+	for (uint32_t thread = 0; thread < threadCount; ++thread) {
+		const uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(count) * thread / threadCount);
+		const uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(count) * (thread + 1) / threadCount);
+		for (uint32_t i = begin; i < end; ++i) {
+			outRanges[i].offset += static_cast<uint32_t>(outPrimitives.size());
+		}
+		outPrimitives.insert(outPrimitives.end(), threadPrimitives[thread].begin(), threadPrimitives[thread].end());
+	}
+}
+
+/*///////////////////////
+	判定
+*////////////////////////
+bool SceneBvh::IntersectBounds(const BvhRay& ray, const BvhBounds& bounds, float& outDistance) {
+	return IntersectSlabs(PreparedRay(ray), bounds, ray.maxDistance, outDistance);
+}
+
+bool SceneBvh::OverlapBounds(const BvhBounds& a, const BvhBounds& b) {
+	return a.min[0] <= b.max[0] && a.max[0] >= b.min[0] &&
+		a.min[1] <= b.max[1] && a.max[1] >= b.min[1] &&
+		a.min[2] <= b.max[2] && a.max[2] >= b.min[2];
+}
+
+bool SceneBvh::OverlapFrustum(const float planes[6][4], const BvhBounds& bounds) {
+	for (int i = 0; i < 6; ++i) {
+		const float* plane = planes[i];
+		const float pX = plane[0] >= 0.0f ? bounds.max[0] : bounds.min[0];
+		const float pY = plane[1] >= 0.0f ? bounds.max[1] : bounds.min[1];
+		const float pZ = plane[2] >= 0.0f ? bounds.max[2] : bounds.min[2];
+		if (plane[0] * pX + plane[1] * pY + plane[2] * pZ + plane[3] < 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,205 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// 軸平行境界ボックス
+/// </summary>
+struct BvhBounds {
+	float min[3];
+	float max[3];
+};
+
+/// <summary>
+/// レイ(directionは正規化していなくてもよい。距離はdirectionの長さを1とした値)
+/// </summary>
+struct BvhRay {
+	float origin[3];
+	float maxDistance;
+	float direction[3];
+};
+
+/// <summary>
+/// レイの判定結果。当たらなければprimitiveがSceneBvh::kInvalidIndex
+/// </summary>
+struct BvhHit {
+	uint32_t primitive;
+	float distance; // プリミティブのAABBに入る距離(内側から撃ったら0)
+};
+
+/// <summary>
+/// まとめて投げた範囲クエリ1つ分の結果の範囲
+/// </summary>
+struct BvhQueryRange {
+	uint32_t offset;
+	uint32_t count;
+};
+
+/// <summary>
+/// シーンのオブジェクト(AABB)に対するBVH。
+/// 二分木をSAHで作ってから4分木に畳み、子4つのAABBを成分ごとに並べてSIMDで一度に判定する。
+/// 構築・リフィット以外はconstで、複数スレッドから同時に問い合わせてよい
+/// </summary>
+class SceneBvh {
+public: // 静的メンバ変数
+	static const uint32_t kInvalidIndex = 0xffffffffu;
+	// 葉に入れるプリミティブの最大数
+	static const uint32_t kMaxLeafSize = 4;
+
+public: // サブクラス
+	/// <summary>
+	/// 4分木のノード(128バイト、キャッシュライン2本)。空きの子は範囲が反転したAABBでどの判定にも当たらない
+	/// </summary>
+	struct alignas(64) Node {
+		float minX[4];
+		float minY[4];
+		float minZ[4];
+		float maxX[4];
+		float maxY[4];
+		float maxZ[4];
+		uint32_t children[4]; // 内部ノードならノード番号、葉なら並べ替え後のプリミティブの先頭
+		uint32_t counts[4];   // 葉のプリミティブ数(0なら内部ノードか空き)
+	};
+
+public: // メンバ関数
+	/// <summary>
+	/// 構築。以前の内容は捨てる
+	/// </summary>
+	/// <param name="bounds">プリミティブのAABB(番号がそのままプリミティブ番号になる)</param>
+	/// <param name="count">プリミティブ数</param>
+	/// <param name="threadCount">使用スレッド数(0なら自動)。結果はスレッド数によらない</param>
+	void Build(const BvhBounds* bounds, uint32_t count, uint32_t threadCount = 1);
+
+	/// <summary>
+	/// 木の形はそのままに、動いたプリミティブに合わせてAABBだけ更新する。
+	/// 大きく動くと木の質が落ちるので、その場合は作り直す
+	/// </summary>
+	/// <param name="bounds">Buildと同じ数・同じ番号のAABB</param>
+	/// <param name="threadCount">使用スレッド数(0なら自動)</param>
+	void Refit(const BvhBounds* bounds, uint32_t threadCount = 1);
+
+	/// <summary>
+	/// 一番近くで当たるプリミティブを探す。距離が同じならプリミティブ番号の小さい方
+	/// </summary>
+	bool Intersect(const BvhRay& ray, BvhHit& outHit) const;
+
+	/// <summary>
+	/// maxDistanceまでに何かに当たるか(遮蔽判定)
+	/// </summary>
+	bool IsOccluded(const BvhRay& ray) const;
+
+	/// <summary>
+	/// レイをまとめて判定する
+	/// </summary>
+	/// <param name="rays">レイ</param>
+	/// <param name="count">レイの数</param>
+	/// <param name="outHits">結果(count個)</param>
+	/// <param name="threadCount">使用スレッド数(0なら自動)</param>
+	void IntersectBatch(const BvhRay* rays, uint32_t count, BvhHit* outHits, uint32_t threadCount = 1) const;
+
+	/// <summary>
+	/// 遮蔽判定をまとめて行う
+	/// </summary>
+	/// <param name="outOccluded">結果(count個、当たれば1)</param>
+	void IsOccludedBatch(const BvhRay* rays, uint32_t count, uint8_t* outOccluded, uint32_t threadCount = 1) const;
+
+	/// <summary>
+	/// AABBと重なるプリミティブの番号をoutPrimitivesの後ろに追加する
+	/// </summary>
+	/// <returns>追加した数</returns>
+	uint32_t QueryBounds(const BvhBounds& bounds, std::vector<uint32_t>& outPrimitives) const;
+
+	/// <summary>
+	/// 視錐台と重なるプリミティブの番号をoutPrimitivesの後ろに追加する
+	/// </summary>
+	/// <param name="planes">内向き法線と距離(xyz・w)。CullingView::planesと同じ形式</param>
+	/// <returns>追加した数</returns>
+	uint32_t QueryFrustum(const float planes[6][4], std::vector<uint32_t>& outPrimitives) const;
+
+	/// <summary>
+	/// AABBのクエリをまとめて行う。結果はクエリ順に連結する
+	/// </summary>
+	/// <param name="bounds">クエリのAABB</param>
+	/// <param name="count">クエリ数</param>
+	/// <param name="outRanges">クエリごとの結果の範囲(count個にする)</param>
+	/// <param name="outPrimitives">結果のプリミティブ番号</param>
+	/// <param name="threadCount">使用スレッド数(0なら自動)</param>
+	void QueryBoundsBatch(const BvhBounds* bounds, uint32_t count, std::vector<BvhQueryRange>& outRanges,
+		std::vector<uint32_t>& outPrimitives, uint32_t threadCount = 1) const;
+
+	/// <summary>
+	/// 視錐台のクエリをまとめて行う(シャドウのカスケードなど)。結果はクエリ順に連結する
+	/// </summary>
+	void QueryFrustumBatch(const float (*planes)[6][4], uint32_t count, std::vector<BvhQueryRange>& outRanges,
+		std::vector<uint32_t>& outPrimitives, uint32_t threadCount = 1) const;
+
+	uint32_t GetPrimitiveCount() const { return static_cast<uint32_t>(primitiveIndices_.size()); }
+	uint32_t GetNodeCount() const { return static_cast<uint32_t>(nodes_.size()); }
+	const std::vector<Node>& GetNodes() const { return nodes_; }
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// レイとAABBの判定(BVHと同じ式。総当たりの検証用にも使う)
+	/// </summary>
+	/// <param name="outDistance">当たったらAABBに入る距離</param>
+	static bool IntersectBounds(const BvhRay& ray, const BvhBounds& bounds, float& outDistance);
+
+	/// <summary>
+	/// AABB同士が重なるか(境界で接していても重なるとみなす)
+	/// </summary>
+	static bool OverlapBounds(const BvhBounds& a, const BvhBounds& b);
+
+	/// <summary>
+	/// AABBが視錐台と重なるか(BVHと同じ式。平面ごとに判定するので保守的)
+	/// </summary>
+	static bool OverlapFrustum(const float planes[6][4], const BvhBounds& bounds);
+
+private: // サブクラス
+	// 構築中の二分木のノード
+	struct BuildNode {
+		BvhBounds bounds;
+		uint32_t left;
+		uint32_t right;
+		uint32_t first;
+		uint32_t count; // 0なら内部ノード
+	};
+
+	// 構築中のプリミティブと作業データ
+	struct BuildPrimitive;
+	struct BuildContext;
+
+private: // メンバ関数
+	/// <summary>
+	/// 構築中のプリミティブの[first, first + count)の二分木を作る
+	/// </summary>
+	/// <returns>作ったノードの番号</returns>
+	uint32_t BuildRange(BuildContext& context, uint32_t first, uint32_t count, uint32_t depth);
+
+	/// <summary>
+	/// 二分木のノードを4分木のノードに畳む(深さ優先の行きがけ順に並べる)
+	/// </summary>
+	/// <returns>作ったノードの番号</returns>
+	uint32_t Collapse(const std::vector<BuildNode>& buildNodes, uint32_t buildIndex);
+
+	/// <summary>
+	/// [begin, end)のノードを後ろから更新する(子は必ず親より後ろにある)
+	/// </summary>
+	void RefitNodes(const BvhBounds* bounds, uint32_t begin, uint32_t end);
+
+	/// <summary>
+	/// レイの走査。anyHitなら最初に当たったところで止める
+	/// </summary>
+	template<bool anyHit>
+	bool Traverse(const BvhRay& ray, BvhHit& outHit) const;
+
+	/// <summary>
+	/// 内部ノード以下のすべてのプリミティブを追加する(完全に視錐台の内側にあるとき)
+	/// </summary>
+	void AppendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& outPrimitives) const;
+
+private: // メンバ変数
+	std::vector<Node> nodes_;
+	std::vector<uint32_t> primitiveIndices_; // 葉の順に並べたプリミティブ番号
+	std::vector<BvhBounds> primitiveBounds_; // primitiveIndices_と同じ順のAABB
+};
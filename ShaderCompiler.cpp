@@ -0,0 +1,99 @@
+#include "ShaderCompiler.h"
+
+#include <Windows.h>
+#include <cassert>
+#include <d3dcompiler.h>
+#include <map>
+#include <mutex>
+#include <string>
+
+#pragma comment(lib,"d3dcompiler.lib")
+
+namespace {
+
+// ファイル名・エントリーポイント・ターゲットをまとめたキー
+std::wstring MakeCacheKey(const wchar_t* filePath, const char* entryPoint, const char* target) {
+	std::wstring key = filePath;
+	key += L'|';
+	for (const char* c = entryPoint; *c != '\0'; ++c) {
+		key += static_cast<wchar_t>(*c);
+	}
+	key += L'|';
+	for (const char* c = target; *c != '\0'; ++c) {
+		key += static_cast<wchar_t>(*c);
+	}
+	return key;
+}
+
+std::mutex shaderCacheMutex;
+std::map<std::wstring, ID3DBlob*> shaderCache;
+
+ID3DBlob* CompileFromFile(const wchar_t* filePath, const char* entryPoint, const char* target) {
+	UINT flags = D3DCOMPILE_ENABLE_STRICTNESS;
+#ifdef _DEBUG
+	flags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+	ID3DBlob* shaderBlob = nullptr;
+	ID3DBlob* errorBlob = nullptr;
+	HRESULT hr = D3DCompileFromFile(filePath, nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, entryPoint, target, flags, 0, &shaderBlob, &errorBlob);
+	if (errorBlob) {
+		// 警告・エラーを出力に流す
+		OutputDebugStringA(static_cast<const char*>(errorBlob->GetBufferPointer()));
+		errorBlob->Release();
+	}
+	return SUCCEEDED(hr) ? shaderBlob : nullptr;
+}
+
+} // namespace
+
+ID3DBlob* CompileShader(const wchar_t* filePath, const char* entryPoint, const char* target) {
+	ID3DBlob* shaderBlob = TryCompileShader(filePath, entryPoint, target);
+	assert(shaderBlob != nullptr);
+	return shaderBlob;
+}
+
+ID3DBlob* TryCompileShader(const wchar_t* filePath, const char* entryPoint, const char* target) {
+	{
+		std::lock_guard<std::mutex> lock(shaderCacheMutex);
+		auto it = shaderCache.find(MakeCacheKey(filePath, entryPoint, target));
+		if (it != shaderCache.end()) {
+			it->second->AddRef();
+			return it->second;
+		}
+	}
+	return CompileFromFile(filePath, entryPoint, target);
+}
+
+void InvalidateShader(const wchar_t* filePath) {
+	// キーは「ファイル名|エントリーポイント|ターゲット」なので、ファイル名と区切りで前方一致するものを消す
+	std::wstring prefix = filePath;
+	prefix += L'|';
+	std::lock_guard<std::mutex> lock(shaderCacheMutex);
+	for (auto it = shaderCache.lower_bound(prefix); it != shaderCache.end() && it->first.compare(0, prefix.size(), prefix) == 0;) {
+		it->second->Release();
+		it = shaderCache.erase(it);
+	}
+}
+
+bool WarmUpShader(const wchar_t* filePath, const char* entryPoint, const char* target) {
+	// コンパイル自体はロックの外で行い、複数のシェーダーを並列にコンパイルできるようにする
+	ID3DBlob* shaderBlob = CompileFromFile(filePath, entryPoint, target);
+	if (shaderBlob == nullptr) {
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(shaderCacheMutex);
+	ID3DBlob*& cached = shaderCache[MakeCacheKey(filePath, entryPoint, target)];
+	if (cached != nullptr) {
+		cached->Release();
+	}
+	cached = shaderBlob;
+	return true;
+}
+
+void ClearShaderCache() {
+	std::lock_guard<std::mutex> lock(shaderCacheMutex);
+	for (auto& [key, shaderBlob] : shaderCache) {
+		shaderBlob->Release();
+	}
+	shaderCache.clear();
+}
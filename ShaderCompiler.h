@@ -0,0 +1,33 @@
+#pragma once
+#include <d3dcommon.h>
+
+/// <summary>
+/// HLSLファイルをコンパイルする。失敗時はエラーを出力してassertする。
+/// 先にWarmUpShaderしてあればキャッシュから返す
+/// </summary>
+/// <param name="filePath">シェーダーファイルのパス</param>
+/// <param name="entryPoint">エントリーポイント名</param>
+/// <param name="target">シェーダーモデル(vs_5_0など)</param>
+/// <returns>コンパイル結果(呼び出し側で解放する)</returns>
+ID3DBlob* CompileShader(const wchar_t* filePath, const char* entryPoint, const char* target);
+
+/// <summary>
+/// CompileShaderと同じだが、失敗してもassertせずnullptrを返す(実行中の読み直し用。スレッドセーフ)
+/// </summary>
+ID3DBlob* TryCompileShader(const wchar_t* filePath, const char* entryPoint, const char* target);
+
+/// <summary>
+/// ファイルが変わったので、そのファイルのキャッシュをすべて捨てる(スレッドセーフ)
+/// </summary>
+void InvalidateShader(const wchar_t* filePath);
+
+/// <summary>
+/// 起動中に別スレッドでコンパイルしてキャッシュしておく(スレッドセーフ)
+/// </summary>
+/// <returns>コンパイルに成功したか</returns>
+bool WarmUpShader(const wchar_t* filePath, const char* entryPoint, const char* target);
+
+/// <summary>
+/// キャッシュしたシェーダーをすべて解放する
+/// </summary>
+void ClearShaderCache();
@@ -0,0 +1,259 @@
+#include "SkeletalAnimation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <thread>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#define SKELETAL_ANIMATION_USE_SSE2
+#endif
+
+namespace {
+
+// 1回に取るキャラクター数(共有カウンターへのアクセスを減らす)
+const uint32_t kCharactersPerBatch = 8;
+
+// 行ベクトルの規約で a×b
+void Multiply(const JointMatrix& a, const JointMatrix& b, JointMatrix& out) {
+#ifdef SKELETAL_ANIMATION_USE_SSE2
+	const __m128 b0 = _mm_load_ps(b.m[0]);
+	const __m128 b1 = _mm_load_ps(b.m[1]);
+	const __m128 b2 = _mm_load_ps(b.m[2]);
+	const __m128 b3 = _mm_load_ps(b.m[3]);
+	for (uint32_t row = 0; row < 4; ++row) {
+		__m128 result = _mm_mul_ps(_mm_set1_ps(a.m[row][0]), b0);
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(a.m[row][1]), b1));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(a.m[row][2]), b2));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(a.m[row][3]), b3));
+		_mm_store_ps(out.m[row], result);
+	}
+#else
+	JointMatrix result;
+	for (uint32_t row = 0; row < 4; ++row) {
+		for (uint32_t column = 0; column < 4; ++column) {
+			result.m[row][column] = ((a.m[row][0] * b.m[0][column] + a.m[row][1] * b.m[1][column]) + a.m[row][2] * b.m[2][column]) + a.m[row][3] * b.m[3][column];
+		}
+	}
+	out = result;
+#endif
+}
+
+// 関節1つ分のローカル行列(拡縮→回転→移動)
+JointMatrix MakeLocalMatrix(const JointTransform& transform) {
+	const float x = transform.rotation[0], y = transform.rotation[1], z = transform.rotation[2], w = transform.rotation[3];
+	const float xx = x * x, yy = y * y, zz = z * z;
+	const float xy = x * y, xz = x * z, yz = y * z;
+	const float wx = w * x, wy = w * y, wz = w * z;
+	const float* s = transform.scale;
+	const float* t = transform.translation;
+	return { {
+		{ (1.0f - 2.0f * (yy + zz)) * s[0], 2.0f * (xy + wz) * s[0], 2.0f * (xz - wy) * s[0], 0.0f },
+		{ 2.0f * (xy - wz) * s[1], (1.0f - 2.0f * (xx + zz)) * s[1], 2.0f * (yz + wx) * s[1], 0.0f },
+		{ 2.0f * (xz + wy) * s[2], 2.0f * (yz - wx) * s[2], (1.0f - 2.0f * (xx + yy)) * s[2], 0.0f },
+		{ t[0], t[1], t[2], 1.0f },
+	} };
+}
+
+// アフィン行列の逆行列
+JointMatrix InverseAffine(const JointMatrix& matrix) {
+	const float (&m)[4][4] = matrix.m;
+	const float cofactor00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+	const float cofactor01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+	const float cofactor02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+	const float determinant = m[0][0] * cofactor00 + m[0][1] * cofactor01 + m[0][2] * cofactor02;
+	assert(determinant != 0.0f);
+	const float inverseDeterminant = 1.0f / determinant;
+
+	JointMatrix result{};
+	result.m[0][0] = cofactor00 * inverseDeterminant;
+	result.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inverseDeterminant;
+	result.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inverseDeterminant;
+	result.m[1][0] = cofactor01 * inverseDeterminant;
+	result.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inverseDeterminant;
+	result.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inverseDeterminant;
+	result.m[2][0] = cofactor02 * inverseDeterminant;
+	result.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inverseDeterminant;
+	result.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inverseDeterminant;
+	for (uint32_t column = 0; column < 3; ++column) {
+		result.m[3][column] = -(m[3][0] * result.m[0][column] + m[3][1] * result.m[1][column] + m[3][2] * result.m[2][column]);
+	}
+	result.m[3][3] = 1.0f;
+	return result;
+}
+
+} // namespace
+
+/*///////////////////////
+	Skeleton
+*////////////////////////
+void Skeleton::Initialize(const int16_t* parents, const JointTransform* bindPose, uint32_t jointCount) {
+	parents_.assign(parents, parents + jointCount);
+	bindPose_.assign(bindPose, bindPose + jointCount);
+
+	std::vector<JointMatrix> modelMatrices(jointCount);
+	inverseBindMatrices_.resize(jointCount);
+	for (uint32_t joint = 0; joint < jointCount; ++joint) {
+		// 親が先に計算済みであること
+		assert(parents[joint] < static_cast<int32_t>(joint));
+		JointMatrix local = MakeLocalMatrix(bindPose[joint]);
+		if (parents[joint] < 0) {
+			modelMatrices[joint] = local;
+		} else {
+			Multiply(local, modelMatrices[parents[joint]], modelMatrices[joint]);
+		}
+		inverseBindMatrices_[joint] = InverseAffine(modelMatrices[joint]);
+	}
+}
+
+/*///////////////////////
+	AnimationSystem
+*////////////////////////
+void AnimationSystem::ComputeModelMatrices(const Skeleton& skeleton, const AnimationPose& pose, JointMatrix* outModelMatrices) {
+	const uint32_t jointCount = skeleton.GetJointCount();
+	assert(pose.jointCount == jointCount);
+
+	// ローカル行列は親子関係と無関係なので4関節ずつまとめて作る
+#ifdef SKELETAL_ANIMATION_USE_SSE2
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 zero = _mm_setzero_ps();
+	for (uint32_t joint = 0; joint < jointCount; joint += 4) {
+		__m128 x = _mm_loadu_ps(&pose.rotationX[joint]), y = _mm_loadu_ps(&pose.rotationY[joint]);
+		__m128 z = _mm_loadu_ps(&pose.rotationZ[joint]), w = _mm_loadu_ps(&pose.rotationW[joint]);
+		__m128 sx = _mm_loadu_ps(&pose.scaleX[joint]), sy = _mm_loadu_ps(&pose.scaleY[joint]), sz = _mm_loadu_ps(&pose.scaleZ[joint]);
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+		// 4関節分の各成分を計算し、転置して関節ごとの行にする
+		__m128 row0[4] = {
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+			zero,
+		};
+		__m128 row1[4] = {
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+			zero,
+		};
+		__m128 row2[4] = {
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+			zero,
+		};
+		__m128 row3[4] = { _mm_loadu_ps(&pose.translationX[joint]), _mm_loadu_ps(&pose.translationY[joint]), _mm_loadu_ps(&pose.translationZ[joint]), one };
+		_MM_TRANSPOSE4_PS(row0[0], row0[1], row0[2], row0[3]);
+		_MM_TRANSPOSE4_PS(row1[0], row1[1], row1[2], row1[3]);
+		_MM_TRANSPOSE4_PS(row2[0], row2[1], row2[2], row2[3]);
+		_MM_TRANSPOSE4_PS(row3[0], row3[1], row3[2], row3[3]);
+
+		const uint32_t count = std::min(jointCount - joint, 4u);
+		for (uint32_t lane = 0; lane < count; ++lane) {
+			JointMatrix& local = outModelMatrices[joint + lane];
+			_mm_store_ps(local.m[0], row0[lane]);
+			_mm_store_ps(local.m[1], row1[lane]);
+			_mm_store_ps(local.m[2], row2[lane]);
+			_mm_store_ps(local.m[3], row3[lane]);
+		}
+	}
+#else
+	for (uint32_t joint = 0; joint < jointCount; ++joint) {
+		outModelMatrices[joint] = MakeLocalMatrix(pose.GetJoint(joint));
+	}
+#endif
+
+	// 親は子より前にあるので、先頭から順に親の行列を掛けていけばよい
+	const std::vector<int16_t>& parents = skeleton.GetParents();
+	for (uint32_t joint = 0; joint < jointCount; ++joint) {
+		if (parents[joint] >= 0) {
+			Multiply(outModelMatrices[joint], outModelMatrices[parents[joint]], outModelMatrices[joint]);
+		}
+	}
+}
+
+void AnimationSystem::WriteSkinningPalette(const Skeleton& skeleton, const JointMatrix* modelMatrices, SkinningMatrix* outPalette) {
+	const std::vector<JointMatrix>& inverseBindMatrices = skeleton.GetInverseBindMatrices();
+	const uint32_t jointCount = skeleton.GetJointCount();
+	for (uint32_t joint = 0; joint < jointCount; ++joint) {
+		JointMatrix skinning;
+		Multiply(inverseBindMatrices[joint], modelMatrices[joint], skinning);
+		// 転置した先頭3行だけを順に書く(書き込み結合メモリでも遅くならないよう、読み出しや飛び飛びの書き込みをしない)
+#ifdef SKELETAL_ANIMATION_USE_SSE2
+		__m128 row0 = _mm_load_ps(skinning.m[0]);
+		__m128 row1 = _mm_load_ps(skinning.m[1]);
+		__m128 row2 = _mm_load_ps(skinning.m[2]);
+		__m128 row3 = _mm_load_ps(skinning.m[3]);
+		_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+		_mm_storeu_ps(outPalette[joint].m[0], row0);
+		_mm_storeu_ps(outPalette[joint].m[1], row1);
+		_mm_storeu_ps(outPalette[joint].m[2], row2);
+#else
+		SkinningMatrix transposed;
+		for (uint32_t row = 0; row < 3; ++row) {
+			for (uint32_t column = 0; column < 4; ++column) {
+				transposed.m[row][column] = skinning.m[column][row];
+			}
+		}
+		outPalette[joint] = transposed;
+#endif
+	}
+}
+
+void AnimationSystem::Evaluate(const CharacterAnimation* characters, uint32_t characterCount, SkinningMatrix* outPalettes, uint32_t threadCount) {
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threadCount = std::clamp((characterCount + kCharactersPerBatch - 1) / kCharactersPerBatch, 1u, threadCount);
+	if (workspaces_.size() < threadCount) {
+		workspaces_.resize(threadCount);
+	}
+
+	if (threadCount == 1) {
+		for (uint32_t i = 0; i < characterCount; ++i) {
+			EvaluateCharacter(characters[i], workspaces_[0], outPalettes);
+		}
+		return;
+	}
+
+	// キャラクターごとに関節数が違うので、空いたスレッドから次のまとまりを取る
+	std::atomic<uint32_t> nextCharacter = 0;
+	std::vector<std::thread> workers;
+	workers.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i) {
+		workers.emplace_back([&, i]() {
+			Workspace& workspace = workspaces_[i];
+			for (uint32_t begin = nextCharacter.fetch_add(kCharactersPerBatch); begin < characterCount; begin = nextCharacter.fetch_add(kCharactersPerBatch)) {
+				const uint32_t end = std::min(begin + kCharactersPerBatch, characterCount);
+				for (uint32_t character = begin; character < end; ++character) {
+					EvaluateCharacter(characters[character], workspace, outPalettes);
+				}
+			}
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void AnimationSystem::EvaluateCharacter(const CharacterAnimation& character, Workspace& workspace, SkinningMatrix* outPalettes) {
+	const Skeleton& skeleton = *character.skeleton;
+	assert(character.clips[0]->GetJointCount() == skeleton.GetJointCount());
+
+	const AnimationPose* pose = &workspace.poses[0];
+	character.clips[0]->Sample(character.times[0], workspace.poses[0]);
+	if (character.clips[1] && character.blendWeight > 0.0f) {
+		character.clips[1]->Sample(character.times[1], workspace.poses[1]);
+		AnimationPose::Blend(workspace.poses[0], workspace.poses[1], character.blendWeight, workspace.blendedPose);
+		pose = &workspace.blendedPose;
+	}
+
+	workspace.modelMatrices.resize(skeleton.GetJointCount());
+	ComputeModelMatrices(skeleton, *pose, workspace.modelMatrices.data());
+	WriteSkinningPalette(skeleton, workspace.modelMatrices.data(), outPalettes + character.paletteOffset);
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "AnimationClip.h"
+
+/// <summary>
+/// 関節の行列(行ベクトル×行列の規約。4行目が移動)
+/// </summary>
+struct alignas(16) JointMatrix {
+	float m[4][4];
+};
+
+/// <summary>
+/// スキニング行列。GPUへ送る量を減らすため転置した3行4列で持つ(HLSLでは float3x4 として mul(m, float4(p, 1)))
+/// </summary>
+struct SkinningMatrix {
+	float m[3][4];
+};
+
+/// <summary>
+/// 骨格。関節は親が子より前に並ぶ順序にする
+/// </summary>
+class Skeleton {
+public: // メンバ関数
+	/// <summary>
+	/// 初期化。バインドポーズから逆バインド行列を求めておく
+	/// </summary>
+	/// <param name="parents">親関節の番号(ルートは-1)</param>
+	/// <param name="bindPose">バインドポーズのローカル変換</param>
+	/// <param name="jointCount">関節数</param>
+	void Initialize(const int16_t* parents, const JointTransform* bindPose, uint32_t jointCount);
+
+	uint32_t GetJointCount() const { return static_cast<uint32_t>(parents_.size()); }
+	const std::vector<int16_t>& GetParents() const { return parents_; }
+	const std::vector<JointTransform>& GetBindPose() const { return bindPose_; }
+	const std::vector<JointMatrix>& GetInverseBindMatrices() const { return inverseBindMatrices_; }
+
+private: // メンバ変数
+	std::vector<int16_t> parents_;
+	std::vector<JointTransform> bindPose_;
+	std::vector<JointMatrix> inverseBindMatrices_;
+};
+
+/// <summary>
+/// キャラクター1体分のアニメーションの指定
+/// </summary>
+struct CharacterAnimation {
+	const Skeleton* skeleton;
+	const CompressedClip* clips[2]; // clips[1]がnullptrなら1つだけ再生する
+	float times[2];
+	float blendWeight;              // 0でclips[0]、1でclips[1]
+	uint32_t paletteOffset;         // 出力先の先頭(スキニング行列の個数単位)
+};
+
+/// <summary>
+/// キャラクターのポーズを求めてスキニング行列を書き出す。キャラクター単位で複数スレッドに分ける
+/// </summary>
+class AnimationSystem {
+public: // 静的メンバ関数
+	/// <summary>
+	/// ポーズから各関節のモデル空間の行列を求める
+	/// </summary>
+	static void ComputeModelMatrices(const Skeleton& skeleton, const AnimationPose& pose, JointMatrix* outModelMatrices);
+
+	/// <summary>
+	/// モデル空間の行列に逆バインド行列を掛けてスキニング行列を書き出す
+	/// </summary>
+	/// <param name="outPalette">書き込み先。書き込むだけで読み戻さないので、アップロードヒープを直接指してよい</param>
+	static void WriteSkinningPalette(const Skeleton& skeleton, const JointMatrix* modelMatrices, SkinningMatrix* outPalette);
+
+public: // メンバ関数
+	/// <summary>
+	/// 全キャラクターのスキニング行列を求める
+	/// </summary>
+	/// <param name="characters">キャラクター</param>
+	/// <param name="characterCount">キャラクター数</param>
+	/// <param name="outPalettes">書き込み先(各キャラクターのpaletteOffsetから関節数分)。フレームごとのアップロード用メモリを直接渡す</param>
+	/// <param name="threadCount">使用スレッド数(0なら自動)</param>
+	void Evaluate(const CharacterAnimation* characters, uint32_t characterCount, SkinningMatrix* outPalettes, uint32_t threadCount = 1);
+
+private: // サブクラス
+	// スレッドごとの作業領域(フレームをまたいで使い回す)
+	struct Workspace {
+		AnimationPose poses[2];
+		AnimationPose blendedPose;
+		std::vector<JointMatrix> modelMatrices;
+	};
+
+private: // メンバ関数
+	static void EvaluateCharacter(const CharacterAnimation& character, Workspace& workspace, SkinningMatrix* outPalettes);
+
+private: // メンバ変数
+	std::vector<Workspace> workspaces_;
+};
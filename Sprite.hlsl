@@ -0,0 +1,48 @@
+// スプライトのインスタンス描画
+// 入力のレイアウトはSpriteBatch.hのSpriteInstanceと合わせる
+
+cbuffer SpriteConstants : register(b0) {
+	float2 screenSize; // 描画先のピクセル数
+};
+
+// バインドレスヒープ全体
+Texture2D<float4> gTextures[] : register(t0, space1);
+SamplerState gSampler : register(s0);
+
+struct SpriteInstance {
+	float2 position : POSITION;
+	float2 size : SIZE;
+	float4 uvRect : TEXCOORD0; // xy: 左上 zw: 右下
+	float rotation : ROTATION;
+	float4 color : COLOR0;
+	uint textureIndex : TEXTUREINDEX;
+};
+
+struct VertexShaderOutput {
+	float4 position : SV_POSITION;
+	float2 texcoord : TEXCOORD0;
+	float4 color : COLOR0;
+	nointerpolation uint textureIndex : TEXTUREINDEX;
+};
+
+// 頂点IDから四角形の角を作る(トライアングルストリップ)
+VertexShaderOutput VSMain(SpriteInstance instance, uint vertexId : SV_VertexID) {
+	float2 corner = float2(vertexId & 1, vertexId >> 1);
+	float2 local = (corner - 0.5f) * instance.size;
+	float s, c;
+	sincos(instance.rotation, s, c);
+	float2 pixel = instance.position + float2(local.x * c - local.y * s, local.x * s + local.y * c);
+
+	VertexShaderOutput output;
+	// ピクセル座標(左上原点)からクリップ座標へ
+	output.position = float4(pixel / screenSize * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+	output.texcoord = lerp(instance.uvRect.xy, instance.uvRect.zw, corner);
+	output.color = instance.color;
+	output.textureIndex = instance.textureIndex;
+	return output;
+}
+
+float4 PSMain(VertexShaderOutput input) : SV_TARGET {
+	// 同じ描画の中でもスプライトごとにページが違いうる
+	return gTextures[NonUniformResourceIndex(input.textureIndex)].Sample(gSampler, input.texcoord) * input.color;
+}
@@ -0,0 +1,94 @@
+#include "SpriteBatch.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+// 基数ソートの1桁のビット数
+const uint32_t kRadixBits = 8;
+const uint32_t kRadixSize = 1u << kRadixBits;
+
+} // namespace
+
+void SpriteBatch::Begin() {
+	instances_.clear();
+	keys_.clear();
+	batches_.clear();
+}
+
+void SpriteBatch::Draw(const Sprite& sprite) {
+	SpriteInstance instance;
+	instance.position[0] = sprite.position[0];
+	instance.position[1] = sprite.position[1];
+	instance.size[0] = sprite.size[0];
+	instance.size[1] = sprite.size[1];
+	instance.uvMin[0] = sprite.uvMin[0];
+	instance.uvMin[1] = sprite.uvMin[1];
+	instance.uvMax[0] = sprite.uvMax[0];
+	instance.uvMax[1] = sprite.uvMax[1];
+	instance.rotation = sprite.rotation;
+	instance.color = sprite.color;
+	instance.textureIndex = sprite.textureIndex;
+	instance.padding = 0;
+	instances_.push_back(instance);
+	keys_.push_back((static_cast<uint32_t>(sprite.layer) << 16) | (sprite.textureIndex & 0xffff));
+}
+
+uint32_t SpriteBatch::End(SpriteInstance* outInstances, uint32_t maxInstanceCount) {
+	batches_.clear();
+	SortByKey();
+
+	const uint32_t count = std::min(static_cast<uint32_t>(order_.size()), maxInstanceCount);
+	for (uint32_t i = 0; i < count; ++i) {
+		const uint32_t source = order_[i];
+		// 書き込み先は読み戻さず、先頭から順に埋める
+		std::memcpy(&outInstances[i], &instances_[source], sizeof(SpriteInstance));
+
+		const uint16_t layer = static_cast<uint16_t>(keys_[source] >> 16);
+		if (batches_.empty() || batches_.back().layer != layer) {
+			batches_.push_back({ layer, i, 0 });
+		}
+		++batches_.back().instanceCount;
+	}
+	return count;
+}
+
+void SpriteBatch::SortByKey() {
+	const size_t count = keys_.size();
+	order_.resize(count);
+	std::iota(order_.begin(), order_.end(), 0u);
+	if (count < 2) {
+		return;
+	}
+	sortScratch_.resize(count);
+
+	// 全要素で一致しているビットの桁は並びが変わらないので飛ばす
+	uint32_t differingBits = 0;
+	for (size_t i = 1; i < count; ++i) {
+		differingBits |= keys_[i] ^ keys_[0];
+	}
+
+	uint32_t histogram[kRadixSize];
+	for (uint32_t shift = 0; shift < 32; shift += kRadixBits) {
+		if (((differingBits >> shift) & (kRadixSize - 1)) == 0) {
+			continue;
+		}
+		std::memset(histogram, 0, sizeof(histogram));
+		for (size_t i = 0; i < count; ++i) {
+			++histogram[(keys_[order_[i]] >> shift) & (kRadixSize - 1)];
+		}
+		uint32_t offset = 0;
+		for (uint32_t& bucket : histogram) {
+			uint32_t bucketCount = bucket;
+			bucket = offset;
+			offset += bucketCount;
+		}
+		for (size_t i = 0; i < count; ++i) {
+			const uint32_t index = order_[i];
+			sortScratch_[histogram[(keys_[index] >> shift) & (kRadixSize - 1)]++] = index;
+		}
+		order_.swap(sortScratch_);
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// スプライト1枚分の指定
+/// </summary>
+struct Sprite {
+	float position[2]; // 中心(ピクセル、左上原点)
+	float size[2];     // 幅と高さ(ピクセル)
+	float uvMin[2];
+	float uvMax[2];
+	float rotation;    // 中心まわりの回転(ラジアン)
+	uint32_t color;    // RGBA8(Rが最下位バイト)
+	uint32_t textureIndex; // バインドレスヒープ上のアトラスページのSRV
+	uint16_t layer;    // 小さいほど先に(奥に)描く
+};
+
+/// <summary>
+/// インスタンスごとの頂点データ(Sprite.hlslの入力と同じレイアウト)
+/// </summary>
+struct SpriteInstance {
+	float position[2];
+	float size[2];
+	float uvMin[2];
+	float uvMax[2];
+	float rotation;
+	uint32_t color;
+	uint32_t textureIndex;
+	uint32_t padding;
+};
+
+/// <summary>
+/// 1回のインスタンス描画にまとめる範囲(同じレイヤーのスプライト)
+/// </summary>
+struct SpriteBatchRange {
+	uint16_t layer;
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+};
+
+/// <summary>
+/// スプライトを溜めてレイヤー・アトラスページ順に並べ替え、インスタンスの列とレイヤーごとの描画範囲を作る。
+/// テクスチャはインスタンスごとにバインドレスのインデックスで引くので、ページが違っても同じレイヤーなら1回の描画で済む。
+/// 同じレイヤー・ページの中では積んだ順を保つ(ページをまたぐ重なりの順序が必要ならレイヤーを分ける)
+/// </summary>
+class SpriteBatch {
+public: // メンバ関数
+	/// <summary>
+	/// 積んだスプライトを空にする
+	/// </summary>
+	void Begin();
+
+	/// <summary>
+	/// スプライトを積む
+	/// </summary>
+	void Draw(const Sprite& sprite);
+
+	/// <summary>
+	/// 並べ替えてインスタンスを書き出し、描画範囲を作る
+	/// </summary>
+	/// <param name="outInstances">書き込み先。先頭から順に書くだけなので、常時マップした頂点バッファを直接渡してよい</param>
+	/// <param name="maxInstanceCount">書き込める数(超えた分は捨てる)</param>
+	/// <returns>書き込んだ数</returns>
+	uint32_t End(SpriteInstance* outInstances, uint32_t maxInstanceCount);
+
+	const std::vector<SpriteBatchRange>& GetBatches() const { return batches_; }
+	uint32_t GetSpriteCount() const { return static_cast<uint32_t>(instances_.size()); }
+
+private: // メンバ関数
+	/// <summary>
+	/// キーの安定な基数ソート(全要素で同じ桁は飛ばす)。結果はorder_に入る
+	/// </summary>
+	void SortByKey();
+
+private: // メンバ変数
+	std::vector<SpriteInstance> instances_; // 積んだ順
+	std::vector<uint32_t> keys_;            // レイヤー(上位16ビット)とページ(下位16ビット)
+	std::vector<uint32_t> order_;
+	std::vector<uint32_t> sortScratch_;
+	std::vector<SpriteBatchRange> batches_;
+};
@@ -0,0 +1,230 @@
+#include "SpriteRenderer.h"
+
+#include "ShaderCompiler.h"
+
+#include <Windows.h>
+#include <cassert>
+#include <cstddef>
+
+void SpriteRenderer::Initialize(ID3D12Device* device, BindlessHeap* bindlessHeap, uint32_t maxSpriteCount) {
+	bindlessHeap_ = bindlessHeap;
+	maxSpriteCount_ = maxSpriteCount;
+	frameIndex_ = 0;
+
+	CreatePipeline(device);
+
+	// インスタンスは毎フレームCPUから書くのでアップロードヒープに置いてマップしたままにする
+	D3D12_HEAP_PROPERTIES heapProperties{};
+	heapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+
+	D3D12_RESOURCE_DESC resourceDesc{};
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resourceDesc.Width = sizeof(SpriteInstance) * static_cast<uint64_t>(maxSpriteCount) * kFrameCount;
+	resourceDesc.Height = 1;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.MipLevels = 1;
+	resourceDesc.SampleDesc.Count = 1;
+	resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+	HRESULT hr = device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&instanceBuffer_));
+	assert(SUCCEEDED(hr));
+	D3D12_RANGE readRange{ 0, 0 };
+	hr = instanceBuffer_->Map(0, &readRange, reinterpret_cast<void**>(&mappedInstances_));
+	assert(SUCCEEDED(hr));
+}
+
+void SpriteRenderer::Finalize() {
+	for (size_t i = 0; i < textures_.size(); ++i) {
+		bindlessHeap_->Free(textureHandles_[i]);
+		textures_[i]->Release();
+	}
+	textures_.clear();
+	textureHandles_.clear();
+	if (instanceBuffer_) {
+		instanceBuffer_->Release();
+		instanceBuffer_ = nullptr;
+		mappedInstances_ = nullptr;
+	}
+	if (pipelineState_) {
+		pipelineState_->Release();
+		pipelineState_ = nullptr;
+	}
+	if (rootSignature_) {
+		rootSignature_->Release();
+		rootSignature_ = nullptr;
+	}
+}
+
+BindlessHandle SpriteRenderer::CreateTexture(ID3D12Device* device, const TextureImage& image) {
+	// CPUから直接書き込めるヒープに置き、WriteToSubresourceで転送する(コマンドリストを使わないので起動中のどのスレッドからでも作れる)
+	D3D12_HEAP_PROPERTIES heapProperties{};
+	heapProperties.Type = D3D12_HEAP_TYPE_CUSTOM;
+	heapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_WRITE_BACK;
+	heapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_L0;
+
+	D3D12_RESOURCE_DESC resourceDesc{};
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	resourceDesc.Width = image.width;
+	resourceDesc.Height = image.height;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.MipLevels = 1;
+	resourceDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	resourceDesc.SampleDesc.Count = 1;
+
+	ID3D12Resource* texture = nullptr;
+	HRESULT hr = device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&texture));
+	assert(SUCCEEDED(hr));
+	hr = texture->WriteToSubresource(0, nullptr, image.pixels.data(), image.width * 4, image.width * image.height * 4);
+	assert(SUCCEEDED(hr));
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+	srvDesc.Format = resourceDesc.Format;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Texture2D.MipLevels = 1;
+	BindlessHandle handle = bindlessHeap_->CreateShaderResourceView(texture, &srvDesc);
+
+	textures_.push_back(texture);
+	textureHandles_.push_back(handle);
+	return handle;
+}
+
+void SpriteRenderer::Render(ID3D12GraphicsCommandList* commandList, SpriteBatch& batch, uint32_t screenWidth, uint32_t screenHeight) {
+	// 今フレームの領域へ並べ替えたインスタンスを書く
+	const uint32_t frameOffset = (frameIndex_++ % kFrameCount) * maxSpriteCount_;
+	const uint32_t instanceCount = batch.End(mappedInstances_ + frameOffset, maxSpriteCount_);
+	if (instanceCount == 0) {
+		return;
+	}
+
+	Constants constants{};
+	constants.screenSize[0] = static_cast<float>(screenWidth);
+	constants.screenSize[1] = static_cast<float>(screenHeight);
+
+	D3D12_VERTEX_BUFFER_VIEW vertexBufferView{};
+	vertexBufferView.BufferLocation = instanceBuffer_->GetGPUVirtualAddress() + sizeof(SpriteInstance) * static_cast<uint64_t>(frameOffset);
+	vertexBufferView.SizeInBytes = static_cast<UINT>(sizeof(SpriteInstance) * instanceCount);
+	vertexBufferView.StrideInBytes = sizeof(SpriteInstance);
+
+	bindlessHeap_->Bind(commandList);
+	commandList->SetGraphicsRootSignature(rootSignature_);
+	commandList->SetPipelineState(pipelineState_);
+	commandList->SetGraphicsRoot32BitConstants(0, sizeof(Constants) / sizeof(uint32_t), &constants, 0);
+	commandList->SetGraphicsRootDescriptorTable(1, bindlessHeap_->GetTableStart());
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	commandList->IASetVertexBuffers(0, 1, &vertexBufferView);
+	// 四角形の4頂点は頂点IDから作り、スプライトはインスタンスとして描く
+	for (const SpriteBatchRange& range : batch.GetBatches()) {
+		commandList->DrawInstanced(4, range.instanceCount, 0, range.firstInstance);
+	}
+}
+
+void SpriteRenderer::CreatePipeline(ID3D12Device* device) {
+	// ルートパラメータ: [0]定数(b0) [1]バインドレスヒープ全体のSRV(t0, space1)
+	D3D12_DESCRIPTOR_RANGE descriptorRange = BindlessHeap::MakeDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1);
+
+	D3D12_ROOT_PARAMETER rootParameters[2]{};
+	rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+	rootParameters[0].Constants.ShaderRegister = 0;
+	rootParameters[0].Constants.Num32BitValues = sizeof(Constants) / sizeof(uint32_t);
+	rootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	rootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+	rootParameters[1].DescriptorTable.NumDescriptorRanges = 1;
+	rootParameters[1].DescriptorTable.pDescriptorRanges = &descriptorRange;
+
+	D3D12_STATIC_SAMPLER_DESC staticSampler{};
+	staticSampler.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+	staticSampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+	staticSampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+	staticSampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+	staticSampler.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+	staticSampler.MaxLOD = D3D12_FLOAT32_MAX;
+	staticSampler.ShaderRegister = 0;
+	staticSampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc{};
+	rootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
+	rootSignatureDesc.NumParameters = _countof(rootParameters);
+	rootSignatureDesc.pParameters = rootParameters;
+	rootSignatureDesc.NumStaticSamplers = 1;
+	rootSignatureDesc.pStaticSamplers = &staticSampler;
+
+	ID3DBlob* signatureBlob = nullptr;
+	ID3DBlob* errorBlob = nullptr;
+	HRESULT hr = D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signatureBlob, &errorBlob);
+	if (FAILED(hr)) {
+		OutputDebugStringA(static_cast<const char*>(errorBlob->GetBufferPointer()));
+		assert(false);
+	}
+	hr = device->CreateRootSignature(0, signatureBlob->GetBufferPointer(), signatureBlob->GetBufferSize(), IID_PPV_ARGS(&rootSignature_));
+	assert(SUCCEEDED(hr));
+	signatureBlob->Release();
+
+	pipelineState_ = CreatePipelineState(device);
+	assert(pipelineState_ != nullptr);
+}
+
+ID3D12PipelineState* SpriteRenderer::CreatePipelineState(ID3D12Device* device) const {
+	// 頂点バッファはインスタンスごとに1要素進める
+	D3D12_INPUT_ELEMENT_DESC inputElementDescs[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, offsetof(SpriteInstance, position), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "SIZE", 0, DXGI_FORMAT_R32G32_FLOAT, 0, offsetof(SpriteInstance, size), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, offsetof(SpriteInstance, uvMin), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "ROTATION", 0, DXGI_FORMAT_R32_FLOAT, 0, offsetof(SpriteInstance, rotation), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, offsetof(SpriteInstance, color), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "TEXTUREINDEX", 0, DXGI_FORMAT_R32_UINT, 0, offsetof(SpriteInstance, textureIndex), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+	};
+
+	// 大きさを決めないテクスチャ配列を使うのでシェーダーモデル5.1
+	ID3DBlob* vertexShaderBlob = TryCompileShader(L"Sprite.hlsl", "VSMain", "vs_5_1");
+	ID3DBlob* pixelShaderBlob = TryCompileShader(L"Sprite.hlsl", "PSMain", "ps_5_1");
+	if (vertexShaderBlob == nullptr || pixelShaderBlob == nullptr) {
+		if (vertexShaderBlob) {
+			vertexShaderBlob->Release();
+		}
+		if (pixelShaderBlob) {
+			pixelShaderBlob->Release();
+		}
+		return nullptr;
+	}
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineStateDesc{};
+	pipelineStateDesc.pRootSignature = rootSignature_;
+	pipelineStateDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
+	pipelineStateDesc.VS = { vertexShaderBlob->GetBufferPointer(), vertexShaderBlob->GetBufferSize() };
+	pipelineStateDesc.PS = { pixelShaderBlob->GetBufferPointer(), pixelShaderBlob->GetBufferSize() };
+	// 半透明合成
+	D3D12_RENDER_TARGET_BLEND_DESC& blendDesc = pipelineStateDesc.BlendState.RenderTarget[0];
+	blendDesc.BlendEnable = TRUE;
+	blendDesc.SrcBlend = D3D12_BLEND_SRC_ALPHA;
+	blendDesc.DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+	blendDesc.BlendOp = D3D12_BLEND_OP_ADD;
+	blendDesc.SrcBlendAlpha = D3D12_BLEND_ONE;
+	blendDesc.DestBlendAlpha = D3D12_BLEND_ZERO;
+	blendDesc.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+	blendDesc.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+	pipelineStateDesc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+	pipelineStateDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	pipelineStateDesc.RasterizerState.DepthClipEnable = TRUE;
+	pipelineStateDesc.SampleMask = D3D12_DEFAULT_SAMPLE_MASK;
+	pipelineStateDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	pipelineStateDesc.NumRenderTargets = 1;
+	// バックバッファのRTVと同じ形式
+	pipelineStateDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	pipelineStateDesc.SampleDesc.Count = 1;
+	ID3D12PipelineState* pipelineState = nullptr;
+	HRESULT hr = device->CreateGraphicsPipelineState(&pipelineStateDesc, IID_PPV_ARGS(&pipelineState));
+
+	vertexShaderBlob->Release();
+	pixelShaderBlob->Release();
+	return SUCCEEDED(hr) ? pipelineState : nullptr;
+}
+
+ID3D12PipelineState* SpriteRenderer::SwapPipelineState(ID3D12PipelineState* pipelineState) {
+	ID3D12PipelineState* oldPipelineState = pipelineState_;
+	pipelineState_ = pipelineState;
+	return oldPipelineState;
+}
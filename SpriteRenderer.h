@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <d3d12.h>
+
+#include "BindlessHeap.h"
+#include "SpriteBatch.h"
+#include "TextureCooker.h"
+
+/// <summary>
+/// SpriteBatchの内容をレイヤーごとに1回のインスタンス描画で描く。
+/// インスタンスは常時マップしたアップロードヒープの頂点バッファへ直接書き、テクスチャはバインドレスヒープから引く
+/// </summary>
+class SpriteRenderer {
+public: // 静的メンバ変数
+	// 頂点バッファをフレームごとに分ける数(GPUが読んでいる領域に書き込まないため)
+	static const uint32_t kFrameCount = 2;
+
+public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	/// <param name="bindlessHeap">テクスチャのSRVを置くヒープ</param>
+	/// <param name="maxSpriteCount">1フレームに描けるスプライト数の上限</param>
+	void Initialize(ID3D12Device* device, BindlessHeap* bindlessHeap, uint32_t maxSpriteCount);
+
+	/// <summary>
+	/// 解放(作ったテクスチャも含む)
+	/// </summary>
+	void Finalize();
+
+	/// <summary>
+	/// アトラスのページからテクスチャを作る
+	/// </summary>
+	/// <returns>スプライトのtextureIndexに渡すSRV</returns>
+	BindlessHandle CreateTexture(ID3D12Device* device, const TextureImage& image);
+
+	/// <summary>
+	/// 積んだスプライトを並べ替えて描く。描画先は設定済みであること
+	/// </summary>
+	/// <param name="commandList">コマンドリスト</param>
+	/// <param name="batch">今フレームのスプライト</param>
+	/// <param name="screenWidth">描画先の幅</param>
+	/// <param name="screenHeight">描画先の高さ</param>
+	void Render(ID3D12GraphicsCommandList* commandList, SpriteBatch& batch, uint32_t screenWidth, uint32_t screenHeight);
+
+	/// <summary>
+	/// Sprite.hlslからパイプラインを作る。失敗したらnullptr(別スレッドから呼べる)
+	/// </summary>
+	ID3D12PipelineState* CreatePipelineState(ID3D12Device* device) const;
+
+	/// <summary>
+	/// パイプラインを差し替える
+	/// </summary>
+	/// <returns>古いパイプライン(GPUが使い終えてから呼び出し側で解放する)</returns>
+	ID3D12PipelineState* SwapPipelineState(ID3D12PipelineState* pipelineState);
+
+private: // サブクラス
+	// ルート定数(Sprite.hlslのSpriteConstantsと同じ並び)
+	struct Constants {
+		float screenSize[2];
+	};
+
+private: // メンバ関数
+	/// <summary>
+	/// ルートシグネチャとパイプラインの生成
+	/// </summary>
+	void CreatePipeline(ID3D12Device* device);
+
+private: // メンバ変数
+	ID3D12RootSignature* rootSignature_ = nullptr;
+	ID3D12PipelineState* pipelineState_ = nullptr;
+	BindlessHeap* bindlessHeap_ = nullptr;
+
+	ID3D12Resource* instanceBuffer_ = nullptr;
+	SpriteInstance* mappedInstances_ = nullptr;
+	uint32_t maxSpriteCount_ = 0;
+	uint32_t frameIndex_ = 0;
+
+	std::vector<ID3D12Resource*> textures_;
+	std::vector<BindlessHandle> textureHandles_;
+};
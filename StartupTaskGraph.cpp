@@ -0,0 +1,204 @@
+#include "StartupTaskGraph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ToMilliseconds(Clock::time_point start, Clock::time_point time) {
+	return std::chrono::duration<double, std::milli>(time - start).count();
+}
+
+} // namespace
+
+StartupTaskGraph::TaskId StartupTaskGraph::AddTask(const char* name, std::function<bool()> function, std::initializer_list<TaskId> dependencies, Affinity affinity) {
+	TaskId id = static_cast<TaskId>(tasks_.size());
+	Task& task = tasks_.emplace_back();
+	task.name = name;
+	task.function = std::move(function);
+	task.affinity = affinity;
+	for (TaskId dependency : dependencies) {
+		// 先に追加したタスクにしか依存できないので循環は起きない
+		assert(dependency < id);
+		task.dependencies.push_back(dependency);
+		tasks_[dependency].dependents.push_back(id);
+	}
+	return id;
+}
+
+bool StartupTaskGraph::Run(uint32_t workerCount) {
+	const size_t taskCount = tasks_.size();
+	timeline_.assign(taskCount, TimelineEntry());
+	for (size_t i = 0; i < taskCount; ++i) {
+		timeline_[i].name = tasks_[i].name;
+	}
+	const Clock::time_point startTime = Clock::now();
+
+	if (workerCount == 0) {
+		// 比較用に追加順にそのまま実行する
+		for (size_t i = 0; i < taskCount; ++i) {
+			TimelineEntry& entry = timeline_[i];
+			bool dependencyFailed = std::any_of(tasks_[i].dependencies.begin(), tasks_[i].dependencies.end(),
+				[this](TaskId dependency) { return !timeline_[dependency].succeeded; });
+			entry.startMilliseconds = ToMilliseconds(startTime, Clock::now());
+			if (dependencyFailed) {
+				entry.skipped = true;
+			} else {
+				entry.succeeded = tasks_[i].function();
+			}
+			entry.endMilliseconds = ToMilliseconds(startTime, Clock::now());
+		}
+		totalMilliseconds_ = ToMilliseconds(startTime, Clock::now());
+		return std::all_of(timeline_.begin(), timeline_.end(), [](const TimelineEntry& entry) { return entry.succeeded; });
+	}
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<TaskId> workerQueue;
+	std::deque<TaskId> mainQueue;
+	std::vector<uint32_t> pendingCounts(taskCount);
+	std::vector<bool> dependencyFailed(taskCount, false);
+	size_t completedCount = 0;
+
+	// 以下の2つはmutexを取った状態で呼ぶ
+	std::function<void(TaskId, bool)> complete;
+	auto enqueue = [&](TaskId id) {
+		if (dependencyFailed[id]) {
+			// 依存先が失敗したので実行せずに終わらせる
+			TimelineEntry& entry = timeline_[id];
+			entry.skipped = true;
+			entry.startMilliseconds = entry.endMilliseconds = ToMilliseconds(startTime, Clock::now());
+			complete(id, false);
+			return;
+		}
+		if (tasks_[id].affinity == Affinity::MainThread) {
+			mainQueue.push_back(id);
+		} else {
+			workerQueue.push_back(id);
+		}
+	};
+	complete = [&](TaskId id, bool succeeded) {
+		++completedCount;
+		for (TaskId dependent : tasks_[id].dependents) {
+			if (!succeeded) {
+				dependencyFailed[dependent] = true;
+			}
+			if (--pendingCounts[dependent] == 0) {
+				enqueue(dependent);
+			}
+		}
+	};
+
+	// キューからタスクを取り出して実行するループ。全タスクが終わったら抜ける
+	auto process = [&](std::deque<TaskId>& queue, uint32_t threadIndex) {
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;) {
+			condition.wait(lock, [&] { return !queue.empty() || completedCount == taskCount; });
+			if (queue.empty()) {
+				return;
+			}
+			TaskId id = queue.front();
+			queue.pop_front();
+			lock.unlock();
+
+			double start = ToMilliseconds(startTime, Clock::now());
+			bool succeeded = tasks_[id].function();
+			double end = ToMilliseconds(startTime, Clock::now());
+
+			lock.lock();
+			TimelineEntry& entry = timeline_[id];
+			entry.startMilliseconds = start;
+			entry.endMilliseconds = end;
+			entry.threadIndex = threadIndex;
+			entry.succeeded = succeeded;
+			complete(id, succeeded);
+			condition.notify_all();
+		}
+	};
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < taskCount; ++i) {
+			pendingCounts[i] = static_cast<uint32_t>(tasks_[i].dependencies.size());
+		}
+		for (size_t i = 0; i < taskCount; ++i) {
+			if (pendingCounts[i] == 0) {
+				enqueue(static_cast<TaskId>(i));
+			}
+		}
+	}
+
+	std::vector<std::thread> workers;
+	workers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; ++i) {
+		workers.emplace_back(process, std::ref(workerQueue), i + 1);
+	}
+	// メインスレッド指定のタスクはここで実行する
+	process(mainQueue, 0);
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	totalMilliseconds_ = ToMilliseconds(startTime, Clock::now());
+	return std::all_of(timeline_.begin(), timeline_.end(), [](const TimelineEntry& entry) { return entry.succeeded; });
+}
+
+double StartupTaskGraph::GetSerialMilliseconds() const {
+	double total = 0.0;
+	for (const TimelineEntry& entry : timeline_) {
+		total += entry.endMilliseconds - entry.startMilliseconds;
+	}
+	return total;
+}
+
+double StartupTaskGraph::GetCriticalPathMilliseconds() const {
+	// 追加順がトポロジカル順になっているので前から1回なめればよい
+	std::vector<double> finish(timeline_.size(), 0.0);
+	double longest = 0.0;
+	for (size_t i = 0; i < timeline_.size(); ++i) {
+		double start = 0.0;
+		for (TaskId dependency : tasks_[i].dependencies) {
+			start = std::max(start, finish[dependency]);
+		}
+		finish[i] = start + (timeline_[i].endMilliseconds - timeline_[i].startMilliseconds);
+		longest = std::max(longest, finish[i]);
+	}
+	return longest;
+}
+
+std::string StartupTaskGraph::FormatTimeline() const {
+	const int kBarWidth = 40;
+	size_t nameWidth = 4;
+	for (const TimelineEntry& entry : timeline_) {
+		nameWidth = std::max(nameWidth, entry.name.size());
+	}
+	double scale = totalMilliseconds_ > 0.0 ? kBarWidth / totalMilliseconds_ : 0.0;
+
+	std::string text;
+	for (const TimelineEntry& entry : timeline_) {
+		// 開始から終了までを#で表す
+		std::string bar(kBarWidth, ' ');
+		int begin = std::clamp(static_cast<int>(entry.startMilliseconds * scale), 0, kBarWidth - 1);
+		int end = std::clamp(static_cast<int>(entry.endMilliseconds * scale), begin + 1, kBarWidth);
+		std::fill(bar.begin() + begin, bar.begin() + end, entry.skipped ? '-' : '#');
+
+		const char* status = entry.skipped ? " skipped" : (entry.succeeded ? "" : " FAILED");
+		char line[256];
+		snprintf(line, sizeof(line), "%-*s %8.2f - %8.2f ms (%8.2f ms) T%u |%s|%s\n", static_cast<int>(nameWidth), entry.name.c_str(),
+			entry.startMilliseconds, entry.endMilliseconds, entry.endMilliseconds - entry.startMilliseconds, entry.threadIndex, bar.c_str(), status);
+		text += line;
+	}
+	char summary[128];
+	snprintf(summary, sizeof(summary), "Total %.2f ms, serial %.2f ms, critical path %.2f ms\n",
+		totalMilliseconds_, GetSerialMilliseconds(), GetCriticalPathMilliseconds());
+	text += summary;
+	return text;
+}
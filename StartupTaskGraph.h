@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// 起動時の初期化処理を依存関係つきのタスクとして並列に実行し、各ステップの時間を記録する。
+/// 依存先は先に追加したタスクしか指定できないので、追加順がそのまま実行可能な順序になる
+/// </summary>
+class StartupTaskGraph {
+public: // サブクラス
+	using TaskId = uint32_t;
+
+	/// <summary>
+	/// 実行するスレッドの指定
+	/// </summary>
+	enum class Affinity {
+		Any,        // ワーカースレッドで実行する
+		MainThread, // Runを呼んだスレッドで実行する(ウィンドウやスワップチェーンの生成など)
+	};
+
+	/// <summary>
+	/// 1ステップ分の記録(時間はRun開始からのミリ秒)
+	/// </summary>
+	struct TimelineEntry {
+		std::string name;
+		double startMilliseconds = 0.0;
+		double endMilliseconds = 0.0;
+		uint32_t threadIndex = 0; // 0がメインスレッド、1以降がワーカー
+		bool succeeded = false;
+		bool skipped = false;     // 依存先が失敗したので実行しなかった
+	};
+
+public: // メンバ関数
+	/// <summary>
+	/// タスクの追加
+	/// </summary>
+	/// <param name="name">タイムラインに出す名前</param>
+	/// <param name="function">処理。失敗したらfalseを返す(依存しているタスクは実行しない)</param>
+	/// <param name="dependencies">先に終わっている必要があるタスク</param>
+	/// <param name="affinity">実行するスレッド</param>
+	TaskId AddTask(const char* name, std::function<bool()> function, std::initializer_list<TaskId> dependencies = {}, Affinity affinity = Affinity::Any);
+
+	/// <summary>
+	/// 全タスクを実行して終わるまで待つ
+	/// </summary>
+	/// <param name="workerCount">ワーカースレッド数。0なら追加順にメインスレッドだけで実行する</param>
+	/// <returns>全タスクが成功したか</returns>
+	bool Run(uint32_t workerCount);
+
+	const std::vector<TimelineEntry>& GetTimeline() const { return timeline_; }
+
+	/// <summary>
+	/// Run全体にかかった時間
+	/// </summary>
+	double GetTotalMilliseconds() const { return totalMilliseconds_; }
+
+	/// <summary>
+	/// 各タスクの時間の合計(順番に実行した場合の目安)
+	/// </summary>
+	double GetSerialMilliseconds() const;
+
+	/// <summary>
+	/// 依存関係上もっとも長い経路の時間(並列化しても縮まない下限)
+	/// </summary>
+	double GetCriticalPathMilliseconds() const;
+
+	/// <summary>
+	/// タイムラインを文字列にする
+	/// </summary>
+	std::string FormatTimeline() const;
+
+private: // サブクラス
+	struct Task {
+		std::string name;
+		std::function<bool()> function;
+		std::vector<TaskId> dependencies;
+		std::vector<TaskId> dependents;
+		Affinity affinity = Affinity::Any;
+	};
+
+private: // メンバ変数
+	std::vector<Task> tasks_;
+	std::vector<TimelineEntry> timeline_;
+	double totalMilliseconds_ = 0.0;
+};
@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "AnimationClip.h"
+#include "TestFramework.h"
+
+namespace {
+
+const float kPi = 3.14159265f;
+
+// 環境によらず同じ列を返す乱数
+class Random {
+public:
+	explicit Random(uint32_t seed) : state_(seed) {}
+
+	uint32_t Next() {
+		state_ = state_ * 1664525u + 1013904223u;
+		return state_ >> 8;
+	}
+
+	float Range(float minimum, float maximum) {
+		return minimum + (maximum - minimum) * static_cast<float>(Next() & 0xFFFF) / 65535.0f;
+	}
+
+private:
+	uint32_t state_;
+};
+
+// 関節ごとに周期と軸の違う動きをつけたクリップ。一部の関節は動かさず、一部は急に向きを変える
+void MakeClip(uint32_t jointCount, uint32_t frameCount, uint32_t seed, AnimationClip& outClip) {
+	Random random(seed);
+	outClip.Initialize(jointCount, frameCount, 30.0f);
+	for (uint32_t joint = 0; joint < jointCount; ++joint) {
+		const float frequency = random.Range(0.5f, 3.0f);
+		const float phase = random.Range(0.0f, 2.0f * kPi);
+		float axis[3] = { random.Range(-1.0f, 1.0f), random.Range(-1.0f, 1.0f), random.Range(-1.0f, 1.0f) };
+		const float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		for (float& component : axis) {
+			component /= axisLength;
+		}
+		const float amplitude = random.Range(0.2f, 2.5f);
+		const bool isStatic = joint % 5 == 4;
+		const bool isStep = joint % 7 == 6;
+		for (uint32_t frame = 0; frame < frameCount; ++frame) {
+			const float time = static_cast<float>(frame) / 30.0f;
+			float wave = std::sin(2.0f * kPi * frequency * time + phase);
+			if (isStatic) {
+				wave = 0.25f;
+			} else if (isStep) {
+				wave = frame < frameCount / 2 ? -0.5f : 0.5f;
+			}
+			JointTransform& key = outClip.GetKey(frame, joint);
+			key.translation[0] = 0.5f * wave;
+			key.translation[1] = 0.2f * static_cast<float>(joint) + 0.05f * wave * wave;
+			key.translation[2] = -0.3f * wave;
+			const float angle = amplitude * wave;
+			const float s = std::sin(angle * 0.5f);
+			key.rotation[0] = axis[0] * s;
+			key.rotation[1] = axis[1] * s;
+			key.rotation[2] = axis[2] * s;
+			key.rotation[3] = std::cos(angle * 0.5f);
+			key.scale[0] = key.scale[1] = key.scale[2] = 1.0f + 0.1f * wave;
+		}
+	}
+}
+
+struct PoseError {
+	float translation = 0.0f;
+	float rotation = 0.0f;
+	float scale = 0.0f;
+};
+
+PoseError MeasureError(const AnimationPose& a, const AnimationPose& b) {
+	PoseError error;
+	for (uint32_t joint = 0; joint < a.jointCount; ++joint) {
+		const JointTransform ja = a.GetJoint(joint);
+		const JointTransform jb = b.GetJoint(joint);
+		// qと-qは同じ回転なので符号をそろえて比べる
+		const float dot = ja.rotation[0] * jb.rotation[0] + ja.rotation[1] * jb.rotation[1] + ja.rotation[2] * jb.rotation[2] + ja.rotation[3] * jb.rotation[3];
+		const float sign = dot < 0.0f ? -1.0f : 1.0f;
+		for (uint32_t i = 0; i < 4; ++i) {
+			error.rotation = std::max(error.rotation, std::abs(ja.rotation[i] - jb.rotation[i] * sign));
+		}
+		for (uint32_t i = 0; i < 3; ++i) {
+			error.translation = std::max(error.translation, std::abs(ja.translation[i] - jb.translation[i]));
+			error.scale = std::max(error.scale, std::abs(ja.scale[i] - jb.scale[i]));
+		}
+	}
+	return error;
+}
+
+// 浮動小数点の丸めの分だけ許容誤差に足す
+const float kEpsilon = 1.0e-5f;
+
+} // namespace
+
+TEST_CASE(CompressedMatchesSourceAtKeys) {
+	for (const ClipCompressionSettings& settings : { ClipCompressionSettings(), ClipCompressionSettings{ 0.005f, 0.002f, 0.01f } }) {
+		AnimationClip clip;
+		MakeClip(40, 91, 3, clip);
+		CompressedClip compressed;
+		compressed.Compress(clip, settings);
+		REQUIRE(compressed.GetJointCount() == clip.GetJointCount());
+		CHECK_NEAR(compressed.GetDuration(), clip.GetDuration(), 1.0e-6);
+
+		AnimationPose expected;
+		AnimationPose actual;
+		PoseError worst;
+		for (uint32_t frame = 0; frame + 1 < clip.GetFrameCount(); ++frame) {
+			const float time = static_cast<float>(frame) / clip.GetSampleRate();
+			clip.Sample(time, expected);
+			compressed.Sample(time, actual);
+			const PoseError error = MeasureError(expected, actual);
+			worst.translation = std::max(worst.translation, error.translation);
+			worst.rotation = std::max(worst.rotation, error.rotation);
+			worst.scale = std::max(worst.scale, error.scale);
+		}
+		CHECK(worst.translation <= settings.translationTolerance + kEpsilon);
+		CHECK(worst.rotation <= settings.rotationTolerance + kEpsilon);
+		CHECK(worst.scale <= settings.scaleTolerance + kEpsilon);
+	}
+}
+
+TEST_CASE(CompressedMatchesSourceBetweenKeys) {
+	const ClipCompressionSettings settings;
+	AnimationClip clip;
+	MakeClip(64, 61, 9, clip);
+	CompressedClip compressed;
+	compressed.Compress(clip, settings);
+
+	Random random(5);
+	AnimationPose expected;
+	AnimationPose actual;
+	PoseError worst;
+	for (uint32_t i = 0; i < 2000; ++i) {
+		const float time = random.Range(0.0f, clip.GetDuration());
+		clip.Sample(time, expected);
+		compressed.Sample(time, actual);
+		const PoseError error = MeasureError(expected, actual);
+		worst.translation = std::max(worst.translation, error.translation);
+		worst.rotation = std::max(worst.rotation, error.rotation);
+		worst.scale = std::max(worst.scale, error.scale);
+	}
+	// 移動と拡縮はキーの誤差の線形補間なので許容誤差に収まる。回転は圧縮時にフレームの間も確かめている
+	CHECK(worst.translation <= settings.translationTolerance + kEpsilon);
+	CHECK(worst.scale <= settings.scaleTolerance + kEpsilon);
+	CHECK(worst.rotation <= settings.rotationTolerance + kEpsilon);
+}
+
+TEST_CASE(CompressionShrinksClip) {
+	AnimationClip clip;
+	MakeClip(64, 121, 11, clip);
+	CompressedClip compressed;
+	compressed.Compress(clip);
+	CHECK(compressed.GetSizeInBytes() < clip.GetSizeInBytes() / 2);
+	CHECK(compressed.GetKeyCount() < static_cast<size_t>(clip.GetFrameCount()) * clip.GetJointCount() * 3);
+
+	// 許容誤差を緩めるとキーが減る
+	CompressedClip loose;
+	loose.Compress(clip, ClipCompressionSettings{ 0.01f, 0.01f, 0.01f });
+	CHECK(loose.GetKeyCount() < compressed.GetKeyCount());
+	CHECK(loose.GetSizeInBytes() < compressed.GetSizeInBytes());
+}
+
+TEST_CASE(ConstantTracksKeepOneKey) {
+	AnimationClip clip;
+	clip.Initialize(8, 31, 30.0f);
+	for (uint32_t frame = 0; frame < clip.GetFrameCount(); ++frame) {
+		for (uint32_t joint = 0; joint < clip.GetJointCount(); ++joint) {
+			clip.GetKey(frame, joint).translation[1] = 0.5f * static_cast<float>(joint);
+		}
+	}
+	CompressedClip compressed;
+	compressed.Compress(clip);
+	// 関節ごとに移動・回転・拡縮の3トラック
+	CHECK(compressed.GetKeyCount() == 8 * 3);
+
+	AnimationPose pose;
+	compressed.Sample(0.4f, pose);
+	for (uint32_t joint = 0; joint < 8; ++joint) {
+		const JointTransform transform = pose.GetJoint(joint);
+		CHECK_NEAR(transform.translation[1], 0.5f * static_cast<float>(joint), 1.0e-6);
+		CHECK_NEAR(transform.rotation[3], 1.0f, 1.0e-4);
+		CHECK_NEAR(transform.scale[0], 1.0f, 1.0e-6);
+	}
+}
+
+TEST_CASE(SamplingLoops) {
+	AnimationClip clip;
+	MakeClip(12, 31, 21, clip);
+	CompressedClip compressed;
+	compressed.Compress(clip);
+	AnimationPose a;
+	AnimationPose b;
+	for (float time : { 0.1f, 0.55f, 0.9f }) {
+		clip.Sample(time, a);
+		clip.Sample(time + clip.GetDuration() * 3.0f, b);
+		PoseError error = MeasureError(a, b);
+		CHECK(error.translation < 1.0e-4f && error.rotation < 1.0e-4f);
+		compressed.Sample(time, a);
+		compressed.Sample(time - compressed.GetDuration(), b);
+		error = MeasureError(a, b);
+		CHECK(error.translation < 1.0e-4f && error.rotation < 1.0e-4f);
+	}
+}
+
+TEST_CASE(PosePadsToMultipleOfFour) {
+	AnimationPose pose;
+	pose.Resize(5);
+	CHECK(pose.jointCount == 5);
+	CHECK(pose.translationX.size() % 4 == 0 && pose.translationX.size() >= 5);
+	// 埋めた分は単位変換
+	CHECK(pose.rotationW.back() == 1.0f);
+	CHECK(pose.scaleX.back() == 1.0f);
+
+	AnimationClip clip;
+	MakeClip(5, 31, 2, clip);
+	AnimationPose a;
+	AnimationPose b;
+	AnimationPose blended;
+	clip.Sample(0.2f, a);
+	clip.Sample(0.7f, b);
+	AnimationPose::Blend(a, b, 0.0f, blended);
+	CHECK(MeasureError(a, blended).translation < 1.0e-6f);
+	AnimationPose::Blend(a, b, 1.0f, blended);
+	CHECK(MeasureError(b, blended).rotation < 1.0e-5f);
+}
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "BenchmarkReport.h"
+#include "TestFramework.h"
+
+namespace {
+
+// 段階2つのシーン。stageMillisecondsは1フレーム目から順に1ずつ増やす
+BenchmarkSceneResult MakeScene(const std::string& name, uint32_t frameCount, double stageScale = 1.0) {
+	BenchmarkSceneResult scene;
+	scene.name = name;
+	scene.threadCount = 4;
+	scene.stageNames = { "Culling", "Lighting" };
+	for (uint32_t i = 0; i < frameCount; ++i) {
+		BenchmarkSceneResult::Frame frame;
+		frame.stageMilliseconds = { stageScale * (1.0 + i), stageScale * 0.5 };
+		frame.totalMilliseconds = frame.stageMilliseconds[0] + frame.stageMilliseconds[1];
+		frame.allocationCount = 10;
+		frame.allocatedBytes = 1000;
+		frame.drawCount = 20;
+		frame.dispatchCount = 3;
+		frame.instanceCount = 5000;
+		frame.pipelineChangeCount = 4;
+		scene.frames.push_back(frame);
+	}
+	scene.metrics.push_back({ "Bvh.buildMilliseconds", 2.5 });
+	scene.Summarize();
+	return scene;
+}
+
+BenchmarkReport MakeReport(const std::vector<BenchmarkSceneResult>& scenes) {
+	BenchmarkReport report;
+	report.SetDescription("test \"report\"\n");
+	report.GetScenes() = scenes;
+	return report;
+}
+
+// JSONを経由して読み込んだもの(比較は保存した基準とするので、読み込んだ側で比べる)
+BenchmarkReport RoundTrip(const BenchmarkReport& report, bool includeFrames = false) {
+	BenchmarkReport loaded;
+	loaded.FromJson(report.ToJson(includeFrames));
+	return loaded;
+}
+
+bool HasRegression(const std::vector<BenchmarkRegression>& regressions, const std::string& scene, const std::string& metric) {
+	return std::any_of(regressions.begin(), regressions.end(), [&](const BenchmarkRegression& regression) {
+		return regression.scene == scene && regression.metric == metric;
+	});
+}
+
+} // namespace
+
+TEST_CASE(SummarizeUsesNearestRankPercentiles) {
+	const BenchmarkSceneResult scene = MakeScene("Small", 100);
+	CHECK(scene.frameCount == 100);
+	REQUIRE(scene.stageSummaries.size() == 2);
+	// 1〜100ミリ秒が1回ずつ
+	CHECK_NEAR(scene.stageSummaries[0].mean, 50.5, 1.0e-9);
+	CHECK_NEAR(scene.stageSummaries[0].median, 50.0, 1.0e-9);
+	CHECK_NEAR(scene.stageSummaries[0].p95, 95.0, 1.0e-9);
+	CHECK_NEAR(scene.stageSummaries[0].p99, 99.0, 1.0e-9);
+	CHECK_NEAR(scene.stageSummaries[0].max, 100.0, 1.0e-9);
+	CHECK_NEAR(scene.totalSummary.median, 50.5, 1.0e-9);
+	CHECK_NEAR(scene.drawsPerFrame, 20.0, 1.0e-9);
+	CHECK_NEAR(scene.allocatedBytesPerFrame, 1000.0, 1.0e-9);
+}
+
+TEST_CASE(JsonRoundTripKeepsSummaries) {
+	const BenchmarkReport report = MakeReport({ MakeScene("Small", 30), MakeScene("City", 60, 2.0) });
+	for (bool includeFrames : { false, true }) {
+		BenchmarkReport loaded;
+		REQUIRE(loaded.FromJson(report.ToJson(includeFrames)));
+		CHECK(loaded.GetDescription() == report.GetDescription());
+		REQUIRE(loaded.GetScenes().size() == 2);
+		const BenchmarkSceneResult& original = report.GetScenes()[1];
+		const BenchmarkSceneResult& scene = loaded.GetScenes()[1];
+		CHECK(scene.name == "City");
+		CHECK(scene.threadCount == 4);
+		// フレームごとの値は読まないが、フレーム数は残る
+		CHECK(scene.frameCount == 60);
+		CHECK(scene.frames.empty());
+		CHECK(scene.stageNames == original.stageNames);
+		REQUIRE(scene.stageSummaries.size() == 2);
+		CHECK_NEAR(scene.stageSummaries[0].p95, original.stageSummaries[0].p95, 1.0e-6);
+		CHECK_NEAR(scene.totalSummary.median, original.totalSummary.median, 1.0e-6);
+		CHECK_NEAR(scene.pipelineChangesPerFrame, 4.0, 1.0e-9);
+		REQUIRE(scene.metrics.size() == 1);
+		CHECK(scene.metrics[0].name == "Bvh.buildMilliseconds");
+		CHECK_NEAR(scene.metrics[0].value, 2.5, 1.0e-9);
+
+		// 読み込んだものを書き出してもフレーム数は変わらない
+		BenchmarkReport reloaded;
+		REQUIRE(reloaded.FromJson(loaded.ToJson()));
+		CHECK(reloaded.GetScenes()[1].frameCount == 60);
+	}
+}
+
+TEST_CASE(ReadRejectsBrokenFiles) {
+	BenchmarkReport report;
+	CHECK(!report.FromJson(""));
+	CHECK(!report.FromJson("{ \"version\": 1, \"scenes\": [ }"));
+	CHECK(!report.FromJson("{ \"version\": 99, \"scenes\": [] }"));
+	CHECK(!report.FromJson("{ \"version\": 1 }"));
+	CHECK(!report.FromJson("{ \"version\": 1, \"scenes\": [] } trailing"));
+	CHECK(report.FromJson("{ \"version\": 1, \"scenes\": [] }"));
+	CHECK(!report.Read("BenchmarkReportTest_missing.json"));
+}
+
+TEST_CASE(WriteAndReadFile) {
+	const BenchmarkReport report = MakeReport({ MakeScene("Small", 10) });
+	const std::string path = "BenchmarkReportTest_report.json";
+	REQUIRE(report.Write(path));
+	BenchmarkReport loaded;
+	CHECK(loaded.Read(path));
+	std::remove(path.c_str());
+	REQUIRE(loaded.GetScenes().size() == 1);
+	CHECK(loaded.GetScenes()[0].frameCount == 10);
+}
+
+TEST_CASE(IdenticalReportsHaveNoRegressions) {
+	const BenchmarkReport report = RoundTrip(MakeReport({ MakeScene("Small", 30), MakeScene("City", 30) }));
+	std::vector<BenchmarkRegression> regressions;
+	CHECK(BenchmarkReport::Compare(report, report, 0.1, regressions));
+	CHECK(regressions.empty());
+}
+
+TEST_CASE(SlowerStagesAreRegressions) {
+	const BenchmarkReport baseline = RoundTrip(MakeReport({ MakeScene("Small", 30) }));
+	std::vector<BenchmarkRegression> regressions;
+
+	// 5%ならしきい値の内側
+	CHECK(BenchmarkReport::Compare(baseline, RoundTrip(MakeReport({ MakeScene("Small", 30, 1.05) })), 0.1, regressions));
+
+	// 20%遅くなると中央値とp95の両方で報告する
+	CHECK(!BenchmarkReport::Compare(baseline, RoundTrip(MakeReport({ MakeScene("Small", 30, 1.2) })), 0.1, regressions));
+	CHECK(HasRegression(regressions, "Small", "Culling.median"));
+	CHECK(HasRegression(regressions, "Small", "Culling.p95"));
+	CHECK(HasRegression(regressions, "Small", "total.median"));
+	const auto median = std::find_if(regressions.begin(), regressions.end(), [](const BenchmarkRegression& regression) { return regression.metric == "Culling.median"; });
+	CHECK_NEAR(median->ratio, 1.2, 1.0e-6);
+
+	// 速くなったものは報告しない
+	regressions.clear();
+	CHECK(BenchmarkReport::Compare(baseline, RoundTrip(MakeReport({ MakeScene("Small", 30, 0.5) })), 0.1, regressions));
+}
+
+TEST_CASE(TinyTimeDifferencesAreIgnored) {
+	// 割合では大きくても、差が揺れの範囲なら報告しない
+	const BenchmarkReport baseline = RoundTrip(MakeReport({ MakeScene("Small", 30, 0.001) }));
+	const BenchmarkReport current = RoundTrip(MakeReport({ MakeScene("Small", 30, 0.0015) }));
+	std::vector<BenchmarkRegression> regressions;
+	CHECK(BenchmarkReport::Compare(baseline, current, 0.1, regressions));
+}
+
+TEST_CASE(MissingScenesAndStagesAreRegressions) {
+	const BenchmarkReport baseline = RoundTrip(MakeReport({ MakeScene("Small", 30), MakeScene("City", 30) }));
+	BenchmarkSceneResult renamed = MakeScene("Small", 30);
+	renamed.stageNames[1] = "Lights";
+	renamed.Summarize();
+	// 今回にだけあるシーンは悪化ではない
+	const BenchmarkReport current = RoundTrip(MakeReport({ renamed, MakeScene("Stress", 30) }));
+	std::vector<BenchmarkRegression> regressions;
+	CHECK(!BenchmarkReport::Compare(baseline, current, 0.1, regressions));
+	CHECK(HasRegression(regressions, "City", "missing"));
+	CHECK(HasRegression(regressions, "Small", "Lighting.missing"));
+	CHECK(!HasRegression(regressions, "Stress", "missing"));
+	CHECK(regressions.size() == 2);
+}
+
+TEST_CASE(DifferentRunConditionsAreRegressions) {
+	const BenchmarkReport baseline = RoundTrip(MakeReport({ MakeScene("Small", 30), MakeScene("City", 30) }));
+	BenchmarkSceneResult threads = MakeScene("Small", 30, 2.0);
+	threads.threadCount = 8;
+	const BenchmarkReport current = RoundTrip(MakeReport({ threads, MakeScene("City", 10) }));
+	std::vector<BenchmarkRegression> regressions;
+	CHECK(!BenchmarkReport::Compare(baseline, current, 0.1, regressions));
+	CHECK(HasRegression(regressions, "Small", "threadCount"));
+	CHECK(HasRegression(regressions, "City", "frameCount"));
+	// 条件の違うシーンの時間は比べない
+	CHECK(!HasRegression(regressions, "Small", "Culling.median"));
+	CHECK(regressions.size() == 2);
+}
+
+TEST_CASE(DrawCountChangesAreRegressionsInBothDirections) {
+	const BenchmarkReport baseline = RoundTrip(MakeReport({ MakeScene("Small", 30) }));
+	std::vector<BenchmarkRegression> regressions;
+
+	// 描画・ディスパッチ・パイプライン切り替えは、しきい値の内側でも減っても報告する
+	BenchmarkSceneResult fewerDraws = MakeScene("Small", 30);
+	fewerDraws.drawsPerFrame = 19.0;
+	fewerDraws.dispatchesPerFrame = 3.1;
+	fewerDraws.pipelineChangesPerFrame = 5.0;
+	CHECK(!BenchmarkReport::Compare(baseline, RoundTrip(MakeReport({ fewerDraws })), 0.5, regressions));
+	CHECK(HasRegression(regressions, "Small", "drawsPerFrame"));
+	CHECK(HasRegression(regressions, "Small", "dispatchesPerFrame"));
+	CHECK(HasRegression(regressions, "Small", "pipelineChangesPerFrame"));
+
+	// 確保の数やインスタンス数は、しきい値を超えて増えたときだけ
+	regressions.clear();
+	BenchmarkSceneResult allocations = MakeScene("Small", 30);
+	allocations.allocationsPerFrame = 5.0;
+	allocations.instancesPerFrame = 5200.0;
+	CHECK(BenchmarkReport::Compare(baseline, RoundTrip(MakeReport({ allocations })), 0.1, regressions));
+	allocations.allocationsPerFrame = 12.0;
+	CHECK(!BenchmarkReport::Compare(baseline, RoundTrip(MakeReport({ allocations })), 0.1, regressions));
+	CHECK(HasRegression(regressions, "Small", "allocationsPerFrame"));
+	CHECK(regressions.size() == 1);
+}
+
+TEST_CASE(CountersFromZeroAreRegressions) {
+	BenchmarkSceneResult base = MakeScene("Small", 30);
+	base.allocationsPerFrame = 0.0;
+	const BenchmarkReport baseline = RoundTrip(MakeReport({ base }));
+	BenchmarkSceneResult scene = MakeScene("Small", 30);
+	scene.allocationsPerFrame = 0.1;
+	std::vector<BenchmarkRegression> regressions;
+	CHECK(!BenchmarkReport::Compare(baseline, RoundTrip(MakeReport({ scene })), 10.0, regressions));
+	CHECK(HasRegression(regressions, "Small", "allocationsPerFrame"));
+	CHECK(regressions[0].ratio == 0.0);
+}
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "BindlessAllocator.h"
+#include "TestFramework.h"
+
+TEST_CASE(HandlesPackIndexAndVersion) {
+	BindlessHandle handle = BindlessHandle::Make(12345, 7);
+	CHECK(handle.GetIndex() == 12345);
+	CHECK(handle.GetVersion() == 7);
+	CHECK(!handle.IsNull());
+	CHECK(BindlessHandle().IsNull());
+	// 最大のインデックスと世代でも互いに混ざらない
+	BindlessHandle last = BindlessHandle::Make(BindlessHandle::kMaxCapacity - 1, BindlessHandle::kVersionMask);
+	CHECK(last.GetIndex() == BindlessHandle::kMaxCapacity - 1);
+	CHECK(last.GetVersion() == BindlessHandle::kVersionMask);
+}
+
+TEST_CASE(AllocatesUniqueIndicesUntilFull) {
+	BindlessAllocator allocator;
+	allocator.Initialize(64);
+	std::set<uint32_t> indices;
+	for (uint32_t i = 0; i < 64; ++i) {
+		BindlessHandle handle = allocator.Allocate();
+		REQUIRE(!handle.IsNull());
+		CHECK(handle.GetIndex() < 64);
+		CHECK(allocator.IsValid(handle));
+		indices.insert(handle.GetIndex());
+	}
+	CHECK(indices.size() == 64);
+	CHECK(allocator.GetAllocatedCount() == 64);
+	CHECK(allocator.Allocate().IsNull());
+}
+
+TEST_CASE(FreeInvalidatesAndRejectsDoubleFree) {
+	BindlessAllocator allocator;
+	allocator.Initialize(8);
+	BindlessHandle handle = allocator.Allocate();
+	CHECK(allocator.Free(handle, 1));
+	CHECK(!allocator.IsValid(handle));
+	CHECK(!allocator.Free(handle, 2));
+	CHECK(!allocator.Free(BindlessHandle(), 2));
+	// 範囲外のインデックスも無効
+	CHECK(!allocator.IsValid(BindlessHandle::Make(100, 1)));
+	CHECK(!allocator.Free(BindlessHandle::Make(100, 1), 2));
+	CHECK(allocator.GetAllocatedCount() == 0);
+	CHECK(allocator.GetPendingCount() == 1);
+}
+
+TEST_CASE(ReuseWaitsForFence) {
+	BindlessAllocator allocator;
+	allocator.Initialize(2);
+	BindlessHandle first = allocator.Allocate();
+	BindlessHandle second = allocator.Allocate();
+	CHECK(allocator.Free(first, 10));
+	CHECK(allocator.Free(second, 20));
+	// GPUが使い終わるまでは空きに戻らない
+	CHECK(allocator.Allocate().IsNull());
+	CHECK(allocator.Recycle(9) == 0);
+	CHECK(allocator.Allocate().IsNull());
+
+	CHECK(allocator.Recycle(10) == 1);
+	BindlessHandle reused = allocator.Allocate();
+	REQUIRE(!reused.IsNull());
+	CHECK(reused.GetIndex() == first.GetIndex());
+	CHECK(allocator.Allocate().IsNull());
+	CHECK(allocator.GetPendingCount() == 1);
+
+	CHECK(allocator.Recycle(25) == 1);
+	CHECK(allocator.GetPendingCount() == 0);
+	CHECK(allocator.Allocate().GetIndex() == second.GetIndex());
+}
+
+TEST_CASE(StaleHandleIsDetectedAfterReuse) {
+	BindlessAllocator allocator;
+	allocator.Initialize(1);
+	BindlessHandle stale = allocator.Allocate();
+	CHECK(allocator.Free(stale, 1));
+	allocator.Recycle(1);
+	BindlessHandle fresh = allocator.Allocate();
+	REQUIRE(!fresh.IsNull());
+	// 同じスロットでも世代が違うので、古いハンドルでは触れない
+	CHECK(fresh.GetIndex() == stale.GetIndex());
+	CHECK(fresh.GetVersion() != stale.GetVersion());
+	CHECK(!allocator.IsValid(stale));
+	CHECK(!allocator.Free(stale, 2));
+	CHECK(allocator.IsValid(fresh));
+}
+
+TEST_CASE(VersionWrapSkipsZero) {
+	BindlessAllocator allocator;
+	allocator.Initialize(1);
+	uint64_t fence = 0;
+	BindlessHandle previous;
+	for (uint32_t i = 0; i < BindlessHandle::kVersionMask + 10; ++i) {
+		BindlessHandle handle = allocator.Allocate();
+		REQUIRE(!handle.IsNull());
+		CHECK(handle.GetVersion() != 0);
+		CHECK(handle.value != previous.value);
+		CHECK(allocator.Free(handle, ++fence));
+		allocator.Recycle(fence);
+		previous = handle;
+	}
+}
+
+TEST_CASE(ConcurrentAllocationIsUnique) {
+	const uint32_t kThreadCount = 4;
+	const uint32_t kPerThread = 2000;
+	BindlessAllocator allocator;
+	allocator.Initialize(kThreadCount * kPerThread);
+	std::vector<std::vector<BindlessHandle>> handles(kThreadCount);
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < kThreadCount; ++t) {
+		threads.emplace_back([&allocator, &handles, t] {
+			for (uint32_t i = 0; i < kPerThread; ++i) {
+				handles[t].push_back(allocator.Allocate());
+				// 半分は解放して、解放待ちとの取り合いも起こす
+				if (i % 2 == 1) {
+					allocator.Free(handles[t].back(), i);
+					handles[t].pop_back();
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	std::vector<uint32_t> indices;
+	for (const std::vector<BindlessHandle>& owned : handles) {
+		for (BindlessHandle handle : owned) {
+			CHECK(allocator.IsValid(handle));
+			indices.push_back(handle.GetIndex());
+		}
+	}
+	std::sort(indices.begin(), indices.end());
+	CHECK(std::adjacent_find(indices.begin(), indices.end()) == indices.end());
+	CHECK(allocator.GetAllocatedCount() == kThreadCount * kPerThread / 2);
+	CHECK(allocator.GetPendingCount() == kThreadCount * kPerThread / 2);
+}
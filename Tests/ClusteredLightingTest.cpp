@@ -0,0 +1,193 @@
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "ClusteredLighting.h"
+#include "TestFramework.h"
+
+namespace {
+
+// 環境によらず同じ列を返す乱数
+class Random {
+public:
+	explicit Random(uint32_t seed) : state_(seed) {}
+
+	uint32_t Next() {
+		state_ = state_ * 1664525u + 1013904223u;
+		return state_ >> 8;
+	}
+
+	float Range(float minimum, float maximum) {
+		return minimum + (maximum - minimum) * static_cast<float>(Next() & 0xFFFF) / 65535.0f;
+	}
+
+private:
+	uint32_t state_;
+};
+
+// y軸まわりにyawだけ回したカメラのビュー行列(行ベクトル×行列の規約)
+void MakeView(const float eye[3], float yaw, float outView[4][4]) {
+	const float c = std::cos(yaw);
+	const float s = std::sin(yaw);
+	// 回転の逆(転置)と平行移動の逆
+	const float view[4][4] = {
+		{ c, 0.0f, s, 0.0f },
+		{ 0.0f, 1.0f, 0.0f, 0.0f },
+		{ -s, 0.0f, c, 0.0f },
+		{ -(eye[0] * c - eye[2] * s), -eye[1], -(eye[0] * s + eye[2] * c), 1.0f },
+	};
+	std::memcpy(outView, view, sizeof(view));
+}
+
+std::vector<ClusterLight> MakeLights(uint32_t count, float worldSize, uint32_t seed) {
+	Random random(seed);
+	std::vector<ClusterLight> lights(count);
+	const float half = worldSize * 0.5f;
+	for (ClusterLight& light : lights) {
+		light.position[0] = random.Range(-half, half);
+		light.position[1] = random.Range(-5.0f, 20.0f);
+		light.position[2] = random.Range(-half, half);
+		light.radius = random.Range(0.5f, 20.0f);
+		light.color[0] = light.color[1] = light.color[2] = 1.0f;
+		light.intensity = 1.0f;
+	}
+	return lights;
+}
+
+bool SameResult(const ClusteredLighting& a, const ClusteredLighting& b) {
+	if (a.GetRanges().size() != b.GetRanges().size() || a.GetLightIndices() != b.GetLightIndices()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.GetRanges().size(); ++i) {
+		if (a.GetRanges()[i].offset != b.GetRanges()[i].offset || a.GetRanges()[i].count != b.GetRanges()[i].count) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+TEST_CASE(BuildMatchesReference) {
+	ClusterGridDesc desc;
+	desc.farZ = 500.0f;
+	ClusteredLighting lighting;
+	ClusteredLighting reference;
+	lighting.Initialize(desc);
+	reference.Initialize(desc);
+
+	const float eye[3] = { 3.0f, 4.0f, -20.0f };
+	float view[4][4];
+	MakeView(eye, 0.3f, view);
+	for (uint32_t lightCount : { 1000u, 4096u, 16384u, 65536u }) {
+		const std::vector<ClusterLight> lights = MakeLights(lightCount, 800.0f, lightCount);
+		reference.BuildReference(view, lights.data(), lightCount);
+		// 1スレッドと複数スレッドのどちらも総当たりと一致する
+		for (uint32_t threadCount : { 1u, 4u }) {
+			lighting.Build(view, lights.data(), lightCount, threadCount);
+			CHECK(SameResult(lighting, reference));
+		}
+		CHECK(!reference.GetLightIndices().empty());
+	}
+}
+
+TEST_CASE(BuildMatchesReferenceForOddCounts) {
+	// 4つずつ処理する端数と、ライトが無い場合
+	ClusteredLighting lighting;
+	ClusteredLighting reference;
+	lighting.Initialize(ClusterGridDesc());
+	reference.Initialize(ClusterGridDesc());
+	const float eye[3] = { 0.0f, 2.0f, -5.0f };
+	float view[4][4];
+	MakeView(eye, -0.7f, view);
+	for (uint32_t lightCount : { 0u, 1u, 3u, 5u, 1023u }) {
+		const std::vector<ClusterLight> lights = MakeLights(lightCount, 200.0f, 100 + lightCount);
+		reference.BuildReference(view, lights.data(), lightCount);
+		lighting.Build(view, lights.data(), lightCount, 3);
+		CHECK(SameResult(lighting, reference));
+	}
+	CHECK(lighting.GetLightIndices().size() > 0);
+}
+
+TEST_CASE(RangesAreContiguousAndSorted) {
+	ClusteredLighting lighting;
+	lighting.Initialize(ClusterGridDesc());
+	const std::vector<ClusterLight> lights = MakeLights(4096, 400.0f, 7);
+	const float eye[3] = { 0.0f, 5.0f, 0.0f };
+	float view[4][4];
+	MakeView(eye, 1.0f, view);
+	lighting.Build(view, lights.data(), static_cast<uint32_t>(lights.size()), 2);
+
+	const std::vector<ClusterRange>& ranges = lighting.GetRanges();
+	const std::vector<uint32_t>& indices = lighting.GetLightIndices();
+	REQUIRE(ranges.size() == lighting.GetClusterCount());
+	uint32_t offset = 0;
+	bool contiguous = true;
+	bool sorted = true;
+	for (const ClusterRange& range : ranges) {
+		contiguous = contiguous && range.offset == offset;
+		for (uint32_t i = 1; i < range.count; ++i) {
+			sorted = sorted && indices[range.offset + i - 1] < indices[range.offset + i];
+		}
+		offset += range.count;
+	}
+	CHECK(contiguous);
+	CHECK(sorted);
+	CHECK(offset == indices.size());
+}
+
+TEST_CASE(LightIsAssignedToItsCluster) {
+	// カメラの正面に置いた小さなライトは、その位置のクラスターにだけ入る
+	ClusterGridDesc desc;
+	ClusteredLighting lighting;
+	lighting.Initialize(desc);
+	const float eye[3] = { 0.0f, 0.0f, 0.0f };
+	float view[4][4];
+	MakeView(eye, 0.0f, view);
+
+	ClusterLight light{};
+	light.position[2] = 37.0f;
+	light.radius = 0.01f;
+	lighting.Build(view, &light, 1, 1);
+	const uint32_t slice = lighting.GetSlice(37.0f);
+	// 画面中央は偶数個のタイルの境目なので、周りの4つ(縦が奇数なら2つ)に入る
+	uint32_t hitCount = 0;
+	for (uint32_t cluster = 0; cluster < lighting.GetClusterCount(); ++cluster) {
+		const ClusterRange& range = lighting.GetRanges()[cluster];
+		if (range.count == 0) {
+			continue;
+		}
+		++hitCount;
+		CHECK(cluster / (desc.tileCountX * desc.tileCountY) == slice);
+		const uint32_t tileX = cluster % desc.tileCountX;
+		CHECK(tileX == desc.tileCountX / 2 - 1 || tileX == desc.tileCountX / 2);
+	}
+	CHECK(hitCount >= 1 && hitCount <= 4);
+
+	// 背後のライトはどこにも入らない
+	light.position[2] = -10.0f;
+	light.radius = 5.0f;
+	lighting.Build(view, &light, 1, 1);
+	CHECK(lighting.GetLightIndices().empty());
+}
+
+TEST_CASE(SliceFollowsLogarithmicSplit) {
+	ClusterGridDesc desc;
+	ClusteredLighting lighting;
+	lighting.Initialize(desc);
+	CHECK(lighting.GetSlice(0.0f) == 0);
+	CHECK(lighting.GetSlice(desc.nearZ) == 0);
+	CHECK(lighting.GetSlice(desc.farZ * 2.0f) == desc.sliceCount - 1);
+	uint32_t previous = 0;
+	bool monotonic = true;
+	for (float z = desc.nearZ; z < desc.farZ; z *= 1.05f) {
+		const uint32_t slice = lighting.GetSlice(z);
+		monotonic = monotonic && slice >= previous;
+		previous = slice;
+	}
+	CHECK(monotonic);
+	// スライスの境目は nearZ * (farZ / nearZ)^(i / sliceCount)
+	const float boundary = desc.nearZ * std::pow(desc.farZ / desc.nearZ, 5.0f / static_cast<float>(desc.sliceCount));
+	CHECK(lighting.GetSlice(boundary * 1.001f) == 5);
+	CHECK(lighting.GetSlice(boundary * 0.999f) == 4);
+}
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "DynamicResolution.h"
+#include "TestFramework.h"
+
+namespace {
+
+const uint32_t kWidth = 1920;
+const uint32_t kHeight = 1080;
+const uint32_t kFrameCount = 1800;
+
+// 環境によらず同じ列を返す乱数([0, 1])
+class Random {
+public:
+	explicit Random(uint32_t seed) : state_(seed) {}
+
+	float Next() {
+		state_ = state_ * 1664525u + 1013904223u;
+		return static_cast<float>((state_ >> 8) & 0xFFFF) / 65535.0f;
+	}
+
+private:
+	uint32_t state_;
+};
+
+// ネイティブ解像度でのGPU時間の列を作る。負荷の形はゲーム中に記録したものを単純にしたもの
+template <typename Function>
+std::vector<float> MakeTrace(Function function) {
+	std::vector<float> trace(kFrameCount);
+	for (uint32_t i = 0; i < kFrameCount; ++i) {
+		trace[i] = function(i);
+	}
+	return trace;
+}
+
+// [begin, end)のフレームで倍率が動いた幅
+float ScaleRange(const std::vector<float>& scales, size_t begin, size_t end) {
+	auto [minimum, maximum] = std::minmax_element(scales.begin() + begin, scales.begin() + end);
+	return *maximum - *minimum;
+}
+
+} // namespace
+
+TEST_CASE(SteadyLoadConverges) {
+	DynamicResolution::Config config;
+	std::vector<float> scales;
+	DynamicResolution::Statistics statistics = DynamicResolution::ReplayTrace(config, MakeTrace([](uint32_t) { return 20.0f; }), kWidth, kHeight, &scales);
+	REQUIRE(scales.size() == kFrameCount);
+	CHECK(statistics.directionChangeCount == 0);
+	// 落ち着いた後は倍率が変わらず、描画時間が予算に収まり、余らせすぎてもいない
+	CHECK(ScaleRange(scales, 120, kFrameCount) == 0.0f);
+	const float settledMilliseconds = 20.0f * scales.back() * scales.back();
+	CHECK(settledMilliseconds <= config.budgetMilliseconds * config.decreaseThreshold);
+	CHECK(settledMilliseconds >= config.budgetMilliseconds * config.increaseThreshold);
+}
+
+TEST_CASE(NoisyLoadDoesNotOscillate) {
+	DynamicResolution::Config config;
+	Random random(1);
+	std::vector<float> scales;
+	DynamicResolution::Statistics statistics = DynamicResolution::ReplayTrace(config,
+		MakeTrace([&](uint32_t) { return 20.0f * (0.9f + 0.2f * random.Next()); }), kWidth, kHeight, &scales);
+	CHECK(statistics.directionChangeCount == 0);
+	CHECK(ScaleRange(scales, 120, kFrameCount) == 0.0f);
+	CHECK(statistics.GetBudgetAdherence() > 0.99f);
+}
+
+TEST_CASE(LoadStepSettlesInBothDirections) {
+	DynamicResolution::Config config;
+	std::vector<float> scales;
+	DynamicResolution::Statistics statistics = DynamicResolution::ReplayTrace(config,
+		MakeTrace([](uint32_t i) { return i >= 300 && i < 900 ? 26.0f : 12.0f; }), kWidth, kHeight, &scales);
+	CHECK(scales[299] == config.maxScale);
+	// 重くなったらすぐ下げ、軽くなったら最大まで戻す。その間に上げ下げを繰り返さない
+	CHECK(scales[310] < scales[299]);
+	CHECK(ScaleRange(scales, 420, 900) == 0.0f);
+	CHECK(scales.back() == config.maxScale);
+	CHECK(ScaleRange(scales, 1100, kFrameCount) == 0.0f);
+	CHECK(statistics.directionChangeCount <= 1);
+}
+
+TEST_CASE(IsolatedSpikesAreIgnored) {
+	DynamicResolution::Config config;
+	Random random(2);
+	uint32_t spikeCount = 0;
+	DynamicResolution::Statistics statistics = DynamicResolution::ReplayTrace(config, MakeTrace([&](uint32_t i) {
+		if (i % 97 == 50) {
+			++spikeCount;
+			return 45.0f;
+		}
+		return 14.0f * (0.95f + 0.1f * random.Next());
+	}), kWidth, kHeight);
+	CHECK(statistics.scaleChangeCount == 0);
+	CHECK(statistics.outlierFrameCount == spikeCount);
+}
+
+TEST_CASE(LoadOutsideRangeClamps) {
+	DynamicResolution::Config config;
+	std::vector<float> scales;
+	DynamicResolution::Statistics light = DynamicResolution::ReplayTrace(config, MakeTrace([](uint32_t) { return 8.0f; }), kWidth, kHeight, &scales);
+	CHECK(light.scaleChangeCount == 0);
+	CHECK(light.minScale == config.maxScale);
+
+	DynamicResolution::Statistics heavy = DynamicResolution::ReplayTrace(config, MakeTrace([](uint32_t) { return 80.0f; }), kWidth, kHeight, &scales);
+	CHECK(heavy.directionChangeCount == 0);
+	CHECK(scales.back() == config.minScale);
+	CHECK(ScaleRange(scales, 60, kFrameCount) == 0.0f);
+}
+
+TEST_CASE(SlowLoadChangeIsTrackedWithoutHunting) {
+	DynamicResolution::Config config;
+	Random random(3);
+	const float frequency = 0.02f;
+	DynamicResolution::Statistics statistics = DynamicResolution::ReplayTrace(config,
+		MakeTrace([&](uint32_t i) { return 18.0f + 4.0f * std::sin(static_cast<float>(i) * frequency) + 2.0f * random.Next(); }), kWidth, kHeight);
+	// 負荷の1周期で上げ下げの向きが変わるのは高々2回
+	const float periods = static_cast<float>(kFrameCount) * frequency / 6.2831853f;
+	CHECK(static_cast<float>(statistics.directionChangeCount) <= 2.0f * std::ceil(periods));
+	CHECK(statistics.GetBudgetAdherence() > 0.95f);
+}
+
+TEST_CASE(MissingSamplesDoNotDriveDecisions) {
+	// タイムスタンプが取れないフレーム(-1)を挟んでも、計測できたフレームだけを並べたときと同じに動く
+	DynamicResolution::Config config;
+	Random random(4);
+	const std::vector<float> trace = MakeTrace([&](uint32_t i) { return (i >= 300 && i < 900 ? 26.0f : 10.0f) * (0.97f + 0.06f * random.Next()); });
+	std::vector<float> gappedTrace;
+	std::vector<size_t> samplePositions;
+	for (size_t i = 0; i < trace.size(); ++i) {
+		samplePositions.push_back(gappedTrace.size());
+		gappedTrace.push_back(trace[i]);
+		// 1〜3フレームの抜けを不規則に入れる
+		for (uint32_t gap = 0; gap < (i * 7) % 4; ++gap) {
+			gappedTrace.push_back(-1.0f);
+		}
+	}
+
+	std::vector<float> scales;
+	std::vector<float> gappedScales;
+	const DynamicResolution::Statistics statistics = DynamicResolution::ReplayTrace(config, trace, kWidth, kHeight, &scales);
+	const DynamicResolution::Statistics gapped = DynamicResolution::ReplayTrace(config, gappedTrace, kWidth, kHeight, &gappedScales);
+	bool sameScales = true;
+	for (size_t i = 0; i < trace.size(); ++i) {
+		sameScales = sameScales && gappedScales[samplePositions[i]] == scales[i];
+	}
+	CHECK(sameScales);
+	CHECK(gapped.frameCount == statistics.frameCount);
+	CHECK(gapped.scaleChangeCount == statistics.scaleChangeCount);
+	CHECK(gapped.directionChangeCount == statistics.directionChangeCount);
+	// 負荷が上がった直後と下がった後の両方で倍率が動いている
+	CHECK(scales[320] < config.maxScale);
+	CHECK(scales.back() == config.maxScale);
+}
+
+TEST_CASE(MissingSamplesKeepScale) {
+	// 予算超過の計測の後に計測が途切れても、同じ値で下げ続けない
+	DynamicResolution controller;
+	DynamicResolution::Config config;
+	controller.Initialize(config, kWidth, kHeight);
+	controller.Update(40.0f);
+	const float scale = controller.GetScale();
+	CHECK(scale < config.maxScale);
+	for (int i = 0; i < 20; ++i) {
+		controller.Update(-1.0f);
+	}
+	CHECK(controller.GetScale() == scale);
+	CHECK(controller.GetStatistics().scaleChangeCount == 1);
+	CHECK(controller.GetStatistics().frameCount == 1);
+}
+
+TEST_CASE(RenderSizeIsAligned) {
+	DynamicResolution controller;
+	DynamicResolution::Config config;
+	controller.Initialize(config, 1000, 563);
+	for (int i = 0; i < 200; ++i) {
+		controller.Update(30.0f);
+		CHECK(controller.GetRenderWidth() % config.alignment == 0);
+		CHECK(controller.GetRenderHeight() % config.alignment == 0 || controller.GetRenderHeight() == 563);
+		CHECK(controller.GetRenderWidth() <= 1000 && controller.GetRenderHeight() <= 563);
+	}
+	CHECK(controller.GetScale() < 1.0f);
+}
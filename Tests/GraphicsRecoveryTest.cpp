@@ -0,0 +1,275 @@
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "GraphicsRecovery.h"
+#include "TestFramework.h"
+
+namespace {
+
+// 呼ばれた操作を記録し、指定した結果を返す偽デバイス
+class FakeDevice : public RecoverableDevice {
+public:
+	DeviceResult WaitForInFlightFrames() override {
+		calls.push_back("Wait");
+		CHECK(objectsAlive);
+		return Pop(waitResults);
+	}
+
+	void ReleaseBackBuffers() override {
+		calls.push_back("ReleaseBackBuffers");
+		backBuffersHeld = false;
+	}
+
+	DeviceResult ResizeBuffers(uint32_t width, uint32_t height) override {
+		calls.push_back("Resize " + std::to_string(width) + "x" + std::to_string(height));
+		// バックバッファを参照したままのResizeBuffersは失敗する
+		CHECK(objectsAlive && !backBuffersHeld);
+		DeviceResult result = Pop(resizeResults);
+		if (result == DeviceResult::Ok) {
+			bufferWidth = width;
+			bufferHeight = height;
+		}
+		return result;
+	}
+
+	DeviceResult CreateRenderTargetViews() override {
+		calls.push_back("CreateRenderTargetViews");
+		CHECK(objectsAlive && !backBuffersHeld);
+		DeviceResult result = Pop(rtvResults);
+		backBuffersHeld = result == DeviceResult::Ok;
+		return result;
+	}
+
+	void ReleaseDeviceObjects() override {
+		calls.push_back("ReleaseDeviceObjects");
+		objectsAlive = false;
+		backBuffersHeld = false;
+	}
+
+	DeviceResult CreateDeviceObjects(uint32_t width, uint32_t height) override {
+		calls.push_back("Create " + std::to_string(width) + "x" + std::to_string(height));
+		// 古いオブジェクトを残したまま作り直さない
+		CHECK(!objectsAlive);
+		DeviceResult result = Pop(createResults);
+		if (result == DeviceResult::Ok) {
+			objectsAlive = true;
+			backBuffersHeld = true;
+			bufferWidth = width;
+			bufferHeight = height;
+		}
+		return result;
+	}
+
+	// 描画できる状態か(デバイス依存オブジェクトとRTVがそろっている)
+	bool IsRenderable() const { return objectsAlive && backBuffersHeld; }
+
+	// 操作ごとに返す結果。空ならOk
+	std::deque<DeviceResult> waitResults;
+	std::deque<DeviceResult> resizeResults;
+	std::deque<DeviceResult> rtvResults;
+	std::deque<DeviceResult> createResults;
+
+	std::vector<std::string> calls;
+	bool objectsAlive = true;
+	bool backBuffersHeld = true;
+	uint32_t bufferWidth = 1280;
+	uint32_t bufferHeight = 720;
+
+private:
+	static DeviceResult Pop(std::deque<DeviceResult>& results) {
+		if (results.empty()) {
+			return DeviceResult::Ok;
+		}
+		DeviceResult result = results.front();
+		results.pop_front();
+		return result;
+	}
+};
+
+// 環境によらず同じ列を返す乱数
+class Random {
+public:
+	explicit Random(uint32_t seed) : state_(seed) {}
+
+	uint32_t Next(uint32_t range) {
+		state_ = state_ * 1664525u + 1013904223u;
+		return (state_ >> 8) % range;
+	}
+
+private:
+	uint32_t state_;
+};
+
+} // namespace
+
+TEST_CASE(ResizeRequestsAreCoalesced) {
+	FakeDevice device;
+	GraphicsRecovery recovery;
+	recovery.Initialize(&device, 1280, 720);
+	recovery.RequestResize(800, 600);
+	recovery.RequestResize(1024, 768);
+	recovery.RequestResize(1600, 900);
+	CHECK(recovery.BeginFrame());
+	const std::vector<std::string> expected = { "Wait", "ReleaseBackBuffers", "Resize 1600x900", "CreateRenderTargetViews" };
+	CHECK(device.calls == expected);
+	CHECK(recovery.GetWidth() == 1600 && recovery.GetHeight() == 900);
+	CHECK(recovery.GetStatistics().resizeCount == 1);
+
+	// 同じサイズへの要求ではバッファを作り直さない
+	device.calls.clear();
+	recovery.RequestResize(1600, 900);
+	CHECK(recovery.BeginFrame());
+	CHECK(device.calls.empty());
+}
+
+TEST_CASE(MinimizeSuspendsWithoutTouchingBuffers) {
+	FakeDevice device;
+	GraphicsRecovery recovery;
+	recovery.Initialize(&device, 1280, 720);
+	recovery.RequestResize(0, 0);
+	CHECK(!recovery.BeginFrame());
+	CHECK(recovery.GetState() == GraphicsRecovery::State::Suspended);
+	CHECK(!recovery.BeginFrame());
+	recovery.RequestResize(1280, 720);
+	CHECK(recovery.BeginFrame());
+	CHECK(recovery.GetState() == GraphicsRecovery::State::Running);
+	CHECK(device.calls.empty());
+}
+
+TEST_CASE(ResizeBeforeInitializeWithSameSizeIsDropped) {
+	FakeDevice device;
+	GraphicsRecovery recovery;
+	recovery.RequestResize(1280, 720);
+	recovery.Initialize(&device, 1280, 720);
+	CHECK(recovery.BeginFrame());
+	CHECK(device.calls.empty());
+}
+
+TEST_CASE(DeviceLostDuringResizeRecreatesAtNewSize) {
+	for (int failingStep = 0; failingStep < 3; ++failingStep) {
+		FakeDevice device;
+		(failingStep == 0 ? device.waitResults : failingStep == 1 ? device.resizeResults : device.rtvResults).push_back(DeviceResult::DeviceLost);
+		GraphicsRecovery recovery;
+		recovery.Initialize(&device, 1280, 720);
+		recovery.RequestResize(1920, 1080);
+		CHECK(!recovery.BeginFrame());
+		CHECK(recovery.GetState() == GraphicsRecovery::State::DeviceLost);
+
+		CHECK(recovery.BeginFrame());
+		CHECK(device.IsRenderable());
+		CHECK(device.bufferWidth == 1920 && device.bufferHeight == 1080);
+		CHECK(device.calls[device.calls.size() - 2] == "ReleaseDeviceObjects");
+		CHECK(device.calls.back() == "Create 1920x1080");
+		CHECK(recovery.GetStatistics().recreateCount == 1);
+		CHECK(recovery.GetStatistics().resizeCount == 0);
+	}
+}
+
+TEST_CASE(DeviceLostIsRecoveredOnNextFrame) {
+	FakeDevice device;
+	GraphicsRecovery recovery;
+	recovery.Initialize(&device, 1280, 720);
+	recovery.NotifyDeviceLost();
+	// 作り直す前に届いたリサイズは、作り直しのサイズとして使う
+	recovery.RequestResize(640, 480);
+	CHECK(recovery.BeginFrame());
+	const std::vector<std::string> expected = { "ReleaseDeviceObjects", "Create 640x480" };
+	CHECK(device.calls == expected);
+	CHECK(recovery.GetWidth() == 640 && recovery.GetHeight() == 480);
+}
+
+TEST_CASE(RecreateRetriesTransientFailures) {
+	FakeDevice device;
+	device.createResults = { DeviceResult::DeviceLost, DeviceResult::DeviceLost, DeviceResult::DeviceLost };
+	GraphicsRecovery recovery;
+	recovery.Initialize(&device, 1280, 720);
+	recovery.NotifyDeviceLost();
+	for (int i = 0; i < 3; ++i) {
+		CHECK(!recovery.BeginFrame());
+		CHECK(recovery.GetState() == GraphicsRecovery::State::DeviceLost);
+	}
+	CHECK(recovery.BeginFrame());
+	CHECK(recovery.GetStatistics().recreateFailureCount == 3);
+	CHECK(recovery.GetStatistics().recreateCount == 1);
+
+	// 成功したら連続失敗の回数は0に戻る
+	recovery.NotifyDeviceLost();
+	device.createResults.assign(GraphicsRecovery::kMaxRecreateAttempts - 1, DeviceResult::DeviceLost);
+	for (uint32_t i = 0; i + 1 < GraphicsRecovery::kMaxRecreateAttempts; ++i) {
+		CHECK(!recovery.BeginFrame());
+	}
+	CHECK(recovery.BeginFrame());
+}
+
+TEST_CASE(RecreateGivesUpAfterMaxAttempts) {
+	FakeDevice device;
+	device.createResults.assign(GraphicsRecovery::kMaxRecreateAttempts, DeviceResult::DeviceLost);
+	GraphicsRecovery recovery;
+	recovery.Initialize(&device, 1280, 720);
+	recovery.NotifyDeviceLost();
+	for (uint32_t i = 0; i < GraphicsRecovery::kMaxRecreateAttempts; ++i) {
+		CHECK(!recovery.BeginFrame());
+	}
+	CHECK(recovery.GetState() == GraphicsRecovery::State::Failed);
+
+	// 諦めた後は通知や要求が来ても何もしない
+	const size_t callCount = device.calls.size();
+	recovery.NotifyDeviceLost();
+	recovery.RequestResize(800, 600);
+	CHECK(!recovery.BeginFrame());
+	CHECK(recovery.GetState() == GraphicsRecovery::State::Failed);
+	CHECK(device.calls.size() == callCount);
+}
+
+TEST_CASE(UnrecoverableFailureStopsImmediately) {
+	FakeDevice device;
+	device.createResults = { DeviceResult::Failed };
+	GraphicsRecovery recovery;
+	recovery.Initialize(&device, 1280, 720);
+	recovery.NotifyDeviceLost();
+	CHECK(!recovery.BeginFrame());
+	CHECK(recovery.GetState() == GraphicsRecovery::State::Failed);
+	CHECK(recovery.GetStatistics().recreateFailureCount == 1);
+}
+
+TEST_CASE(RandomFaultsNeverRenderWithBrokenDevice) {
+	// 要求と故障をランダムに混ぜ、描画してよいと返したときは必ずデバイスが使える状態であることを確かめる
+	for (uint32_t seed = 1; seed <= 200; ++seed) {
+		Random random(seed);
+		FakeDevice device;
+		GraphicsRecovery recovery;
+		recovery.Initialize(&device, 1280, 720);
+		for (int frame = 0; frame < 100; ++frame) {
+			switch (random.Next(6)) {
+			case 0:
+				recovery.RequestResize(320 + random.Next(1600), 240 + random.Next(900));
+				break;
+			case 1:
+				recovery.RequestResize(0, 0);
+				break;
+			case 2:
+				// Presentなどでの検出。実際のデバイスも使えなくなる
+				recovery.NotifyDeviceLost();
+				device.objectsAlive = random.Next(2) == 0;
+				break;
+			case 3: {
+				std::deque<DeviceResult>* queues[] = { &device.waitResults, &device.resizeResults, &device.rtvResults, &device.createResults };
+				queues[random.Next(4)]->push_back(DeviceResult::DeviceLost);
+				break;
+			}
+			default:
+				break;
+			}
+			const bool renderable = recovery.BeginFrame();
+			if (recovery.GetState() == GraphicsRecovery::State::Failed) {
+				break;
+			}
+			CHECK(renderable == (recovery.GetState() == GraphicsRecovery::State::Running));
+			if (renderable) {
+				CHECK(device.IsRenderable());
+				CHECK(device.bufferWidth == recovery.GetWidth() && device.bufferHeight == recovery.GetHeight());
+			}
+		}
+	}
+}
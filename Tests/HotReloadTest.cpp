@@ -0,0 +1,341 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FileWatcher.h"
+#include "HotReload.h"
+#include "TestFramework.h"
+
+namespace {
+
+// テストごとの作業ディレクトリ(作り直して空から始め、終わったら消す)
+class TemporaryDirectory {
+public:
+	explicit TemporaryDirectory(const std::string& name) : path_(std::filesystem::temp_directory_path() / ("HotReloadTest_" + name)) {
+		std::filesystem::remove_all(path_);
+		std::filesystem::create_directories(path_);
+	}
+
+	~TemporaryDirectory() {
+		std::error_code error;
+		std::filesystem::remove_all(path_, error);
+	}
+
+	std::string GetPath() const { return path_.string(); }
+
+	void CreateDirectory(const std::string& relativePath) const {
+		std::filesystem::create_directories(path_ / relativePath);
+	}
+
+	void WriteFile(const std::string& relativePath, const std::string& text) const {
+		std::ofstream stream(path_ / relativePath, std::ios::binary | std::ios::trunc);
+		stream << text;
+	}
+
+private:
+	std::filesystem::path path_;
+};
+
+// 条件が満たされるまで待つ
+bool WaitUntil(const std::function<bool()>& condition, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	while (!condition()) {
+		if (std::chrono::steady_clock::now() > deadline) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return true;
+}
+
+bool Contains(const std::vector<std::string>& files, const std::string& file) {
+	return std::find(files.begin(), files.end(), file) != files.end();
+}
+
+// 指定したファイルがすべて届くまで取り出し続ける
+bool PollUntil(FileWatcher& watcher, const std::vector<std::string>& expected, std::vector<std::string>& outFiles) {
+	return WaitUntil([&]() {
+		watcher.Poll(outFiles, 0);
+		return std::all_of(expected.begin(), expected.end(), [&](const std::string& file) { return Contains(outFiles, file); });
+	});
+}
+
+// 作り直しの回数と、差し替え・解放の様子を記録する項目
+struct TestItem {
+	std::atomic<uint32_t> rebuildCount = 0;
+	std::atomic<bool> rebuiltOnMainThread = false;
+	uint32_t version = 0;        // メインスレッドから見た今の版
+	uint32_t discardCount = 0;   // apply=falseで捨てられた数
+	uint32_t releasedVersion = 0;
+	uint32_t releaseCount = 0;
+	bool fail = false;
+
+	HotReload::RebuildFunction MakeRebuild(std::thread::id mainThread) {
+		return [this, mainThread]() -> HotReload::SwapFunction {
+			if (std::this_thread::get_id() == mainThread) {
+				rebuiltOnMainThread = true;
+			}
+			const uint32_t built = ++rebuildCount;
+			if (fail) {
+				return {};
+			}
+			return [this, built](bool apply) -> HotReload::ReleaseFunction {
+				if (!apply) {
+					++discardCount;
+					return {};
+				}
+				const uint32_t old = version;
+				version = built;
+				return [this, old]() {
+					releasedVersion = old;
+					++releaseCount;
+				};
+			};
+		};
+	}
+};
+
+// a.hlsl → common/b.hlsli → ../c.hlsli と common/d.hlsli。c.hlsliはb.hlsliを読み返す(循環)
+void WriteShaderTree(const TemporaryDirectory& directory) {
+	directory.CreateDirectory("common");
+	directory.WriteFile("a.hlsl", "#include \"common/b.hlsli\"\nfloat4 main() : SV_Target { return 0; }\n");
+	directory.WriteFile("common/b.hlsli", "  #include \"../c.hlsli\"\n#include \"d.hlsli\"\n");
+	directory.WriteFile("c.hlsli", "#include \"common/b.hlsli\"\n");
+	directory.WriteFile("common/d.hlsli", "// no includes\n");
+	directory.WriteFile("other.hlsl", "float4 main() : SV_Target { return 1; }\n");
+}
+
+} // namespace
+
+TEST_CASE(WatcherReportsFilesInSubdirectories) {
+	TemporaryDirectory directory("Subdirectories");
+	directory.CreateDirectory("sub/deeper");
+	FileWatcher watcher;
+	REQUIRE(watcher.Start(directory.GetPath()));
+
+	directory.WriteFile("root.txt", "1");
+	directory.WriteFile("sub/a.hlsli", "2");
+	directory.WriteFile("sub/deeper/b.hlsli", "3");
+	std::vector<std::string> files;
+	CHECK(PollUntil(watcher, { "root.txt", "sub/a.hlsli", "sub/deeper/b.hlsli" }, files));
+	// 同じファイルへの複数回の書き込みは1つにまとまる
+	CHECK(std::count(files.begin(), files.end(), "sub/a.hlsli") == 1);
+	watcher.Stop();
+	CHECK(!watcher.IsRunning());
+}
+
+TEST_CASE(WatcherFollowsNewDirectories) {
+	TemporaryDirectory directory("NewDirectories");
+	FileWatcher watcher;
+	REQUIRE(watcher.Start(directory.GetPath()));
+
+	// 作った直後に書いたファイルと、まとめて作った深いディレクトリのファイル
+	directory.CreateDirectory("new");
+	directory.WriteFile("new/c.txt", "1");
+	directory.CreateDirectory("nested/x/y");
+	directory.WriteFile("nested/x/y/d.txt", "2");
+	std::vector<std::string> files;
+	CHECK(PollUntil(watcher, { "new/c.txt", "nested/x/y/d.txt" }, files));
+
+	// 後から作ったディレクトリも監視が続く(残っている通知を捨ててから書く)
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	watcher.Poll(files, 0);
+	files.clear();
+	directory.WriteFile("nested/x/y/d.txt", "3");
+	CHECK(PollUntil(watcher, { "nested/x/y/d.txt" }, files));
+}
+
+TEST_CASE(WatcherWaitsForWritesToSettle) {
+	TemporaryDirectory directory("Settle");
+	FileWatcher watcher;
+	REQUIRE(watcher.Start(directory.GetPath()));
+	directory.WriteFile("a.txt", "1");
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+	std::vector<std::string> files;
+	CHECK(watcher.Poll(files, 60ull * 1000000000ull) == 0);
+	CHECK(files.empty());
+	CHECK(watcher.Poll(files, 0) == 1);
+	CHECK(Contains(files, "a.txt"));
+	// 取り出したものは残らない
+	CHECK(watcher.Poll(files, 0) == 0);
+}
+
+TEST_CASE(WatcherFailsOnMissingDirectory) {
+	FileWatcher watcher;
+	CHECK(!watcher.Start((std::filesystem::temp_directory_path() / "HotReloadTest_DoesNotExist").string()));
+	CHECK(!watcher.IsRunning());
+}
+
+TEST_CASE(CollectIncludesFollowsRelativePaths) {
+	TemporaryDirectory directory("CollectIncludes");
+	WriteShaderTree(directory);
+	std::vector<std::string> files;
+	HotReload::CollectIncludes(directory.GetPath(), "./a.hlsl", files);
+	REQUIRE(files.size() == 4);
+	CHECK(files[0] == "a.hlsl");
+	CHECK(Contains(files, "common/b.hlsli"));
+	CHECK(Contains(files, "c.hlsli"));
+	CHECK(Contains(files, "common/d.hlsli"));
+
+	// .hlsl/.hlsli以外は中を読まない
+	files.clear();
+	directory.WriteFile("texture.txt", "#include \"a.hlsl\"\n");
+	HotReload::CollectIncludes(directory.GetPath(), "texture.txt", files);
+	CHECK(files.size() == 1);
+}
+
+TEST_CASE(ChangedIncludeRebuildsOnlyDependents) {
+	TemporaryDirectory directory("Dependents");
+	WriteShaderTree(directory);
+	HotReload hotReload;
+	hotReload.Initialize(directory.GetPath());
+	TestItem shader;
+	TestItem other;
+	const HotReload::ItemId shaderId = hotReload.Register("Shader", { "a.hlsl" }, shader.MakeRebuild(std::this_thread::get_id()));
+	hotReload.Register("Other", { "other.hlsl" }, other.MakeRebuild(std::this_thread::get_id()));
+	CHECK(hotReload.GetDependencies(shaderId).size() == 4);
+
+	// 区切りが\でも同じファイルとみなす
+	hotReload.NotifyFileChanged("common\\d.hlsli");
+	CHECK(WaitUntil([&]() { return hotReload.GetStatistics().rebuildCount == 1 && hotReload.GetStatistics().swapCount == 0; }));
+	CHECK(shader.rebuildCount == 1);
+	CHECK(other.rebuildCount == 0);
+	CHECK(!shader.rebuiltOnMainThread);
+
+	hotReload.NotifyFileChanged("other.hlsl");
+	CHECK(WaitUntil([&]() { return other.rebuildCount == 1; }));
+	CHECK(shader.rebuildCount == 1);
+	hotReload.Finalize();
+}
+
+TEST_CASE(RebuildRecollectsDependencies) {
+	TemporaryDirectory directory("Recollect");
+	WriteShaderTree(directory);
+	HotReload hotReload;
+	REQUIRE(hotReload.Initialize(directory.GetPath()));
+	TestItem shader;
+	const HotReload::ItemId id = hotReload.Register("Shader", { "a.hlsl" }, shader.MakeRebuild(std::this_thread::get_id()));
+
+	// #includeを書き換えると、作り直しの後で依存ファイルが入れ替わる
+	directory.WriteFile("a.hlsl", "#include \"e.hlsli\"\n");
+	CHECK(WaitUntil([&]() { return shader.rebuildCount == 1 && hotReload.GetDependencies(id).size() == 2; }));
+	const std::vector<std::string> dependencies = hotReload.GetDependencies(id);
+	CHECK(Contains(dependencies, "e.hlsli"));
+	CHECK(!Contains(dependencies, "c.hlsli"));
+
+	// 外れたファイルでは作り直さず、新しいファイルでは作り直す
+	hotReload.NotifyFileChanged("c.hlsli");
+	std::this_thread::sleep_for(std::chrono::milliseconds(150));
+	CHECK(shader.rebuildCount == 1);
+	hotReload.NotifyFileChanged("e.hlsli");
+	CHECK(WaitUntil([&]() { return shader.rebuildCount == 2; }));
+}
+
+TEST_CASE(SwapWaitsForFrameAndReleaseWaitsForFence) {
+	TemporaryDirectory directory("Deferred");
+	WriteShaderTree(directory);
+	HotReload hotReload;
+	hotReload.Initialize(directory.GetPath());
+	TestItem shader;
+	hotReload.Register("Shader", { "a.hlsl" }, shader.MakeRebuild(std::this_thread::get_id()));
+
+	hotReload.NotifyFileChanged("a.hlsl");
+	CHECK(WaitUntil([&]() { return shader.rebuildCount == 1; }));
+	// 作り直しが済んでもフレームの境目までは差し替えない
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	CHECK(shader.version == 0);
+	CHECK(!hotReload.IsIdle());
+
+	// フェンス5をシグナルするフレームで差し替え、古いものはGPUが5を終えるまで残す
+	hotReload.BeginFrame(5, 3);
+	CHECK(shader.version == 1);
+	CHECK(hotReload.GetRetiredCount() == 1);
+	CHECK(shader.releaseCount == 0);
+	CHECK(hotReload.IsIdle());
+	hotReload.BeginFrame(6, 4);
+	CHECK(shader.releaseCount == 0);
+	hotReload.BeginFrame(7, 5);
+	CHECK(shader.releaseCount == 1);
+	CHECK(shader.releasedVersion == 0);
+	CHECK(hotReload.GetRetiredCount() == 0);
+
+	const HotReload::Statistics statistics = hotReload.GetStatistics();
+	CHECK(statistics.swapCount == 1);
+	CHECK(statistics.releaseCount == 1);
+
+	// Finalizeは解放待ちをフェンスによらず解放する
+	hotReload.NotifyFileChanged("a.hlsl");
+	CHECK(WaitUntil([&]() { return shader.rebuildCount == 2; }));
+	hotReload.BeginFrame(8, 7);
+	CHECK(shader.version == 2);
+	hotReload.Finalize();
+	CHECK(shader.releaseCount == 2);
+	CHECK(shader.releasedVersion == 1);
+}
+
+TEST_CASE(FailedRebuildKeepsCurrent) {
+	TemporaryDirectory directory("Failure");
+	WriteShaderTree(directory);
+	HotReload hotReload;
+	hotReload.Initialize(directory.GetPath());
+	TestItem shader;
+	shader.fail = true;
+	hotReload.Register("Shader", { "a.hlsl" }, shader.MakeRebuild(std::this_thread::get_id()));
+	hotReload.NotifyFileChanged("a.hlsl");
+	CHECK(WaitUntil([&]() { return hotReload.GetStatistics().failureCount == 1; }));
+	CHECK(WaitUntil([&]() { return hotReload.IsIdle(); }));
+	hotReload.BeginFrame(1, 0);
+	CHECK(shader.version == 0);
+	CHECK(hotReload.GetRetiredCount() == 0);
+}
+
+TEST_CASE(SuspendDiscardsPendingSwaps) {
+	TemporaryDirectory directory("Suspend");
+	WriteShaderTree(directory);
+	HotReload hotReload;
+	hotReload.Initialize(directory.GetPath());
+	TestItem shader;
+	hotReload.Register("Shader", { "a.hlsl" }, shader.MakeRebuild(std::this_thread::get_id()));
+
+	hotReload.NotifyFileChanged("a.hlsl");
+	CHECK(WaitUntil([&]() { return shader.rebuildCount == 1; }));
+	// 差し替え待ちは捨てる(apply=falseで呼ぶ)
+	hotReload.Suspend();
+	CHECK(shader.discardCount == 1);
+	hotReload.BeginFrame(1, 0);
+	CHECK(shader.version == 0);
+
+	// 止めている間の変更は、再開してから作り直す
+	hotReload.NotifyFileChanged("a.hlsl");
+	std::this_thread::sleep_for(std::chrono::milliseconds(150));
+	CHECK(shader.rebuildCount == 1);
+	hotReload.Resume();
+	CHECK(WaitUntil([&]() { return shader.rebuildCount == 2; }));
+	hotReload.BeginFrame(2, 1);
+	CHECK(shader.version == 2);
+}
+
+TEST_CASE(WatchedFileInSubdirectoryTriggersReload) {
+	TemporaryDirectory directory("EndToEnd");
+	WriteShaderTree(directory);
+	HotReload hotReload;
+	REQUIRE(hotReload.Initialize(directory.GetPath()));
+	TestItem shader;
+	TestItem other;
+	hotReload.Register("Shader", { "a.hlsl" }, shader.MakeRebuild(std::this_thread::get_id()));
+	hotReload.Register("Other", { "other.hlsl" }, other.MakeRebuild(std::this_thread::get_id()));
+
+	// サブディレクトリのインクルードファイルを書き換えると、それを読むシェーダーだけ作り直す
+	directory.WriteFile("common/d.hlsli", "// changed\n");
+	CHECK(WaitUntil([&]() { return shader.rebuildCount == 1; }));
+	hotReload.BeginFrame(1, 0);
+	CHECK(shader.version == 1);
+	CHECK(other.rebuildCount == 0);
+}
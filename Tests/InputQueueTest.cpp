@@ -0,0 +1,206 @@
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "InputQueue.h"
+#include "TestFramework.h"
+
+namespace {
+
+InputEvent MakeEvent(uint64_t timestamp, InputEventType type, uint32_t code = 0, int32_t x = 0, int32_t y = 0) {
+	InputEvent event{};
+	event.timestamp = timestamp;
+	event.type = type;
+	event.code = code;
+	event.x = x;
+	event.y = y;
+	return event;
+}
+
+} // namespace
+
+TEST_CASE(RingRejectsPushWhenFull) {
+	SpscRing<uint32_t, 8> ring;
+	for (uint32_t i = 0; i < 8; ++i) {
+		CHECK(ring.Push(i));
+	}
+	CHECK(!ring.Push(8));
+	uint32_t value = 0;
+	REQUIRE(ring.Pop(value));
+	CHECK(value == 0);
+	// 1つ空いたので書き込める。添字が1周しても順番は変わらない
+	CHECK(ring.Push(8));
+	for (uint32_t i = 1; i <= 8; ++i) {
+		REQUIRE(ring.Pop(value));
+		CHECK(value == i);
+	}
+	CHECK(!ring.Pop(value));
+	CHECK(ring.Front() == nullptr);
+}
+
+TEST_CASE(RingKeepsOrderAcrossThreads) {
+	// 小さいリングで書き込み側と読み出し側を何度も追いつかせる
+	const uint32_t kCount = 200000;
+	auto ring = std::make_unique<SpscRing<uint32_t, 64>>();
+	std::thread producer([&ring] {
+		for (uint32_t i = 0; i < kCount; ++i) {
+			while (!ring->Push(i)) {
+				std::this_thread::yield();
+			}
+		}
+	});
+	uint32_t expected = 0;
+	bool ordered = true;
+	while (expected < kCount) {
+		uint32_t value = 0;
+		if (!ring->Pop(value)) {
+			std::this_thread::yield();
+			continue;
+		}
+		ordered = ordered && value == expected;
+		++expected;
+	}
+	producer.join();
+	CHECK(ordered);
+	uint32_t value = 0;
+	CHECK(!ring->Pop(value));
+}
+
+TEST_CASE(DrainStopsAtTimestamp) {
+	InputQueue queue;
+	queue.Push(MakeEvent(10, InputEventType::KeyDown, 'A'));
+	queue.Push(MakeEvent(20, InputEventType::KeyUp, 'A'));
+	queue.Push(MakeEvent(30, InputEventType::KeyDown, 'B'));
+
+	std::vector<InputEvent> events;
+	CHECK(queue.Drain(5, events) == 0);
+	CHECK(events.empty());
+	CHECK(queue.Drain(20, events) == 2);
+	REQUIRE(events.size() == 2);
+	CHECK(events[0].type == InputEventType::KeyDown && events[0].code == 'A');
+	CHECK(events[1].type == InputEventType::KeyUp && events[1].timestamp == 20);
+	// 残りは次の更新で取り出す
+	CHECK(queue.Drain(UINT64_MAX, events) == 1);
+	REQUIRE(events.size() == 3);
+	CHECK(events[2].code == 'B');
+	CHECK(queue.Drain(UINT64_MAX, events) == 0);
+}
+
+TEST_CASE(CoalesceMergesMovesWheelAndRepeats) {
+	std::vector<InputEvent> events = {
+		MakeEvent(1, InputEventType::MouseMove, 0, 1, 2),
+		MakeEvent(2, InputEventType::MouseMove, 0, 3, -1),
+		MakeEvent(3, InputEventType::MouseMove, 0, -2, 4),
+		MakeEvent(4, InputEventType::KeyDown, 'W'),
+		MakeEvent(5, InputEventType::KeyDown, 'W'), // キーリピート
+		MakeEvent(6, InputEventType::KeyDown, 'S'), // 別のキーはまとめない
+		MakeEvent(7, InputEventType::MouseWheel, 0, 0, 120),
+		MakeEvent(8, InputEventType::MouseWheel, 0, 0, -240),
+		MakeEvent(9, InputEventType::MouseButtonDown, 0),
+		MakeEvent(10, InputEventType::MouseButtonDown, 0), // ボタンはまとめない
+		MakeEvent(11, InputEventType::MouseMove, 0, 5, 5),
+	};
+	InputQueue::Coalesce(events);
+	REQUIRE(events.size() == 7);
+	CHECK(events[0].type == InputEventType::MouseMove && events[0].x == 2 && events[0].y == 5 && events[0].timestamp == 3);
+	CHECK(events[1].type == InputEventType::KeyDown && events[1].code == 'W' && events[1].timestamp == 5);
+	CHECK(events[2].type == InputEventType::KeyDown && events[2].code == 'S');
+	CHECK(events[3].type == InputEventType::MouseWheel && events[3].y == -120 && events[3].timestamp == 8);
+	CHECK(events[4].type == InputEventType::MouseButtonDown);
+	CHECK(events[5].type == InputEventType::MouseButtonDown);
+	CHECK(events[6].type == InputEventType::MouseMove && events[6].x == 5);
+}
+
+TEST_CASE(CoalesceLeavesEarlierEventsAlone) {
+	// Drainは追加した分だけをまとめる
+	std::vector<InputEvent> events = {
+		MakeEvent(1, InputEventType::MouseMove, 0, 1, 1),
+	};
+	InputQueue queue;
+	queue.Push(MakeEvent(2, InputEventType::MouseMove, 0, 1, 1));
+	queue.Push(MakeEvent(3, InputEventType::MouseMove, 0, 1, 1));
+	CHECK(queue.Drain(UINT64_MAX, events) == 2);
+	REQUIRE(events.size() == 2);
+	CHECK(events[0].x == 1 && events[0].timestamp == 1);
+	CHECK(events[1].x == 2 && events[1].timestamp == 3);
+}
+
+TEST_CASE(OverflowIsCounted) {
+	auto queue = std::make_unique<InputQueue>();
+	const size_t kExtra = 10;
+	for (size_t i = 0; i < InputQueue::kCapacity + kExtra; ++i) {
+		queue->Push(MakeEvent(i, InputEventType::KeyDown, static_cast<uint32_t>(i % 2)));
+	}
+	CHECK(queue->GetDroppedCount() == kExtra);
+	// 捨てたのは後から来た分で、先に積んだものは残っている
+	std::vector<InputEvent> events;
+	CHECK(queue->Drain(UINT64_MAX, events) == InputQueue::kCapacity);
+	REQUIRE(!events.empty());
+	CHECK(events.front().timestamp == 0);
+	CHECK(events.back().timestamp == InputQueue::kCapacity - 1);
+}
+
+TEST_CASE(StateTracksTriggersAndDeltas) {
+	InputQueue queue;
+	InputState state;
+	queue.Push(MakeEvent(1, InputEventType::KeyDown, 'A'));
+	queue.Push(MakeEvent(2, InputEventType::KeyUp, 'A'));
+	queue.Push(MakeEvent(3, InputEventType::KeyDown, 'D'));
+	queue.Push(MakeEvent(4, InputEventType::MouseMove, 0, 3, -2));
+	queue.Push(MakeEvent(5, InputEventType::MouseMove, 0, 4, 1));
+	queue.Push(MakeEvent(6, InputEventType::MouseButtonDown, 1));
+	queue.Push(MakeEvent(7, InputEventType::MouseWheel, 0, 0, 120));
+
+	state.BeginUpdate();
+	CHECK(queue.Drain(10, state) == 7);
+	// 同じ更新中に押して離したキーも押されたものとして扱う
+	CHECK(state.IsKeyTriggered('A'));
+	CHECK(state.IsKeyReleased('A'));
+	CHECK(!state.IsKeyDown('A'));
+	CHECK(state.IsKeyDown('D') && state.IsKeyTriggered('D'));
+	CHECK(state.GetMouseDeltaX() == 7 && state.GetMouseDeltaY() == -1);
+	CHECK(state.IsMouseButtonDown(1));
+	CHECK(state.GetWheelDelta() == 120);
+
+	// 次の更新では押しっぱなしの状態だけが残る
+	queue.Push(MakeEvent(11, InputEventType::KeyDown, 'D')); // キーリピート
+	state.BeginUpdate();
+	CHECK(queue.Drain(20, state) == 1);
+	CHECK(state.IsKeyDown('D'));
+	CHECK(!state.IsKeyTriggered('D'));
+	CHECK(!state.IsKeyTriggered('A') && !state.IsKeyReleased('A'));
+	CHECK(state.GetMouseDeltaX() == 0 && state.GetWheelDelta() == 0);
+	CHECK(state.IsMouseButtonDown(1));
+	// 範囲外のコードは無視する
+	state.Apply(MakeEvent(21, InputEventType::KeyDown, InputState::kKeyCount));
+	CHECK(!state.IsKeyDown(InputState::kKeyCount));
+}
+
+TEST_CASE(ReleaseWhileUnfocusedIsNotDropped) {
+	InputQueue queue;
+	InputState state;
+	// 前面にあるときに押し、フォーカスを失ってから離す
+	queue.Push(MakeEvent(1, InputEventType::KeyDown, 'W'), true);
+	queue.Push(MakeEvent(2, InputEventType::MouseButtonDown, 0), true);
+	queue.Push(MakeEvent(3, InputEventType::KeyUp, 'W'), false);
+	queue.Push(MakeEvent(4, InputEventType::MouseButtonUp, 0), false);
+	// 前面にない間の押下・移動・ホイールは積まない
+	queue.Push(MakeEvent(5, InputEventType::KeyDown, 'S'), false);
+	queue.Push(MakeEvent(6, InputEventType::MouseMove, 0, 10, 10), false);
+	queue.Push(MakeEvent(7, InputEventType::MouseButtonDown, 1), false);
+	queue.Push(MakeEvent(8, InputEventType::MouseWheel, 0, 0, 120), false);
+
+	state.BeginUpdate();
+	CHECK(queue.Drain(10, state) == 4);
+	CHECK(!state.IsKeyDown('W') && state.IsKeyReleased('W'));
+	CHECK(!state.IsMouseButtonDown(0));
+	CHECK(!state.IsKeyDown('S') && !state.IsKeyTriggered('S'));
+	CHECK(!state.IsMouseButtonDown(1));
+	CHECK(state.GetMouseDeltaX() == 0 && state.GetWheelDelta() == 0);
+
+	// 前面にない間に押したキーを前面に戻ってから離しても、離したことにはならない
+	queue.Push(MakeEvent(11, InputEventType::KeyUp, 'S'), true);
+	state.BeginUpdate();
+	CHECK(queue.Drain(20, state) == 1);
+	CHECK(!state.IsKeyDown('S') && !state.IsKeyReleased('S'));
+}
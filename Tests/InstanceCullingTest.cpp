@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "InstanceCulling.h"
+#include "TestFramework.h"
+
+namespace {
+
+const float kNearZ = 0.1f;
+const float kFarZ = 100.0f;
+
+// 環境によらず同じ列を返す乱数
+class Random {
+public:
+	explicit Random(uint32_t seed) : state_(seed) {}
+
+	float Range(float minimum, float maximum) {
+		state_ = state_ * 1664525u + 1013904223u;
+		return minimum + (maximum - minimum) * static_cast<float>((state_ >> 8) & 0xFFFF) / 65535.0f;
+	}
+
+private:
+	uint32_t state_;
+};
+
+// 原点から+zを向くカメラの透視投影(行ベクトル×行列、D3DのクリップZは0～w)
+void MakeProjection(float fovY, float aspectRatio, float out[4][4]) {
+	const float yScale = 1.0f / std::tan(fovY * 0.5f);
+	const float zScale = kFarZ / (kFarZ - kNearZ);
+	const float m[4][4] = {
+		{ yScale / aspectRatio, 0.0f, 0.0f, 0.0f },
+		{ 0.0f, yScale, 0.0f, 0.0f },
+		{ 0.0f, 0.0f, zScale, 1.0f },
+		{ 0.0f, 0.0f, -kNearZ * zScale, 0.0f },
+	};
+	std::copy(&m[0][0], &m[0][0] + 16, &out[0][0]);
+}
+
+float ViewDepthToNdc(float z) {
+	return (z - kNearZ) * kFarZ / ((kFarZ - kNearZ) * z);
+}
+
+std::vector<CullingInstance> MakeInstances(uint32_t count, uint32_t seed) {
+	Random random(seed);
+	std::vector<CullingInstance> instances(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		instances[i] = {};
+		instances[i].center[0] = random.Range(-60.0f, 60.0f);
+		instances[i].center[1] = random.Range(-30.0f, 30.0f);
+		instances[i].center[2] = random.Range(-20.0f, 120.0f);
+		instances[i].radius = random.Range(0.1f, 3.0f);
+		instances[i].meshIndex = i % 3;
+	}
+	return instances;
+}
+
+const CullingMesh kMeshes[3] = {
+	{ 36, 0, 0, 0 },
+	{ 120, 36, 24, 0 },
+	{ 960, 156, 48, 0 },
+};
+
+// 境界球を囲むAABBを投影した矩形(最上位ミップの画素範囲)と最も手前の深度。ニア面をまたぐならfalse
+bool ProjectBounds(const float viewProjection[4][4], const CullingInstance& instance, uint32_t width, uint32_t height,
+	uint32_t& x0, uint32_t& x1, uint32_t& y0, uint32_t& y1, float& minZ) {
+	float minX = 1.0f, minY = 1.0f, maxX = -1.0f, maxY = -1.0f;
+	minZ = 1.0f;
+	for (uint32_t corner = 0; corner < 8; ++corner) {
+		const float p[3] = {
+			instance.center[0] + ((corner & 1) ? instance.radius : -instance.radius),
+			instance.center[1] + ((corner & 2) ? instance.radius : -instance.radius),
+			instance.center[2] + ((corner & 4) ? instance.radius : -instance.radius),
+		};
+		float clip[4];
+		for (uint32_t c = 0; c < 4; ++c) {
+			clip[c] = p[0] * viewProjection[0][c] + p[1] * viewProjection[1][c] + p[2] * viewProjection[2][c] + viewProjection[3][c];
+		}
+		if (clip[3] <= 1e-5f) {
+			return false;
+		}
+		minX = std::min(minX, clip[0] / clip[3]);
+		maxX = std::max(maxX, clip[0] / clip[3]);
+		minY = std::min(minY, clip[1] / clip[3]);
+		maxY = std::max(maxY, clip[1] / clip[3]);
+		minZ = std::min(minZ, clip[2] / clip[3]);
+	}
+	auto toPixel = [](float uv, uint32_t size) {
+		return std::min(static_cast<uint32_t>(std::clamp(uv, 0.0f, 1.0f) * static_cast<float>(size)), size - 1);
+	};
+	x0 = toPixel(minX * 0.5f + 0.5f, width);
+	x1 = toPixel(maxX * 0.5f + 0.5f, width);
+	y0 = toPixel(-maxY * 0.5f + 0.5f, height);
+	y1 = toPixel(-minY * 0.5f + 0.5f, height);
+	return minZ > 0.0f;
+}
+
+// 奇数サイズを含む深度バッファ。手前の壁の中に、ところどころ奥まで抜けた穴がある
+std::vector<float> MakeDepth(uint32_t width, uint32_t height, uint32_t seed) {
+	Random random(seed);
+	std::vector<float> depth(static_cast<size_t>(width) * height);
+	for (uint32_t y = 0; y < height; ++y) {
+		for (uint32_t x = 0; x < width; ++x) {
+			const bool hole = (x * 7 + y * 3) % 11 == 0 || x == width - 1 || y == height - 1;
+			depth[static_cast<size_t>(y) * width + x] = hole ? 1.0f : ViewDepthToNdc(random.Range(4.0f, 12.0f));
+		}
+	}
+	return depth;
+}
+
+} // namespace
+
+TEST_CASE(FrustumCullingMatchesScalarTest) {
+	float viewProjection[4][4];
+	MakeProjection(1.0f, 16.0f / 9.0f, viewProjection);
+	const std::vector<CullingInstance> instances = MakeInstances(20011, 1);
+	const CullingView view = InstanceCulling::MakeView(viewProjection, nullptr, static_cast<uint32_t>(instances.size()));
+
+	std::vector<DrawIndexedArguments> expected;
+	for (uint32_t i = 0; i < instances.size(); ++i) {
+		if (InstanceCulling::IsInsideFrustum(view, instances[i].center, instances[i].radius)) {
+			const CullingMesh& mesh = kMeshes[instances[i].meshIndex];
+			expected.push_back({ mesh.indexCount, 1, mesh.startIndex, mesh.baseVertex, i });
+		}
+	}
+	CHECK(!expected.empty() && expected.size() < instances.size());
+
+	for (uint32_t threadCount : { 1u, 3u, 8u }) {
+		std::vector<DrawIndexedArguments> arguments(instances.size());
+		const uint32_t count = InstanceCulling::Cull(view, instances.data(), kMeshes, nullptr, arguments.data(), threadCount);
+		REQUIRE(count == expected.size());
+		for (uint32_t i = 0; i < count; ++i) {
+			CHECK(arguments[i].startInstanceLocation == expected[i].startInstanceLocation);
+			CHECK(arguments[i].indexCountPerInstance == expected[i].indexCountPerInstance);
+			CHECK(arguments[i].startIndexLocation == expected[i].startIndexLocation);
+			CHECK(arguments[i].baseVertexLocation == expected[i].baseVertexLocation);
+			CHECK(arguments[i].instanceCount == 1);
+		}
+	}
+}
+
+TEST_CASE(FrustumPlanesClassifyKnownSpheres) {
+	float viewProjection[4][4];
+	MakeProjection(1.0f, 1.0f, viewProjection);
+	const CullingView view = InstanceCulling::MakeView(viewProjection, nullptr, 0);
+	const float ahead[3] = { 0.0f, 0.0f, 10.0f };
+	const float behind[3] = { 0.0f, 0.0f, -10.0f };
+	const float beyondFar[3] = { 0.0f, 0.0f, kFarZ + 5.0f };
+	const float farLeft[3] = { -100.0f, 0.0f, 10.0f };
+	CHECK(InstanceCulling::IsInsideFrustum(view, ahead, 1.0f));
+	CHECK(!InstanceCulling::IsInsideFrustum(view, behind, 1.0f));
+	CHECK(!InstanceCulling::IsInsideFrustum(view, beyondFar, 1.0f));
+	CHECK(InstanceCulling::IsInsideFrustum(view, beyondFar, 10.0f));
+	CHECK(!InstanceCulling::IsInsideFrustum(view, farLeft, 1.0f));
+}
+
+TEST_CASE(HiZMipsHoldMaxOfFootprint) {
+	for (auto [width, height] : { std::pair{ 37u, 23u }, std::pair{ 64u, 64u }, std::pair{ 1u, 9u }, std::pair{ 33u, 2u } }) {
+		const std::vector<float> depth = MakeDepth(width, height, width * 131 + height);
+		HiZBuffer hiZ;
+		hiZ.Build(depth.data(), width, height);
+		const uint32_t expectedMips = static_cast<uint32_t>(std::floor(std::log2(static_cast<float>(std::max(width, height))))) + 1;
+		REQUIRE(hiZ.GetMipCount() == expectedMips);
+		for (uint32_t mip = 0; mip < hiZ.GetMipCount(); ++mip) {
+			CHECK(hiZ.GetWidth(mip) == std::max(1u, width >> mip) && hiZ.GetHeight(mip) == std::max(1u, height >> mip));
+			// テクセル(x, y)は最上位ミップの[x << mip, (x + 1) << mip)を受け持ち、最後のテクセルは端まで含む
+			for (uint32_t y = 0; y < hiZ.GetHeight(mip); ++y) {
+				for (uint32_t x = 0; x < hiZ.GetWidth(mip); ++x) {
+					const uint32_t sx1 = x + 1 == hiZ.GetWidth(mip) ? width : (x + 1) << mip;
+					const uint32_t sy1 = y + 1 == hiZ.GetHeight(mip) ? height : (y + 1) << mip;
+					float expected = 0.0f;
+					for (uint32_t sy = y << mip; sy < sy1; ++sy) {
+						for (uint32_t sx = x << mip; sx < sx1; ++sx) {
+							expected = std::max(expected, depth[static_cast<size_t>(sy) * width + sx]);
+						}
+					}
+					CHECK(hiZ.Load(mip, x, y) == expected);
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE(HiZOcclusionIsConservative) {
+	// 隠れていると判定したものは、投影した矩形内のどの画素よりも手前の深度が奥にある
+	uint32_t occludedCount = 0, visibleCount = 0;
+	for (auto [width, height] : { std::pair{ 97u, 61u }, std::pair{ 128u, 72u }, std::pair{ 45u, 45u } }) {
+		float viewProjection[4][4];
+		MakeProjection(1.0f, static_cast<float>(width) / static_cast<float>(height), viewProjection);
+		const std::vector<float> depth = MakeDepth(width, height, width + height);
+		HiZBuffer hiZ;
+		hiZ.Build(depth.data(), width, height);
+
+		const std::vector<CullingInstance> instances = MakeInstances(20000, width);
+		for (const CullingInstance& instance : instances) {
+			uint32_t x0, x1, y0, y1;
+			float minZ;
+			const bool projected = ProjectBounds(viewProjection, instance, width, height, x0, x1, y0, y1, minZ);
+			const bool occluded = hiZ.IsOccluded(viewProjection, instance.center, instance.radius);
+			if (!occluded) {
+				++visibleCount;
+				continue;
+			}
+			++occludedCount;
+			REQUIRE(projected);
+			float maxDepth = 0.0f;
+			for (uint32_t y = y0; y <= y1; ++y) {
+				for (uint32_t x = x0; x <= x1; ++x) {
+					maxDepth = std::max(maxDepth, depth[static_cast<size_t>(y) * width + x]);
+				}
+			}
+			CHECK(minZ > maxDepth);
+		}
+	}
+	// 判定の両方が十分に起きていること
+	CHECK(occludedCount > 1000);
+	CHECK(visibleCount > 1000);
+}
+
+TEST_CASE(HiZKeepsObjectsSeenThroughOddEdge) {
+	// 幅7の深度バッファで右から3列目(x = 4)だけが奥まで抜けている。ミップ1のテクセル2はx = 4～6を受け持つ
+	const uint32_t width = 7, height = 7;
+	std::vector<float> depth(width * height, ViewDepthToNdc(2.0f));
+	for (uint32_t y = 0; y < height; ++y) {
+		depth[y * width + 4] = 1.0f;
+	}
+	HiZBuffer hiZ;
+	hiZ.Build(depth.data(), width, height);
+
+	float viewProjection[4][4];
+	MakeProjection(1.0f, 1.0f, viewProjection);
+	// x = 3～4の画素にまたがる、壁より奥の小さな球
+	const float z = 20.0f;
+	const float halfWidth = z * std::tan(0.5f);
+	CullingInstance instance{};
+	instance.center[0] = ((4.0f / 7.0f) * 2.0f - 1.0f) * halfWidth;
+	instance.center[2] = z;
+	instance.radius = halfWidth * 2.0f / 7.0f * 0.6f;
+	CHECK(!hiZ.IsOccluded(viewProjection, instance.center, instance.radius));
+
+	// 抜けていなければ隠れる
+	std::fill(depth.begin(), depth.end(), ViewDepthToNdc(2.0f));
+	hiZ.Build(depth.data(), width, height);
+	CHECK(hiZ.IsOccluded(viewProjection, instance.center, instance.radius));
+}
+
+TEST_CASE(CullWithHiZRemovesOnlyOccluded) {
+	const uint32_t width = 97, height = 61;
+	float viewProjection[4][4];
+	MakeProjection(1.0f, static_cast<float>(width) / static_cast<float>(height), viewProjection);
+	const std::vector<float> depth = MakeDepth(width, height, 5);
+	HiZBuffer hiZ;
+	hiZ.Build(depth.data(), width, height);
+	const std::vector<CullingInstance> instances = MakeInstances(30000, 9);
+	const CullingView view = InstanceCulling::MakeView(viewProjection, &hiZ, static_cast<uint32_t>(instances.size()));
+	CHECK(view.hiZMipCount == hiZ.GetMipCount());
+
+	std::vector<uint32_t> expected;
+	for (uint32_t i = 0; i < instances.size(); ++i) {
+		if (InstanceCulling::IsInsideFrustum(view, instances[i].center, instances[i].radius) &&
+			!hiZ.IsOccluded(viewProjection, instances[i].center, instances[i].radius)) {
+			expected.push_back(i);
+		}
+	}
+	for (uint32_t threadCount : { 1u, 4u }) {
+		std::vector<DrawIndexedArguments> arguments(instances.size());
+		const uint32_t count = InstanceCulling::Cull(view, instances.data(), kMeshes, &hiZ, arguments.data(), threadCount);
+		REQUIRE(count == expected.size());
+		for (uint32_t i = 0; i < count; ++i) {
+			CHECK(arguments[i].startInstanceLocation == expected[i]);
+		}
+	}
+}
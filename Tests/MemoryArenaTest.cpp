@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MemoryArena.h"
+#include "TestFramework.h"
+
+namespace {
+
+bool IsAligned(const void* pointer, size_t alignment) {
+	return reinterpret_cast<uintptr_t>(pointer) % alignment == 0;
+}
+
+size_t CountSnapshots(const char* name) {
+	size_t count = 0;
+	for (const MemoryTracker::Snapshot& snapshot : MemoryTracker::GetInstance()->GetSnapshots()) {
+		count += snapshot.name == name ? 1 : 0;
+	}
+	return count;
+}
+
+} // namespace
+
+TEST_CASE(LinearArenaAlignsAddresses) {
+	LinearArena arena(64 * 1024, "TestLinear");
+	// 確保の間に半端なサイズを挟み、オフセットだけを揃えたのでは足りない状態にする
+	for (size_t alignment = 1; alignment <= 4096; alignment *= 2) {
+		arena.Allocate(3, 1);
+		void* pointer = arena.Allocate(40, alignment);
+		CHECK(IsAligned(pointer, alignment));
+	}
+	// 容量を超えた分もアライメントを守る
+	void* overflow = arena.Allocate(128 * 1024, 1024);
+	CHECK(IsAligned(overflow, 1024));
+	CHECK(arena.GetStatistics()->overflowCount.load() >= 1);
+	arena.Reset();
+	CHECK(arena.GetUsedBytes() == 0);
+}
+
+TEST_CASE(ScratchStackAlignsAddressesAndRewinds) {
+	ScratchStack stack(64 * 1024, "TestScratch");
+	const ScratchStack::Marker start = stack.GetMarker();
+	for (size_t alignment = 1; alignment <= 4096; alignment *= 2) {
+		stack.Allocate(5, 1);
+		CHECK(IsAligned(stack.Allocate(24, alignment), alignment));
+	}
+	{
+		ScratchScope scope(stack);
+		CHECK(IsAligned(scope.Allocate(100 * 1024, 256), 256));
+		std::pmr::vector<int> values(scope.GetResource());
+		values.assign(1000, 7);
+		CHECK(values.back() == 7);
+	}
+	stack.FreeToMarker(start);
+	const ScratchStack::Marker end = stack.GetMarker();
+	CHECK(end.offset == start.offset && end.overflowCount == start.overflowCount);
+}
+
+TEST_CASE(FrameAllocatorKeepsPreviousFrame) {
+	FrameAllocator allocator(4096, "TestFrame");
+	allocator.BeginFrame();
+	char* previous = allocator.AllocateArray<char>(64);
+	std::memset(previous, 'a', 64);
+
+	// 次のフレームでは別のアリーナを使うので、前のフレームの内容は残る
+	allocator.BeginFrame();
+	char* current = allocator.AllocateArray<char>(64);
+	std::memset(current, 'b', 64);
+	CHECK(std::all_of(previous, previous + 64, [](char c) { return c == 'a'; }));
+
+	std::pmr::string text("frame allocated text that does not fit in the small buffer", allocator.GetResource());
+	CHECK(text.size() > 32);
+	CHECK(allocator.GetCurrentArena().GetUsedBytes() >= 64 + text.size());
+}
+
+TEST_CASE(ConcurrentArenaAllocationsDoNotOverlap) {
+	const uint32_t kThreadCount = 4;
+	const uint32_t kAllocationCount = 2000;
+	LinearArena arena(256 * 1024, "TestConcurrent");
+	std::vector<std::vector<std::pair<uint8_t*, size_t>>> blocks(kThreadCount);
+	std::vector<std::thread> workers;
+	for (uint32_t t = 0; t < kThreadCount; ++t) {
+		workers.emplace_back([&, t]() {
+			for (uint32_t i = 0; i < kAllocationCount; ++i) {
+				const size_t size = 8 + (i * 37 + t) % 120;
+				const size_t alignment = size_t(1) << ((i + t) % 7);
+				uint8_t* pointer = static_cast<uint8_t*>(arena.Allocate(size, alignment));
+				std::memset(pointer, static_cast<int>(t + 1), size);
+				blocks[t].emplace_back(pointer, size);
+			}
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	// 他のスレッドに上書きされていなければ重なっていない(容量を超えた分はヒープに逃がしている)
+	for (uint32_t t = 0; t < kThreadCount; ++t) {
+		for (const auto& [pointer, size] : blocks[t]) {
+			CHECK(std::all_of(pointer, pointer + size, [t](uint8_t value) { return value == t + 1; }));
+		}
+	}
+	CHECK(arena.GetStatistics()->allocationCount.load() >= kThreadCount * kAllocationCount);
+}
+
+TEST_CASE(ThreadLocalScratchSharesOneStatistics) {
+	ScratchStack::GetThreadLocal().Allocate(16);
+	const size_t snapshotCount = MemoryTracker::GetInstance()->GetSnapshots().size();
+	for (int round = 0; round < 8; ++round) {
+		std::vector<std::thread> workers;
+		for (int i = 0; i < 8; ++i) {
+			workers.emplace_back([]() {
+				ScratchScope scope;
+				CHECK(IsAligned(scope.Allocate(64, 64), 64));
+			});
+		}
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}
+	// 64スレッドが作られても登録は増えない
+	CHECK(MemoryTracker::GetInstance()->GetSnapshots().size() == snapshotCount);
+	CHECK(CountSnapshots("ThreadScratch") == 1);
+
+	// 同じ名前は共有し、違う名前は別に登録する
+	MemoryStatistics* first = MemoryTracker::GetInstance()->Register("TestShared");
+	CHECK(MemoryTracker::GetInstance()->Register("TestShared") == first);
+	CHECK(MemoryTracker::GetInstance()->Register("TestOther") != first);
+}
+
+TEST_CASE(PoolReusesBlocks) {
+	PoolAllocator pool(24, 4, "TestPool");
+	std::vector<void*> blocks;
+	for (int i = 0; i < 10; ++i) {
+		blocks.push_back(pool.Allocate());
+		CHECK(IsAligned(blocks.back(), alignof(std::max_align_t)));
+	}
+	std::sort(blocks.begin(), blocks.end());
+	CHECK(std::adjacent_find(blocks.begin(), blocks.end()) == blocks.end());
+
+	void* last = blocks.back();
+	pool.Free(last);
+	CHECK(pool.Allocate() == last);
+
+	ObjectPool<std::string> strings(8, "TestObjectPool");
+	std::string* text = strings.Create("pooled");
+	CHECK(*text == "pooled");
+	strings.Destroy(text);
+	CHECK(strings.Create("again") == text);
+}
@@ -0,0 +1,172 @@
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "ParticleSystem.h"
+#include "TestFramework.h"
+
+namespace {
+
+// main.cppと同じ噴水。寿命は呼び出し側で決める
+ParticleEmitter MakeEmitter(float emitRate, float lifetimeMin, float lifetimeMax) {
+	ParticleEmitter emitter{};
+	emitter.positionSpread = 0.1f;
+	emitter.velocity[1] = 6.0f;
+	emitter.velocitySpread = 2.5f;
+	emitter.gravity[1] = -6.0f;
+	emitter.drag = 0.2f;
+	emitter.lifetimeMin = lifetimeMin;
+	emitter.lifetimeMax = lifetimeMax;
+	emitter.emitRate = emitRate;
+	emitter.size = 0.03f;
+	return emitter;
+}
+
+std::vector<ParticleData> Snapshot(const ParticleSystem& particles) {
+	std::vector<ParticleData> result(particles.GetAliveCount());
+	particles.CopyTo(result.data());
+	return result;
+}
+
+bool SameParticles(const std::vector<ParticleData>& a, const std::vector<ParticleData>& b) {
+	return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), sizeof(ParticleData) * a.size()) == 0);
+}
+
+} // namespace
+
+TEST_CASE(SimdStepMatchesScalarStep) {
+	// 4で割り切れない数にして、端数の4つ組も確かめる
+	const uint32_t kCount = 1003;
+	const float kDeltaTime = 1.0f / 60.0f;
+	ParticleEmitter emitter = MakeEmitter(0.0f, 100.0f, 100.0f);
+	emitter.gravity[0] = 1.5f;
+	emitter.gravity[2] = -0.5f;
+	ParticleSystem particles;
+	particles.Initialize(kCount, 7);
+	REQUIRE(particles.Emit(emitter, kCount) == kCount);
+	std::vector<ParticleData> before = Snapshot(particles);
+
+	particles.Update(emitter, kDeltaTime);
+	REQUIRE(particles.GetAliveCount() == kCount);
+
+	const float dragFactor = 1.0f - emitter.drag * kDeltaTime;
+	bool matched = true;
+	for (uint32_t i = 0; i < kCount; ++i) {
+		ParticleData expected = before[i];
+		for (int axis = 0; axis < 3; ++axis) {
+			expected.velocity[axis] = (expected.velocity[axis] + emitter.gravity[axis] * kDeltaTime) * dragFactor;
+			expected.position[axis] = expected.position[axis] + expected.velocity[axis] * kDeltaTime;
+		}
+		expected.age += kDeltaTime;
+		const ParticleData actual = particles.GetParticle(i);
+		for (int axis = 0; axis < 3; ++axis) {
+			matched = matched && std::abs(actual.velocity[axis] - expected.velocity[axis]) <= 1e-5f;
+			matched = matched && std::abs(actual.position[axis] - expected.position[axis]) <= 1e-5f;
+		}
+		matched = matched && actual.age == expected.age && actual.lifetime == expected.lifetime;
+	}
+	CHECK(matched);
+}
+
+TEST_CASE(UpdateIsIndependentOfThreadCount) {
+	// 複数スレッドに分かれるだけの数を用意し、発生と寿命切れを毎フレーム混ぜる
+	const uint32_t kCapacity = 200000;
+	const uint32_t kFrameCount = 12;
+	const ParticleEmitter emitter = MakeEmitter(600000.0f, 0.05f, 0.3f);
+	std::vector<ParticleData> reference;
+	for (uint32_t threadCount : { 1u, 2u, 5u, 0u }) {
+		ParticleSystem particles;
+		particles.Initialize(kCapacity, 42);
+		particles.Emit(emitter, 150000);
+		for (uint32_t frame = 0; frame < kFrameCount; ++frame) {
+			particles.Update(emitter, 1.0f / 60.0f, threadCount);
+		}
+		std::vector<ParticleData> result = Snapshot(particles);
+		if (threadCount == 1) {
+			REQUIRE(result.size() > 2 * 16384);
+			reference = std::move(result);
+		} else {
+			CHECK(SameParticles(result, reference));
+		}
+	}
+}
+
+TEST_CASE(CompactionKeepsAliveOrder) {
+	const uint32_t kCount = 50000;
+	const float kDeltaTime = 0.05f;
+	const ParticleEmitter emitter = MakeEmitter(0.0f, 0.01f, 0.2f);
+	for (uint32_t threadCount : { 1u, 3u }) {
+		ParticleSystem particles;
+		particles.Initialize(kCount, 3);
+		particles.Emit(emitter, kCount);
+		const std::vector<ParticleData> before = Snapshot(particles);
+
+		particles.Update(emitter, kDeltaTime, threadCount);
+
+		// 寿命は更新で変わらないので、生き残ったものの寿命の並びで順序を確かめる
+		std::vector<float> expected;
+		for (const ParticleData& particle : before) {
+			if (particle.age + kDeltaTime < particle.lifetime) {
+				expected.push_back(particle.lifetime);
+			}
+		}
+		REQUIRE(!expected.empty() && expected.size() < before.size());
+		REQUIRE(particles.GetAliveCount() == expected.size());
+		bool ordered = true;
+		for (uint32_t i = 0; i < particles.GetAliveCount(); ++i) {
+			ordered = ordered && particles.GetParticle(i).lifetime == expected[i];
+		}
+		CHECK(ordered);
+	}
+}
+
+TEST_CASE(EmitClampsToFreeCapacity) {
+	const ParticleEmitter emitter = MakeEmitter(0.0f, 10.0f, 10.0f);
+	ParticleSystem particles;
+	particles.Initialize(10);
+	CHECK(particles.Emit(emitter, 7) == 7);
+	CHECK(particles.Emit(emitter, 7) == 3);
+	CHECK(particles.Emit(emitter, 1) == 0);
+	CHECK(particles.GetAliveCount() == 10);
+
+	// 毎秒の発生数が多すぎても最大数を超えない
+	ParticleSystem flooded;
+	flooded.Initialize(100);
+	flooded.Update(MakeEmitter(1.0e6f, 10.0f, 10.0f), 1.0f / 60.0f);
+	CHECK(flooded.GetAliveCount() == 100);
+}
+
+TEST_CASE(FractionalEmitRateCarriesOver) {
+	// 1フレームあたり0.3125個。2進で割り切れる値にして誤差を入れない
+	const ParticleEmitter emitter = MakeEmitter(2.5f, 100.0f, 100.0f);
+	ParticleSystem particles;
+	particles.Initialize(64);
+	const uint32_t expected[] = { 0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5 };
+	bool matched = true;
+	for (uint32_t expectedCount : expected) {
+		particles.Update(emitter, 0.125f);
+		matched = matched && particles.GetAliveCount() == expectedCount;
+	}
+	CHECK(matched);
+	CHECK(particles.GetAliveCount() == 5);
+}
+
+TEST_CASE(CopyMatchesGetParticleAtScale) {
+	const ParticleEmitter emitter = MakeEmitter(0.0f, 0.01f, 0.03f);
+	for (uint32_t capacity : { 100000u, 1000000u }) {
+		ParticleSystem particles;
+		particles.Initialize(capacity, 11);
+		REQUIRE(particles.Emit(emitter, capacity) == capacity);
+		// 一部を寿命切れにしてから書き出す
+		particles.Update(emitter, 0.016f, 0);
+		REQUIRE(particles.GetAliveCount() > 0 && particles.GetAliveCount() < capacity);
+
+		const std::vector<ParticleData> copied = Snapshot(particles);
+		bool matched = true;
+		for (uint32_t i = 0; i < particles.GetAliveCount(); ++i) {
+			const ParticleData particle = particles.GetParticle(i);
+			matched = matched && std::memcmp(&copied[i], &particle, sizeof(ParticleData)) == 0;
+		}
+		CHECK(matched);
+	}
+}
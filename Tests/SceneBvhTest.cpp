@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "SceneBvh.h"
+#include "TestFramework.h"
+
+namespace {
+
+// 環境によらず同じ列を返す乱数
+class Random {
+public:
+	explicit Random(uint32_t seed) : state_(seed) {}
+
+	uint32_t Next() {
+		state_ = state_ * 1664525u + 1013904223u;
+		return state_ >> 8;
+	}
+
+	float Range(float minimum, float maximum) {
+		return minimum + (maximum - minimum) * static_cast<float>(Next() & 0xFFFF) / 65535.0f;
+	}
+
+private:
+	uint32_t state_;
+};
+
+// 大きさのばらついた箱を散らし、同じ位置に重ねた箱も混ぜる(距離が同じときの番号の決め方を見る)
+std::vector<BvhBounds> MakeBounds(uint32_t count, float worldSize, uint32_t seed) {
+	Random random(seed);
+	std::vector<BvhBounds> bounds(count);
+	const float half = worldSize * 0.5f;
+	for (uint32_t i = 0; i < count; ++i) {
+		if (i % 50 == 49) {
+			bounds[i] = bounds[i - 1];
+			continue;
+		}
+		const float size = i % 100 == 0 ? random.Range(5.0f, 30.0f) : random.Range(0.1f, 3.0f);
+		for (int axis = 0; axis < 3; ++axis) {
+			const float center = random.Range(-half, half);
+			bounds[i].min[axis] = center - size * random.Range(0.2f, 1.0f);
+			bounds[i].max[axis] = center + size * random.Range(0.2f, 1.0f);
+		}
+	}
+	return bounds;
+}
+
+// 各プリミティブを少しずつ、一部は大きく動かす
+void MoveBounds(std::vector<BvhBounds>& bounds, uint32_t seed) {
+	Random random(seed);
+	for (size_t i = 0; i < bounds.size(); ++i) {
+		const float scale = i % 10 == 0 ? 20.0f : 1.0f;
+		for (int axis = 0; axis < 3; ++axis) {
+			const float offset = random.Range(-scale, scale);
+			bounds[i].min[axis] += offset;
+			bounds[i].max[axis] += offset;
+		}
+	}
+}
+
+std::vector<BvhRay> MakeRays(uint32_t count, float worldSize, uint32_t seed) {
+	Random random(seed);
+	std::vector<BvhRay> rays(count);
+	const float half = worldSize * 0.5f;
+	for (uint32_t i = 0; i < count; ++i) {
+		BvhRay& ray = rays[i];
+		for (int axis = 0; axis < 3; ++axis) {
+			ray.origin[axis] = random.Range(-half, half);
+			ray.direction[axis] = random.Range(-1.0f, 1.0f);
+		}
+		// 軸と平行なレイと、長さの短いレイも混ぜる
+		if (i % 8 == 0) {
+			ray.direction[0] = ray.direction[1] = 0.0f;
+			ray.direction[2] = 1.0f;
+		}
+		ray.maxDistance = i % 4 == 0 ? random.Range(1.0f, 20.0f) : worldSize * 4.0f;
+	}
+	return rays;
+}
+
+// 原点から+zを向いた視錐台(内向き法線と距離)を、y軸まわりにyawだけ回す
+void MakeFrustum(float yaw, float nearZ, float farZ, float outPlanes[6][4]) {
+	const float localPlanes[6][4] = {
+		{ 1.0f, 0.0f, 1.0f, 0.0f },  // 左
+		{ -1.0f, 0.0f, 1.0f, 0.0f }, // 右
+		{ 0.0f, 2.0f, 1.0f, 0.0f },  // 下(縦は狭め)
+		{ 0.0f, -2.0f, 1.0f, 0.0f }, // 上
+		{ 0.0f, 0.0f, 1.0f, -nearZ },
+		{ 0.0f, 0.0f, -1.0f, farZ },
+	};
+	const float c = std::cos(yaw);
+	const float s = std::sin(yaw);
+	for (int i = 0; i < 6; ++i) {
+		outPlanes[i][0] = c * localPlanes[i][0] + s * localPlanes[i][2];
+		outPlanes[i][1] = localPlanes[i][1];
+		outPlanes[i][2] = -s * localPlanes[i][0] + c * localPlanes[i][2];
+		outPlanes[i][3] = localPlanes[i][3];
+	}
+}
+
+// 総当たりで一番近い当たり(距離が同じなら番号の小さい方)
+BvhHit IntersectBruteForce(const std::vector<BvhBounds>& bounds, const BvhRay& ray) {
+	BvhHit hit{ SceneBvh::kInvalidIndex, ray.maxDistance };
+	for (uint32_t i = 0; i < bounds.size(); ++i) {
+		float distance;
+		if (SceneBvh::IntersectBounds(ray, bounds[i], distance) &&
+			(hit.primitive == SceneBvh::kInvalidIndex || distance < hit.distance)) {
+			hit = { i, distance };
+		}
+	}
+	return hit;
+}
+
+std::vector<uint32_t> QueryBoundsBruteForce(const std::vector<BvhBounds>& bounds, const BvhBounds& query) {
+	std::vector<uint32_t> result;
+	for (uint32_t i = 0; i < bounds.size(); ++i) {
+		if (SceneBvh::OverlapBounds(bounds[i], query)) {
+			result.push_back(i);
+		}
+	}
+	return result;
+}
+
+std::vector<uint32_t> QueryFrustumBruteForce(const std::vector<BvhBounds>& bounds, const float planes[6][4]) {
+	std::vector<uint32_t> result;
+	for (uint32_t i = 0; i < bounds.size(); ++i) {
+		if (SceneBvh::OverlapFrustum(planes, bounds[i])) {
+			result.push_back(i);
+		}
+	}
+	return result;
+}
+
+std::vector<uint32_t> Sorted(std::vector<uint32_t> values) {
+	std::sort(values.begin(), values.end());
+	return values;
+}
+
+// レイ・AABB・視錐台のクエリがすべて総当たりと一致するか
+bool MatchesBruteForce(const SceneBvh& bvh, const std::vector<BvhBounds>& bounds, float worldSize, uint32_t seed) {
+	bool matches = true;
+	for (const BvhRay& ray : MakeRays(500, worldSize, seed)) {
+		const BvhHit expected = IntersectBruteForce(bounds, ray);
+		BvhHit hit;
+		const bool found = bvh.Intersect(ray, hit);
+		matches = matches && found == (expected.primitive != SceneBvh::kInvalidIndex) && hit.primitive == expected.primitive;
+		matches = matches && (!found || hit.distance == expected.distance);
+		matches = matches && bvh.IsOccluded(ray) == found;
+	}
+
+	Random random(seed);
+	std::vector<uint32_t> primitives;
+	for (uint32_t i = 0; i < 100; ++i) {
+		BvhBounds query;
+		const float size = random.Range(0.5f, worldSize * 0.2f);
+		for (int axis = 0; axis < 3; ++axis) {
+			const float center = random.Range(-worldSize * 0.5f, worldSize * 0.5f);
+			query.min[axis] = center - size;
+			query.max[axis] = center + size;
+		}
+		primitives.clear();
+		const uint32_t added = bvh.QueryBounds(query, primitives);
+		matches = matches && added == primitives.size() && Sorted(primitives) == QueryBoundsBruteForce(bounds, query);
+	}
+
+	for (uint32_t i = 0; i < 16; ++i) {
+		float planes[6][4];
+		MakeFrustum(static_cast<float>(i) * 0.4f, 1.0f, worldSize * (0.1f + 0.1f * static_cast<float>(i % 8)), planes);
+		primitives.clear();
+		const uint32_t added = bvh.QueryFrustum(planes, primitives);
+		matches = matches && added == primitives.size() && Sorted(primitives) == QueryFrustumBruteForce(bounds, planes);
+	}
+	return matches;
+}
+
+} // namespace
+
+TEST_CASE(QueriesMatchBruteForce) {
+	for (uint32_t count : { 1u, 5u, 17u, 300u, 5000u }) {
+		const float worldSize = 20.0f * std::sqrt(static_cast<float>(count));
+		const std::vector<BvhBounds> bounds = MakeBounds(count, worldSize, count);
+		SceneBvh bvh;
+		bvh.Build(bounds.data(), count, 1);
+		CHECK(bvh.GetPrimitiveCount() == count);
+		CHECK(MatchesBruteForce(bvh, bounds, worldSize, count + 1));
+	}
+}
+
+TEST_CASE(QueriesMatchBruteForceAfterRefit) {
+	const uint32_t kCount = 4000;
+	const float worldSize = 800.0f;
+	std::vector<BvhBounds> bounds = MakeBounds(kCount, worldSize, 3);
+	SceneBvh bvh;
+	bvh.Build(bounds.data(), kCount, 2);
+	CHECK(MatchesBruteForce(bvh, bounds, worldSize, 4));
+
+	// 木の形はそのままでも、動かした後のAABBで正しく答える
+	for (uint32_t frame = 0; frame < 3; ++frame) {
+		MoveBounds(bounds, 10 + frame);
+		bvh.Refit(bounds.data(), frame == 0 ? 1 : 3);
+		CHECK(MatchesBruteForce(bvh, bounds, worldSize, 20 + frame));
+	}
+}
+
+TEST_CASE(BuildDoesNotDependOnThreadCount) {
+	const uint32_t kCount = 20000;
+	const std::vector<BvhBounds> bounds = MakeBounds(kCount, 2000.0f, 8);
+	SceneBvh single;
+	SceneBvh multi;
+	single.Build(bounds.data(), kCount, 1);
+	multi.Build(bounds.data(), kCount, 4);
+	REQUIRE(single.GetNodeCount() == multi.GetNodeCount());
+	CHECK(std::memcmp(single.GetNodes().data(), multi.GetNodes().data(), sizeof(SceneBvh::Node) * single.GetNodeCount()) == 0);
+
+	// 葉には高々kMaxLeafSize個
+	bool leafSizeOk = true;
+	for (const SceneBvh::Node& node : single.GetNodes()) {
+		for (uint32_t count : node.counts) {
+			leafSizeOk = leafSizeOk && count <= SceneBvh::kMaxLeafSize;
+		}
+	}
+	CHECK(leafSizeOk);
+}
+
+TEST_CASE(BatchQueriesMatchSingleQueries) {
+	const uint32_t kCount = 3000;
+	const float worldSize = 600.0f;
+	const std::vector<BvhBounds> bounds = MakeBounds(kCount, worldSize, 12);
+	SceneBvh bvh;
+	bvh.Build(bounds.data(), kCount, 1);
+
+	const std::vector<BvhRay> rays = MakeRays(1000, worldSize, 13);
+	std::vector<BvhHit> hits(rays.size());
+	std::vector<uint8_t> occluded(rays.size());
+	bvh.IntersectBatch(rays.data(), static_cast<uint32_t>(rays.size()), hits.data(), 3);
+	bvh.IsOccludedBatch(rays.data(), static_cast<uint32_t>(rays.size()), occluded.data(), 3);
+	bool raysMatch = true;
+	for (size_t i = 0; i < rays.size(); ++i) {
+		BvhHit hit;
+		const bool found = bvh.Intersect(rays[i], hit);
+		raysMatch = raysMatch && hits[i].primitive == hit.primitive && (occluded[i] != 0) == found;
+	}
+	CHECK(raysMatch);
+
+	float planes[4][6][4];
+	for (uint32_t i = 0; i < 4; ++i) {
+		MakeFrustum(static_cast<float>(i) * 1.5f, 1.0f, 100.0f * static_cast<float>(i + 1), planes[i]);
+	}
+	std::vector<BvhQueryRange> ranges;
+	std::vector<uint32_t> primitives;
+	bvh.QueryFrustumBatch(planes, 4, ranges, primitives, 2);
+	REQUIRE(ranges.size() == 4);
+	bool frustumsMatch = true;
+	for (uint32_t i = 0; i < 4; ++i) {
+		const std::vector<uint32_t> batch(primitives.begin() + ranges[i].offset, primitives.begin() + ranges[i].offset + ranges[i].count);
+		frustumsMatch = frustumsMatch && Sorted(batch) == QueryFrustumBruteForce(bounds, planes[i]);
+	}
+	CHECK(frustumsMatch);
+
+	const BvhBounds queries[2] = { { { -50.0f, -50.0f, -50.0f }, { 50.0f, 50.0f, 50.0f } }, { { 200.0f, -5.0f, 0.0f }, { 260.0f, 5.0f, 80.0f } } };
+	bvh.QueryBoundsBatch(queries, 2, ranges, primitives, 2);
+	REQUIRE(ranges.size() == 2);
+	CHECK(ranges[0].offset == 0 && ranges[1].offset == ranges[0].count);
+	const std::vector<uint32_t> second(primitives.begin() + ranges[1].offset, primitives.begin() + ranges[1].offset + ranges[1].count);
+	CHECK(Sorted(second) == QueryBoundsBruteForce(bounds, queries[1]));
+}
+
+TEST_CASE(EmptyBvhFindsNothing) {
+	SceneBvh bvh;
+	bvh.Build(nullptr, 0, 1);
+	BvhRay ray{ { 0.0f, 0.0f, 0.0f }, 100.0f, { 0.0f, 0.0f, 1.0f } };
+	BvhHit hit;
+	CHECK(!bvh.Intersect(ray, hit));
+	CHECK(hit.primitive == SceneBvh::kInvalidIndex);
+	CHECK(!bvh.IsOccluded(ray));
+	std::vector<uint32_t> primitives;
+	const BvhBounds query{ { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f } };
+	CHECK(bvh.QueryBounds(query, primitives) == 0);
+}
@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <vector>
+
+#include "SpriteBatch.h"
+#include "TestFramework.h"
+#include "TextureAtlas.h"
+
+namespace {
+
+// 環境によらず同じ列を返す乱数
+class Random {
+public:
+	explicit Random(uint32_t seed) : state_(seed) {}
+
+	uint32_t Next() {
+		state_ = state_ * 1664525u + 1013904223u;
+		return state_ >> 8;
+	}
+
+	uint32_t Range(uint32_t minimum, uint32_t maximum) {
+		return minimum + Next() % (maximum - minimum + 1);
+	}
+
+private:
+	uint32_t state_;
+};
+
+// 積んだ順の番号をcolorに入れたスプライト
+Sprite MakeSprite(uint32_t id, uint16_t layer, uint32_t textureIndex) {
+	Sprite sprite{};
+	sprite.size[0] = sprite.size[1] = 16.0f;
+	sprite.uvMax[0] = sprite.uvMax[1] = 1.0f;
+	sprite.color = id;
+	sprite.textureIndex = textureIndex;
+	sprite.layer = layer;
+	return sprite;
+}
+
+// 期待する並び(レイヤー、ページ、積んだ順)
+bool IsSortedStably(const std::vector<Sprite>& sprites, const std::vector<SpriteInstance>& instances, uint32_t count) {
+	for (uint32_t i = 1; i < count; ++i) {
+		const Sprite& a = sprites[instances[i - 1].color];
+		const Sprite& b = sprites[instances[i].color];
+		if (a.layer != b.layer) {
+			if (a.layer > b.layer) {
+				return false;
+			}
+		} else if (a.textureIndex != b.textureIndex) {
+			if (a.textureIndex > b.textureIndex) {
+				return false;
+			}
+		} else if (instances[i - 1].color >= instances[i].color) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// 余白込みの矩形が重なるか
+bool Overlaps(const AtlasRect& a, const AtlasRect& b, uint32_t padding) {
+	if (a.page != b.page) {
+		return false;
+	}
+	return a.x - padding < b.x + b.width + padding && b.x - padding < a.x + a.width + padding &&
+		a.y - padding < b.y + b.height + padding && b.y - padding < a.y + a.height + padding;
+}
+
+// 画素ごとに位置と画像番号から決まる色を入れた画像
+TextureImage MakeImage(uint32_t width, uint32_t height, uint32_t id) {
+	TextureImage image;
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(static_cast<size_t>(width) * height * 4);
+	for (uint32_t y = 0; y < height; ++y) {
+		for (uint32_t x = 0; x < width; ++x) {
+			uint8_t* pixel = &image.pixels[(static_cast<size_t>(y) * width + x) * 4];
+			pixel[0] = static_cast<uint8_t>(x * 7 + id);
+			pixel[1] = static_cast<uint8_t>(y * 13 + id);
+			pixel[2] = static_cast<uint8_t>(id * 31);
+			pixel[3] = 255;
+		}
+	}
+	return image;
+}
+
+bool SamePixel(const uint8_t* a, const uint8_t* b) {
+	return a[0] == b[0] && a[1] == b[1] && a[2] == b[2] && a[3] == b[3];
+}
+
+} // namespace
+
+TEST_CASE(SortIsStableByLayerAndPage) {
+	Random random(3);
+	std::vector<Sprite> sprites;
+	for (uint32_t i = 0; i < 5000; ++i) {
+		sprites.push_back(MakeSprite(i, static_cast<uint16_t>(random.Range(0, 5)), random.Range(0, 7)));
+	}
+	SpriteBatch batch;
+	batch.Begin();
+	for (const Sprite& sprite : sprites) {
+		batch.Draw(sprite);
+	}
+	std::vector<SpriteInstance> instances(sprites.size());
+	const uint32_t count = batch.End(instances.data(), static_cast<uint32_t>(instances.size()));
+	REQUIRE(count == sprites.size());
+	CHECK(IsSortedStably(sprites, instances, count));
+}
+
+TEST_CASE(SortHandlesWideKeys) {
+	// レイヤーとページが8ビットを超え、基数ソートが複数の桁を回す
+	Random random(11);
+	std::vector<Sprite> sprites;
+	for (uint32_t i = 0; i < 3000; ++i) {
+		sprites.push_back(MakeSprite(i, static_cast<uint16_t>(random.Range(0, 1000)), random.Range(0, 40000)));
+	}
+	// 同じキーのスプライトも混ぜる
+	for (uint32_t i = 0; i < 500; ++i) {
+		sprites.push_back(MakeSprite(3000 + i, 700, 300));
+	}
+	SpriteBatch batch;
+	batch.Begin();
+	for (const Sprite& sprite : sprites) {
+		batch.Draw(sprite);
+	}
+	std::vector<SpriteInstance> instances(sprites.size());
+	const uint32_t count = batch.End(instances.data(), static_cast<uint32_t>(instances.size()));
+	REQUIRE(count == sprites.size());
+	CHECK(IsSortedStably(sprites, instances, count));
+}
+
+TEST_CASE(SortKeepsOrderWhenKeysMatch) {
+	// 全部同じキーなら全桁を飛ばし、積んだ順のまま1つの範囲になる
+	SpriteBatch batch;
+	batch.Begin();
+	for (uint32_t i = 0; i < 300; ++i) {
+		batch.Draw(MakeSprite(i, 4, 2));
+	}
+	std::vector<SpriteInstance> instances(300);
+	CHECK(batch.End(instances.data(), 300) == 300);
+	bool inOrder = true;
+	for (uint32_t i = 0; i < 300; ++i) {
+		inOrder = inOrder && instances[i].color == i;
+	}
+	CHECK(inOrder);
+	REQUIRE(batch.GetBatches().size() == 1);
+	CHECK(batch.GetBatches()[0].layer == 4);
+	CHECK(batch.GetBatches()[0].instanceCount == 300);
+}
+
+TEST_CASE(RangesSplitByLayer) {
+	Random random(7);
+	std::vector<Sprite> sprites;
+	for (uint32_t i = 0; i < 2000; ++i) {
+		// レイヤー0,2,5だけを使い、ページはばらばら
+		const uint16_t layers[] = { 0, 2, 5 };
+		sprites.push_back(MakeSprite(i, layers[random.Range(0, 2)], random.Range(0, 3)));
+	}
+	SpriteBatch batch;
+	batch.Begin();
+	for (const Sprite& sprite : sprites) {
+		batch.Draw(sprite);
+	}
+	std::vector<SpriteInstance> instances(sprites.size());
+	const uint32_t count = batch.End(instances.data(), static_cast<uint32_t>(instances.size()));
+
+	// ページが違っても同じレイヤーなら1つの範囲。範囲は隙間なく並ぶ
+	const std::vector<SpriteBatchRange>& ranges = batch.GetBatches();
+	REQUIRE(ranges.size() == 3);
+	CHECK(ranges[0].layer == 0 && ranges[1].layer == 2 && ranges[2].layer == 5);
+	uint32_t next = 0;
+	bool sameLayer = true;
+	for (const SpriteBatchRange& range : ranges) {
+		CHECK(range.firstInstance == next);
+		for (uint32_t i = range.firstInstance; i < range.firstInstance + range.instanceCount; ++i) {
+			sameLayer = sameLayer && sprites[instances[i].color].layer == range.layer;
+		}
+		next += range.instanceCount;
+	}
+	CHECK(sameLayer);
+	CHECK(next == count);
+}
+
+TEST_CASE(EndTruncatesToCapacity) {
+	SpriteBatch batch;
+	batch.Begin();
+	for (uint32_t i = 0; i < 100; ++i) {
+		batch.Draw(MakeSprite(i, static_cast<uint16_t>(i % 2), 0));
+	}
+	// 書き込める数を超えた分(奥から並べた後ろ側)は捨てる
+	std::vector<SpriteInstance> instances(60);
+	CHECK(batch.End(instances.data(), 60) == 60);
+	const std::vector<SpriteBatchRange>& ranges = batch.GetBatches();
+	REQUIRE(ranges.size() == 2);
+	CHECK(ranges[0].instanceCount == 50);
+	CHECK(ranges[1].instanceCount == 10);
+	CHECK(batch.GetSpriteCount() == 100);
+
+	// Beginで空になる
+	batch.Begin();
+	CHECK(batch.End(instances.data(), 60) == 0);
+	CHECK(batch.GetBatches().empty());
+}
+
+TEST_CASE(PackerKeepsRectsInsidePagesWithoutOverlap) {
+	for (uint32_t padding : { 0u, 1u, 4u }) {
+		AtlasPacker packer;
+		packer.Initialize(512, 256, padding);
+		Random random(padding + 1);
+		std::vector<AtlasRect> rects;
+		for (uint32_t i = 0; i < 600; ++i) {
+			AtlasRect rect;
+			REQUIRE(packer.Insert(random.Range(1, 90), random.Range(1, 90), rect));
+			rects.push_back(rect);
+		}
+		CHECK(packer.GetPageCount() > 1);
+
+		bool inside = true;
+		bool overlap = false;
+		for (size_t i = 0; i < rects.size(); ++i) {
+			const AtlasRect& rect = rects[i];
+			inside = inside && rect.page < packer.GetPageCount() &&
+				rect.x >= padding && rect.y >= padding &&
+				rect.x + rect.width + padding <= packer.GetPageWidth() &&
+				rect.y + rect.height + padding <= packer.GetPageHeight();
+			for (size_t j = i + 1; j < rects.size(); ++j) {
+				overlap = overlap || Overlaps(rect, rects[j], padding);
+			}
+		}
+		CHECK(inside);
+		CHECK(!overlap);
+		CHECK(packer.GetOccupancy() > 0.5f && packer.GetOccupancy() <= 1.0f);
+	}
+}
+
+TEST_CASE(PackerRejectsOversizedRects) {
+	AtlasPacker packer;
+	packer.Initialize(64, 64, 2);
+	AtlasRect rect;
+	// 余白込みでページを超えるものは置けない
+	CHECK(!packer.Insert(61, 10, rect));
+	CHECK(!packer.Insert(10, 61, rect));
+	CHECK(packer.GetPageCount() == 0);
+	// ちょうど収まるものは置ける
+	CHECK(packer.Insert(60, 60, rect));
+	CHECK(rect.page == 0 && rect.x == 2 && rect.y == 2);
+	CHECK_NEAR(packer.GetOccupancy(), 1.0, 1.0e-6);
+	// 次は新しいページに入る
+	CHECK(packer.Insert(1, 1, rect));
+	CHECK(rect.page == 1);
+}
+
+TEST_CASE(AtlasCopiesImagesAndExtrudesPadding) {
+	const uint32_t kPageSize = 128;
+	const uint32_t kPadding = 3;
+	Random random(5);
+	std::vector<TextureImage> images;
+	for (uint32_t i = 0; i < 40; ++i) {
+		images.push_back(MakeImage(random.Range(1, 40), random.Range(1, 40), i));
+	}
+	std::vector<TextureImage> pages;
+	std::vector<AtlasRect> rects;
+	REQUIRE(TextureAtlas::Build(images, kPageSize, kPadding, pages, rects));
+	REQUIRE(rects.size() == images.size());
+	CHECK(pages.size() >= 2);
+
+	// 余白込みの範囲の各画素は、元画像の座標を端で止めた画素と同じ
+	bool matches = true;
+	for (size_t i = 0; i < images.size(); ++i) {
+		const TextureImage& image = images[i];
+		const AtlasRect& rect = rects[i];
+		REQUIRE(rect.width == image.width && rect.height == image.height);
+		const TextureImage& page = pages[rect.page];
+		const int32_t pad = static_cast<int32_t>(kPadding);
+		for (int32_t y = -pad; y < static_cast<int32_t>(image.height) + pad; ++y) {
+			for (int32_t x = -pad; x < static_cast<int32_t>(image.width) + pad; ++x) {
+				const int32_t sourceX = std::clamp(x, 0, static_cast<int32_t>(image.width) - 1);
+				const int32_t sourceY = std::clamp(y, 0, static_cast<int32_t>(image.height) - 1);
+				const uint8_t* expected = &image.pixels[(static_cast<size_t>(sourceY) * image.width + static_cast<size_t>(sourceX)) * 4];
+				const size_t pageX = static_cast<size_t>(static_cast<int32_t>(rect.x) + x);
+				const size_t pageY = static_cast<size_t>(static_cast<int32_t>(rect.y) + y);
+				matches = matches && SamePixel(&page.pixels[(pageY * kPageSize + pageX) * 4], expected);
+			}
+		}
+	}
+	CHECK(matches);
+
+	// UVは余白を含まない範囲
+	float uvMin[2];
+	float uvMax[2];
+	TextureAtlas::GetUvRect(rects[0], kPageSize, kPageSize, uvMin, uvMax);
+	CHECK_NEAR(uvMin[0], static_cast<double>(rects[0].x) / kPageSize, 1.0e-6);
+	CHECK_NEAR(uvMax[1], static_cast<double>(rects[0].y + rects[0].height) / kPageSize, 1.0e-6);
+}
+
+TEST_CASE(AtlasFailsWhenImageDoesNotFit) {
+	std::vector<TextureImage> images = { MakeImage(8, 8, 0), MakeImage(64, 8, 1) };
+	std::vector<TextureImage> pages;
+	std::vector<AtlasRect> rects;
+	CHECK(!TextureAtlas::Build(images, 64, 1, pages, rects));
+	CHECK(TextureAtlas::Build(images, 64, 0, pages, rects));
+	CHECK(pages.size() == 1);
+}
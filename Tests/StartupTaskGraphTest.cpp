@@ -0,0 +1,186 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "StartupTaskGraph.h"
+#include "TestFramework.h"
+
+namespace {
+
+void SleepMilliseconds(int milliseconds) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+// 実行された順番を記録する
+class ExecutionLog {
+public:
+	void Add(StartupTaskGraph::TaskId id) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		order_.push_back(id);
+	}
+
+	size_t IndexOf(StartupTaskGraph::TaskId id) const {
+		for (size_t i = 0; i < order_.size(); ++i) {
+			if (order_[i] == id) {
+				return i;
+			}
+		}
+		return order_.size();
+	}
+
+	size_t GetCount() const { return order_.size(); }
+
+private:
+	std::mutex mutex_;
+	std::vector<StartupTaskGraph::TaskId> order_;
+};
+
+} // namespace
+
+TEST_CASE(DependenciesFinishBeforeDependents) {
+	for (uint32_t workerCount : { 0u, 1u, 4u }) {
+		StartupTaskGraph graph;
+		// main.cppの起動処理と同じ形の依存関係
+		auto add = [&](const char* name, std::initializer_list<StartupTaskGraph::TaskId> dependencies) {
+			return graph.AddTask(name, [] { SleepMilliseconds(1); return true; }, dependencies);
+		};
+		StartupTaskGraph::TaskId window = add("Window", {});
+		StartupTaskGraph::TaskId factory = add("DXGIFactory", {});
+		StartupTaskGraph::TaskId adapter = add("Adapter", { factory });
+		StartupTaskGraph::TaskId device = add("Device", { adapter });
+		StartupTaskGraph::TaskId queue = add("CommandQueue", { device });
+		StartupTaskGraph::TaskId shader = add("ShaderWarmUp", {});
+		StartupTaskGraph::TaskId swapChain = add("SwapChain", { window, factory, queue });
+		add("Pipeline", { device, shader });
+		add("RTV", { swapChain, device });
+
+		REQUIRE(graph.Run(workerCount));
+		const std::vector<StartupTaskGraph::TimelineEntry>& timeline = graph.GetTimeline();
+		REQUIRE(timeline.size() == 9);
+		const std::vector<std::vector<StartupTaskGraph::TaskId>> dependencies = {
+			{}, {}, { factory }, { adapter }, { device }, {}, { window, factory, queue }, { device, shader }, { swapChain, device },
+		};
+		for (size_t i = 0; i < timeline.size(); ++i) {
+			CHECK(timeline[i].succeeded);
+			CHECK(!timeline[i].skipped);
+			CHECK(timeline[i].endMilliseconds >= timeline[i].startMilliseconds);
+			for (StartupTaskGraph::TaskId dependency : dependencies[i]) {
+				CHECK(timeline[i].startMilliseconds >= timeline[dependency].endMilliseconds);
+			}
+		}
+		CHECK(graph.GetCriticalPathMilliseconds() <= graph.GetSerialMilliseconds() + 1e-9);
+		CHECK(graph.GetTotalMilliseconds() >= graph.GetCriticalPathMilliseconds() * 0.5);
+	}
+}
+
+TEST_CASE(SerialRunKeepsInsertionOrder) {
+	StartupTaskGraph graph;
+	ExecutionLog log;
+	for (StartupTaskGraph::TaskId i = 0; i < 16; ++i) {
+		// 依存関係のないタスクでも追加順に実行する
+		graph.AddTask("Task", [&log, i] { log.Add(i); return true; });
+	}
+	REQUIRE(graph.Run(0));
+	REQUIRE(log.GetCount() == 16);
+	for (StartupTaskGraph::TaskId i = 0; i < 16; ++i) {
+		CHECK(log.IndexOf(i) == i);
+		CHECK(graph.GetTimeline()[i].threadIndex == 0);
+	}
+}
+
+TEST_CASE(IndependentTasksRunConcurrently) {
+	// 2つのタスクが互いの開始を待つ。並列に動かなければ時間切れで失敗する
+	StartupTaskGraph graph;
+	std::atomic<int> arrived = 0;
+	auto rendezvous = [&arrived] {
+		arrived.fetch_add(1);
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (arrived.load() < 2) {
+			if (std::chrono::steady_clock::now() > deadline) {
+				return false;
+			}
+			std::this_thread::yield();
+		}
+		return true;
+	};
+	graph.AddTask("A", rendezvous);
+	graph.AddTask("B", rendezvous);
+	CHECK(graph.Run(2));
+	const std::vector<StartupTaskGraph::TimelineEntry>& timeline = graph.GetTimeline();
+	REQUIRE(timeline.size() == 2);
+	CHECK(timeline[0].threadIndex != timeline[1].threadIndex);
+	CHECK(timeline[0].threadIndex >= 1 && timeline[1].threadIndex >= 1);
+}
+
+TEST_CASE(ParallelRunApproachesCriticalPath) {
+	// 重さの同じ独立したタスク4つは、4スレッドならほぼ1つ分の時間で終わる
+	StartupTaskGraph graph;
+	const int kTaskMilliseconds = 30;
+	for (int i = 0; i < 4; ++i) {
+		graph.AddTask("Sleep", [] { SleepMilliseconds(kTaskMilliseconds); return true; });
+	}
+	REQUIRE(graph.Run(4));
+	CHECK(graph.GetSerialMilliseconds() >= 4 * kTaskMilliseconds * 0.9);
+	CHECK(graph.GetCriticalPathMilliseconds() < graph.GetSerialMilliseconds() * 0.5);
+	CHECK(graph.GetTotalMilliseconds() < graph.GetSerialMilliseconds() * 0.75);
+}
+
+TEST_CASE(MainThreadTasksRunOnCaller) {
+	StartupTaskGraph graph;
+	const std::thread::id caller = std::this_thread::get_id();
+	std::thread::id windowThread;
+	std::thread::id swapChainThread;
+	StartupTaskGraph::TaskId device = graph.AddTask("Device", [] { SleepMilliseconds(2); return true; });
+	StartupTaskGraph::TaskId window = graph.AddTask("Window", [&] { windowThread = std::this_thread::get_id(); return true; }, {}, StartupTaskGraph::Affinity::MainThread);
+	// ワーカーで終わったタスクの後に続くメインスレッドのタスク
+	graph.AddTask("SwapChain", [&] { swapChainThread = std::this_thread::get_id(); return true; }, { device, window }, StartupTaskGraph::Affinity::MainThread);
+	REQUIRE(graph.Run(3));
+	CHECK(windowThread == caller);
+	CHECK(swapChainThread == caller);
+	CHECK(graph.GetTimeline()[1].threadIndex == 0);
+	CHECK(graph.GetTimeline()[2].threadIndex == 0);
+	CHECK(graph.GetTimeline()[0].threadIndex >= 1);
+}
+
+TEST_CASE(FailureSkipsDependents) {
+	for (uint32_t workerCount : { 0u, 2u }) {
+		StartupTaskGraph graph;
+		std::atomic<int> dependentRuns = 0;
+		std::atomic<bool> independentRan = false;
+		StartupTaskGraph::TaskId device = graph.AddTask("Device", [] { return false; });
+		StartupTaskGraph::TaskId queue = graph.AddTask("CommandQueue", [&] { ++dependentRuns; return true; }, { device });
+		graph.AddTask("SwapChain", [&] { ++dependentRuns; return true; }, { queue }, StartupTaskGraph::Affinity::MainThread);
+		graph.AddTask("Shader", [&] { independentRan = true; return true; });
+
+		CHECK(!graph.Run(workerCount));
+		CHECK(dependentRuns.load() == 0);
+		CHECK(independentRan.load());
+		const std::vector<StartupTaskGraph::TimelineEntry>& timeline = graph.GetTimeline();
+		REQUIRE(timeline.size() == 4);
+		CHECK(!timeline[0].succeeded && !timeline[0].skipped);
+		CHECK(timeline[1].skipped && !timeline[1].succeeded);
+		CHECK(timeline[2].skipped && !timeline[2].succeeded);
+		CHECK(timeline[3].succeeded);
+
+		const std::string text = graph.FormatTimeline();
+		CHECK(text.find("FAILED") != std::string::npos);
+		CHECK(text.find("skipped") != std::string::npos);
+		CHECK(text.find("critical path") != std::string::npos);
+	}
+}
+
+TEST_CASE(RunCanBeRepeated) {
+	// 計測のために同じグラフを何度実行しても結果が変わらない
+	StartupTaskGraph graph;
+	std::atomic<int> runCount = 0;
+	StartupTaskGraph::TaskId first = graph.AddTask("First", [&] { ++runCount; return true; });
+	graph.AddTask("Second", [&] { ++runCount; return true; }, { first });
+	for (int i = 0; i < 3; ++i) {
+		CHECK(graph.Run(2));
+		CHECK(graph.GetTimeline()[1].startMilliseconds >= graph.GetTimeline()[0].endMilliseconds);
+	}
+	CHECK(runCount.load() == 6);
+}
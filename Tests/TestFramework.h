@@ -0,0 +1,75 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/// <summary>
+/// ctestから実行する単体テストの登録と判定。TEST_CASEで定義した関数をTestMain.cppのmainが順に実行する
+/// </summary>
+class TestRegistry {
+public: // サブクラス
+	struct TestCase {
+		const char* name;
+		std::function<void()> body;
+	};
+
+public: // 静的メンバ関数
+	static std::vector<TestCase>& GetTestCases() {
+		static std::vector<TestCase> testCases;
+		return testCases;
+	}
+
+	/// <summary>
+	/// 失敗を記録する(実行中のテストは続ける)
+	/// </summary>
+	static void Fail(const char* file, int line, const char* expression) {
+		std::fprintf(stderr, "%s(%d): CHECK failed: %s\n", file, line, expression);
+		++GetFailureCount();
+	}
+
+	static int& GetFailureCount() {
+		static int failureCount = 0;
+		return failureCount;
+	}
+
+	/// <summary>
+	/// 静的初期化でテストを登録するためのもの
+	/// </summary>
+	struct Registrar {
+		Registrar(const char* name, std::function<void()> body) { GetTestCases().push_back({ name, std::move(body) }); }
+	};
+};
+
+#define TEST_CONCAT_INNER(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT_INNER(a, b)
+
+#define TEST_CASE(name) \
+	static void TEST_CONCAT(TestBody_, name)(); \
+	static TestRegistry::Registrar TEST_CONCAT(testRegistrar_, name)(#name, &TEST_CONCAT(TestBody_, name)); \
+	static void TEST_CONCAT(TestBody_, name)()
+
+#define CHECK(expression) \
+	do { \
+		if (!(expression)) { \
+			TestRegistry::Fail(__FILE__, __LINE__, #expression); \
+		} \
+	} while (false)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do { \
+		if (!(std::fabs(static_cast<double>(a) - static_cast<double>(b)) <= static_cast<double>(tolerance))) { \
+			std::fprintf(stderr, "%s(%d): CHECK_NEAR failed: %s = %g, %s = %g\n", __FILE__, __LINE__, #a, static_cast<double>(a), #b, static_cast<double>(b)); \
+			++TestRegistry::GetFailureCount(); \
+		} \
+	} while (false)
+
+// 以降のチェックが意味を持たないときに、そのテストを打ち切る
+#define REQUIRE(expression) \
+	do { \
+		if (!(expression)) { \
+			TestRegistry::Fail(__FILE__, __LINE__, #expression); \
+			return; \
+		} \
+	} while (false)
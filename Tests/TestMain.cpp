@@ -0,0 +1,21 @@
+#include <cstdio>
+#include <cstring>
+
+#include "TestFramework.h"
+
+// 引数を渡すと、名前がその文字列を含むテストだけを実行する
+int main(int argc, char** argv) {
+	const char* filter = argc > 1 ? argv[1] : nullptr;
+	int runCount = 0;
+	for (const TestRegistry::TestCase& testCase : TestRegistry::GetTestCases()) {
+		if (filter && std::strstr(testCase.name, filter) == nullptr) {
+			continue;
+		}
+		const int failuresBefore = TestRegistry::GetFailureCount();
+		testCase.body();
+		std::printf("%s %s\n", TestRegistry::GetFailureCount() == failuresBefore ? "[  OK  ]" : "[FAILED]", testCase.name);
+		++runCount;
+	}
+	std::printf("%d tests, %d failures\n", runCount, TestRegistry::GetFailureCount());
+	return TestRegistry::GetFailureCount() == 0 && runCount > 0 ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include <cmath>
+#include <cstring>
+
+#include "TestFramework.h"
+#include "TextureCooker.h"
+
+namespace {
+
+// 滑らかなグラデーションに円と細い線を重ねた画像(実際の色テクスチャに近い、ブロックごとに色の変化がある画像)
+TextureImage MakeTestImage(uint32_t width, uint32_t height) {
+	TextureImage image;
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(static_cast<size_t>(width) * height * 4);
+	for (uint32_t y = 0; y < height; ++y) {
+		for (uint32_t x = 0; x < width; ++x) {
+			const float u = static_cast<float>(x) / static_cast<float>(width);
+			const float v = static_cast<float>(y) / static_cast<float>(height);
+			const float dx = u - 0.5f, dy = v - 0.5f;
+			const bool inside = dx * dx + dy * dy < 0.09f;
+			uint8_t* pixel = &image.pixels[(static_cast<size_t>(y) * width + x) * 4];
+			pixel[0] = static_cast<uint8_t>(inside ? 230 : 255.0f * u);
+			pixel[1] = static_cast<uint8_t>(inside ? 60 : 255.0f * v);
+			pixel[2] = static_cast<uint8_t>(x % 16 == 0 ? 255 : 128.0f + 100.0f * std::sin(u * 6.0f));
+			pixel[3] = static_cast<uint8_t>(255.0f * (1.0f - v * 0.5f));
+		}
+	}
+	return image;
+}
+
+double EncodeDecodePSNR(const TextureImage& image, TextureFormat format, uint32_t channelMask) {
+	std::vector<uint8_t> encoded = TextureCooker::Encode(image, format);
+	TextureImage decoded;
+	if (!TextureCooker::Decode(encoded.data(), image.width, image.height, format, decoded)) {
+		return 0.0;
+	}
+	return TextureCooker::CalculatePSNR(image, decoded, channelMask);
+}
+
+} // namespace
+
+TEST_CASE(PSNRMeetsFormatQuality) {
+	const TextureImage image = MakeTestImage(256, 256);
+	// BC1は不透明の画像に使う(アルファが128未満の画素は透明になり色が0になる)
+	TextureImage opaque = image;
+	for (size_t i = 3; i < opaque.pixels.size(); i += 4) {
+		opaque.pixels[i] = 255;
+	}
+	// 形式ごとの下限(dB)。BC1/BC3はRGB、BC5はRG、BC7はRGBAで測る
+	CHECK(EncodeDecodePSNR(opaque, TextureFormat::BC1, 0x7) > 38.0);
+	CHECK(EncodeDecodePSNR(image, TextureFormat::BC3, 0x7) > 38.0);
+	CHECK(EncodeDecodePSNR(image, TextureFormat::BC3, 0x8) > 40.0);
+	CHECK(EncodeDecodePSNR(image, TextureFormat::BC5, 0x3) > 50.0);
+	CHECK(EncodeDecodePSNR(image, TextureFormat::BC7, 0xF) > 42.0);
+	CHECK(std::isinf(EncodeDecodePSNR(image, TextureFormat::RGBA8, 0xF)));
+}
+
+TEST_CASE(BC7IsBetterThanBC3) {
+	const TextureImage image = MakeTestImage(128, 128);
+	CHECK(EncodeDecodePSNR(image, TextureFormat::BC7, 0x7) > EncodeDecodePSNR(image, TextureFormat::BC3, 0x7));
+}
+
+TEST_CASE(EncodeIsIndependentOfThreadCount) {
+	const TextureImage image = MakeTestImage(200, 120);
+	for (TextureFormat format : { TextureFormat::BC1, TextureFormat::BC3, TextureFormat::BC5, TextureFormat::BC7 }) {
+		CHECK(TextureCooker::Encode(image, format, 1) == TextureCooker::Encode(image, format, 4));
+	}
+}
+
+TEST_CASE(MipChainReachesOnePixel) {
+	const TextureImage image = MakeTestImage(100, 60);
+	std::vector<TextureImage> mips = TextureCooker::GenerateMipChain(image, true);
+	REQUIRE(mips.size() == 7);
+	CHECK(mips[0].pixels == image.pixels);
+	CHECK(mips[1].width == 50 && mips[1].height == 30);
+	CHECK(mips[6].width == 1 && mips[6].height == 1);
+	for (const TextureImage& mip : mips) {
+		CHECK(mip.pixels.size() == static_cast<size_t>(mip.width) * mip.height * 4);
+	}
+}
+
+TEST_CASE(CookUsesCopyableFootprintLayout) {
+	const TextureImage image = MakeTestImage(100, 60);
+	for (TextureFormat format : { TextureFormat::RGBA8, TextureFormat::BC1, TextureFormat::BC7 }) {
+		TextureCooker::Desc desc;
+		desc.format = format;
+		std::vector<uint8_t> cooked = TextureCooker::Cook(image, desc);
+		CookedTexture texture;
+		REQUIRE(TextureCooker::LoadFromMemory(std::move(cooked), texture));
+		REQUIRE(texture.header.mipLevels == 7);
+
+		std::vector<TextureImage> mips = TextureCooker::GenerateMipChain(image, true);
+		for (uint32_t mip = 0; mip < texture.header.mipLevels; ++mip) {
+			const CookedTextureHeader::MipLevel& level = texture.header.mips[mip];
+			CHECK(level.offset % 512 == 0);
+			CHECK(level.rowPitch % 256 == 0);
+			CHECK(level.width == mips[mip].width && level.height == mips[mip].height);
+
+			// 行ピッチ付きで展開した結果が、詰めて圧縮したものを展開した結果と一致する
+			TextureImage fromCooked, fromEncoded;
+			std::vector<uint8_t> encoded = TextureCooker::Encode(mips[mip], format);
+			CHECK(TextureCooker::Decode(texture.GetMipData(mip), level.width, level.height, format, fromCooked, level.rowPitch));
+			CHECK(TextureCooker::Decode(encoded.data(), level.width, level.height, format, fromEncoded));
+			CHECK(fromCooked.pixels == fromEncoded.pixels);
+		}
+	}
+}
+
+TEST_CASE(LoadRejectsBrokenContainer) {
+	TextureCooker::Desc desc;
+	desc.format = TextureFormat::BC1;
+	const std::vector<uint8_t> cooked = TextureCooker::Cook(MakeTestImage(64, 64), desc);
+	CookedTexture texture;
+
+	std::vector<uint8_t> truncated(cooked.begin(), cooked.begin() + cooked.size() / 2);
+	CHECK(!TextureCooker::LoadFromMemory(std::move(truncated), texture));
+
+	std::vector<uint8_t> wrongMagic = cooked;
+	wrongMagic[0] ^= 0xFF;
+	CHECK(!TextureCooker::LoadFromMemory(std::move(wrongMagic), texture));
+
+	// 境界に揃っていないミップはコピーできないので受け付けない
+	std::vector<uint8_t> misaligned = cooked;
+	CookedTextureHeader header;
+	std::memcpy(&header, misaligned.data(), sizeof(header));
+	header.mips[1].offset += 16;
+	std::memcpy(misaligned.data(), &header, sizeof(header));
+	CHECK(!TextureCooker::LoadFromMemory(std::move(misaligned), texture));
+
+	std::vector<uint8_t> valid = cooked;
+	CHECK(TextureCooker::LoadFromMemory(std::move(valid), texture));
+}
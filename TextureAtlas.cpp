@@ -0,0 +1,171 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <numeric>
+
+/*///////////////////////
+	AtlasPacker
+*////////////////////////
+void AtlasPacker::Initialize(uint32_t pageWidth, uint32_t pageHeight, uint32_t padding) {
+	assert(pageWidth > 0 && pageHeight > 0);
+	pageWidth_ = pageWidth;
+	pageHeight_ = pageHeight;
+	padding_ = padding;
+	usedArea_ = 0;
+	skylines_.clear();
+}
+
+bool AtlasPacker::Insert(uint32_t width, uint32_t height, AtlasRect& outRect) {
+	// 余白は四辺に付ける(隣の画像の余白と接してもにじまない)
+	const uint32_t paddedWidth = width + padding_ * 2;
+	const uint32_t paddedHeight = height + padding_ * 2;
+	if (paddedWidth > pageWidth_ || paddedHeight > pageHeight_) {
+		return false;
+	}
+
+	// 先のページから順に探し、どこにも入らなければ新しいページを開く
+	size_t node = 0;
+	uint32_t y = 0;
+	uint32_t page = 0;
+	for (; page < skylines_.size(); ++page) {
+		if (FindPosition(skylines_[page], paddedWidth, paddedHeight, node, y)) {
+			break;
+		}
+	}
+	if (page == skylines_.size()) {
+		skylines_.push_back({ { 0, 0, pageWidth_ } });
+		node = 0;
+		y = 0;
+	}
+
+	std::vector<SkylineNode>& skyline = skylines_[page];
+	outRect = { page, skyline[node].x + padding_, y + padding_, width, height };
+	Place(skyline, node, y, paddedWidth, paddedHeight);
+	usedArea_ += static_cast<uint64_t>(paddedWidth) * paddedHeight;
+	return true;
+}
+
+float AtlasPacker::GetOccupancy() const {
+	if (skylines_.empty()) {
+		return 0.0f;
+	}
+	return static_cast<float>(static_cast<double>(usedArea_) / (static_cast<double>(pageWidth_) * pageHeight_ * static_cast<double>(skylines_.size())));
+}
+
+bool AtlasPacker::FindPosition(const std::vector<SkylineNode>& skyline, uint32_t width, uint32_t height, size_t& outNode, uint32_t& outY) const {
+	uint32_t bestTop = UINT32_MAX;
+	bool found = false;
+	for (size_t i = 0; i < skyline.size(); ++i) {
+		const uint32_t x = skyline[i].x;
+		if (x + width > pageWidth_) {
+			break;
+		}
+		// 幅がかかる区間のうち一番高いところに載る
+		uint32_t y = 0;
+		uint32_t remaining = width;
+		for (size_t j = i; remaining > 0; ++j) {
+			y = std::max(y, skyline[j].y);
+			remaining -= std::min(remaining, skyline[j].width);
+		}
+		if (y + height > pageHeight_) {
+			continue;
+		}
+		// 上端が一番低い位置、同じなら左を選ぶ
+		if (y + height < bestTop) {
+			bestTop = y + height;
+			outNode = i;
+			outY = y;
+			found = true;
+		}
+	}
+	return found;
+}
+
+void AtlasPacker::Place(std::vector<SkylineNode>& skyline, size_t node, uint32_t y, uint32_t width, uint32_t height) {
+	const uint32_t x = skyline[node].x;
+	skyline.insert(skyline.begin() + static_cast<std::ptrdiff_t>(node), { x, y + height, width });
+
+	// 新しい区間に隠れた部分を削る
+	const uint32_t right = x + width;
+	size_t i = node + 1;
+	while (i < skyline.size() && skyline[i].x < right) {
+		const uint32_t nodeRight = skyline[i].x + skyline[i].width;
+		if (nodeRight <= right) {
+			skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(i));
+		} else {
+			skyline[i].width = nodeRight - right;
+			skyline[i].x = right;
+			break;
+		}
+	}
+
+	// 同じ高さで隣り合う区間はまとめる
+	for (size_t j = 0; j + 1 < skyline.size();) {
+		if (skyline[j].y == skyline[j + 1].y) {
+			skyline[j].width += skyline[j + 1].width;
+			skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(j + 1));
+		} else {
+			++j;
+		}
+	}
+}
+
+/*///////////////////////
+	TextureAtlas
+*////////////////////////
+bool TextureAtlas::Build(const std::vector<TextureImage>& images, uint32_t pageSize, uint32_t padding,
+	std::vector<TextureImage>& outPages, std::vector<AtlasRect>& outRects) {
+	// 高い順に置くと輪郭がそろって隙間が減る
+	std::vector<uint32_t> order(images.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return images[a].height != images[b].height ? images[a].height > images[b].height : images[a].width > images[b].width;
+	});
+
+	AtlasPacker packer;
+	packer.Initialize(pageSize, pageSize, padding);
+	outRects.assign(images.size(), {});
+	for (uint32_t index : order) {
+		if (!packer.Insert(images[index].width, images[index].height, outRects[index])) {
+			return false;
+		}
+	}
+
+	outPages.assign(packer.GetPageCount(), {});
+	for (TextureImage& page : outPages) {
+		page.width = pageSize;
+		page.height = pageSize;
+		page.pixels.assign(static_cast<size_t>(pageSize) * pageSize * 4, 0);
+	}
+	for (size_t i = 0; i < images.size(); ++i) {
+		const TextureImage& image = images[i];
+		const AtlasRect& rect = outRects[i];
+		if (image.width == 0 || image.height == 0) {
+			continue;
+		}
+		TextureImage& page = outPages[rect.page];
+		// 余白込みの範囲を、元画像の座標を端で止めながら埋める
+		const int32_t pad = static_cast<int32_t>(padding);
+		for (int32_t y = -pad; y < static_cast<int32_t>(image.height) + pad; ++y) {
+			const uint32_t sourceY = static_cast<uint32_t>(std::clamp(y, 0, static_cast<int32_t>(image.height) - 1));
+			uint8_t* destinationRow = &page.pixels[(static_cast<size_t>(static_cast<int32_t>(rect.y) + y) * pageSize + rect.x) * 4];
+			const uint8_t* sourceRow = &image.pixels[static_cast<size_t>(sourceY) * image.width * 4];
+			std::memcpy(destinationRow, sourceRow, static_cast<size_t>(image.width) * 4);
+			for (int32_t x = 1; x <= pad; ++x) {
+				std::memcpy(destinationRow - static_cast<std::ptrdiff_t>(x) * 4, sourceRow, 4);
+				std::memcpy(destinationRow + (static_cast<size_t>(image.width) - 1 + static_cast<uint32_t>(x)) * 4, sourceRow + (static_cast<size_t>(image.width) - 1) * 4, 4);
+			}
+		}
+	}
+	return true;
+}
+
+void TextureAtlas::GetUvRect(const AtlasRect& rect, uint32_t pageWidth, uint32_t pageHeight, float outUvMin[2], float outUvMax[2]) {
+	outUvMin[0] = static_cast<float>(rect.x) / static_cast<float>(pageWidth);
+	outUvMin[1] = static_cast<float>(rect.y) / static_cast<float>(pageHeight);
+	outUvMax[0] = static_cast<float>(rect.x + rect.width) / static_cast<float>(pageWidth);
+	outUvMax[1] = static_cast<float>(rect.y + rect.height) / static_cast<float>(pageHeight);
+}
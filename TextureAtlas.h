@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "TextureCooker.h"
+
+/// <summary>
+/// アトラス上の画像の位置(ピクセル。余白は含まない)
+/// </summary>
+struct AtlasRect {
+	uint32_t page;
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+};
+
+/// <summary>
+/// 矩形をページに詰める(スカイライン法。各ページの上端の輪郭を持ち、一番低く置ける位置を選ぶ)
+/// </summary>
+class AtlasPacker {
+public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="pageWidth">ページの幅</param>
+	/// <param name="pageHeight">ページの高さ</param>
+	/// <param name="padding">画像の周囲に空ける余白(にじみ防止)</param>
+	void Initialize(uint32_t pageWidth, uint32_t pageHeight, uint32_t padding);
+
+	/// <summary>
+	/// 矩形を置く。既存のページに入らなければページを増やす
+	/// </summary>
+	/// <returns>置けたか(余白込みでページより大きいと置けない)</returns>
+	bool Insert(uint32_t width, uint32_t height, AtlasRect& outRect);
+
+	uint32_t GetPageCount() const { return static_cast<uint32_t>(skylines_.size()); }
+	uint32_t GetPageWidth() const { return pageWidth_; }
+	uint32_t GetPageHeight() const { return pageHeight_; }
+
+	/// <summary>
+	/// 全ページの面積に対する、置いた矩形(余白込み)の面積の割合
+	/// </summary>
+	float GetOccupancy() const;
+
+private: // サブクラス
+	// 輪郭の1区間。[x, x + width)の上端の高さがy
+	struct SkylineNode {
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+	};
+
+private: // メンバ関数
+	/// <summary>
+	/// ページ内で一番低く置ける位置を探す
+	/// </summary>
+	/// <returns>置ける位置があったか</returns>
+	bool FindPosition(const std::vector<SkylineNode>& skyline, uint32_t width, uint32_t height, size_t& outNode, uint32_t& outY) const;
+
+	/// <summary>
+	/// 置いた矩形で輪郭を更新する
+	/// </summary>
+	void Place(std::vector<SkylineNode>& skyline, size_t node, uint32_t y, uint32_t width, uint32_t height);
+
+private: // メンバ変数
+	std::vector<std::vector<SkylineNode>> skylines_; // ページごとの輪郭
+	uint32_t pageWidth_ = 0;
+	uint32_t pageHeight_ = 0;
+	uint32_t padding_ = 0;
+	uint64_t usedArea_ = 0;
+};
+
+/// <summary>
+/// 画像をアトラスのページにまとめる(ビルド時の処理)。出来たページはTextureCookerでそのままクックできる
+/// </summary>
+class TextureAtlas {
+public: // 静的メンバ関数
+	/// <summary>
+	/// 画像をページに詰めて書き込む。余白には画像の端のピクセルを延ばしてにじみを防ぐ
+	/// </summary>
+	/// <param name="images">元画像</param>
+	/// <param name="pageSize">ページの幅と高さ</param>
+	/// <param name="padding">余白</param>
+	/// <param name="outPages">出来たページ</param>
+	/// <param name="outRects">各画像の位置(imagesと同じ順)</param>
+	/// <returns>すべての画像を置けたか</returns>
+	static bool Build(const std::vector<TextureImage>& images, uint32_t pageSize, uint32_t padding,
+		std::vector<TextureImage>& outPages, std::vector<AtlasRect>& outRects);
+
+	/// <summary>
+	/// 位置をUVに変換する
+	/// </summary>
+	static void GetUvRect(const AtlasRect& rect, uint32_t pageWidth, uint32_t pageHeight, float outUvMin[2], float outUvMax[2]);
+};
@@ -0,0 +1,955 @@
+#include "TextureCooker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TEXTURE_COOKER_USE_SSE2
+#endif
+
+namespace {
+
+// DXGI_FORMATの値(d3d12.hに依存しないよう値を直接持つ)
+const uint32_t kDxgiFormatR8G8B8A8Unorm = 28;
+const uint32_t kDxgiFormatR8G8B8A8UnormSrgb = 29;
+const uint32_t kDxgiFormatBC1Unorm = 71;
+const uint32_t kDxgiFormatBC1UnormSrgb = 72;
+const uint32_t kDxgiFormatBC3Unorm = 77;
+const uint32_t kDxgiFormatBC3UnormSrgb = 78;
+const uint32_t kDxgiFormatBC5Unorm = 83;
+const uint32_t kDxgiFormatBC7Unorm = 98;
+const uint32_t kDxgiFormatBC7UnormSrgb = 99;
+
+// D3D12_TEXTURE_DATA_PITCH_ALIGNMENTとD3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+const uint32_t kRowPitchAlignment = 256;
+const uint32_t kPlacementAlignment = 512;
+
+// BC7の4bitインデックス用補間ウェイト
+const int kBC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+/*///////////////////////
+	色空間変換
+*////////////////////////
+float SrgbToLinear(float c) {
+	return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSrgb(float c) {
+	return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+uint8_t ToUnorm8(float value) {
+	return static_cast<uint8_t>(std::clamp(value * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+
+/*///////////////////////
+	ブロック入出力
+*////////////////////////
+
+// 4x4ブロックをRGBA8で取り出す。画像端はクランプする
+void FetchBlock(const TextureImage& image, uint32_t blockX, uint32_t blockY, uint8_t block[64]) {
+	for (uint32_t y = 0; y < 4; ++y) {
+		uint32_t sy = std::min(blockY * 4 + y, image.height - 1);
+		for (uint32_t x = 0; x < 4; ++x) {
+			uint32_t sx = std::min(blockX * 4 + x, image.width - 1);
+			std::memcpy(&block[(y * 4 + x) * 4], &image.pixels[(static_cast<size_t>(sy) * image.width + sx) * 4], 4);
+		}
+	}
+}
+
+void StoreBlock(TextureImage& image, uint32_t blockX, uint32_t blockY, const uint8_t block[64]) {
+	for (uint32_t y = 0; y < 4; ++y) {
+		uint32_t dy = blockY * 4 + y;
+		if (dy >= image.height) {
+			break;
+		}
+		for (uint32_t x = 0; x < 4; ++x) {
+			uint32_t dx = blockX * 4 + x;
+			if (dx >= image.width) {
+				break;
+			}
+			std::memcpy(&image.pixels[(static_cast<size_t>(dy) * image.width + dx) * 4], &block[(y * 4 + x) * 4], 4);
+		}
+	}
+}
+
+// 128bitブロックへのビット書き込み
+class BlockBitWriter {
+public:
+	explicit BlockBitWriter(uint8_t* out) : out_(out) { std::memset(out_, 0, 16); }
+
+	void Write(uint32_t value, uint32_t bitCount) {
+		for (uint32_t i = 0; i < bitCount; ++i, ++position_) {
+			if (value & (1u << i)) {
+				out_[position_ >> 3] |= static_cast<uint8_t>(1u << (position_ & 7));
+			}
+		}
+	}
+
+private:
+	uint8_t* out_;
+	uint32_t position_ = 0;
+};
+
+class BlockBitReader {
+public:
+	explicit BlockBitReader(const uint8_t* in) : in_(in) {}
+
+	uint32_t Read(uint32_t bitCount) {
+		uint32_t value = 0;
+		for (uint32_t i = 0; i < bitCount; ++i, ++position_) {
+			value |= static_cast<uint32_t>((in_[position_ >> 3] >> (position_ & 7)) & 1) << i;
+		}
+		return value;
+	}
+
+private:
+	const uint8_t* in_;
+	uint32_t position_ = 0;
+};
+
+/*///////////////////////
+	端点の推定
+*////////////////////////
+
+// 主成分軸に射影した最小・最大から端点を求める(channelCountは3か4)
+void ComputePrincipalEndpoints(const float pixels[16][4], uint32_t channelCount, float endpoint0[4], float endpoint1[4]) {
+	float mean[4] = {};
+	for (uint32_t i = 0; i < 16; ++i) {
+		for (uint32_t c = 0; c < channelCount; ++c) {
+			mean[c] += pixels[i][c] / 16.0f;
+		}
+	}
+
+	float covariance[4][4] = {};
+	for (uint32_t i = 0; i < 16; ++i) {
+		for (uint32_t a = 0; a < channelCount; ++a) {
+			for (uint32_t b = 0; b < channelCount; ++b) {
+				covariance[a][b] += (pixels[i][a] - mean[a]) * (pixels[i][b] - mean[b]);
+			}
+		}
+	}
+
+	// べき乗法で主成分を求める
+	float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; ++iteration) {
+		float next[4] = {};
+		for (uint32_t a = 0; a < channelCount; ++a) {
+			for (uint32_t b = 0; b < channelCount; ++b) {
+				next[a] += covariance[a][b] * axis[b];
+			}
+		}
+		float length = 0.0f;
+		for (uint32_t c = 0; c < channelCount; ++c) {
+			length = std::max(length, std::abs(next[c]));
+		}
+		if (length < 1e-6f) {
+			break;
+		}
+		for (uint32_t c = 0; c < channelCount; ++c) {
+			axis[c] = next[c] / length;
+		}
+	}
+
+	float axisLengthSq = 0.0f;
+	for (uint32_t c = 0; c < channelCount; ++c) {
+		axisLengthSq += axis[c] * axis[c];
+	}
+
+	float minProjection = 0.0f;
+	float maxProjection = 0.0f;
+	for (uint32_t i = 0; i < 16; ++i) {
+		float projection = 0.0f;
+		for (uint32_t c = 0; c < channelCount; ++c) {
+			projection += (pixels[i][c] - mean[c]) * axis[c];
+		}
+		projection /= axisLengthSq;
+		minProjection = std::min(minProjection, projection);
+		maxProjection = std::max(maxProjection, projection);
+	}
+
+	for (uint32_t c = 0; c < channelCount; ++c) {
+		endpoint0[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+		endpoint1[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+	}
+}
+
+// インデックスが決まった状態で端点を最小二乗法で解き直す。weightは端点1側の割合
+bool RefineEndpoints(const float pixels[16][4], const float weights[16], uint32_t channelCount, float endpoint0[4], float endpoint1[4]) {
+	float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+	float ax[4] = {}, bx[4] = {};
+	for (uint32_t i = 0; i < 16; ++i) {
+		float b = weights[i];
+		float a = 1.0f - b;
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+		for (uint32_t c = 0; c < channelCount; ++c) {
+			ax[c] += a * pixels[i][c];
+			bx[c] += b * pixels[i][c];
+		}
+	}
+	float determinant = aa * bb - ab * ab;
+	if (std::abs(determinant) < 1e-6f) {
+		return false;
+	}
+	for (uint32_t c = 0; c < channelCount; ++c) {
+		endpoint0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+		endpoint1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+	}
+	return true;
+}
+
+/*///////////////////////
+	パレット探索(SIMD)
+*////////////////////////
+
+// 各ピクセルに最も近いパレットエントリを選び、二乗誤差の合計を返す
+// palette[channel][entry]。paletteSizeは4の倍数
+uint32_t FindNearestIndices(const float pixels[16][4], const float palette[4][16], uint32_t paletteSize, uint32_t channelCount, uint8_t indices[16]) {
+	uint32_t totalError = 0;
+	for (uint32_t i = 0; i < 16; ++i) {
+		float bestError = std::numeric_limits<float>::max();
+		uint32_t bestIndex = 0;
+		for (uint32_t base = 0; base < paletteSize; base += 4) {
+			float errors[4];
+#ifdef TEXTURE_COOKER_USE_SSE2
+			__m128 error = _mm_setzero_ps();
+			for (uint32_t c = 0; c < channelCount; ++c) {
+				__m128 difference = _mm_sub_ps(_mm_loadu_ps(&palette[c][base]), _mm_set1_ps(pixels[i][c]));
+				error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+			}
+			_mm_storeu_ps(errors, error);
+#else
+			for (uint32_t j = 0; j < 4; ++j) {
+				errors[j] = 0.0f;
+				for (uint32_t c = 0; c < channelCount; ++c) {
+					float difference = palette[c][base + j] - pixels[i][c];
+					errors[j] += difference * difference;
+				}
+			}
+#endif
+			for (uint32_t j = 0; j < 4; ++j) {
+				if (errors[j] < bestError) {
+					bestError = errors[j];
+					bestIndex = base + j;
+				}
+			}
+		}
+		indices[i] = static_cast<uint8_t>(bestIndex);
+		totalError += static_cast<uint32_t>(bestError);
+	}
+	return totalError;
+}
+
+/*///////////////////////
+	BC1
+*////////////////////////
+uint16_t PackRgb565(const float color[4]) {
+	uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+	uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+	uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void UnpackRgb565(uint16_t packed, float color[4]) {
+	uint32_t r = (packed >> 11) & 31;
+	uint32_t g = (packed >> 5) & 63;
+	uint32_t b = packed & 31;
+	color[0] = static_cast<float>((r << 3) | (r >> 2));
+	color[1] = static_cast<float>((g << 2) | (g >> 4));
+	color[2] = static_cast<float>((b << 3) | (b >> 2));
+	color[3] = 255.0f;
+}
+
+// c0,c1から4色(もしくは3色+透明)のパレットを作る
+void BuildBC1Palette(uint16_t c0, uint16_t c1, bool fourColor, float palette[4][16]) {
+	float e0[4], e1[4];
+	UnpackRgb565(c0, e0);
+	UnpackRgb565(c1, e1);
+	for (uint32_t c = 0; c < 3; ++c) {
+		palette[c][0] = e0[c];
+		palette[c][1] = e1[c];
+		if (fourColor) {
+			palette[c][2] = std::floor((2.0f * e0[c] + e1[c]) / 3.0f);
+			palette[c][3] = std::floor((e0[c] + 2.0f * e1[c]) / 3.0f);
+		} else {
+			palette[c][2] = std::floor((e0[c] + e1[c]) / 2.0f);
+			palette[c][3] = 0.0f;
+		}
+	}
+	palette[3][0] = palette[3][1] = palette[3][2] = 255.0f;
+	palette[3][3] = fourColor ? 255.0f : 0.0f;
+}
+
+// 3色+透明モードの3番は選ばせない
+uint32_t FindNearestBC1Indices(const float pixels[16][4], const float palette[4][16], bool fourColor, const bool transparent[16], uint8_t indices[16]) {
+	if (fourColor) {
+		return FindNearestIndices(pixels, palette, 4, 3, indices);
+	}
+	float opaquePalette[4][16];
+	std::memcpy(opaquePalette, palette, sizeof(opaquePalette));
+	for (uint32_t c = 0; c < 3; ++c) {
+		opaquePalette[c][3] = std::numeric_limits<float>::max() / 8.0f;
+	}
+	uint32_t error = FindNearestIndices(pixels, opaquePalette, 4, 3, indices);
+	for (uint32_t i = 0; i < 16; ++i) {
+		if (transparent[i]) {
+			indices[i] = 3;
+		}
+	}
+	return error;
+}
+
+void EncodeBC1Block(const uint8_t block[64], uint8_t out[8], bool allowTransparent) {
+	float pixels[16][4];
+	bool transparent[16];
+	bool hasTransparent = false;
+	for (uint32_t i = 0; i < 16; ++i) {
+		for (uint32_t c = 0; c < 4; ++c) {
+			pixels[i][c] = block[i * 4 + c];
+		}
+		transparent[i] = allowTransparent && block[i * 4 + 3] < 128;
+		hasTransparent |= transparent[i];
+	}
+	const bool fourColor = !hasTransparent;
+
+	float endpoint0[4], endpoint1[4];
+	ComputePrincipalEndpoints(pixels, 3, endpoint0, endpoint1);
+
+	uint16_t bestC0 = 0, bestC1 = 0;
+	uint8_t bestIndices[16] = {};
+	uint32_t bestError = std::numeric_limits<uint32_t>::max();
+
+	// 主成分で求めた端点と、そのインデックスで解き直した端点の良い方を使う
+	for (int pass = 0; pass < 2; ++pass) {
+		uint16_t c0 = PackRgb565(endpoint0);
+		uint16_t c1 = PackRgb565(endpoint1);
+		// 4色モードはc0>c1、3色モードはc0<=c1
+		if ((fourColor && c0 < c1) || (!fourColor && c0 > c1)) {
+			std::swap(c0, c1);
+		}
+
+		float palette[4][16];
+		BuildBC1Palette(c0, c1, fourColor && c0 != c1, palette);
+		uint8_t indices[16];
+		uint32_t error = FindNearestBC1Indices(pixels, palette, fourColor && c0 != c1, transparent, indices);
+		if (error < bestError) {
+			bestError = error;
+			bestC0 = c0;
+			bestC1 = c1;
+			std::memcpy(bestIndices, indices, sizeof(indices));
+		}
+
+		if (pass == 0) {
+			float weights[16];
+			const float kFourColorWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+			const float kThreeColorWeights[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+			float opaquePixels[16][4];
+			uint32_t opaqueCount = 0;
+			for (uint32_t i = 0; i < 16; ++i) {
+				if (transparent[i]) {
+					continue;
+				}
+				std::memcpy(opaquePixels[opaqueCount], pixels[i], sizeof(pixels[i]));
+				weights[opaqueCount] = (fourColor && c0 != c1 ? kFourColorWeights : kThreeColorWeights)[indices[i]];
+				++opaqueCount;
+			}
+			// 透明ピクセル分は最後の不透明ピクセルで埋める(誤差に影響しない)
+			if (opaqueCount == 0) {
+				break;
+			}
+			for (uint32_t i = opaqueCount; i < 16; ++i) {
+				std::memcpy(opaquePixels[i], opaquePixels[opaqueCount - 1], sizeof(opaquePixels[i]));
+				weights[i] = weights[opaqueCount - 1];
+			}
+			// c0/c1の入れ替えがあった場合はウェイトの向きもそろえる
+			if (c0 != PackRgb565(endpoint0)) {
+				std::swap(endpoint0, endpoint1);
+			}
+			if (!RefineEndpoints(opaquePixels, weights, 3, endpoint0, endpoint1)) {
+				break;
+			}
+		}
+	}
+
+	uint32_t indexBits = 0;
+	for (uint32_t i = 0; i < 16; ++i) {
+		indexBits |= static_cast<uint32_t>(bestIndices[i]) << (i * 2);
+	}
+	std::memcpy(out, &bestC0, 2);
+	std::memcpy(out + 2, &bestC1, 2);
+	std::memcpy(out + 4, &indexBits, 4);
+}
+
+void DecodeBC1Block(const uint8_t in[8], uint8_t block[64], bool forceFourColor) {
+	uint16_t c0, c1;
+	uint32_t indexBits;
+	std::memcpy(&c0, in, 2);
+	std::memcpy(&c1, in + 2, 2);
+	std::memcpy(&indexBits, in + 4, 4);
+
+	float palette[4][16];
+	BuildBC1Palette(c0, c1, forceFourColor || c0 > c1, palette);
+	for (uint32_t i = 0; i < 16; ++i) {
+		uint32_t index = (indexBits >> (i * 2)) & 3;
+		for (uint32_t c = 0; c < 4; ++c) {
+			block[i * 4 + c] = static_cast<uint8_t>(palette[c][index]);
+		}
+	}
+}
+
+/*///////////////////////
+	BC4(BC3のアルファ、BC5の各チャンネル)
+*////////////////////////
+void BuildBC4Palette(uint8_t a0, uint8_t a1, uint8_t palette[8]) {
+	palette[0] = a0;
+	palette[1] = a1;
+	if (a0 > a1) {
+		for (uint32_t i = 1; i < 7; ++i) {
+			palette[i + 1] = static_cast<uint8_t>(((7 - i) * a0 + i * a1) / 7);
+		}
+	} else {
+		for (uint32_t i = 1; i < 5; ++i) {
+			palette[i + 1] = static_cast<uint8_t>(((5 - i) * a0 + i * a1) / 5);
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+void EncodeBC4Block(const uint8_t block[64], uint32_t channel, uint8_t out[8]) {
+	uint8_t minValue = 255, maxValue = 0;
+	for (uint32_t i = 0; i < 16; ++i) {
+		minValue = std::min(minValue, block[i * 4 + channel]);
+		maxValue = std::max(maxValue, block[i * 4 + channel]);
+	}
+
+	out[0] = maxValue;
+	out[1] = minValue;
+	uint8_t palette[8];
+	BuildBC4Palette(maxValue, minValue, palette);
+
+	uint64_t indexBits = 0;
+	for (uint32_t i = 0; i < 16; ++i) {
+		int value = block[i * 4 + channel];
+		uint32_t bestIndex = 0;
+		int bestError = 256;
+		for (uint32_t j = 0; j < 8; ++j) {
+			int error = std::abs(value - palette[j]);
+			if (error < bestError) {
+				bestError = error;
+				bestIndex = j;
+			}
+		}
+		indexBits |= static_cast<uint64_t>(bestIndex) << (i * 3);
+	}
+	for (uint32_t i = 0; i < 6; ++i) {
+		out[2 + i] = static_cast<uint8_t>(indexBits >> (i * 8));
+	}
+}
+
+void DecodeBC4Block(const uint8_t in[8], uint32_t channel, uint8_t block[64]) {
+	uint8_t palette[8];
+	BuildBC4Palette(in[0], in[1], palette);
+	uint64_t indexBits = 0;
+	for (uint32_t i = 0; i < 6; ++i) {
+		indexBits |= static_cast<uint64_t>(in[2 + i]) << (i * 8);
+	}
+	for (uint32_t i = 0; i < 16; ++i) {
+		block[i * 4 + channel] = palette[(indexBits >> (i * 3)) & 7];
+	}
+}
+
+/*///////////////////////
+	BC7(モード6: 1サブセット、RGBA 7bit+pビット、4bitインデックス)
+*////////////////////////
+
+// 端点をRGBA7bit+pビットに量子化する
+void QuantizeBC7Endpoint(const float endpoint[4], uint32_t quantized[4], uint32_t& pBit) {
+	uint32_t bestError = std::numeric_limits<uint32_t>::max();
+	for (uint32_t p = 0; p < 2; ++p) {
+		uint32_t candidate[4];
+		uint32_t error = 0;
+		for (uint32_t c = 0; c < 4; ++c) {
+			float value = (endpoint[c] - static_cast<float>(p)) / 2.0f;
+			candidate[c] = static_cast<uint32_t>(std::clamp(value + 0.5f, 0.0f, 127.0f));
+			int difference = static_cast<int>((candidate[c] << 1) | p) - static_cast<int>(endpoint[c] + 0.5f);
+			error += static_cast<uint32_t>(difference * difference);
+		}
+		if (error < bestError) {
+			bestError = error;
+			pBit = p;
+			std::memcpy(quantized, candidate, sizeof(candidate));
+		}
+	}
+}
+
+void BuildBC7Palette(const uint32_t q0[4], uint32_t p0, const uint32_t q1[4], uint32_t p1, float palette[4][16]) {
+	for (uint32_t c = 0; c < 4; ++c) {
+		int e0 = static_cast<int>((q0[c] << 1) | p0);
+		int e1 = static_cast<int>((q1[c] << 1) | p1);
+		for (uint32_t i = 0; i < 16; ++i) {
+			palette[c][i] = static_cast<float>(((64 - kBC7Weights4[i]) * e0 + kBC7Weights4[i] * e1 + 32) >> 6);
+		}
+	}
+}
+
+void EncodeBC7Block(const uint8_t block[64], uint8_t out[16]) {
+	float pixels[16][4];
+	for (uint32_t i = 0; i < 16; ++i) {
+		for (uint32_t c = 0; c < 4; ++c) {
+			pixels[i][c] = block[i * 4 + c];
+		}
+	}
+
+	float endpoint0[4], endpoint1[4];
+	ComputePrincipalEndpoints(pixels, 4, endpoint0, endpoint1);
+
+	uint32_t bestQ0[4] = {}, bestQ1[4] = {}, bestP0 = 0, bestP1 = 0;
+	uint8_t bestIndices[16] = {};
+	uint32_t bestError = std::numeric_limits<uint32_t>::max();
+
+	for (int pass = 0; pass < 2; ++pass) {
+		uint32_t q0[4], q1[4], p0 = 0, p1 = 0;
+		QuantizeBC7Endpoint(endpoint0, q0, p0);
+		QuantizeBC7Endpoint(endpoint1, q1, p1);
+
+		float palette[4][16];
+		BuildBC7Palette(q0, p0, q1, p1, palette);
+		uint8_t indices[16];
+		uint32_t error = FindNearestIndices(pixels, palette, 16, 4, indices);
+		if (error < bestError) {
+			bestError = error;
+			std::memcpy(bestQ0, q0, sizeof(q0));
+			std::memcpy(bestQ1, q1, sizeof(q1));
+			bestP0 = p0;
+			bestP1 = p1;
+			std::memcpy(bestIndices, indices, sizeof(indices));
+		}
+
+		if (pass == 0) {
+			float weights[16];
+			for (uint32_t i = 0; i < 16; ++i) {
+				weights[i] = static_cast<float>(kBC7Weights4[indices[i]]) / 64.0f;
+			}
+			if (!RefineEndpoints(pixels, weights, 4, endpoint0, endpoint1)) {
+				break;
+			}
+		}
+	}
+
+	// アンカー(先頭ピクセル)のインデックス最上位ビットは0でなければならない
+	if (bestIndices[0] & 8) {
+		std::swap(bestQ0, bestQ1);
+		std::swap(bestP0, bestP1);
+		for (uint32_t i = 0; i < 16; ++i) {
+			bestIndices[i] = static_cast<uint8_t>(15 - bestIndices[i]);
+		}
+	}
+
+	BlockBitWriter writer(out);
+	writer.Write(1u << 6, 7); // モード6
+	for (uint32_t c = 0; c < 4; ++c) {
+		writer.Write(bestQ0[c], 7);
+		writer.Write(bestQ1[c], 7);
+	}
+	writer.Write(bestP0, 1);
+	writer.Write(bestP1, 1);
+	writer.Write(bestIndices[0], 3);
+	for (uint32_t i = 1; i < 16; ++i) {
+		writer.Write(bestIndices[i], 4);
+	}
+}
+
+bool DecodeBC7Block(const uint8_t in[16], uint8_t block[64]) {
+	if ((in[0] & 0x7F) != 0x40) {
+		return false;
+	}
+	BlockBitReader reader(in);
+	reader.Read(7);
+	uint32_t q0[4], q1[4];
+	for (uint32_t c = 0; c < 4; ++c) {
+		q0[c] = reader.Read(7);
+		q1[c] = reader.Read(7);
+	}
+	uint32_t p0 = reader.Read(1);
+	uint32_t p1 = reader.Read(1);
+
+	float palette[4][16];
+	BuildBC7Palette(q0, p0, q1, p1, palette);
+	for (uint32_t i = 0; i < 16; ++i) {
+		uint32_t index = reader.Read(i == 0 ? 3 : 4);
+		for (uint32_t c = 0; c < 4; ++c) {
+			block[i * 4 + c] = static_cast<uint8_t>(palette[c][index]);
+		}
+	}
+	return true;
+}
+
+/*///////////////////////
+	並列実行
+*////////////////////////
+
+// ブロック行単位でワーカースレッドに分配する
+template <typename Function>
+void ParallelForRows(uint32_t rowCount, uint32_t threadCount, const Function& function) {
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threadCount = std::min(threadCount, rowCount);
+	if (threadCount <= 1) {
+		for (uint32_t row = 0; row < rowCount; ++row) {
+			function(row);
+		}
+		return;
+	}
+
+	std::atomic<uint32_t> nextRow = 0;
+	std::vector<std::thread> workers;
+	workers.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i) {
+		workers.emplace_back([&]() {
+			for (uint32_t row = nextRow++; row < rowCount; row = nextRow++) {
+				function(row);
+			}
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+uint32_t AlignUp(uint32_t value, uint32_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+std::vector<TextureImage> TextureCooker::GenerateMipChain(const TextureImage& source, bool srgb) {
+	assert(source.width > 0 && source.height > 0);
+	assert(source.pixels.size() == static_cast<size_t>(source.width) * source.height * 4);
+
+	std::vector<TextureImage> mips;
+	mips.push_back(source);
+
+	// 量子化誤差が積み重ならないよう、リニア空間の浮動小数点で縮小を繰り返す
+	float toLinear[256];
+	for (uint32_t i = 0; i < 256; ++i) {
+		toLinear[i] = srgb ? SrgbToLinear(static_cast<float>(i) / 255.0f) : static_cast<float>(i) / 255.0f;
+	}
+	uint32_t width = source.width;
+	uint32_t height = source.height;
+	std::vector<float> level(static_cast<size_t>(width) * height * 4);
+	for (size_t i = 0; i < level.size(); ++i) {
+		level[i] = (i % 4 == 3) ? static_cast<float>(source.pixels[i]) / 255.0f : toLinear[source.pixels[i]];
+	}
+
+	// [1,3,3,1]/8の分離フィルタ(双一次の2倍縮小)。端はクランプ
+	const float kTaps[4] = { 1.0f / 8.0f, 3.0f / 8.0f, 3.0f / 8.0f, 1.0f / 8.0f };
+	while (width > 1 || height > 1) {
+		uint32_t nextWidth = std::max(1u, width / 2);
+		uint32_t nextHeight = std::max(1u, height / 2);
+
+		// 横方向
+		std::vector<float> horizontal(static_cast<size_t>(nextWidth) * height * 4);
+		for (uint32_t y = 0; y < height; ++y) {
+			for (uint32_t x = 0; x < nextWidth; ++x) {
+				float sum[4] = {};
+				for (int t = 0; t < 4; ++t) {
+					int sx = width == 1 ? 0 : std::clamp(static_cast<int>(x * 2) + t - 1, 0, static_cast<int>(width) - 1);
+					const float* texel = &level[(static_cast<size_t>(y) * width + sx) * 4];
+					for (uint32_t c = 0; c < 4; ++c) {
+						sum[c] += texel[c] * kTaps[t];
+					}
+				}
+				std::memcpy(&horizontal[(static_cast<size_t>(y) * nextWidth + x) * 4], sum, sizeof(sum));
+			}
+		}
+
+		// 縦方向
+		std::vector<float> next(static_cast<size_t>(nextWidth) * nextHeight * 4);
+		for (uint32_t y = 0; y < nextHeight; ++y) {
+			for (uint32_t x = 0; x < nextWidth; ++x) {
+				float sum[4] = {};
+				for (int t = 0; t < 4; ++t) {
+					int sy = height == 1 ? 0 : std::clamp(static_cast<int>(y * 2) + t - 1, 0, static_cast<int>(height) - 1);
+					const float* texel = &horizontal[(static_cast<size_t>(sy) * nextWidth + x) * 4];
+					for (uint32_t c = 0; c < 4; ++c) {
+						sum[c] += texel[c] * kTaps[t];
+					}
+				}
+				std::memcpy(&next[(static_cast<size_t>(y) * nextWidth + x) * 4], sum, sizeof(sum));
+			}
+		}
+
+		TextureImage mip;
+		mip.width = nextWidth;
+		mip.height = nextHeight;
+		mip.pixels.resize(next.size());
+		for (size_t i = 0; i < next.size(); ++i) {
+			float value = next[i];
+			if (srgb && i % 4 != 3) {
+				value = LinearToSrgb(value);
+			}
+			mip.pixels[i] = ToUnorm8(value);
+		}
+		mips.push_back(std::move(mip));
+
+		level = std::move(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+	return mips;
+}
+
+std::vector<uint8_t> TextureCooker::Encode(const TextureImage& image, TextureFormat format, uint32_t threadCount) {
+	assert(image.pixels.size() == static_cast<size_t>(image.width) * image.height * 4);
+	if (format == TextureFormat::RGBA8) {
+		return image.pixels;
+	}
+
+	const uint32_t blocksWide = (image.width + 3) / 4;
+	const uint32_t blocksHigh = (image.height + 3) / 4;
+	const uint32_t blockSize = GetBlockSize(format);
+	std::vector<uint8_t> output(static_cast<size_t>(blocksWide) * blocksHigh * blockSize);
+
+	ParallelForRows(blocksHigh, threadCount, [&](uint32_t blockY) {
+		uint8_t block[64];
+		for (uint32_t blockX = 0; blockX < blocksWide; ++blockX) {
+			FetchBlock(image, blockX, blockY, block);
+			uint8_t* out = &output[(static_cast<size_t>(blockY) * blocksWide + blockX) * blockSize];
+			switch (format) {
+			case TextureFormat::BC1:
+				EncodeBC1Block(block, out, true);
+				break;
+			case TextureFormat::BC3:
+				EncodeBC4Block(block, 3, out);
+				EncodeBC1Block(block, out + 8, false);
+				break;
+			case TextureFormat::BC5:
+				EncodeBC4Block(block, 0, out);
+				EncodeBC4Block(block, 1, out + 8);
+				break;
+			case TextureFormat::BC7:
+				EncodeBC7Block(block, out);
+				break;
+			default:
+				break;
+			}
+		}
+	});
+	return output;
+}
+
+bool TextureCooker::Decode(const uint8_t* data, uint32_t width, uint32_t height, TextureFormat format, TextureImage& output, uint32_t rowPitch) {
+	output.width = width;
+	output.height = height;
+	output.pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+	if (format == TextureFormat::RGBA8) {
+		const size_t tightPitch = static_cast<size_t>(width) * 4;
+		const size_t sourcePitch = rowPitch != 0 ? rowPitch : tightPitch;
+		for (uint32_t y = 0; y < height; ++y) {
+			std::memcpy(&output.pixels[y * tightPitch], data + y * sourcePitch, tightPitch);
+		}
+		return true;
+	}
+
+	const uint32_t blocksWide = (width + 3) / 4;
+	const uint32_t blocksHigh = (height + 3) / 4;
+	const uint32_t blockSize = GetBlockSize(format);
+	const size_t sourcePitch = rowPitch != 0 ? rowPitch : static_cast<size_t>(blocksWide) * blockSize;
+	for (uint32_t blockY = 0; blockY < blocksHigh; ++blockY) {
+		for (uint32_t blockX = 0; blockX < blocksWide; ++blockX) {
+			const uint8_t* in = &data[blockY * sourcePitch + static_cast<size_t>(blockX) * blockSize];
+			uint8_t block[64];
+			switch (format) {
+			case TextureFormat::BC1:
+				DecodeBC1Block(in, block, false);
+				break;
+			case TextureFormat::BC3:
+				DecodeBC1Block(in + 8, block, true);
+				DecodeBC4Block(in, 3, block);
+				break;
+			case TextureFormat::BC5:
+				for (uint32_t i = 0; i < 16; ++i) {
+					block[i * 4 + 2] = 0;
+					block[i * 4 + 3] = 255;
+				}
+				DecodeBC4Block(in, 0, block);
+				DecodeBC4Block(in + 8, 1, block);
+				break;
+			case TextureFormat::BC7:
+				if (!DecodeBC7Block(in, block)) {
+					return false;
+				}
+				break;
+			default:
+				return false;
+			}
+			StoreBlock(output, blockX, blockY, block);
+		}
+	}
+	return true;
+}
+
+double TextureCooker::CalculatePSNR(const TextureImage& reference, const TextureImage& test, uint32_t channelMask) {
+	assert(reference.width == test.width && reference.height == test.height);
+	double squaredError = 0.0;
+	size_t sampleCount = 0;
+	for (size_t i = 0; i < reference.pixels.size(); ++i) {
+		if (!(channelMask & (1u << (i % 4)))) {
+			continue;
+		}
+		double difference = static_cast<double>(reference.pixels[i]) - static_cast<double>(test.pixels[i]);
+		squaredError += difference * difference;
+		++sampleCount;
+	}
+	if (sampleCount == 0 || squaredError == 0.0) {
+		return std::numeric_limits<double>::infinity();
+	}
+	double meanSquaredError = squaredError / static_cast<double>(sampleCount);
+	return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+std::vector<uint8_t> TextureCooker::Cook(const TextureImage& source, const Desc& desc) {
+	std::vector<TextureImage> mips;
+	if (desc.generateMips) {
+		mips = GenerateMipChain(source, desc.srgb);
+	} else {
+		mips.push_back(source);
+	}
+	if (mips.size() > CookedTextureHeader::kMaxMipLevels) {
+		mips.resize(CookedTextureHeader::kMaxMipLevels);
+	}
+
+	CookedTextureHeader header{};
+	header.magic = CookedTextureHeader::kMagic;
+	header.version = CookedTextureHeader::kVersion;
+	header.dxgiFormat = GetDxgiFormat(desc.format, desc.srgb);
+	header.width = source.width;
+	header.height = source.height;
+	header.mipLevels = static_cast<uint32_t>(mips.size());
+
+	// D3D12のコピー用フットプリントと同じ並び(行ピッチ256バイト、ミップの先頭512バイト)で書き出す。
+	// ファイル全体をアップロードバッファの512バイト境界に置けば、各ミップはoffsetとrowPitchをそのままフットプリントにしてコピーできる
+	std::vector<uint8_t> output(AlignUp(sizeof(CookedTextureHeader), kPlacementAlignment));
+	for (uint32_t mip = 0; mip < header.mipLevels; ++mip) {
+		std::vector<uint8_t> encoded = Encode(mips[mip], desc.format, desc.threadCount);
+
+		CookedTextureHeader::MipLevel& level = header.mips[mip];
+		level.width = mips[mip].width;
+		level.height = mips[mip].height;
+		uint32_t tightPitch;
+		if (desc.format == TextureFormat::RGBA8) {
+			tightPitch = level.width * 4;
+			level.rowCount = level.height;
+		} else {
+			tightPitch = ((level.width + 3) / 4) * GetBlockSize(desc.format);
+			level.rowCount = (level.height + 3) / 4;
+		}
+		level.rowPitch = AlignUp(tightPitch, kRowPitchAlignment);
+		level.offset = output.size();
+		level.size = level.rowPitch * level.rowCount;
+
+		output.resize(AlignUp(static_cast<uint32_t>(output.size() + level.size), kPlacementAlignment));
+		for (uint32_t row = 0; row < level.rowCount; ++row) {
+			std::memcpy(&output[level.offset + static_cast<size_t>(row) * level.rowPitch], &encoded[static_cast<size_t>(row) * tightPitch], tightPitch);
+		}
+	}
+	std::memcpy(output.data(), &header, sizeof(header));
+	return output;
+}
+
+bool TextureCooker::SaveToFile(const std::string& filePath, const std::vector<uint8_t>& cooked) {
+	std::ofstream file(filePath, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(cooked.data()), static_cast<std::streamsize>(cooked.size()));
+	return static_cast<bool>(file);
+}
+
+bool TextureCooker::LoadFromFile(const std::string& filePath, CookedTexture& texture) {
+	std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+	if (!file) {
+		return false;
+	}
+	std::streamsize size = file.tellg();
+	if (size <= 0) {
+		return false;
+	}
+	file.seekg(0, std::ios::beg);
+
+	// ファイル全体を1回で読み込み、以降は変換なしで参照する
+	std::vector<uint8_t> data(static_cast<size_t>(size));
+	if (!file.read(reinterpret_cast<char*>(data.data()), size)) {
+		return false;
+	}
+	return LoadFromMemory(std::move(data), texture);
+}
+
+bool TextureCooker::LoadFromMemory(std::vector<uint8_t>&& data, CookedTexture& texture) {
+	if (data.size() < sizeof(CookedTextureHeader)) {
+		return false;
+	}
+	CookedTextureHeader header;
+	std::memcpy(&header, data.data(), sizeof(header));
+	if (header.magic != CookedTextureHeader::kMagic || header.version != CookedTextureHeader::kVersion) {
+		return false;
+	}
+	if (header.mipLevels == 0 || header.mipLevels > CookedTextureHeader::kMaxMipLevels) {
+		return false;
+	}
+	for (uint32_t mip = 0; mip < header.mipLevels; ++mip) {
+		const CookedTextureHeader::MipLevel& level = header.mips[mip];
+		if (level.offset > data.size() || level.size > data.size() - level.offset) {
+			return false;
+		}
+		if (static_cast<uint64_t>(level.rowPitch) * level.rowCount != level.size) {
+			return false;
+		}
+		if (level.offset % kPlacementAlignment != 0 || level.rowPitch % kRowPitchAlignment != 0) {
+			return false;
+		}
+	}
+	texture.header = header;
+	texture.data = std::move(data);
+	return true;
+}
+
+uint32_t TextureCooker::GetDxgiFormat(TextureFormat format, bool srgb) {
+	switch (format) {
+	case TextureFormat::BC1:
+		return srgb ? kDxgiFormatBC1UnormSrgb : kDxgiFormatBC1Unorm;
+	case TextureFormat::BC3:
+		return srgb ? kDxgiFormatBC3UnormSrgb : kDxgiFormatBC3Unorm;
+	case TextureFormat::BC5:
+		// 法線などのデータ用なのでsRGB版は存在しない
+		return kDxgiFormatBC5Unorm;
+	case TextureFormat::BC7:
+		return srgb ? kDxgiFormatBC7UnormSrgb : kDxgiFormatBC7Unorm;
+	default:
+		return srgb ? kDxgiFormatR8G8B8A8UnormSrgb : kDxgiFormatR8G8B8A8Unorm;
+	}
+}
+
+uint32_t TextureCooker::GetBlockSize(TextureFormat format) {
+	switch (format) {
+	case TextureFormat::BC1:
+		return 8;
+	case TextureFormat::BC3:
+	case TextureFormat::BC5:
+	case TextureFormat::BC7:
+		return 16;
+	default:
+		return 4;
+	}
+}
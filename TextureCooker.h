@@ -0,0 +1,138 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// クック後のテクスチャ形式
+/// </summary>
+enum class TextureFormat : uint32_t {
+	RGBA8, // 無圧縮(スワップチェーンと同じ形式)
+	BC1,   // RGB 4bpp(1bitアルファ)
+	BC3,   // RGBA 8bpp
+	BC5,   // RG 8bpp(法線マップ用)
+	BC7,   // RGBA 8bpp 高品質
+};
+
+/// <summary>
+/// RGBA8のCPU側イメージ
+/// </summary>
+struct TextureImage {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<uint8_t> pixels; // width * height * 4
+};
+
+/// <summary>
+/// クック済みテクスチャファイルのヘッダ
+/// </summary>
+struct CookedTextureHeader {
+	static const uint32_t kMagic = 0x58455443; // 'CTEX'
+	static const uint32_t kVersion = 2;
+	static const uint32_t kMaxMipLevels = 16;
+
+	struct MipLevel {
+		uint64_t offset;   // ファイル先頭からのオフセット(512バイト境界)
+		uint32_t size;     // バイト数(rowPitch * rowCount)
+		uint32_t rowPitch; // 1行(BCはブロック1行)あたりのバイト数(256バイト境界。行末は0で埋める)
+		uint32_t rowCount; // 行数(BCはブロック行数)
+		uint32_t width;
+		uint32_t height;
+		uint32_t reserved;
+	};
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t dxgiFormat; // DXGI_FORMATの値をそのまま持つ
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+	uint32_t flags;
+	uint32_t reserved;
+	MipLevel mips[kMaxMipLevels];
+};
+
+/// <summary>
+/// ロード済みのクック済みテクスチャ。dataはファイル全体で、各ミップはヘッダのoffsetで参照する
+/// </summary>
+struct CookedTexture {
+	CookedTextureHeader header{};
+	std::vector<uint8_t> data;
+
+	const uint8_t* GetMipData(uint32_t mipLevel) const { return data.data() + header.mips[mipLevel].offset; }
+};
+
+/// <summary>
+/// テクスチャのミップ生成とBC圧縮を行うアセットクック処理
+/// </summary>
+class TextureCooker {
+public: // サブクラス
+	struct Desc {
+		TextureFormat format = TextureFormat::BC7;
+		bool srgb = true;           // sRGBとして扱う(ミップ生成はリニア空間で行う)
+		bool generateMips = true;
+		uint32_t threadCount = 0;   // 0ならハードウェアスレッド数
+	};
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// ミップチェーンの生成。[0]は元画像のコピー
+	/// </summary>
+	/// <param name="source">元画像</param>
+	/// <param name="srgb">sRGB画像ならリニア空間でフィルタする</param>
+	/// <returns>1x1までのミップチェーン</returns>
+	static std::vector<TextureImage> GenerateMipChain(const TextureImage& source, bool srgb);
+
+	/// <summary>
+	/// 1枚の画像をブロック圧縮する
+	/// </summary>
+	/// <param name="image">圧縮する画像</param>
+	/// <param name="format">出力形式</param>
+	/// <param name="threadCount">使用スレッド数(0なら自動)</param>
+	/// <returns>ブロック行順に並んだ圧縮データ</returns>
+	static std::vector<uint8_t> Encode(const TextureImage& image, TextureFormat format, uint32_t threadCount = 0);
+
+	/// <summary>
+	/// 圧縮データをRGBA8に展開する(品質検証用。BC7はエンコーダが出力するモード6のみ対応)
+	/// </summary>
+	/// <param name="rowPitch">1行(BCはブロック1行)あたりのバイト数。0なら詰めて並んでいるとみなす</param>
+	/// <returns>展開に成功したか</returns>
+	static bool Decode(const uint8_t* data, uint32_t width, uint32_t height, TextureFormat format, TextureImage& output, uint32_t rowPitch = 0);
+
+	/// <summary>
+	/// 2つの画像のPSNR(dB)を計算する
+	/// </summary>
+	/// <param name="channelMask">比較するチャンネル(bit0=R, bit1=G, bit2=B, bit3=A)</param>
+	static double CalculatePSNR(const TextureImage& reference, const TextureImage& test, uint32_t channelMask = 0xF);
+
+	/// <summary>
+	/// ミップ生成から圧縮までを行い、GPUにそのまま転送できるコンテナを作る。
+	/// 各ミップはD3D12のコピー用フットプリントに合わせ、行ピッチを256バイト、先頭を512バイト境界に揃えて並べる
+	/// </summary>
+	static std::vector<uint8_t> Cook(const TextureImage& source, const Desc& desc);
+
+	/// <summary>
+	/// クック済みテクスチャをファイルに書き出す
+	/// </summary>
+	static bool SaveToFile(const std::string& filePath, const std::vector<uint8_t>& cooked);
+
+	/// <summary>
+	/// クック済みテクスチャを1回の読み込みでロードする
+	/// </summary>
+	static bool LoadFromFile(const std::string& filePath, CookedTexture& texture);
+
+	/// <summary>
+	/// メモリ上のコンテナを検証して取り込む
+	/// </summary>
+	static bool LoadFromMemory(std::vector<uint8_t>&& data, CookedTexture& texture);
+
+	/// <summary>
+	/// 形式に対応するDXGI_FORMATの値
+	/// </summary>
+	static uint32_t GetDxgiFormat(TextureFormat format, bool srgb);
+
+	/// <summary>
+	/// 4x4ブロック1つあたりのバイト数(RGBA8は1ピクセルあたり)
+	/// </summary>
+	static uint32_t GetBlockSize(TextureFormat format);
+};
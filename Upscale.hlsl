@@ -0,0 +1,29 @@
+// 内部解像度のシーンをバックバッファへ拡大する
+
+cbuffer UpscaleConstants : register(b0) {
+	float2 uvScale; // 描画した範囲のUV
+	float2 uvMax;   // 範囲外をサンプルしないためのクランプ値
+	uint sceneIndex; // バインドレスヒープ上のシーンのSRV
+};
+
+// バインドレスヒープ全体
+Texture2D<float4> gTextures[] : register(t0, space1);
+SamplerState gSampler : register(s0);
+
+struct VertexShaderOutput {
+	float4 position : SV_POSITION;
+	float2 texcoord : TEXCOORD0;
+};
+
+// 頂点IDから画面全体を覆う三角形を作る
+VertexShaderOutput VSMain(uint vertexId : SV_VertexID) {
+	VertexShaderOutput output;
+	float2 uv = float2((vertexId << 1) & 2, vertexId & 2);
+	output.position = float4(uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+	output.texcoord = uv * uvScale;
+	return output;
+}
+
+float4 PSMain(VertexShaderOutput input) : SV_TARGET {
+	return gTextures[sceneIndex].Sample(gSampler, min(input.texcoord, uvMax));
+}
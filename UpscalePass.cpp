@@ -0,0 +1,261 @@
+#include "UpscalePass.h"
+
+#include "ShaderCompiler.h"
+
+#include <Windows.h>
+#include <cassert>
+
+namespace {
+
+// シーンはsRGBで書き込み、拡大時にリニアで読み出す
+const DXGI_FORMAT kSceneFormat = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+
+} // namespace
+
+void UpscalePass::Initialize(ID3D12Device* device, BindlessHeap* bindlessHeap, uint32_t outputWidth, uint32_t outputHeight) {
+	bindlessHeap_ = bindlessHeap;
+
+	// RTVはこのパス専用のヒープに置き、SRVはバインドレスヒープに作る
+	D3D12_DESCRIPTOR_HEAP_DESC rtvDescriptorHeapDesc{};
+	rtvDescriptorHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+	rtvDescriptorHeapDesc.NumDescriptors = 1;
+	HRESULT hr = device->CreateDescriptorHeap(&rtvDescriptorHeapDesc, IID_PPV_ARGS(&rtvDescriptorHeap_));
+	assert(SUCCEEDED(hr));
+
+	CreatePipeline(device);
+	CreateRenderTarget(device, outputWidth, outputHeight);
+}
+
+void UpscalePass::Resize(ID3D12Device* device, uint32_t outputWidth, uint32_t outputHeight) {
+	if (outputWidth == targetWidth_ && outputHeight == targetHeight_) {
+		return;
+	}
+	bindlessHeap_->Free(sceneSrv_);
+	renderTarget_->Release();
+	renderTarget_ = nullptr;
+	CreateRenderTarget(device, outputWidth, outputHeight);
+}
+
+void UpscalePass::Finalize() {
+	if (renderTarget_) {
+		bindlessHeap_->Free(sceneSrv_);
+		sceneSrv_ = {};
+		renderTarget_->Release();
+		renderTarget_ = nullptr;
+	}
+	if (rtvDescriptorHeap_) {
+		rtvDescriptorHeap_->Release();
+		rtvDescriptorHeap_ = nullptr;
+	}
+	if (pipelineState_) {
+		pipelineState_->Release();
+		pipelineState_ = nullptr;
+	}
+	if (rootSignature_) {
+		rootSignature_->Release();
+		rootSignature_ = nullptr;
+	}
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE UpscalePass::BeginScene(ID3D12GraphicsCommandList* commandList, uint32_t renderWidth, uint32_t renderHeight) {
+	renderWidth_ = renderWidth < targetWidth_ ? renderWidth : targetWidth_;
+	renderHeight_ = renderHeight < targetHeight_ ? renderHeight : targetHeight_;
+
+	// 読み出し用の状態から描画先の状態へ
+	D3D12_RESOURCE_BARRIER barrier{};
+	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+	barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+	barrier.Transition.pResource = renderTarget_;
+	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
+	commandList->ResourceBarrier(1, &barrier);
+
+	D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = rtvDescriptorHeap_->GetCPUDescriptorHandleForHeapStart();
+	commandList->OMSetRenderTargets(1, &rtvHandle, false, nullptr);
+
+	// 今フレームの描画サイズだけを使う
+	D3D12_VIEWPORT viewport{};
+	viewport.Width = static_cast<float>(renderWidth_);
+	viewport.Height = static_cast<float>(renderHeight_);
+	viewport.MaxDepth = 1.0f;
+	commandList->RSSetViewports(1, &viewport);
+
+	D3D12_RECT scissorRect{};
+	scissorRect.right = static_cast<LONG>(renderWidth_);
+	scissorRect.bottom = static_cast<LONG>(renderHeight_);
+	commandList->RSSetScissorRects(1, &scissorRect);
+
+	return rtvHandle;
+}
+
+void UpscalePass::Execute(ID3D12GraphicsCommandList* commandList, D3D12_CPU_DESCRIPTOR_HANDLE outputRtv, uint32_t outputWidth, uint32_t outputHeight) {
+	D3D12_RESOURCE_BARRIER barrier{};
+	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+	barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+	barrier.Transition.pResource = renderTarget_;
+	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
+	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+	commandList->ResourceBarrier(1, &barrier);
+
+	commandList->OMSetRenderTargets(1, &outputRtv, false, nullptr);
+
+	D3D12_VIEWPORT viewport{};
+	viewport.Width = static_cast<float>(outputWidth);
+	viewport.Height = static_cast<float>(outputHeight);
+	viewport.MaxDepth = 1.0f;
+	commandList->RSSetViewports(1, &viewport);
+
+	D3D12_RECT scissorRect{};
+	scissorRect.right = static_cast<LONG>(outputWidth);
+	scissorRect.bottom = static_cast<LONG>(outputHeight);
+	commandList->RSSetScissorRects(1, &scissorRect);
+
+	// 描画した範囲のUVと、範囲外を拾わないためのクランプ値
+	Constants constants{};
+	constants.uvScale[0] = static_cast<float>(renderWidth_) / static_cast<float>(targetWidth_);
+	constants.uvScale[1] = static_cast<float>(renderHeight_) / static_cast<float>(targetHeight_);
+	constants.uvMax[0] = (static_cast<float>(renderWidth_) - 0.5f) / static_cast<float>(targetWidth_);
+	constants.uvMax[1] = (static_cast<float>(renderHeight_) - 0.5f) / static_cast<float>(targetHeight_);
+	constants.sceneIndex = sceneSrv_.GetIndex();
+
+	// テーブルはバインドレスヒープ全体を指すので、テクスチャの指定はインデックスだけで済む
+	bindlessHeap_->Bind(commandList);
+	commandList->SetGraphicsRootSignature(rootSignature_);
+	commandList->SetPipelineState(pipelineState_);
+	commandList->SetGraphicsRoot32BitConstants(0, sizeof(Constants) / sizeof(uint32_t), &constants, 0);
+	commandList->SetGraphicsRootDescriptorTable(1, bindlessHeap_->GetTableStart());
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	// 頂点バッファを使わず、頂点IDから画面全体を覆う三角形を作る
+	commandList->DrawInstanced(3, 1, 0, 0);
+}
+
+void UpscalePass::CreatePipeline(ID3D12Device* device) {
+	// ルートパラメータ: [0]定数(b0) [1]バインドレスヒープ全体のSRV(t0, space1)
+	D3D12_DESCRIPTOR_RANGE descriptorRange = BindlessHeap::MakeDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1);
+
+	D3D12_ROOT_PARAMETER rootParameters[2]{};
+	rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	rootParameters[0].Constants.ShaderRegister = 0;
+	rootParameters[0].Constants.Num32BitValues = sizeof(Constants) / sizeof(uint32_t);
+	rootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	rootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+	rootParameters[1].DescriptorTable.NumDescriptorRanges = 1;
+	rootParameters[1].DescriptorTable.pDescriptorRanges = &descriptorRange;
+
+	// 拡大はバイリニアで行う
+	D3D12_STATIC_SAMPLER_DESC staticSampler{};
+	staticSampler.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+	staticSampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+	staticSampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+	staticSampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+	staticSampler.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+	staticSampler.MaxLOD = D3D12_FLOAT32_MAX;
+	staticSampler.ShaderRegister = 0;
+	staticSampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc{};
+	rootSignatureDesc.NumParameters = _countof(rootParameters);
+	rootSignatureDesc.pParameters = rootParameters;
+	rootSignatureDesc.NumStaticSamplers = 1;
+	rootSignatureDesc.pStaticSamplers = &staticSampler;
+
+	ID3DBlob* signatureBlob = nullptr;
+	ID3DBlob* errorBlob = nullptr;
+	HRESULT hr = D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signatureBlob, &errorBlob);
+	if (FAILED(hr)) {
+		OutputDebugStringA(static_cast<const char*>(errorBlob->GetBufferPointer()));
+		assert(false);
+	}
+	hr = device->CreateRootSignature(0, signatureBlob->GetBufferPointer(), signatureBlob->GetBufferSize(), IID_PPV_ARGS(&rootSignature_));
+	assert(SUCCEEDED(hr));
+	signatureBlob->Release();
+
+	pipelineState_ = CreatePipelineState(device);
+	assert(pipelineState_ != nullptr);
+}
+
+ID3D12PipelineState* UpscalePass::CreatePipelineState(ID3D12Device* device) const {
+	// 大きさを決めないテクスチャ配列を使うのでシェーダーモデル5.1
+	ID3DBlob* vertexShaderBlob = TryCompileShader(L"Upscale.hlsl", "VSMain", "vs_5_1");
+	ID3DBlob* pixelShaderBlob = TryCompileShader(L"Upscale.hlsl", "PSMain", "ps_5_1");
+	if (vertexShaderBlob == nullptr || pixelShaderBlob == nullptr) {
+		if (vertexShaderBlob) {
+			vertexShaderBlob->Release();
+		}
+		if (pixelShaderBlob) {
+			pixelShaderBlob->Release();
+		}
+		return nullptr;
+	}
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineStateDesc{};
+	pipelineStateDesc.pRootSignature = rootSignature_;
+	pipelineStateDesc.VS = { vertexShaderBlob->GetBufferPointer(), vertexShaderBlob->GetBufferSize() };
+	pipelineStateDesc.PS = { pixelShaderBlob->GetBufferPointer(), pixelShaderBlob->GetBufferSize() };
+	pipelineStateDesc.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+	pipelineStateDesc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+	pipelineStateDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	pipelineStateDesc.RasterizerState.DepthClipEnable = TRUE;
+	pipelineStateDesc.SampleMask = D3D12_DEFAULT_SAMPLE_MASK;
+	pipelineStateDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	pipelineStateDesc.NumRenderTargets = 1;
+	// バックバッファのRTVと同じ形式
+	pipelineStateDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	pipelineStateDesc.SampleDesc.Count = 1;
+	ID3D12PipelineState* pipelineState = nullptr;
+	HRESULT hr = device->CreateGraphicsPipelineState(&pipelineStateDesc, IID_PPV_ARGS(&pipelineState));
+
+	vertexShaderBlob->Release();
+	pixelShaderBlob->Release();
+	return SUCCEEDED(hr) ? pipelineState : nullptr;
+}
+
+ID3D12PipelineState* UpscalePass::SwapPipelineState(ID3D12PipelineState* pipelineState) {
+	ID3D12PipelineState* oldPipelineState = pipelineState_;
+	pipelineState_ = pipelineState;
+	return oldPipelineState;
+}
+
+void UpscalePass::CreateRenderTarget(ID3D12Device* device, uint32_t width, uint32_t height) {
+	targetWidth_ = width;
+	targetHeight_ = height;
+
+	D3D12_HEAP_PROPERTIES heapProperties{};
+	heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+
+	D3D12_RESOURCE_DESC resourceDesc{};
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	resourceDesc.Width = width;
+	resourceDesc.Height = height;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.MipLevels = 1;
+	resourceDesc.Format = kSceneFormat;
+	resourceDesc.SampleDesc.Count = 1;
+	resourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+	D3D12_CLEAR_VALUE clearValue{};
+	clearValue.Format = kSceneFormat;
+	clearValue.Color[0] = 0.1f;
+	clearValue.Color[1] = 0.25f;
+	clearValue.Color[2] = 0.5f;
+	clearValue.Color[3] = 1.0f;
+
+	HRESULT hr = device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, &clearValue, IID_PPV_ARGS(&renderTarget_));
+	assert(SUCCEEDED(hr));
+
+	D3D12_RENDER_TARGET_VIEW_DESC rtvDesc{};
+	rtvDesc.Format = kSceneFormat;
+	rtvDesc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2D;
+	device->CreateRenderTargetView(renderTarget_, &rtvDesc, rtvDescriptorHeap_->GetCPUDescriptorHandleForHeapStart());
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+	srvDesc.Format = kSceneFormat;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Texture2D.MipLevels = 1;
+	sceneSrv_ = bindlessHeap_->CreateShaderResourceView(renderTarget_, &srvDesc);
+}
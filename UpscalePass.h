@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+
+#include <d3d12.h>
+
+#include "BindlessHeap.h"
+
+/// <summary>
+/// 内部解像度のシーン用レンダーターゲットと、それをバックバッファへ拡大するパス
+/// </summary>
+class UpscalePass {
+public: // メンバ関数
+	/// <summary>
+	/// 初期化。レンダーターゲットは出力サイズ(最大倍率)で確保し、描画時は左上の一部だけを使う
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	/// <param name="bindlessHeap">シーンのSRVを置くヒープ</param>
+	/// <param name="outputWidth">出力の幅</param>
+	/// <param name="outputHeight">出力の高さ</param>
+	void Initialize(ID3D12Device* device, BindlessHeap* bindlessHeap, uint32_t outputWidth, uint32_t outputHeight);
+
+	/// <summary>
+	/// 出力サイズの変更に合わせてレンダーターゲットを作り直す(GPUが使っていないときに呼ぶ)
+	/// </summary>
+	void Resize(ID3D12Device* device, uint32_t outputWidth, uint32_t outputHeight);
+
+	/// <summary>
+	/// 解放
+	/// </summary>
+	void Finalize();
+
+	/// <summary>
+	/// シーン描画の開始。内部レンダーターゲットを描画先に設定する
+	/// </summary>
+	/// <param name="commandList">コマンドリスト</param>
+	/// <param name="renderWidth">今フレームの描画幅</param>
+	/// <param name="renderHeight">今フレームの描画高さ</param>
+	/// <returns>シーン用RTV</returns>
+	D3D12_CPU_DESCRIPTOR_HANDLE BeginScene(ID3D12GraphicsCommandList* commandList, uint32_t renderWidth, uint32_t renderHeight);
+
+	/// <summary>
+	/// 描画した範囲を出力先に拡大する
+	/// </summary>
+	/// <param name="commandList">コマンドリスト</param>
+	/// <param name="outputRtv">出力先(バックバッファ)のRTV</param>
+	/// <param name="outputWidth">出力の幅</param>
+	/// <param name="outputHeight">出力の高さ</param>
+	void Execute(ID3D12GraphicsCommandList* commandList, D3D12_CPU_DESCRIPTOR_HANDLE outputRtv, uint32_t outputWidth, uint32_t outputHeight);
+
+	/// <summary>
+	/// Upscale.hlslからパイプラインを作る。失敗したらnullptr(別スレッドから呼べる)
+	/// </summary>
+	ID3D12PipelineState* CreatePipelineState(ID3D12Device* device) const;
+
+	/// <summary>
+	/// パイプラインを差し替える
+	/// </summary>
+	/// <returns>古いパイプライン(GPUが使い終えてから呼び出し側で解放する)</returns>
+	ID3D12PipelineState* SwapPipelineState(ID3D12PipelineState* pipelineState);
+
+private: // サブクラス
+	// ルート定数(Upscale.hlslのUpscaleConstantsと同じ並び)
+	struct Constants {
+		float uvScale[2];
+		float uvMax[2];
+		uint32_t sceneIndex;
+	};
+
+private: // メンバ関数
+	/// <summary>
+	/// ルートシグネチャとパイプラインの生成
+	/// </summary>
+	void CreatePipeline(ID3D12Device* device);
+
+	/// <summary>
+	/// レンダーターゲットとビューの生成
+	/// </summary>
+	void CreateRenderTarget(ID3D12Device* device, uint32_t width, uint32_t height);
+
+private: // メンバ変数
+	ID3D12RootSignature* rootSignature_ = nullptr;
+	ID3D12PipelineState* pipelineState_ = nullptr;
+	ID3D12DescriptorHeap* rtvDescriptorHeap_ = nullptr;
+	BindlessHeap* bindlessHeap_ = nullptr;
+	ID3D12Resource* renderTarget_ = nullptr;
+	BindlessHandle sceneSrv_;
+
+	uint32_t targetWidth_ = 0;
+	uint32_t targetHeight_ = 0;
+	uint32_t renderWidth_ = 0;
+	uint32_t renderHeight_ = 0;
+};
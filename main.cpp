@@ -1,9 +1,31 @@
 #include <Windows.h>
 #include "System.h"
+#include "GraphicsRecovery.h"
+#include "DynamicResolution.h"
+#include "GpuTimer.h"
+#include "UpscalePass.h"
+#include "BindlessHeap.h"
+#include "MemoryArena.h"
+#include "ShaderCompiler.h"
+#include "StartupTaskGraph.h"
+#include "InputQueue.h"
+#include "InputThread.h"
+#include "GpuParticles.h"
+#include "SpriteRenderer.h"
+#include "ClusteredLightingBuffers.h"
+#include "TextureAtlas.h"
+#include "HotReload.h"
+#include <algorithm>
 #include <cstdint>
 #include <string>
 #include <format>
+#include <iterator>
+#include <memory_resource>
+#include <string_view>
 #include <cassert>
+#include <cmath>
+#include <cstring>
+#include <thread>
 
 #include <d3d12.h>
 #include <dxgi1_6.h>
@@ -56,6 +78,270 @@ std::string ConvertString(const std::wstring& str) {
 	return result;
 }
 
+// 変換先をメモリリソース上に作る版(フレーム中はフレームアロケータを渡してヒープを使わない)
+std::pmr::wstring ConvertString(std::string_view str, std::pmr::memory_resource* resource) {
+	std::pmr::wstring result(resource);
+	if (str.empty()) {
+		return result;
+	}
+
+	auto sizeNeeded = MultiByteToWideChar(CP_UTF8, 0, str.data(), static_cast<int>(str.size()), NULL, 0);
+	if (sizeNeeded == 0) {
+		return result;
+	}
+	result.resize(sizeNeeded);
+	MultiByteToWideChar(CP_UTF8, 0, str.data(), static_cast<int>(str.size()), result.data(), sizeNeeded);
+	return result;
+}
+
+/*///////////////////////
+	フレーム中のログ
+	(文字列の組み立てと変換をフレームアロケータ上で行う)
+*////////////////////////
+template <typename... Args>
+void LogFrame(FrameAllocator& frameAllocator, std::format_string<Args...> format, Args&&... args) {
+	std::pmr::string message(frameAllocator.GetResource());
+	std::format_to(std::back_inserter(message), format, std::forward<Args>(args)...);
+	OutputDebugStringW(ConvertString(message, frameAllocator.GetResource()).c_str());
+}
+
+template <typename T>
+void SafeRelease(T*& object) {
+	if (object) {
+		object->Release();
+		object = nullptr;
+	}
+}
+
+/*///////////////////////
+	ビュープロジェクション行列
+	(回転なしで+zを向くカメラ。行ベクトル×行列の規約)
+*////////////////////////
+void MakeViewProjection(const float eye[3], float fovY, float aspectRatio, float nearZ, float farZ, float outMatrix[4][4]) {
+	const float yScale = 1.0f / std::tan(fovY * 0.5f);
+	const float xScale = yScale / aspectRatio;
+	const float zScale = farZ / (farZ - nearZ);
+	// 平行移動と透視投影を掛けたもの
+	const float matrix[4][4] = {
+		{ xScale, 0.0f, 0.0f, 0.0f },
+		{ 0.0f, yScale, 0.0f, 0.0f },
+		{ 0.0f, 0.0f, zScale, 1.0f },
+		{ -eye[0] * xScale, -eye[1] * yScale, -eye[2] * zScale - nearZ * zScale, -eye[2] },
+	};
+	std::memcpy(outMatrix, matrix, sizeof(matrix));
+}
+
+/*///////////////////////
+	スプライト用の画像
+	(大きさと色の違う円と輪をアトラスへ詰める素材として作る)
+*////////////////////////
+std::vector<TextureImage> MakeSpriteImages(uint32_t count) {
+	std::vector<TextureImage> images(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		TextureImage& image = images[i];
+		image.width = 16 + (i * 37) % 113;
+		image.height = 16 + (i * 59) % 97;
+		image.pixels.resize(static_cast<size_t>(image.width) * image.height * 4);
+		const bool ring = (i % 3) == 0;
+		const uint8_t red = static_cast<uint8_t>(128 + (i * 53) % 128);
+		const uint8_t green = static_cast<uint8_t>(128 + (i * 97) % 128);
+		const uint8_t blue = static_cast<uint8_t>(128 + (i * 29) % 128);
+		for (uint32_t y = 0; y < image.height; ++y) {
+			for (uint32_t x = 0; x < image.width; ++x) {
+				// 中心からの距離を縦横それぞれの半径で割って楕円にする
+				const float u = (static_cast<float>(x) + 0.5f) / static_cast<float>(image.width) * 2.0f - 1.0f;
+				const float v = (static_cast<float>(y) + 0.5f) / static_cast<float>(image.height) * 2.0f - 1.0f;
+				const float distance = std::sqrt(u * u + v * v);
+				const bool inside = ring ? (distance < 1.0f && distance > 0.6f) : distance < 1.0f;
+				uint8_t* pixel = &image.pixels[(static_cast<size_t>(y) * image.width + x) * 4];
+				pixel[0] = red;
+				pixel[1] = green;
+				pixel[2] = blue;
+				pixel[3] = inside ? 255 : 0;
+			}
+		}
+	}
+	return images;
+}
+
+/*///////////////////////
+	パイプラインの読み直し
+	(シェーダーのキャッシュを捨てて作り直し、差し替えた古いパイプラインはGPUが使い終えてから解放する)
+*////////////////////////
+template <typename Pass>
+HotReload::RebuildFunction MakePipelineReload(Pass& pass, ID3D12Device*& device, const wchar_t* shaderFile) {
+	return [&pass, &device, shaderFile]() -> HotReload::SwapFunction {
+		InvalidateShader(shaderFile);
+		ID3D12PipelineState* pipelineState = pass.CreatePipelineState(device);
+		if (pipelineState == nullptr) {
+			// コンパイルエラーなら今のパイプラインを使い続ける
+			return nullptr;
+		}
+		return [&pass, pipelineState](bool apply) -> HotReload::ReleaseFunction {
+			if (!apply) {
+				pipelineState->Release();
+				return nullptr;
+			}
+			ID3D12PipelineState* oldPipelineState = pass.SwapPipelineState(pipelineState);
+			return [oldPipelineState]() { oldPipelineState->Release(); };
+		};
+	};
+}
+
+DeviceResult ToDeviceResult(HRESULT hr) {
+	if (SUCCEEDED(hr)) {
+		return DeviceResult::Ok;
+	}
+	if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET || hr == DXGI_ERROR_DEVICE_HUNG) {
+		return DeviceResult::DeviceLost;
+	}
+	return DeviceResult::Failed;
+}
+
+/*///////////////////////
+	D3D12のデバイス依存オブジェクト
+	(リサイズ・デバイスロスト時に作成時の設定から作り直す)
+*////////////////////////
+class D3D12RecoverableDevice : public RecoverableDevice {
+public:
+	// WinMainで作ったオブジェクトと作成時の設定への参照
+	struct Objects {
+		HWND hwnd;
+		IDXGIFactory7*& dxgiFactory;
+		IDXGIAdapter4*& useAdapter;
+		ID3D12Device*& device;
+		ID3D12CommandQueue*& commandQueue;
+		ID3D12CommandAllocator*& commandAllocator;
+		ID3D12GraphicsCommandList*& commandList;
+		IDXGISwapChain4*& swapChain;
+		ID3D12DescriptorHeap*& rtvDescriptorHeap;
+		ID3D12Resource* (&swapChainResources)[2];
+		D3D12_CPU_DESCRIPTOR_HANDLE(&rtvHandles)[2];
+		ID3D12Fence*& fence;
+		uint64_t& fenceValue;
+		HANDLE fenceEvent;
+		D3D_FEATURE_LEVEL featureLevel;
+		const D3D12_COMMAND_QUEUE_DESC& commandQueueDesc;
+		DXGI_SWAP_CHAIN_DESC1& swapChainDesc;
+		const D3D12_DESCRIPTOR_HEAP_DESC& rtvDescriptorHeapDesc;
+		const D3D12_RENDER_TARGET_VIEW_DESC& rtvDesc;
+	};
+
+	explicit D3D12RecoverableDevice(const Objects& objects) : o_(objects) {}
+
+	DeviceResult WaitForInFlightFrames() override {
+		// 削除されたデバイスのFenceはUINT64_MAXを返すので待ち続けることはない
+		if (o_.fence->GetCompletedValue() < o_.fenceValue) {
+			o_.fence->SetEventOnCompletion(o_.fenceValue, o_.fenceEvent);
+			WaitForSingleObject(o_.fenceEvent, INFINITE);
+		}
+		return ToDeviceResult(o_.device->GetDeviceRemovedReason());
+	}
+
+	void ReleaseBackBuffers() override {
+		SafeRelease(o_.swapChainResources[0]);
+		SafeRelease(o_.swapChainResources[1]);
+	}
+
+	DeviceResult ResizeBuffers(uint32_t width, uint32_t height) override {
+		HRESULT hr = o_.swapChain->ResizeBuffers(o_.swapChainDesc.BufferCount, width, height,
+			o_.swapChainDesc.Format, o_.swapChainDesc.Flags);
+		if (SUCCEEDED(hr)) {
+			o_.swapChainDesc.Width = width;
+			o_.swapChainDesc.Height = height;
+		}
+		return ToDeviceResult(hr);
+	}
+
+	DeviceResult CreateRenderTargetViews() override {
+		for (UINT i = 0; i < 2; ++i) {
+			HRESULT hr = o_.swapChain->GetBuffer(i, IID_PPV_ARGS(&o_.swapChainResources[i]));
+			if (FAILED(hr)) {
+				return ToDeviceResult(hr);
+			}
+		}
+		// ヒープはそのまま使い、同じハンドルの位置にRTVを書き直す
+		o_.rtvHandles[0] = o_.rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+		o_.rtvHandles[1].ptr = o_.rtvHandles[0].ptr + o_.device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+		o_.device->CreateRenderTargetView(o_.swapChainResources[0], &o_.rtvDesc, o_.rtvHandles[0]);
+		o_.device->CreateRenderTargetView(o_.swapChainResources[1], &o_.rtvDesc, o_.rtvHandles[1]);
+		return DeviceResult::Ok;
+	}
+
+	void ReleaseDeviceObjects() override {
+		SafeRelease(o_.fence);
+		SafeRelease(o_.rtvDescriptorHeap);
+		ReleaseBackBuffers();
+		SafeRelease(o_.swapChain);
+		SafeRelease(o_.commandList);
+		SafeRelease(o_.commandAllocator);
+		SafeRelease(o_.commandQueue);
+		SafeRelease(o_.device);
+		SafeRelease(o_.useAdapter);
+	}
+
+	DeviceResult CreateDeviceObjects(uint32_t width, uint32_t height) override {
+		// アダプタ構成が変わっていればファクトリーから作り直す
+		if (!o_.dxgiFactory->IsCurrent()) {
+			SafeRelease(o_.dxgiFactory);
+			if (FAILED(CreateDXGIFactory(IID_PPV_ARGS(&o_.dxgiFactory)))) {
+				return DeviceResult::Failed;
+			}
+		}
+
+		for (UINT i = 0; o_.dxgiFactory->EnumAdapterByGpuPreference(i, DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE,
+			IID_PPV_ARGS(&o_.useAdapter)) != DXGI_ERROR_NOT_FOUND; ++i) {
+			DXGI_ADAPTER_DESC3 adapterDesc{};
+			if (SUCCEEDED(o_.useAdapter->GetDesc3(&adapterDesc)) && !(adapterDesc.Flags & DXGI_ADAPTER_FLAG3_SOFTWARE)) {
+				break;
+			}
+			SafeRelease(o_.useAdapter);
+		}
+		if (o_.useAdapter == nullptr) {
+			return DeviceResult::DeviceLost;
+		}
+
+		HRESULT hr = D3D12CreateDevice(o_.useAdapter, o_.featureLevel, IID_PPV_ARGS(&o_.device));
+		if (SUCCEEDED(hr)) {
+			hr = o_.device->CreateCommandQueue(&o_.commandQueueDesc, IID_PPV_ARGS(&o_.commandQueue));
+		}
+		if (SUCCEEDED(hr)) {
+			hr = o_.device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&o_.commandAllocator));
+		}
+		if (SUCCEEDED(hr)) {
+			hr = o_.device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, o_.commandAllocator, nullptr,
+				IID_PPV_ARGS(&o_.commandList));
+		}
+		if (SUCCEEDED(hr)) {
+			o_.swapChainDesc.Width = width;
+			o_.swapChainDesc.Height = height;
+			hr = o_.dxgiFactory->CreateSwapChainForHwnd(o_.commandQueue, o_.hwnd, &o_.swapChainDesc,
+				nullptr, nullptr, reinterpret_cast<IDXGISwapChain1**>(&o_.swapChain));
+		}
+		if (SUCCEEDED(hr)) {
+			hr = o_.device->CreateDescriptorHeap(&o_.rtvDescriptorHeapDesc, IID_PPV_ARGS(&o_.rtvDescriptorHeap));
+		}
+		if (FAILED(hr)) {
+			return ToDeviceResult(hr);
+		}
+
+		DeviceResult result = CreateRenderTargetViews();
+		if (result != DeviceResult::Ok) {
+			return result;
+		}
+
+		o_.fenceValue = 0;
+		hr = o_.device->CreateFence(o_.fenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&o_.fence));
+		return ToDeviceResult(hr);
+	}
+
+private:
+	Objects o_;
+};
+
+// リサイズ・デバイスロストの状態管理
+GraphicsRecovery graphicsRecovery;
+
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
 
 	// メッセージに応じてゲーム固有の処理
@@ -65,6 +351,15 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
 		// OSに対してアプリの終了を伝える
 		PostQuitMessage(0);
 		return 0;
+		// ウインドウのサイズが変わった
+	case WM_SIZE:
+		// ここでは要求を積むだけで、実際の作り直しはフレームの境目で行う
+		if (wparam == SIZE_MINIMIZED) {
+			graphicsRecovery.RequestResize(0, 0);
+		} else {
+			graphicsRecovery.RequestResize(LOWORD(lparam), HIWORD(lparam));
+		}
+		return 0;
 	}
 	// 標準のメッセージ処理を行う
 	return DefWindowProc(hwnd, msg, wparam, lparam);
@@ -73,81 +368,98 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
 // Windowsアプリでのエントリーポイント(main関数)
 int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 
-	WNDCLASS wc{};
-	// ウインドウプロシージャ
-	wc.lpfnWndProc = WindowProc;
-	// ウインドウクラス名
-	wc.lpszClassName = L"CG2WindowClass";
-	// インスタンスハンドル
-	wc.hInstance = GetModuleHandle(nullptr);
-	//カーソル
-	wc.hCursor = LoadCursor(nullptr, IDC_ARROW);
-
-	// ウインドウクラスを登録する
-	RegisterClass(&wc);
-
 	// クライアント領域のサイズ
 	static const int32_t kWindowWidth = 1280;
 	static const int32_t kWindowHeight = 720;
 
-	// ウインドウサイズを表す構造体にクライアント領域を入れる
-	RECT wrc = { 0,0,kWindowWidth,kWindowHeight };
-
-	// クライアント領域を元に実際のサイズにwrcを変更してもらう
-	AdjustWindowRect(&wrc, WS_OVERLAPPEDWINDOW, false);
-
-	// ウインドの生成
-	HWND hwnd = CreateWindow(
-		wc.lpszClassName,
-		L"CG2",
-		WS_OVERLAPPEDWINDOW,
-		CW_USEDEFAULT,
-		CW_USEDEFAULT,
-		wrc.right - wrc.left,
-		wrc.bottom - wrc.top,
-		nullptr,
-		nullptr,
-		wc.hInstance,
-		nullptr
-	);
-
-	// ウインドウを表示する
-	ShowWindow(hwnd, SW_SHOW);
+	// 起動処理を依存関係ごとにタスクへ分け、独立したもの同士を並列に進める
+	StartupTaskGraph startup;
+	HRESULT hr = S_OK;
+
+	HWND hwnd = nullptr;
+	StartupTaskGraph::TaskId windowTask = startup.AddTask("Window", [&] {
+		WNDCLASS wc{};
+		// ウインドウプロシージャ
+		wc.lpfnWndProc = WindowProc;
+		// ウインドウクラス名
+		wc.lpszClassName = L"CG2WindowClass";
+		// インスタンスハンドル
+		wc.hInstance = GetModuleHandle(nullptr);
+		//カーソル
+		wc.hCursor = LoadCursor(nullptr, IDC_ARROW);
+
+		// ウインドウクラスを登録する
+		RegisterClass(&wc);
+
+		// ウインドウサイズを表す構造体にクライアント領域を入れる
+		RECT wrc = { 0,0,kWindowWidth,kWindowHeight };
+
+		// クライアント領域を元に実際のサイズにwrcを変更してもらう
+		AdjustWindowRect(&wrc, WS_OVERLAPPEDWINDOW, false);
+
+		// ウインドの生成
+		hwnd = CreateWindow(
+			wc.lpszClassName,
+			L"CG2",
+			WS_OVERLAPPEDWINDOW,
+			CW_USEDEFAULT,
+			CW_USEDEFAULT,
+			wrc.right - wrc.left,
+			wrc.bottom - wrc.top,
+			nullptr,
+			nullptr,
+			wc.hInstance,
+			nullptr
+		);
+
+		// ウインドウを表示する
+		ShowWindow(hwnd, SW_SHOW);
+		return hwnd != nullptr;
+	}, {}, StartupTaskGraph::Affinity::MainThread); // メッセージはウインドウを作ったスレッドに届くのでメインスレッドで作る
 
 #ifdef _DEBUG
 	ID3D12Debug1* debugController = nullptr;
-	if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debugController)))) {
-		// デバッグレイヤーを有効化する
-		debugController->EnableDebugLayer();
-
-		// さらにGPU側出もチェックを行えるようにする
-		debugController->SetEnableGPUBasedValidation(TRUE);
-	}
+#endif // DEBUG
+	StartupTaskGraph::TaskId debugLayerTask = startup.AddTask("DebugLayer", [&] {
+#ifdef _DEBUG
+		if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debugController)))) {
+			// デバッグレイヤーを有効化する
+			debugController->EnableDebugLayer();
 
+			// さらにGPU側出もチェックを行えるようにする
+			debugController->SetEnableGPUBasedValidation(TRUE);
+		}
 #endif // DEBUG
+		return true;
+	});
 
 	/*///////////////////////
 	DXGIファクトリーの生成
 *////////////////////////
 	IDXGIFactory7* dxgiFactory = nullptr;
-	HRESULT hr = CreateDXGIFactory(IID_PPV_ARGS(&dxgiFactory));
-	assert(SUCCEEDED(hr));
+	StartupTaskGraph::TaskId factoryTask = startup.AddTask("DXGIFactory", [&] {
+		HRESULT factoryResult = CreateDXGIFactory(IID_PPV_ARGS(&dxgiFactory));
+		assert(SUCCEEDED(factoryResult));
+		return SUCCEEDED(factoryResult);
+	});
 
 	IDXGIAdapter4* useAdapter = nullptr;
-
-	for (UINT i = 0; dxgiFactory->EnumAdapterByGpuPreference(i, DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE,
-		IID_PPV_ARGS(&useAdapter)) != DXGI_ERROR_NOT_FOUND; ++i) {
-		DXGI_ADAPTER_DESC3 adapterDesc{};
-		hr = useAdapter->GetDesc3(&adapterDesc);
-		assert(SUCCEEDED(hr));
-
-		if (!(adapterDesc.Flags & DXGI_ADAPTER_FLAG3_SOFTWARE)) {
-			Log(std::format(L"Use Adapter:{}\n", adapterDesc.Description));
-			break;
+	StartupTaskGraph::TaskId adapterTask = startup.AddTask("Adapter", [&] {
+		for (UINT i = 0; dxgiFactory->EnumAdapterByGpuPreference(i, DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE,
+			IID_PPV_ARGS(&useAdapter)) != DXGI_ERROR_NOT_FOUND; ++i) {
+			DXGI_ADAPTER_DESC3 adapterDesc{};
+			HRESULT adapterResult = useAdapter->GetDesc3(&adapterDesc);
+			assert(SUCCEEDED(adapterResult));
+
+			if (!(adapterDesc.Flags & DXGI_ADAPTER_FLAG3_SOFTWARE)) {
+				Log(std::format(L"Use Adapter:{}\n", adapterDesc.Description));
+				break;
+			}
+			useAdapter = nullptr;
 		}
-		useAdapter = nullptr;
-	}
-	assert(useAdapter != nullptr);
+		assert(useAdapter != nullptr);
+		return useAdapter != nullptr;
+	}, { factoryTask });
 
 	ID3D12Device* device = nullptr;
 
@@ -155,51 +467,60 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 		D3D_FEATURE_LEVEL_12_2,D3D_FEATURE_LEVEL_12_0
 	};
 	const char* featureLevelStrings[] = { "12.2,","12.1","12.0" };
-
-	for (size_t i = 0; i < _countof(featureLevels); ++i) {
-		hr = D3D12CreateDevice(useAdapter, featureLevels[i], IID_PPV_ARGS(&device));
-
-		if (SUCCEEDED(hr)) {
-			Log(std::format("FeatureLevel : {}\n", featureLevelStrings[i]));
-			break;
+	// デバイスロスト時の再生成で使う
+	D3D_FEATURE_LEVEL deviceFeatureLevel = featureLevels[0];
+
+	// デバッグレイヤーはデバイスより先に有効にしておく必要がある
+	StartupTaskGraph::TaskId deviceTask = startup.AddTask("Device", [&] {
+		for (size_t i = 0; i < _countof(featureLevels); ++i) {
+			HRESULT deviceResult = D3D12CreateDevice(useAdapter, featureLevels[i], IID_PPV_ARGS(&device));
+
+			if (SUCCEEDED(deviceResult)) {
+				Log(std::format("FeatureLevel : {}\n", featureLevelStrings[i]));
+				deviceFeatureLevel = featureLevels[i];
+				break;
+			}
 		}
-	}
-	assert(device != nullptr);
-	Log("Complete create D3D12Device!!!\n");
+		assert(device != nullptr);
+		Log("Complete create D3D12Device!!!\n");
+		return device != nullptr;
+	}, { debugLayerTask, adapterTask });
 
+	startup.AddTask("InfoQueue", [&] {
 #ifdef _DEBUG
-	ID3D12InfoQueue* infoQueue = nullptr;
-
-	if (SUCCEEDED(device->QueryInterface(IID_PPV_ARGS(&infoQueue)))) {
-		// ヤバイエラー時に止まる
-		infoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_CORRUPTION, true);
-		// エラー時に止まる
-		infoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_ERROR, true);
-		// 警告時に止まる
-		//infoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_WARNING, true);
-
-		// 抑制するメッセージのID
-		D3D12_MESSAGE_ID denyIds[] = {
-			// Window11でのDXGIデバックレイヤーとDX12デバックレイヤーの相互作用バグによるエラーメッセージ
-			// https://stackoverflow.com/questions/69805245/directx-12-application-is-crashing-in-window-11
-			D3D12_MESSAGE_ID_RESOURCE_BARRIER_MISMATCHING_COMMAND_LIST_TYPE
-		};
-
-		// 抑制するレベル
-		D3D12_MESSAGE_SEVERITY severities[] = { D3D12_MESSAGE_SEVERITY_INFO };
-		D3D12_INFO_QUEUE_FILTER filter{};
-		filter.DenyList.NumIDs = _countof(denyIds);
-		filter.DenyList.pIDList = denyIds;
-		filter.DenyList.NumSeverities = _countof(severities);
-		filter.DenyList.pSeverityList = severities;
-
-		// 指定したメッセージの表示を抑制する
-		infoQueue->PushStorageFilter(&filter);
-		// 解放
-		infoQueue->Release();
-	}
-
+		ID3D12InfoQueue* infoQueue = nullptr;
+
+		if (SUCCEEDED(device->QueryInterface(IID_PPV_ARGS(&infoQueue)))) {
+			// ヤバイエラー時に止まる
+			infoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_CORRUPTION, true);
+			// エラー時に止まる
+			infoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_ERROR, true);
+			// 警告時に止まる
+			//infoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_WARNING, true);
+
+			// 抑制するメッセージのID
+			D3D12_MESSAGE_ID denyIds[] = {
+				// Window11でのDXGIデバックレイヤーとDX12デバックレイヤーの相互作用バグによるエラーメッセージ
+				// https://stackoverflow.com/questions/69805245/directx-12-application-is-crashing-in-window-11
+				D3D12_MESSAGE_ID_RESOURCE_BARRIER_MISMATCHING_COMMAND_LIST_TYPE
+			};
+
+			// 抑制するレベル
+			D3D12_MESSAGE_SEVERITY severities[] = { D3D12_MESSAGE_SEVERITY_INFO };
+			D3D12_INFO_QUEUE_FILTER filter{};
+			filter.DenyList.NumIDs = _countof(denyIds);
+			filter.DenyList.pIDList = denyIds;
+			filter.DenyList.NumSeverities = _countof(severities);
+			filter.DenyList.pSeverityList = severities;
+
+			// 指定したメッセージの表示を抑制する
+			infoQueue->PushStorageFilter(&filter);
+			// 解放
+			infoQueue->Release();
+		}
 #endif // DEBUG
+		return true;
+	}, { deviceTask });
 
 	/*///////////////////////
 		コマンドキューを生成
@@ -207,19 +528,21 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 
 	ID3D12CommandQueue* commandQueue = nullptr;
 	D3D12_COMMAND_QUEUE_DESC commandQueueDesc{};
-
-	hr = device->CreateCommandQueue(&commandQueueDesc, IID_PPV_ARGS(&commandQueue));
-	// コマンドキューの生成がうまくいかなかったので起動できない
-	assert(SUCCEEDED(hr));
-
 	ID3D12CommandAllocator* commandAllocator = nullptr;
-	hr = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocator));
-	assert(SUCCEEDED(hr));
-
 	ID3D12GraphicsCommandList* commandList = nullptr;
-	hr = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocator, nullptr,
-		IID_PPV_ARGS(&commandList));
-	assert(SUCCEEDED(hr));
+	StartupTaskGraph::TaskId commandQueueTask = startup.AddTask("CommandQueue", [&] {
+		HRESULT queueResult = device->CreateCommandQueue(&commandQueueDesc, IID_PPV_ARGS(&commandQueue));
+		// コマンドキューの生成がうまくいかなかったので起動できない
+		assert(SUCCEEDED(queueResult));
+
+		queueResult = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocator));
+		assert(SUCCEEDED(queueResult));
+
+		queueResult = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocator, nullptr,
+			IID_PPV_ARGS(&commandList));
+		assert(SUCCEEDED(queueResult));
+		return SUCCEEDED(queueResult);
+	}, { deviceTask });
 
 	IDXGISwapChain4* swapChain = nullptr;
 	DXGI_SWAP_CHAIN_DESC1 swapChainDesc{};
@@ -231,72 +554,354 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	swapChainDesc.BufferCount = 2; // ダブルバッファ
 	swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD; // モニタに移したら中身を吐き破棄
 
-	// コマンドキュー、ウィンドウハンドル、設定を渡して生成
-	hr = dxgiFactory->CreateSwapChainForHwnd(commandQueue, hwnd, &swapChainDesc,
-		nullptr, nullptr, reinterpret_cast<IDXGISwapChain1**>(&swapChain));
-	assert(SUCCEEDED(hr));
+	// DXGIはウインドウにメッセージを送るので、スワップチェーンもウインドウと同じスレッドで作る
+	StartupTaskGraph::TaskId swapChainTask = startup.AddTask("SwapChain", [&] {
+		// コマンドキュー、ウィンドウハンドル、設定を渡して生成
+		HRESULT swapChainResult = dxgiFactory->CreateSwapChainForHwnd(commandQueue, hwnd, &swapChainDesc,
+			nullptr, nullptr, reinterpret_cast<IDXGISwapChain1**>(&swapChain));
+		assert(SUCCEEDED(swapChainResult));
+		return SUCCEEDED(swapChainResult);
+	}, { windowTask, factoryTask, commandQueueTask }, StartupTaskGraph::Affinity::MainThread);
 
 	ID3D12DescriptorHeap* rtvDescriptorHeap = nullptr;
 	D3D12_DESCRIPTOR_HEAP_DESC rtvDescriptorHeapDesc{};
 	rtvDescriptorHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV; // レンダーターゲットビュー用
 	rtvDescriptorHeapDesc.NumDescriptors = 2; // ダブルバッファ用に2つ。多くても構わない
-	hr = device->CreateDescriptorHeap(&rtvDescriptorHeapDesc, IID_PPV_ARGS(&rtvDescriptorHeap));
-	// ディスクリプタヒープが作れなかったので起動できない
-	assert(SUCCEEDED(hr));
+	StartupTaskGraph::TaskId rtvHeapTask = startup.AddTask("RTVHeap", [&] {
+		HRESULT heapResult = device->CreateDescriptorHeap(&rtvDescriptorHeapDesc, IID_PPV_ARGS(&rtvDescriptorHeap));
+		// ディスクリプタヒープが作れなかったので起動できない
+		assert(SUCCEEDED(heapResult));
+		return SUCCEEDED(heapResult);
+	}, { deviceTask });
 
 	// SwapChainからResourceを引っ張ってくる
 	ID3D12Resource* swapChainResources[2] = { nullptr };
-	hr = swapChain->GetBuffer(0, IID_PPV_ARGS(&swapChainResources[0]));
-	// うまく取得できなければ起動できない
-	assert(SUCCEEDED(hr));
-	hr = swapChain->GetBuffer(1, IID_PPV_ARGS(&swapChainResources[1]));
-	assert(SUCCEEDED(hr));
 
 	// RTVの設定
 	D3D12_RENDER_TARGET_VIEW_DESC rtvDesc{};
 	rtvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB; // 出力結果をSRGBに変換して書き込む
 	rtvDesc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2D; // 2Dテクスチャとして書き込む
 
-	// ディスクリプタの先端を取得する
-	D3D12_CPU_DESCRIPTOR_HANDLE rtvStartHandle = rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-
 	// RTVを2つ作るのでディスクリプタを2つ用意
 	D3D12_CPU_DESCRIPTOR_HANDLE rtvHandles[2];
 
-	// まず1つ目を作る。1つ目は最初のところに作る。作る場所をこちらで指定する必要がある。
-	rtvHandles[0] = rtvStartHandle;
-	device->CreateRenderTargetView(swapChainResources[0], &rtvDesc, rtvHandles[0]);
+	startup.AddTask("RenderTargetViews", [&] {
+		HRESULT bufferResult = swapChain->GetBuffer(0, IID_PPV_ARGS(&swapChainResources[0]));
+		// うまく取得できなければ起動できない
+		assert(SUCCEEDED(bufferResult));
+		bufferResult = swapChain->GetBuffer(1, IID_PPV_ARGS(&swapChainResources[1]));
+		assert(SUCCEEDED(bufferResult));
+
+		// ディスクリプタの先端を取得する
+		D3D12_CPU_DESCRIPTOR_HANDLE rtvStartHandle = rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
 
-	// 2つ目のディクリプタハンドルを得る
-	rtvHandles[1].ptr = rtvHandles[0].ptr + device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-	// 2つ目を作る
-	device->CreateRenderTargetView(swapChainResources[1], &rtvDesc, rtvHandles[1]);
+		// まず1つ目を作る。1つ目は最初のところに作る。作る場所をこちらで指定する必要がある。
+		rtvHandles[0] = rtvStartHandle;
+		device->CreateRenderTargetView(swapChainResources[0], &rtvDesc, rtvHandles[0]);
+
+		// 2つ目のディクリプタハンドルを得る
+		rtvHandles[1].ptr = rtvHandles[0].ptr + device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+		// 2つ目を作る
+		device->CreateRenderTargetView(swapChainResources[1], &rtvDesc, rtvHandles[1]);
+		return SUCCEEDED(bufferResult);
+	}, { swapChainTask, rtvHeapTask });
 
 
 	// 初期値0でFenceを作る
 	ID3D12Fence* fence = nullptr;
 	uint64_t fenceValue = 0;
+	HANDLE fenceEvent = nullptr;
+
+	startup.AddTask("Fence", [&] {
+		HRESULT fenceResult = device->CreateFence(fenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence));
+		assert(SUCCEEDED(fenceResult));
+
+		// FenceのSignalを持つためのイベントを作成する
+		fenceEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+		assert(fenceEvent != nullptr);
+		return SUCCEEDED(fenceResult) && fenceEvent != nullptr;
+	}, { deviceTask });
+
+	// シェーダーのコンパイルはデバイスと関係なく進められるので最初から別スレッドで始めておく
+	StartupTaskGraph::TaskId shaderWarmUpTask = startup.AddTask("ShaderWarmUp", [] {
+		bool succeeded = WarmUpShader(L"Upscale.hlsl", "VSMain", "vs_5_1");
+		succeeded = WarmUpShader(L"Upscale.hlsl", "PSMain", "ps_5_1") && succeeded;
+		succeeded = WarmUpShader(L"InstanceCulling.hlsl", "main", "cs_5_0") && succeeded;
+		for (const char* entryPoint : { "CSInitialize", "CSEmit", "CSSimulate", "CSFinalize" }) {
+			succeeded = WarmUpShader(L"Particles.hlsl", entryPoint, "cs_5_0") && succeeded;
+		}
+		succeeded = WarmUpShader(L"Particles.hlsl", "VSMain", "vs_5_0") && succeeded;
+		succeeded = WarmUpShader(L"Particles.hlsl", "PSMain", "ps_5_0") && succeeded;
+		succeeded = WarmUpShader(L"Sprite.hlsl", "VSMain", "vs_5_1") && succeeded;
+		succeeded = WarmUpShader(L"Sprite.hlsl", "PSMain", "ps_5_1") && succeeded;
+		return succeeded;
+	});
+
+	// GPU時間の計測
+	GpuTimer gpuTimer;
+	startup.AddTask("GpuTimer", [&] {
+		gpuTimer.Initialize(device, commandQueue);
+		return true;
+	}, { commandQueueTask });
+
+	// シェーダーから見えるディスクリプタはすべてこのヒープに置く
+	BindlessHeap bindlessHeap;
+	StartupTaskGraph::TaskId bindlessHeapTask = startup.AddTask("BindlessHeap", [&] {
+		bindlessHeap.Initialize(device);
+		return true;
+	}, { deviceTask });
+
+	// 動的解像度。シーンは内部解像度で描き、最後にバックバッファへ拡大する
+	UpscalePass upscalePass;
+	startup.AddTask("UpscalePipeline", [&] {
+		// パイプラインの生成はスワップチェーンの生成と並行して進める
+		upscalePass.Initialize(device, &bindlessHeap, kWindowWidth, kWindowHeight);
+		return true;
+	}, { deviceTask, bindlessHeapTask, shaderWarmUpTask });
+
+	// パーティクル。シミュレーションは専用のコンピュートキューで行う
+	const uint32_t kParticleCapacity = 1 << 18;
+	GpuParticles gpuParticles;
+	startup.AddTask("Particles", [&] {
+		gpuParticles.Initialize(device, kParticleCapacity);
+		return true;
+	}, { deviceTask, shaderWarmUpTask });
+
+	// スプライト。画像はデバイスを待たずにアトラスへ詰めておく
+	const uint32_t kSpriteImageCount = 48;
+	const uint32_t kSpriteAtlasSize = 512;
+	const uint32_t kMaxSpriteCount = 1 << 16;
+	std::vector<TextureImage> spriteAtlasPages;
+	std::vector<AtlasRect> spriteAtlasRects;
+	StartupTaskGraph::TaskId spriteAtlasTask = startup.AddTask("SpriteAtlas", [&] {
+		return TextureAtlas::Build(MakeSpriteImages(kSpriteImageCount), kSpriteAtlasSize, 2, spriteAtlasPages, spriteAtlasRects);
+	});
+	SpriteRenderer spriteRenderer;
+	std::vector<BindlessHandle> spriteAtlasHandles;
+	startup.AddTask("Sprites", [&] {
+		spriteRenderer.Initialize(device, &bindlessHeap, kMaxSpriteCount);
+		for (const TextureImage& page : spriteAtlasPages) {
+			spriteAtlasHandles.push_back(spriteRenderer.CreateTexture(device, page));
+		}
+		return true;
+	}, { deviceTask, bindlessHeapTask, shaderWarmUpTask, spriteAtlasTask });
+
+	// クラスタードライティング。ライトの割り当てはCPUで行い、結果をStructuredBufferでシェーダーへ渡す
+	const uint32_t kClusterLightCount = 1024;
+	const uint32_t kMaxClusterLightIndexCount = 1 << 18;
+	ClusterGridDesc clusterGridDesc;
+	clusterGridDesc.nearZ = 0.1f;
+	clusterGridDesc.farZ = 100.0f;
+	clusterGridDesc.fovY = 0.8f;
+	clusterGridDesc.aspectRatio = static_cast<float>(kWindowWidth) / static_cast<float>(kWindowHeight);
+	ClusteredLighting clusteredLighting;
+	ClusteredLightingBuffers clusteredLightingBuffers;
+	startup.AddTask("ClusteredLighting", [&] {
+		clusteredLighting.Initialize(clusterGridDesc);
+		clusteredLightingBuffers.Initialize(device, &bindlessHeap, clusteredLighting.GetClusterCount(), kClusterLightCount, kMaxClusterLightIndexCount);
+		return true;
+	}, { deviceTask, bindlessHeapTask });
+
+	uint32_t startupWorkerCount = std::min<uint32_t>(std::max<uint32_t>(std::thread::hardware_concurrency(), 2) - 1, 4);
+	bool startupSucceeded = startup.Run(startupWorkerCount);
+	Log(startup.FormatTimeline());
+	assert(startupSucceeded);
+	if (!startupSucceeded) {
+		return -1;
+	}
 
-	hr = device->CreateFence(fenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence));
-	assert(SUCCEEDED(hr));
-
-	// FenceのSignalを持つためのイベントを作成する
-	HANDLE fenceEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
-	assert(fenceEvent != nullptr);
-
+	// リサイズ・デバイスロスト時に作り直せるよう、作成時の設定ごと渡しておく
+	D3D12RecoverableDevice recoverableDevice({
+		hwnd, dxgiFactory, useAdapter, device, commandQueue, commandAllocator, commandList,
+		swapChain, rtvDescriptorHeap, swapChainResources, rtvHandles, fence, fenceValue, fenceEvent,
+		deviceFeatureLevel, commandQueueDesc, swapChainDesc, rtvDescriptorHeapDesc, rtvDesc });
+	graphicsRecovery.Initialize(&recoverableDevice, swapChainDesc.Width, swapChainDesc.Height);
+	GraphicsRecovery::Statistics recoveryStatistics = graphicsRecovery.GetStatistics();
+
+	DynamicResolution dynamicResolution;
+	dynamicResolution.Initialize(DynamicResolution::Config(), swapChainDesc.Width, swapChainDesc.Height);
+
+	// フレーム内だけで使う一時データ用のアロケータ
+	FrameAllocator frameAllocator(4 * 1024 * 1024, "Frame");
+
+
+	// 入力は専用スレッドで受け取り、固定更新ごとにまとめて取り込む
+	InputQueue inputQueue;
+	InputThread inputThread;
+	inputThread.Start(hwnd, &inputQueue);
+	InputState inputState;
+	const uint64_t kFixedUpdateNanoseconds = 1000000000ull / 60;
+	// 処理落ちしたときに追いつこうとして更新し続けないよう、1フレームあたりの回数に上限を設ける
+	const uint32_t kMaxFixedUpdatesPerFrame = 4;
+	uint64_t nextFixedUpdateTime = InputQueue::GetTimestamp() + kFixedUpdateNanoseconds;
+
+	// 原点から噴き上がるエミッター
+	ParticleEmitter particleEmitter{};
+	particleEmitter.positionSpread = 0.1f;
+	particleEmitter.velocity[1] = 6.0f;
+	particleEmitter.velocitySpread = 2.5f;
+	particleEmitter.gravity[1] = -6.0f;
+	particleEmitter.drag = 0.2f;
+	particleEmitter.lifetimeMin = 1.5f;
+	particleEmitter.lifetimeMax = 3.0f;
+	particleEmitter.emitRate = 80000.0f;
+	particleEmitter.size = 0.03f;
+	const float kCameraPosition[3] = { 0.0f, 3.0f, -12.0f };
+	const float kCameraRight[3] = { 1.0f, 0.0f, 0.0f };
+	const float kCameraUp[3] = { 0.0f, 1.0f, 0.0f };
+	uint64_t lastFrameTime = InputQueue::GetTimestamp();
+
+	// カメラのまわりを回る点光源。毎フレームクラスターへ割り当て直す
+	std::vector<ClusterLight> clusterLights(kClusterLightCount);
+	for (uint32_t i = 0; i < kClusterLightCount; ++i) {
+		ClusterLight& light = clusterLights[i];
+		light.radius = 1.5f + static_cast<float>(i % 5);
+		light.color[0] = 0.5f + 0.5f * static_cast<float>((i * 53) % 97) / 96.0f;
+		light.color[1] = 0.5f + 0.5f * static_cast<float>((i * 29) % 89) / 88.0f;
+		light.color[2] = 0.5f + 0.5f * static_cast<float>((i * 71) % 83) / 82.0f;
+		light.intensity = 2.0f;
+	}
+	ClusteredLightingBuffers::Constants clusterConstants{};
+	float lightTime = 0.0f;
+
+	// 画面上を回るスプライト。奥と手前の2レイヤーに分ける
+	const uint32_t kSpriteCount = 4096;
+	SpriteBatch spriteBatch;
+	float spriteTime = 0.0f;
+
+	// シェーダーの読み直し。コンパイルとパイプラインの生成は専用スレッドで行い、メインスレッドは差し替えるだけにする
+	HotReload hotReload;
+	if (!hotReload.Initialize(".")) {
+		Log("HotReload : file watching is not available\n");
+	}
+	hotReload.Register("UpscalePipeline", { "Upscale.hlsl" }, MakePipelineReload(upscalePass, device, L"Upscale.hlsl"));
+	hotReload.Register("SpritePipeline", { "Sprite.hlsl" }, MakePipelineReload(spriteRenderer, device, L"Sprite.hlsl"));
+	HotReload::Statistics hotReloadStatistics = hotReload.GetStatistics();
 
 	/*System::Initialize(kWindowTitle, 1280, 720);*/
 
 	MSG msg{};
 	// ウインドウのxボタンが押されるまでループ
 	while (msg.message != WM_QUIT) {
-		//Windowにメッセージが来てたら最優先で処理させる
-		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+		//Windowにメッセージが来てたら溜まっている分をすべて処理してから描画する
+		while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+			if (msg.message == WM_QUIT) {
+				break;
+			}
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
-		} else {
+		}
+		if (msg.message != WM_QUIT) {
 			// ゲームの処理
 
+			// 固定更新。各更新ではその更新の終わりの時刻までに起きた入力だけを取り込む
+			uint64_t now = InputQueue::GetTimestamp();
+			for (uint32_t i = 0; i < kMaxFixedUpdatesPerFrame && nextFixedUpdateTime <= now; ++i) {
+				inputState.BeginUpdate();
+				inputQueue.Drain(nextFixedUpdateTime, inputState);
+				nextFixedUpdateTime += kFixedUpdateNanoseconds;
+			}
+			if (nextFixedUpdateTime <= now) {
+				// 追いつけなかった分は捨てる
+				nextFixedUpdateTime = now + kFixedUpdateNanoseconds;
+			}
+
+			// このフレームの一時的な確保(ログの文字列など)はフレームアロケータから行う
+			frameAllocator.BeginFrame();
+
+			// デバイスを作り直す間は読み直しを止める(作り直し用スレッドが古いデバイスを使わないように)
+			if (graphicsRecovery.GetState() == GraphicsRecovery::State::DeviceLost) {
+				hotReload.Suspend();
+			}
+
+			// 溜まっているリサイズ・デバイスロストを処理する。描画できない間はフレームを飛ばす
+			if (!graphicsRecovery.BeginFrame()) {
+				if (graphicsRecovery.GetState() == GraphicsRecovery::State::Failed) {
+					Log("Failed to recreate D3D12Device\n");
+					DestroyWindow(hwnd);
+				}
+				continue;
+			}
+			const GraphicsRecovery::Statistics& statistics = graphicsRecovery.GetStatistics();
+			if (statistics.resizeCount != recoveryStatistics.resizeCount) {
+				LogFrame(frameAllocator, "Resize {}x{} : {:.3f}ms\n", graphicsRecovery.GetWidth(), graphicsRecovery.GetHeight(), statistics.lastResizeMilliseconds);
+				upscalePass.Resize(device, graphicsRecovery.GetWidth(), graphicsRecovery.GetHeight());
+				dynamicResolution.SetOutputSize(graphicsRecovery.GetWidth(), graphicsRecovery.GetHeight());
+				// クラスターの形は縦横比で変わる
+				clusterGridDesc.aspectRatio = static_cast<float>(graphicsRecovery.GetWidth()) / static_cast<float>(graphicsRecovery.GetHeight());
+				// タイル数は固定なのでバッファは作り直さない。数が変わるとクラスターごとの範囲バッファをはみ出す
+				uint32_t clusterCount = clusteredLighting.GetClusterCount();
+				clusteredLighting.Initialize(clusterGridDesc);
+				assert(clusteredLighting.GetClusterCount() == clusterCount);
+				(void)clusterCount;
+			}
+			if (statistics.recreateCount != recoveryStatistics.recreateCount) {
+				LogFrame(frameAllocator, "Recreate D3D12Device : {:.3f}ms\n", statistics.lastRecreateMilliseconds);
+				// 新しいデバイスでGPUリソースを作り直す
+				gpuTimer.Finalize();
+				gpuTimer.Initialize(device, commandQueue);
+				upscalePass.Finalize();
+				spriteRenderer.Finalize();
+				clusteredLightingBuffers.Finalize();
+				bindlessHeap.Finalize();
+				bindlessHeap.Initialize(device);
+				clusteredLightingBuffers.Initialize(device, &bindlessHeap, clusteredLighting.GetClusterCount(), kClusterLightCount, kMaxClusterLightIndexCount);
+				upscalePass.Initialize(device, &bindlessHeap, graphicsRecovery.GetWidth(), graphicsRecovery.GetHeight());
+				gpuParticles.Finalize();
+				gpuParticles.Initialize(device, kParticleCapacity);
+				// アトラスのページはCPU側に残してあるので上げ直すだけでよい
+				spriteRenderer.Initialize(device, &bindlessHeap, kMaxSpriteCount);
+				spriteAtlasHandles.clear();
+				for (const TextureImage& page : spriteAtlasPages) {
+					spriteAtlasHandles.push_back(spriteRenderer.CreateTexture(device, page));
+				}
+				dynamicResolution.SetOutputSize(graphicsRecovery.GetWidth(), graphicsRecovery.GetHeight());
+				// 差し替え前のパイプラインは古いデバイスのものなので、GPUが止まっている今まとめて解放する
+				hotReload.ReleaseRetired();
+				hotReload.Resume();
+			}
+			recoveryStatistics = statistics;
+
+			// GPUが終えたフレームで解放したディスクリプタを再利用に回す
+			bindlessHeap.BeginFrame(fenceValue + 1, fence->GetCompletedValue());
+			// 読み直したパイプラインへの差し替えもフレームの境目で行う
+			hotReload.BeginFrame(fenceValue + 1, fence->GetCompletedValue());
+			HotReload::Statistics currentHotReloadStatistics = hotReload.GetStatistics();
+			if (currentHotReloadStatistics.swapCount != hotReloadStatistics.swapCount ||
+				currentHotReloadStatistics.failureCount != hotReloadStatistics.failureCount) {
+				LogFrame(frameAllocator, "HotReload : {} swaps, {} failures, rebuild {:.3f}ms, swap {:.3f}us\n",
+					currentHotReloadStatistics.swapCount, currentHotReloadStatistics.failureCount,
+					currentHotReloadStatistics.lastRebuildMilliseconds, currentHotReloadStatistics.lastBeginFrameMicroseconds);
+			}
+			hotReloadStatistics = currentHotReloadStatistics;
+
+			// 前フレームのGPU時間から今フレームの描画解像度を決める
+			dynamicResolution.Update(gpuTimer.GetMilliseconds());
+
+			// パーティクルのシミュレーションを先にコンピュートキューへ流しておく(前フレームの描画は完了済み)
+			// 飛ばしたフレームの分まで一度に進めないよう経過時間に上限を設ける
+			float frameDeltaSeconds = std::min(static_cast<float>(now - lastFrameTime) * 1.0e-9f, 0.1f);
+			lastFrameTime = now;
+			gpuParticles.Simulate(particleEmitter, frameDeltaSeconds);
+
+			// ライトを動かして割り当て、今フレームのバッファへ書き込む(ライティングのパスはclusterConstantsをルート定数で受け取る)
+			lightTime += frameDeltaSeconds;
+			for (uint32_t i = 0; i < kClusterLightCount; ++i) {
+				const float radius = 2.0f + static_cast<float>(i % 37) * 1.2f;
+				const float angle = static_cast<float>(i) * 2.3999632f + lightTime * (0.1f + static_cast<float>(i % 11) * 0.02f);
+				clusterLights[i].position[0] = std::cos(angle) * radius;
+				clusterLights[i].position[1] = static_cast<float>(i % 7);
+				clusterLights[i].position[2] = std::sin(angle) * radius + 20.0f;
+			}
+			const float lightView[4][4] = {
+				{ 1.0f, 0.0f, 0.0f, 0.0f },
+				{ 0.0f, 1.0f, 0.0f, 0.0f },
+				{ 0.0f, 0.0f, 1.0f, 0.0f },
+				{ -kCameraPosition[0], -kCameraPosition[1], -kCameraPosition[2], 1.0f },
+			};
+			clusteredLighting.Build(lightView, clusterLights.data(), kClusterLightCount);
+			clusterConstants = clusteredLightingBuffers.Upload(clusteredLighting, clusterLights.data(), kClusterLightCount);
+
 			typedef struct D3D12_CPU_DESCROPTOR_HANDLE {
 				SIZE_T ptr;
 			} D3D12_CPU_DESCRIPTOR_HANDLE;
@@ -304,6 +909,8 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 
 			UINT backBufferIndex = swapChain->GetCurrentBackBufferIndex();
 
+			gpuTimer.Begin(commandList);
+
 			// TransitionBarrierの設定
 			D3D12_RESOURCE_BARRIER barrier{};
 
@@ -326,12 +933,44 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 			commandList->ResourceBarrier(1, &barrier);
 
 
-			// 描画先のRTVを設定する
-			commandList->OMSetRenderTargets(1, &rtvHandles[backBufferIndex], false, nullptr);
+			// 描画先を内部解像度のレンダーターゲットにする
+			auto sceneRtvHandle = upscalePass.BeginScene(commandList, dynamicResolution.GetRenderWidth(), dynamicResolution.GetRenderHeight());
 
 			// 指定した色で画面全体をクリアする
 			float clearColor[] = { 0.1f,0.25f,0.5f,1.0f }; // 
-			commandList->ClearRenderTargetView(rtvHandles[backBufferIndex], clearColor, 0, nullptr);
+			commandList->ClearRenderTargetView(sceneRtvHandle, clearColor, 0, nullptr);
+
+			// パーティクルの描画。個数はGPUが書いた描画引数で決まる
+			float viewProjection[4][4];
+			MakeViewProjection(kCameraPosition, 0.8f,
+				static_cast<float>(graphicsRecovery.GetWidth()) / static_cast<float>(graphicsRecovery.GetHeight()), 0.1f, 100.0f, viewProjection);
+			gpuParticles.Draw(commandList, viewProjection, kCameraRight, kCameraUp);
+
+			// 内部解像度で描いた結果をバックバッファへ拡大する
+			upscalePass.Execute(commandList, rtvHandles[backBufferIndex], graphicsRecovery.GetWidth(), graphicsRecovery.GetHeight());
+
+			// スプライトはバックバッファへ出力解像度のまま重ねる。描画はレイヤーごとに1回
+			spriteTime += frameDeltaSeconds;
+			spriteBatch.Begin();
+			const float screenCenter[2] = { static_cast<float>(graphicsRecovery.GetWidth()) * 0.5f, static_cast<float>(graphicsRecovery.GetHeight()) * 0.5f };
+			for (uint32_t i = 0; i < kSpriteCount; ++i) {
+				const uint32_t imageIndex = i % kSpriteImageCount;
+				const AtlasRect& rect = spriteAtlasRects[imageIndex];
+				const float radius = 40.0f + static_cast<float>(i % 97) * 4.0f;
+				const float angle = static_cast<float>(i) * 0.61803f * 6.2831853f + spriteTime * (0.2f + static_cast<float>(i % 7) * 0.05f);
+				Sprite sprite{};
+				sprite.position[0] = screenCenter[0] + std::cos(angle) * radius;
+				sprite.position[1] = screenCenter[1] + std::sin(angle) * radius * 0.6f;
+				sprite.size[0] = static_cast<float>(rect.width) * 0.5f;
+				sprite.size[1] = static_cast<float>(rect.height) * 0.5f;
+				TextureAtlas::GetUvRect(rect, kSpriteAtlasSize, kSpriteAtlasSize, sprite.uvMin, sprite.uvMax);
+				sprite.rotation = angle;
+				sprite.color = 0xc0ffffff;
+				sprite.textureIndex = spriteAtlasHandles[rect.page].GetIndex();
+				sprite.layer = static_cast<uint16_t>(i & 1);
+				spriteBatch.Draw(sprite);
+			}
+			spriteRenderer.Render(commandList, spriteBatch, graphicsRecovery.GetWidth(), graphicsRecovery.GetHeight());
 
 
 			// 画面に描く処理はすべて終わり、画面に移すので状態を遷移
@@ -341,6 +980,7 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 			// TransitionBarrierを張る
 			commandList->ResourceBarrier(1, &barrier);
 
+			gpuTimer.End(commandList);
 
 			// コマンドリストの内容を確定させる。
 			hr = commandList->Close();
@@ -348,11 +988,23 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 
 
 
+			// パーティクルのシミュレーションが終わってから描画を始める
+			gpuParticles.WaitForSimulation(commandQueue);
 			ID3D12CommandList* commandLists[] = { commandList };
 			commandQueue->ExecuteCommandLists(1, commandLists);
+			// 投入したコマンドでデバイスが削除された場合はPresentの結果を待たずに作り直しへ回す
+			if (ToDeviceResult(device->GetDeviceRemovedReason()) != DeviceResult::Ok) {
+				graphicsRecovery.NotifyDeviceLost();
+				continue;
+			}
 
 			// GPUとOSに画面の交換を行うよう通知する
-			swapChain->Present(1, 0);
+			hr = swapChain->Present(1, 0);
+			if (ToDeviceResult(hr) == DeviceResult::DeviceLost) {
+				// デバイスが失われたので次のフレームの先頭で作り直す
+				graphicsRecovery.NotifyDeviceLost();
+				continue;
+			}
 
 			// Fenceの値を更新
 			fenceValue++;
@@ -367,6 +1019,14 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 				// イベントを待つ
 				WaitForSingleObject(fenceEvent, INFINITE);
 			}
+			// 実行中に削除されたデバイスのフェンスは完了扱いになるので、待ち終わった後にも確かめる
+			if (ToDeviceResult(device->GetDeviceRemovedReason()) != DeviceResult::Ok) {
+				graphicsRecovery.NotifyDeviceLost();
+				continue;
+			}
+
+			// GPUの処理が終わったので計測結果を読み戻す
+			gpuTimer.Resolve();
 
 
 			// 次のフレーム用のコマンドリストを準備
@@ -377,17 +1037,24 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 		}
 	}
 
+	// GPUの処理が終わるのを待ってから解放する
+	if (fence != nullptr) {
+		recoverableDevice.WaitForInFlightFrames();
+	}
+	inputThread.Stop();
+	hotReload.Finalize();
 	CloseHandle(fenceEvent);
-	fence->Release();
-	rtvDescriptorHeap->Release();
-	swapChainResources[0]->Release();
-	swapChainResources[1]->Release();
-	swapChain->Release();
-	commandList->Release();
-	commandAllocator->Release();
-	commandQueue->Release();
-	device->Release();
-	useAdapter->Release();
+	for (const MemoryTracker::Snapshot& snapshot : MemoryTracker::GetInstance()->GetSnapshots()) {
+		Log(std::format("Memory {} : {} allocations, peak {} bytes, {} overflows\n", snapshot.name, snapshot.allocationCount, snapshot.peakBytes, snapshot.overflowCount));
+	}
+	upscalePass.Finalize();
+	gpuParticles.Finalize();
+	spriteRenderer.Finalize();
+	clusteredLightingBuffers.Finalize();
+	bindlessHeap.Finalize();
+	gpuTimer.Finalize();
+	ClearShaderCache();
+	recoverableDevice.ReleaseDeviceObjects();
 	dxgiFactory->Release();
 #ifdef _DEBUG
 	debugController->Release();